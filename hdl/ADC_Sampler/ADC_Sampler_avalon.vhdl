@@ -0,0 +1,438 @@
+----------------------------------------------------------------------------
+-- Description:  ADC sampler avalon support - Scans the LTC2308 at a
+--               programmable rate and queues timestamped samples in a FIFO
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.1
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.math_real.all;
+use ieee.numeric_std.all;
+
+entity ADC_Sampler_avalon is
+	generic (
+		CLK_PERIOD		: time := 20 ns;
+		FIFO_DEPTH		: integer := 512
+	);
+	port (
+		clk				: in	std_ulogic;
+		rst				: in	std_ulogic;
+
+		-- avalon memory-mapped slave interface
+		avs_read			: in	std_logic;
+		avs_write		: in	std_logic;
+		avs_address		: in	std_logic_vector(4 downto 0);
+		avs_readdata	: out	std_logic_vector(31 downto 0);
+		avs_writedata	: in	std_logic_vector(31 downto 0);
+
+		-- interrupt sender; level, high while any enabled irq_status bit is set
+		irq				: out	std_logic;
+
+		-- LTC2308 pins; export to top-level
+		adc_convst		: out	std_logic;
+		adc_sck			: out	std_logic;
+		adc_sdi			: out	std_logic;
+		adc_sdo			: in	std_logic
+	);
+end entity ADC_Sampler_avalon;
+
+architecture ADC_Sampler_avalon_arch of ADC_Sampler_avalon is
+	constant system_clock_frequency : integer := 1 sec / CLK_PERIOD; -- 50,000,000 for 20ns
+	constant clocks_per_us : integer := system_clock_frequency / 1000000;
+
+	-- Latest value of each channel
+	type latest_array is array (0 to 7) of std_logic_vector(11 downto 0);
+	signal latest : latest_array := (others => (others => '0'));
+
+	-- ctrl_reg: bit 0 enables scanning, bit 1 enables the FIFO, bits 15:8 are
+	-- the channel mask. rate_reg is the number of clocks between scans.
+	signal ctrl_reg: std_ulogic_vector(31 downto 0) 		:= (others => '0');
+	signal rate_reg: std_ulogic_vector(31 downto 0) 		:= std_ulogic_vector(to_unsigned(50000, 32)); -- 1 kHz
+	signal scan_enable : std_logic;
+	signal fifo_enable : std_logic;
+	signal mask : std_logic_vector(7 downto 0);
+
+	-- Free-running microsecond counter; timestamps samples and is readable
+	signal time_us : unsigned(31 downto 0) := (others => '0');
+	signal us_prescale : integer range 0 to clocks_per_us - 1 := 0;
+
+	-- Scan sequencing
+	signal scan_counter : unsigned(31 downto 0) := (others => '0');
+	signal frames_left : integer range 0 to 9 := 0;
+	-- channel the conversion in the next frame will use
+	signal conv_ch : unsigned(2 downto 0) := (others => '0');
+	-- channel the frame in progress is converting
+	signal frame_ch : unsigned(2 downto 0) := (others => '0');
+	-- set when conv_ch isn't known to be loaded into the ADC, so the next
+	-- frame's result has to be thrown away
+	signal discard : std_logic := '1';
+	signal frame_discard : std_logic := '1';
+	signal spi_start : std_logic := '0';
+	signal spi_busy : std_logic;
+	signal spi_done : std_logic;
+	signal spi_result : std_logic_vector(11 downto 0);
+	signal next_ch : unsigned(2 downto 0);
+
+	-- Sample FIFO. Each word is [31:16] timestamp in us, [15] valid,
+	-- [14:12] channel, [11:0] value.
+	type fifo_array is array (0 to FIFO_DEPTH - 1) of std_logic_vector(31 downto 0);
+	signal fifo : fifo_array;
+	signal fifo_rd : integer range 0 to FIFO_DEPTH - 1 := 0;
+	signal fifo_wr : integer range 0 to FIFO_DEPTH - 1 := 0;
+	signal fifo_level : integer range 0 to FIFO_DEPTH := 0;
+	signal fifo_push : std_logic := '0';
+	signal fifo_pop : std_logic;
+	signal fifo_din : std_logic_vector(31 downto 0) := (others => '0');
+	-- Set when a sample was dropped because the FIFO was full; write 1 to clear
+	signal overflow : std_ulogic := '0';
+
+	signal status_reg : std_ulogic_vector(31 downto 0);
+
+	-- Last sample taken, for the threshold checks; sample_valid is high for
+	-- one clock when a new one is here
+	signal sample_valid : std_logic := '0';
+	signal sample_ch : unsigned(2 downto 0) := (others => '0');
+	signal sample_value : unsigned(11 downto 0) := (others => '0');
+
+	-- Per-channel thresholds; a sample above high or below low is outside
+	-- the channel's window
+	type threshold_array is array (0 to 7) of unsigned(11 downto 0);
+	signal low_threshold : threshold_array := (others => (others => '0'));
+	signal high_threshold : threshold_array := (others => (others => '1'));
+
+	-- irq_status: bit n latches a high-threshold crossing on channel n,
+	-- bit (n + 8) a low-threshold crossing, and bit 16 is high while the
+	-- FIFO level is at or above watermark_reg. irq_enable has the same
+	-- layout. The crossing bits are write-1-to-clear; the watermark bit
+	-- clears itself once the FIFO is drained.
+	signal alarm_status : std_ulogic_vector(15 downto 0) := (others => '0');
+	-- Channels whose last sample was outside their window, laid out like
+	-- alarm_status; a channel has to come back inside before it can raise
+	-- another alarm
+	signal outside : std_ulogic_vector(15 downto 0) := (others => '0');
+	signal watermark : std_ulogic;
+	signal irq_status_reg : std_ulogic_vector(31 downto 0);
+	signal irq_enable_reg : std_ulogic_vector(31 downto 0) := (others => '0');
+	signal watermark_reg : std_ulogic_vector(31 downto 0) := std_ulogic_vector(to_unsigned(FIFO_DEPTH / 2, 32));
+
+	-- Next channel after ch in mask, wrapping around
+	function next_in_mask(ch : unsigned(2 downto 0); m : std_logic_vector(7 downto 0)) return unsigned is
+		variable c : unsigned(2 downto 0) := ch;
+	begin
+		for i in 1 to 8 loop
+			c := ch + to_unsigned(i mod 8, 3);
+			if (m(to_integer(c)) = '1') then
+				return c;
+			end if;
+		end loop;
+		return ch;
+	end function;
+
+	-- Lowest channel in mask
+	function first_in_mask(m : std_logic_vector(7 downto 0)) return unsigned is
+	begin
+		for i in 0 to 7 loop
+			if (m(i) = '1') then
+				return to_unsigned(i, 3);
+			end if;
+		end loop;
+		return to_unsigned(0, 3);
+	end function;
+
+	-- Number of channels in mask
+	function count_mask(m : std_logic_vector(7 downto 0)) return integer is
+		variable n : integer range 0 to 8 := 0;
+	begin
+		for i in 0 to 7 loop
+			if (m(i) = '1') then
+				n := n + 1;
+			end if;
+		end loop;
+		return n;
+	end function;
+
+	component LTC2308_SPI is
+		port (
+			clk			: in	std_logic;
+			rst			: in	std_logic;
+			start			: in	std_logic;
+			next_ch		: in	unsigned(2 downto 0);
+			busy			: out	std_logic;
+			done			: out	std_logic;
+			result		: out	std_logic_vector(11 downto 0);
+			adc_convst	: out	std_logic;
+			adc_sck		: out	std_logic;
+			adc_sdi		: out	std_logic;
+			adc_sdo		: in	std_logic
+		);
+	end component LTC2308_SPI;
+
+begin
+
+	scan_enable <= ctrl_reg(0);
+	fifo_enable <= ctrl_reg(1);
+	mask <= std_logic_vector(ctrl_reg(15 downto 8));
+
+	SPI : LTC2308_SPI
+	port map (
+		clk => clk,
+		rst => rst,
+		start => spi_start,
+		next_ch => next_ch,
+		busy => spi_busy,
+		done => spi_done,
+		result => spi_result,
+		adc_convst => adc_convst,
+		adc_sck => adc_sck,
+		adc_sdi => adc_sdi,
+		adc_sdo => adc_sdo
+	);
+
+	-- A discarded frame only exists to load the scan's first channel
+	next_ch <= first_in_mask(mask) when discard = '1' else next_in_mask(conv_ch, mask);
+
+	-- Counts microseconds for the sample timestamps
+	timebase : process(clk, rst)
+	begin
+		if (rst = '1') then
+			time_us <= (others => '0');
+			us_prescale <= 0;
+		elsif (rising_edge(clk)) then
+			if (us_prescale = clocks_per_us - 1) then
+				us_prescale <= 0;
+				time_us <= time_us + 1;
+			else
+				us_prescale <= us_prescale + 1;
+			end if;
+		end if;
+	end process timebase;
+
+	-- Starts a scan every rate_reg clocks and runs one frame per channel in
+	-- the mask. If the ADC isn't already set up for the scan's first channel
+	-- (after reset or a mask change), one extra frame is run first and its
+	-- result is thrown away. A scan that's due while the last one is still
+	-- running is skipped.
+	sequencer : process(clk, rst)
+	begin
+		if (rst = '1') then
+			scan_counter <= (others => '0');
+			frames_left <= 0;
+			conv_ch <= (others => '0');
+			frame_ch <= (others => '0');
+			discard <= '1';
+			frame_discard <= '1';
+			spi_start <= '0';
+			fifo_push <= '0';
+			fifo_din <= (others => '0');
+			sample_valid <= '0';
+			sample_ch <= (others => '0');
+			sample_value <= (others => '0');
+			latest <= (others => (others => '0'));
+		elsif (rising_edge(clk)) then
+			spi_start <= '0';
+			fifo_push <= '0';
+			sample_valid <= '0';
+
+			if (scan_enable = '0' or unsigned(mask) = 0) then
+				scan_counter <= (others => '0');
+				frames_left <= 0;
+			elsif (scan_counter = 0) then
+				scan_counter <= unsigned(rate_reg) - 1;
+				if (frames_left = 0) then
+					if (discard = '0' and conv_ch = first_in_mask(mask)) then
+						frames_left <= count_mask(mask);
+					else
+						discard <= '1';
+						frames_left <= count_mask(mask) + 1;
+					end if;
+				end if;
+			else
+				scan_counter <= scan_counter - 1;
+			end if;
+
+			if (frames_left > 0 and spi_busy = '0' and spi_start = '0') then
+				spi_start <= '1';
+				frame_ch <= conv_ch;
+				frame_discard <= discard;
+				conv_ch <= next_ch;
+				discard <= '0';
+				frames_left <= frames_left - 1;
+			end if;
+
+			if (spi_done = '1' and frame_discard = '0') then
+				latest(to_integer(frame_ch)) <= spi_result;
+				fifo_din <= std_logic_vector(time_us(15 downto 0)) & '1' & std_logic_vector(frame_ch) & spi_result;
+				fifo_push <= fifo_enable;
+				sample_valid <= '1';
+				sample_ch <= frame_ch;
+				sample_value <= unsigned(spi_result);
+			end if;
+		end if;
+	end process sequencer;
+
+	-- Reading the data register pops the FIFO
+	fifo_pop <= '1' when (avs_read = '1' and avs_address = "01011" and fifo_level > 0) else '0';
+
+	-- FIFO memory; written here and read in avalon_register_read so it can
+	-- be inferred as block RAM
+	fifo_ram : process(clk)
+	begin
+		if (rising_edge(clk)) then
+			if (fifo_push = '1' and fifo_level < FIFO_DEPTH) then
+				fifo(fifo_wr) <= fifo_din;
+			end if;
+		end if;
+	end process fifo_ram;
+
+	fifo_pointers : process(clk, rst)
+		variable push : boolean;
+		variable pop : boolean;
+	begin
+		if (rst = '1') then
+			fifo_rd <= 0;
+			fifo_wr <= 0;
+			fifo_level <= 0;
+			overflow <= '0';
+		elsif (rising_edge(clk)) then
+			push := fifo_push = '1' and fifo_level < FIFO_DEPTH;
+			pop := fifo_pop = '1';
+
+			if (fifo_push = '1' and fifo_level = FIFO_DEPTH) then
+				overflow <= '1';
+			end if;
+			if (push) then
+				fifo_wr <= (fifo_wr + 1) mod FIFO_DEPTH;
+			end if;
+			if (pop) then
+				fifo_rd <= (fifo_rd + 1) mod FIFO_DEPTH;
+			end if;
+			if (push and not pop) then
+				fifo_level <= fifo_level + 1;
+			elsif (pop and not push) then
+				fifo_level <= fifo_level - 1;
+			end if;
+
+			if (avs_write = '1' and avs_address = "01010") then
+				if (avs_writedata(31) = '1') then
+					overflow <= '0';
+				end if;
+				-- Flush
+				if (avs_writedata(30) = '1') then
+					fifo_rd <= 0;
+					fifo_wr <= 0;
+					fifo_level <= 0;
+				end if;
+			end if;
+		end if;
+	end process fifo_pointers;
+
+	-- FIFO level in bits 15:0, overflow in bit 31
+	status_reg(15 downto 0) <= std_ulogic_vector(to_unsigned(fifo_level, 16));
+	status_reg(30 downto 16) <= (others => '0');
+	status_reg(31) <= overflow;
+
+	-- Checks every sample, whether or not it goes into the FIFO, against its
+	-- channel's threshold window and latches crossings into alarm_status.
+	-- Writing a 1 to an irq_status bit clears it; a crossing in the same
+	-- clock wins.
+	alarms : process(clk, rst)
+		variable ch : integer range 0 to 7;
+	begin
+		if (rst = '1') then
+			alarm_status <= (others => '0');
+			outside <= (others => '0');
+		elsif (rising_edge(clk)) then
+			if (avs_write = '1' and avs_address = "01110") then
+				alarm_status <= alarm_status and not std_ulogic_vector(avs_writedata(15 downto 0));
+			end if;
+
+			if (sample_valid = '1') then
+				ch := to_integer(sample_ch);
+				outside(ch) <= '0';
+				outside(ch + 8) <= '0';
+				if (sample_value > high_threshold(ch)) then
+					outside(ch) <= '1';
+					if (outside(ch) = '0') then
+						alarm_status(ch) <= '1';
+					end if;
+				elsif (sample_value < low_threshold(ch)) then
+					outside(ch + 8) <= '1';
+					if (outside(ch + 8) = '0') then
+						alarm_status(ch + 8) <= '1';
+					end if;
+				end if;
+			end if;
+		end if;
+	end process alarms;
+
+	-- A watermark of 0 would always be set, so it's treated as off
+	watermark <= '1' when unsigned(watermark_reg) /= 0 and to_unsigned(fifo_level, 32) >= unsigned(watermark_reg) else '0';
+
+	irq_status_reg(15 downto 0) <= alarm_status;
+	irq_status_reg(16) <= watermark;
+	irq_status_reg(31 downto 17) <= (others => '0');
+
+	irq <= '1' when (irq_status_reg and irq_enable_reg) /= (31 downto 0 => '0') else '0';
+
+	-- Checks if read was sent, if so, checks register and reads out data.
+	-- Reading an empty FIFO returns 0, which has the valid bit clear.
+	avalon_register_read : process(clk)
+	begin
+		if (rising_edge(clk) and avs_read = '1') then
+			case avs_address is
+				when "00000" | "00001" | "00010" | "00011" | "00100" | "00101" | "00110" | "00111" =>
+					avs_readdata <= std_logic_vector(resize(unsigned(latest(to_integer(unsigned(avs_address(2 downto 0))))), 32));
+				when "01000" => avs_readdata <= std_logic_vector(ctrl_reg);
+				when "01001" => avs_readdata <= std_logic_vector(rate_reg);
+				when "01010" => avs_readdata <= std_logic_vector(status_reg);
+				when "01011" =>
+					if (fifo_level > 0) then
+						avs_readdata <= fifo(fifo_rd);
+					else
+						avs_readdata <= (others => '0');
+					end if;
+				when "01100" => avs_readdata <= std_logic_vector(time_us);
+				when "01101" => avs_readdata <= std_logic_vector(irq_enable_reg);
+				when "01110" => avs_readdata <= std_logic_vector(irq_status_reg);
+				when "01111" => avs_readdata <= std_logic_vector(watermark_reg);
+				when "10000" | "10001" | "10010" | "10011" | "10100" | "10101" | "10110" | "10111" =>
+					avs_readdata <= "0000" & std_logic_vector(high_threshold(to_integer(unsigned(avs_address(2 downto 0)))))
+						& "0000" & std_logic_vector(low_threshold(to_integer(unsigned(avs_address(2 downto 0)))));
+				when others => avs_readdata <= (others => '0');
+			end case;
+		end if;
+	end process avalon_register_read;
+
+	-- Checks if write was sent, if so checks address and writes to appropriate register
+	avalon_register_write : process(clk, rst)
+	begin
+		if (rst = '1') then
+			ctrl_reg <= (others => '0');
+			rate_reg <= std_ulogic_vector(to_unsigned(50000, 32));
+			irq_enable_reg <= (others => '0');
+			watermark_reg <= std_ulogic_vector(to_unsigned(FIFO_DEPTH / 2, 32));
+			low_threshold <= (others => (others => '0'));
+			high_threshold <= (others => (others => '1'));
+		elsif (rising_edge(clk) and avs_write = '1') then
+			case avs_address is
+				when "01000" => ctrl_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+				when "01001" =>
+					-- A scan needs at least one clock
+					if (unsigned(avs_writedata) /= 0) then
+						rate_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					end if;
+				when "01101" => irq_enable_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+				when "01111" => watermark_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+				when "10000" | "10001" | "10010" | "10011" | "10100" | "10101" | "10110" | "10111" =>
+					low_threshold(to_integer(unsigned(avs_address(2 downto 0)))) <= unsigned(avs_writedata(11 downto 0));
+					high_threshold(to_integer(unsigned(avs_address(2 downto 0)))) <= unsigned(avs_writedata(27 downto 16));
+				when others => null;
+			end case;
+		end if;
+	end process;
+
+end architecture ADC_Sampler_avalon_arch;
@@ -0,0 +1,156 @@
+# TCL File Generated by Component Editor 23.1
+# Wed Dec 11 14:29:05 MST 2024
+# DO NOT MODIFY
+
+
+# 
+# ADC_Sampler_avalon "ADC_Sampler_avalon" v1.0
+# Grant Kirkland 2024.12.11.14:29:05
+# 
+# 
+
+# 
+# request TCL package from ACDS 16.1
+# 
+package require -exact qsys 16.1
+
+
+# 
+# module ADC_Sampler_avalon
+# 
+set_module_property DESCRIPTION ""
+set_module_property NAME ADC_Sampler_avalon
+set_module_property VERSION 1.0
+set_module_property INTERNAL false
+set_module_property OPAQUE_ADDRESS_MAP true
+set_module_property AUTHOR "Grant Kirkland"
+set_module_property DISPLAY_NAME ADC_Sampler_avalon
+set_module_property INSTANTIATE_IN_SYSTEM_MODULE true
+set_module_property EDITABLE true
+set_module_property REPORT_TO_TALKBACK false
+set_module_property ALLOW_GREYBOX_GENERATION false
+set_module_property REPORT_HIERARCHY false
+
+
+# 
+# file sets
+# 
+add_fileset QUARTUS_SYNTH QUARTUS_SYNTH "" ""
+set_fileset_property QUARTUS_SYNTH TOP_LEVEL ADC_Sampler_avalon
+set_fileset_property QUARTUS_SYNTH ENABLE_RELATIVE_INCLUDE_PATHS false
+set_fileset_property QUARTUS_SYNTH ENABLE_FILE_OVERWRITE_MODE false
+add_fileset_file ADC_Sampler_avalon.vhdl VHDL PATH ../../hdl/ADC_Sampler/ADC_Sampler_avalon.vhdl TOP_LEVEL_FILE
+add_fileset_file LTC2308_SPI.vhdl VHDL PATH ../../hdl/ADC_Sampler/LTC2308_SPI.vhdl
+
+
+# 
+# parameters
+# 
+
+
+# 
+# display items
+# 
+
+
+# 
+# connection point avalon_slave_0
+# 
+add_interface avalon_slave_0 avalon end
+set_interface_property avalon_slave_0 addressUnits WORDS
+set_interface_property avalon_slave_0 associatedClock clk
+set_interface_property avalon_slave_0 associatedReset rst
+set_interface_property avalon_slave_0 bitsPerSymbol 8
+set_interface_property avalon_slave_0 burstOnBurstBoundariesOnly false
+set_interface_property avalon_slave_0 burstcountUnits WORDS
+set_interface_property avalon_slave_0 explicitAddressSpan 0
+set_interface_property avalon_slave_0 holdTime 0
+set_interface_property avalon_slave_0 linewrapBursts false
+set_interface_property avalon_slave_0 maximumPendingReadTransactions 0
+set_interface_property avalon_slave_0 maximumPendingWriteTransactions 0
+set_interface_property avalon_slave_0 readLatency 1
+set_interface_property avalon_slave_0 readWaitTime 0
+set_interface_property avalon_slave_0 setupTime 0
+set_interface_property avalon_slave_0 timingUnits Cycles
+set_interface_property avalon_slave_0 writeWaitTime 0
+set_interface_property avalon_slave_0 ENABLED true
+set_interface_property avalon_slave_0 EXPORT_OF ""
+set_interface_property avalon_slave_0 PORT_NAME_MAP ""
+set_interface_property avalon_slave_0 CMSIS_SVD_VARIABLES ""
+set_interface_property avalon_slave_0 SVD_ADDRESS_GROUP ""
+
+add_interface_port avalon_slave_0 avs_read read Input 1
+add_interface_port avalon_slave_0 avs_write write Input 1
+add_interface_port avalon_slave_0 avs_address address Input 5
+add_interface_port avalon_slave_0 avs_readdata readdata Output 32
+add_interface_port avalon_slave_0 avs_writedata writedata Input 32
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isFlash 0
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isMemoryDevice 0
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isNonVolatileStorage 0
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isPrintableDevice 0
+
+
+# 
+# connection point clk
+# 
+add_interface clk clock end
+set_interface_property clk clockRate 0
+set_interface_property clk ENABLED true
+set_interface_property clk EXPORT_OF ""
+set_interface_property clk PORT_NAME_MAP ""
+set_interface_property clk CMSIS_SVD_VARIABLES ""
+set_interface_property clk SVD_ADDRESS_GROUP ""
+
+add_interface_port clk clk clk Input 1
+
+
+# 
+# connection point rst
+# 
+add_interface rst reset end
+set_interface_property rst associatedClock clk
+set_interface_property rst synchronousEdges DEASSERT
+set_interface_property rst ENABLED true
+set_interface_property rst EXPORT_OF ""
+set_interface_property rst PORT_NAME_MAP ""
+set_interface_property rst CMSIS_SVD_VARIABLES ""
+set_interface_property rst SVD_ADDRESS_GROUP ""
+
+add_interface_port rst rst reset Input 1
+
+
+# 
+# connection point irq
+# 
+add_interface irq interrupt end
+set_interface_property irq associatedAddressablePoint avalon_slave_0
+set_interface_property irq associatedClock clk
+set_interface_property irq associatedReset rst
+set_interface_property irq bridgedReceiverOffset ""
+set_interface_property irq bridgesToReceiver ""
+set_interface_property irq ENABLED true
+set_interface_property irq EXPORT_OF ""
+set_interface_property irq PORT_NAME_MAP ""
+set_interface_property irq CMSIS_SVD_VARIABLES ""
+set_interface_property irq SVD_ADDRESS_GROUP ""
+
+add_interface_port irq irq irq Output 1
+
+
+# 
+# connection point conduit_end
+# 
+add_interface conduit_end conduit end
+set_interface_property conduit_end associatedClock clk
+set_interface_property conduit_end associatedReset ""
+set_interface_property conduit_end ENABLED true
+set_interface_property conduit_end EXPORT_OF ""
+set_interface_property conduit_end PORT_NAME_MAP ""
+set_interface_property conduit_end CMSIS_SVD_VARIABLES ""
+set_interface_property conduit_end SVD_ADDRESS_GROUP ""
+
+add_interface_port conduit_end adc_convst convst Output 1
+add_interface_port conduit_end adc_sck sck Output 1
+add_interface_port conduit_end adc_sdi sdi Output 1
+add_interface_port conduit_end adc_sdo sdo Input 1
+
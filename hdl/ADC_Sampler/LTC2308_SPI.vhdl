@@ -0,0 +1,132 @@
+----------------------------------------------------------------------------
+-- Description:  LTC2308 SPI engine - Runs one conversion/data transfer frame
+--               of the DE10 Nano's LTC2308 ADC at a time
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- The LTC2308 is pipelined by one frame: the 6-bit input word that picks the
+-- channel is shifted in during a frame's data transfer and applies to the
+-- *next* conversion, while SDO shifts out the result of the conversion that
+-- frame just did. Whoever drives this engine has to remember which channel
+-- each frame is converting.
+entity LTC2308_SPI is
+	generic (
+		-- SCK half period in clocks; 2 gives a 12.5 MHz SCK from 50 MHz
+		SCK_HALF			: integer := 2;
+		-- tCONV (1.6 us max) in clocks
+		CONV_CLOCKS		: integer := 80;
+		-- CONVST high time in clocks; at least tWHCONV (20 ns)
+		CONVST_CLOCKS	: integer := 3
+	);
+	port (
+		clk			: in	std_logic;
+		rst			: in	std_logic;
+		-- starts a frame; ignored while busy
+		start			: in	std_logic;
+		-- single-ended channel the conversion in the next frame should use
+		next_ch		: in	unsigned(2 downto 0);
+		busy			: out	std_logic;
+		-- high for one clock when result holds the frame's conversion
+		done			: out	std_logic;
+		result		: out	std_logic_vector(11 downto 0);
+		-- LTC2308 pins
+		adc_convst	: out	std_logic;
+		adc_sck		: out	std_logic;
+		adc_sdi		: out	std_logic;
+		adc_sdo		: in	std_logic
+	);
+end entity LTC2308_SPI;
+
+architecture LTC2308_SPI_arch of LTC2308_SPI is
+	type state_type is (IDLE, CONVST, CONVERT, SHIFT);
+	signal state : state_type := IDLE;
+
+	signal counter : integer range 0 to CONV_CLOCKS := 0;
+	signal bit_count : integer range 0 to 12 := 0;
+	signal sck : std_logic := '0';
+	signal din : std_logic_vector(11 downto 0) := (others => '0');
+	signal dout : std_logic_vector(11 downto 0) := (others => '0');
+
+begin
+
+	-- Steps through CONVST pulse -> conversion time -> 12-bit transfer. SDI is
+	-- changed while SCK is low and both lines are sampled on the rising edge.
+	frame : process(clk, rst)
+	begin
+		if (rst = '1') then
+			state <= IDLE;
+			counter <= 0;
+			bit_count <= 0;
+			sck <= '0';
+			din <= (others => '0');
+			dout <= (others => '0');
+			adc_convst <= '0';
+			done <= '0';
+		elsif (rising_edge(clk)) then
+			done <= '0';
+
+			case state is
+				when IDLE =>
+					if (start = '1') then
+						-- Single-ended, unipolar, no sleep: S/D O/S S1 S0 UNI SLP
+						din <= '1' & next_ch(0) & next_ch(2) & next_ch(1) & '1' & '0' & "000000";
+						adc_convst <= '1';
+						counter <= CONVST_CLOCKS - 1;
+						state <= CONVST;
+					end if;
+
+				when CONVST =>
+					if (counter = 0) then
+						adc_convst <= '0';
+						counter <= CONV_CLOCKS - 1;
+						state <= CONVERT;
+					else
+						counter <= counter - 1;
+					end if;
+
+				when CONVERT =>
+					if (counter = 0) then
+						counter <= SCK_HALF - 1;
+						bit_count <= 12;
+						state <= SHIFT;
+					else
+						counter <= counter - 1;
+					end if;
+
+				when SHIFT =>
+					if (counter /= 0) then
+						counter <= counter - 1;
+					elsif (sck = '0') then
+						-- Rising edge: sample SDO
+						sck <= '1';
+						dout <= dout(10 downto 0) & adc_sdo;
+						counter <= SCK_HALF - 1;
+					else
+						-- Falling edge: move on to the next SDI bit
+						sck <= '0';
+						din <= din(10 downto 0) & '0';
+						counter <= SCK_HALF - 1;
+						if (bit_count = 1) then
+							done <= '1';
+							state <= IDLE;
+						end if;
+						bit_count <= bit_count - 1;
+					end if;
+			end case;
+		end if;
+	end process frame;
+
+	busy <= '0' when state = IDLE else '1';
+	result <= dout;
+	adc_sck <= sck;
+	adc_sdi <= din(11);
+
+end architecture;
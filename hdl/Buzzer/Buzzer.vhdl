@@ -32,25 +32,42 @@ architecture Buzzer_arch of Buzzer is
 	signal PWM_output : std_ulogic := '0';
 	signal high_counter : integer := 0;
 	signal period_counter : integer := 0;
+
+	-- Terminal count pipeline, so the counters reload from a register rather
+	-- than from the end of a multiplier: the registered period, then the
+	-- period in clocks before the shift and whether it's silence
+	signal period_in : unsigned(W_PERIOD - 1 downto 0) := (others => '0');
+	signal period_product : unsigned(31 + W_PERIOD downto 0) := (others => '0');
+	signal silent : std_ulogic := '1';
 	
 begin
 
+	-- Multiplies out the next period two clocks ahead of the period boundary that loads it
+	terminal_counts : process(clk)
+	begin
+		if (rising_edge(clk)) then
+			period_in <= period;
+			period_product <= to_unsigned(system_clock_frequency, 32) * period_in;
+			if (period_in = 0) then
+				silent <= '1';
+			else
+				silent <= '0';
+			end if;
+		end if;
+	end process terminal_counts;
+
 	-- Repeatedly cycles through the period and high counters, outputting 1 while high is counting down, and 0 after high is finished and period is still counting
+	-- Reset leaves period_counter at 0, so the first clock after reset loads the counters; reset has to last two clocks for terminal_counts to be ready
 	modulator : process(clk, rst)
 	begin
 		if (rst = '1') then
 			PWM_output <= '1';
-			if (period = 0) then
-				period_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * 8, 12)) - 1;
-				high_counter <= 0;
-			else 
-				period_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 12)) - 1;
-				high_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 13)) - 1;
-			end if;
+			period_counter <= 0;
+			high_counter <= 0;
 		elsif (rising_edge(clk) and period_counter = 0) then
-			if (period > 0) then
-				period_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 12)) - 1;
-				high_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 13)) - 1;
+			if (silent = '0') then
+				period_counter <= to_integer(shift_right(period_product, 12)) - 1;
+				high_counter <= to_integer(shift_right(period_product, 13)) - 1;
 				PWM_output <= '1';
 			else 
 				period_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * 8, 12)) - 1;
@@ -35,6 +35,31 @@ architecture Buzzer_avalon_arch of Buzzer_avalon is
 	signal period_width : integer := 13;
 	
 	signal period_reg: std_ulogic_vector(31 downto 0) 		:= "00000000000000000000000010000000";
+
+	-- Note sequencer FIFO. Each entry is a period and how many clocks to play
+	-- it for; while entries are playing they drive the buzzer instead of
+	-- period_reg.
+	constant NOTE_FIFO_DEPTH : integer := 32;
+	type period_array is array (0 to NOTE_FIFO_DEPTH - 1) of std_ulogic_vector(period_width - 1 downto 0);
+	type duration_array is array (0 to NOTE_FIFO_DEPTH - 1) of unsigned(31 downto 0);
+	signal fifo_period : period_array;
+	signal fifo_duration : duration_array;
+	signal fifo_rd : integer range 0 to NOTE_FIFO_DEPTH - 1 := 0;
+	signal fifo_wr : integer range 0 to NOTE_FIFO_DEPTH - 1 := 0;
+	signal fifo_level : integer range 0 to NOTE_FIFO_DEPTH := 0;
+
+	-- Duration that goes with the next period pushed into the FIFO
+	signal duration_reg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+
+	-- Note being played and the clocks left in it
+	signal note_period : std_ulogic_vector(period_width - 1 downto 0) := (others => '0');
+	signal note_clocks : unsigned(31 downto 0) := (others => '0');
+	signal playing : std_ulogic := '0';
+	-- Set when a note ends with nothing queued behind it; write 1 to clear
+	signal underrun : std_ulogic := '0';
+
+	signal buzzer_period : std_ulogic_vector(period_width - 1 downto 0);
+	signal status_reg : std_ulogic_vector(31 downto 0);
 		
 	component Buzzer is
 		generic (
@@ -55,9 +80,18 @@ begin
 	port map (
 		clk => clk,
 		rst => rst,
-		period => unsigned(period_reg(period_width - 1 downto 0)),
+		period => unsigned(buzzer_period),
 		output => GPIO
 	);
+
+	buzzer_period <= note_period when playing = '1' else period_reg(period_width - 1 downto 0);
+
+	-- FIFO level in bits 5:0, playing in bit 8, underrun in bit 9
+	status_reg(5 downto 0) <= std_ulogic_vector(to_unsigned(fifo_level, 6));
+	status_reg(7 downto 6) <= (others => '0');
+	status_reg(8) <= playing;
+	status_reg(9) <= underrun;
+	status_reg(31 downto 10) <= (others => '0');
 	
 	-- Checks if read was flagged, if so, checks register and reads out data
 	avalon_register_read : process(clk)
@@ -65,21 +99,81 @@ begin
 		if (rising_edge(clk) and avs_read = '1') then
 			case avs_address is 
 				when "00" => avs_readdata <= std_logic_vector(period_reg);
+				when "01" => avs_readdata <= std_logic_vector(duration_reg);
+				when "10" => avs_readdata <= std_logic_vector(resize(unsigned(note_period), 32));
+				when "11" => avs_readdata <= std_logic_vector(status_reg);
 				when others => avs_readdata <= (others => '0');
 			end case;
 		end if;
 	end process avalon_register_read;
 
-	-- Checks if write was flagged, if so checks address and writes to appropriate register
+	-- Checks if write was flagged, if so checks address and writes to appropriate register.
+	-- Writing "10" pushes a note made of the written period and duration_reg;
+	-- pushes into a full FIFO are dropped. The sequencer pops the next note
+	-- as soon as the current one runs out of clocks, so back-to-back notes
+	-- have no gap between them.
 	avalon_register_write : process(clk, rst)
+		variable push : boolean;
+		variable pop : boolean;
 	begin
 		if (rst = '1') then
 			period_reg <= "00000000000000000000000010000000";
-		elsif (rising_edge(clk) and avs_write = '1') then
-			case avs_address is 
-				when "00" => period_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
-				when others => null;
-			end case;
+			duration_reg <= (others => '0');
+			fifo_rd <= 0;
+			fifo_wr <= 0;
+			fifo_level <= 0;
+			note_period <= (others => '0');
+			note_clocks <= (others => '0');
+			playing <= '0';
+			underrun <= '0';
+		elsif (rising_edge(clk)) then
+			push := avs_write = '1' and avs_address = "10" and fifo_level < NOTE_FIFO_DEPTH;
+			pop := fifo_level > 0 and (playing = '0' or note_clocks <= 1);
+
+			if (push) then
+				fifo_period(fifo_wr) <= std_ulogic_vector(avs_writedata(period_width - 1 downto 0));
+				fifo_duration(fifo_wr) <= unsigned(duration_reg);
+				fifo_wr <= (fifo_wr + 1) mod NOTE_FIFO_DEPTH;
+			end if;
+
+			if (pop) then
+				note_period <= fifo_period(fifo_rd);
+				note_clocks <= fifo_duration(fifo_rd);
+				playing <= '1';
+				fifo_rd <= (fifo_rd + 1) mod NOTE_FIFO_DEPTH;
+			elsif (playing = '1') then
+				if (note_clocks <= 1) then
+					playing <= '0';
+					underrun <= '1';
+				else
+					note_clocks <= note_clocks - 1;
+				end if;
+			end if;
+
+			if (push and not pop) then
+				fifo_level <= fifo_level + 1;
+			elsif (pop and not push) then
+				fifo_level <= fifo_level - 1;
+			end if;
+
+			if (avs_write = '1') then
+				case avs_address is 
+					when "00" => period_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "01" => duration_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "11" =>
+						if (avs_writedata(9) = '1') then
+							underrun <= '0';
+						end if;
+						-- Flush: drop the queue and stop the current note
+						if (avs_writedata(10) = '1') then
+							fifo_rd <= 0;
+							fifo_wr <= 0;
+							fifo_level <= 0;
+							playing <= '0';
+						end if;
+					when others => null;
+				end case;
+			end if;
 		end if;
 	end process;
 
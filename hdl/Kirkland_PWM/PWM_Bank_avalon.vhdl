@@ -0,0 +1,246 @@
+----------------------------------------------------------------------------
+-- Description:  PWM bank avalon support - N PWM channels behind one
+--               register window, with the periods shared per group
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity PWM_Bank_avalon is
+	generic (
+		CLK_PERIOD		: time := 20 ns;
+		-- Number of PWM outputs, 1 to 64
+		N_CHANNELS		: integer range 1 to 64 := 16;
+		-- The channels are split into N_GROUPS runs of consecutive channels
+		-- that share a period register; 1 gives every channel the same
+		-- period and N_CHANNELS gives every channel its own
+		N_GROUPS			: integer range 1 to 64 := 1
+	);
+	port (
+		clk				: in	std_ulogic;
+		rst				: in	std_ulogic;
+
+		-- avalon memory-mapped slave interface
+		avs_read			: in	std_logic;
+		avs_write		: in	std_logic;
+		avs_address		: in	std_logic_vector(7 downto 0);
+		avs_readdata	: out	std_logic_vector(31 downto 0);
+		avs_writedata	: in	std_logic_vector(31 downto 0);
+
+		-- external I/O; export to top-level
+		GPIO				: out	std_logic_vector(N_CHANNELS - 1 downto 0)
+	);
+end entity PWM_Bank_avalon;
+
+architecture PWM_Bank_avalon_arch of PWM_Bank_avalon is
+	constant duty_cycle_width : integer := 22; -- 22.21
+	constant period_width : integer := 13; -- 13.7
+
+	-- 1 s (1 Hz) in 1/128 s units, like the RGB controller
+	constant period_default : unsigned(period_width - 1 downto 0) := to_unsigned(16#80#, period_width);
+
+	-- Register blocks, selected by avs_address(7 downto 6); the low six bits
+	-- are the channel or group number
+	constant BLOCK_CTRL : std_logic_vector(1 downto 0) := "00";
+	constant BLOCK_PERIOD : std_logic_vector(1 downto 0) := "01";
+	constant BLOCK_DUTY : std_logic_vector(1 downto 0) := "10";
+	constant BLOCK_STEP : std_logic_vector(1 downto 0) := "11";
+
+	-- Group a channel's period comes from
+	function group_of(ch : integer) return integer is
+	begin
+		return ch * N_GROUPS / N_CHANNELS;
+	end function;
+
+	-- First channel of a group; its period_start stands in for the group's
+	function first_of(g : integer) return integer is
+	begin
+		return (g * N_CHANNELS + N_GROUPS - 1) / N_GROUPS;
+	end function;
+
+	type period_array is array (0 to N_GROUPS - 1) of unsigned(period_width - 1 downto 0);
+	type duty_array is array (0 to N_CHANNELS - 1) of unsigned(duty_cycle_width - 1 downto 0);
+
+	-- Shadow registers; bus writes land here. Only the bits the controllers
+	-- use are stored, so a 64-channel bank stays small, and the rest read 0.
+	signal period_reg : period_array := (others => period_default);
+	signal dc_reg : duty_array := (others => (others => '0'));
+	signal step_reg : duty_array := (others => (others => '0'));
+
+	-- Copies of the shadow registers taken when the commit register is
+	-- written. Groups apply these rather than the shadow registers, so shadow
+	-- writes after a commit can't sneak into a group that hasn't applied it.
+	signal period_stg : period_array := (others => period_default);
+	signal dc_stg : duty_array := (others => (others => '0'));
+	signal step_stg : duty_array := (others => (others => '0'));
+
+	-- Active copies that drive the PWM controllers. A commit's staged copy
+	-- goes here at each group's next period boundary, so the channels of a
+	-- group always switch together.
+	signal period_act : period_array := (others => period_default);
+	signal dc_act : duty_array := (others => (others => '0'));
+	signal step_act : duty_array := (others => (others => '0'));
+
+	-- Bit g is set by a commit and cleared once group g has applied it
+	signal commit_pending : std_ulogic_vector(N_GROUPS - 1 downto 0) := (others => '0');
+	signal period_start : std_logic_vector(N_CHANNELS - 1 downto 0);
+	signal ramping : std_logic_vector(N_CHANNELS - 1 downto 0);
+	-- ramping padded out to the two status registers
+	signal ramping_status : std_logic_vector(63 downto 0);
+
+	signal info_reg : std_logic_vector(31 downto 0);
+
+	component PWM_Controller is
+		generic (
+			CLK_PERIOD		: time := 20 ns;
+			W_DUTY_CYCLE	: integer := 22; -- 22.21;
+			W_PERIOD			: integer := 13  -- 13.7
+		);
+		port (
+			clk			: in	std_logic;
+			rst			: in	std_logic;
+			period		: in	unsigned(W_PERIOD - 1 downto 0);
+			duty_cycle	: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
+			step			: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
+			dither		: in	std_logic := '0';
+			output		: out	std_logic := '0';
+			period_start	: out	std_logic;
+			ramping		: out	std_logic
+		);
+	end component PWM_Controller;
+
+begin
+
+	assert N_GROUPS <= N_CHANNELS
+		report "PWM_Bank_avalon: N_GROUPS can't be more than N_CHANNELS"
+		severity failure;
+
+	channels : for ch in 0 to N_CHANNELS - 1 generate
+		PWM : PWM_Controller
+		generic map (
+			CLK_PERIOD => CLK_PERIOD,
+			W_DUTY_CYCLE => duty_cycle_width,
+			W_PERIOD => period_width
+		)
+		port map (
+			clk => clk,
+			rst => rst,
+			period => period_act(group_of(ch)),
+			duty_cycle => dc_act(ch),
+			step => step_act(ch),
+			output => GPIO(ch),
+			period_start => period_start(ch),
+			ramping => ramping(ch)
+		);
+	end generate channels;
+
+	ramping_status <= std_logic_vector(resize(unsigned(ramping), 64));
+
+	-- [7:0] number of channels, [15:8] number of groups, so a driver can size
+	-- itself from the hardware
+	info_reg <= x"0000" & std_logic_vector(to_unsigned(N_GROUPS, 8)) & std_logic_vector(to_unsigned(N_CHANNELS, 8));
+
+	-- Checks if read was sent, if so, checks register and reads out data
+	avalon_register_read : process(clk)
+		variable index : integer range 0 to 63;
+	begin
+		if (rising_edge(clk) and avs_read = '1') then
+			index := to_integer(unsigned(avs_address(5 downto 0)));
+			avs_readdata <= (others => '0');
+			case avs_address(7 downto 6) is
+				when BLOCK_CTRL =>
+					case index is
+						when 0 => avs_readdata <= info_reg;
+						when 1 =>
+							if (commit_pending /= (commit_pending'range => '0')) then
+								avs_readdata(0) <= '1';
+							end if;
+						when 2 => avs_readdata <= ramping_status(31 downto 0);
+						when 3 => avs_readdata <= ramping_status(63 downto 32);
+						when others => null;
+					end case;
+				when BLOCK_PERIOD =>
+					if (index < N_GROUPS) then
+						avs_readdata <= std_logic_vector(resize(period_reg(index), 32));
+					end if;
+				when BLOCK_DUTY =>
+					if (index < N_CHANNELS) then
+						avs_readdata <= std_logic_vector(resize(dc_reg(index), 32));
+					end if;
+				when others =>
+					if (index < N_CHANNELS) then
+						avs_readdata <= std_logic_vector(resize(step_reg(index), 32));
+					end if;
+			end case;
+		end if;
+	end process avalon_register_read;
+
+	-- Checks if write was sent, if so checks address and writes to appropriate register.
+	-- A commit stages a copy of the shadow registers and marks every group
+	-- pending. Each group then copies its part of the staged set to the
+	-- active registers on the clock where its controllers sample them, so a
+	-- group's channels switch together at the start of one of its PWM
+	-- periods. Groups with different periods apply the same commit at their
+	-- own boundaries.
+	avalon_register_write : process(clk, rst)
+		variable index : integer range 0 to 63;
+	begin
+		if (rst = '1') then
+			period_reg <= (others => period_default);
+			dc_reg <= (others => (others => '0'));
+			step_reg <= (others => (others => '0'));
+			period_stg <= (others => period_default);
+			dc_stg <= (others => (others => '0'));
+			step_stg <= (others => (others => '0'));
+			period_act <= (others => period_default);
+			dc_act <= (others => (others => '0'));
+			step_act <= (others => (others => '0'));
+			commit_pending <= (others => '0');
+		elsif (rising_edge(clk)) then
+			for ch in 0 to N_CHANNELS - 1 loop
+				if (commit_pending(group_of(ch)) = '1' and period_start(ch) = '1') then
+					dc_act(ch) <= dc_stg(ch);
+					step_act(ch) <= step_stg(ch);
+				end if;
+			end loop;
+			for g in 0 to N_GROUPS - 1 loop
+				if (commit_pending(g) = '1' and period_start(first_of(g)) = '1') then
+					period_act(g) <= period_stg(g);
+					commit_pending(g) <= '0';
+				end if;
+			end loop;
+
+			if (avs_write = '1') then
+				index := to_integer(unsigned(avs_address(5 downto 0)));
+				case avs_address(7 downto 6) is
+					when BLOCK_CTRL =>
+						if (index = 1 and avs_writedata(0) = '1') then
+							period_stg <= period_reg;
+							dc_stg <= dc_reg;
+							step_stg <= step_reg;
+							commit_pending <= (others => '1');
+						end if;
+					when BLOCK_PERIOD =>
+						if (index < N_GROUPS) then
+							period_reg(index) <= unsigned(avs_writedata(period_width - 1 downto 0));
+						end if;
+					when BLOCK_DUTY =>
+						if (index < N_CHANNELS) then
+							dc_reg(index) <= unsigned(avs_writedata(duty_cycle_width - 1 downto 0));
+						end if;
+					when others =>
+						if (index < N_CHANNELS) then
+							step_reg(index) <= unsigned(avs_writedata(duty_cycle_width - 1 downto 0));
+						end if;
+				end case;
+			end if;
+		end if;
+	end process;
+
+end architecture PWM_Bank_avalon_arch;
@@ -0,0 +1,149 @@
+# TCL File Generated by Component Editor 23.1
+# Thu Dec 12 10:12:03 MST 2024
+# DO NOT MODIFY
+
+
+# 
+# Kirkland_PWM_Bank_avalon "Kirkland_PWM_Bank_avalon" v1.0
+# Grant Kirkland 2024.12.12.10:12:03
+# 
+# 
+
+# 
+# request TCL package from ACDS 16.1
+# 
+package require -exact qsys 16.1
+
+
+# 
+# module Kirkland_PWM_Bank_avalon
+# 
+set_module_property DESCRIPTION ""
+set_module_property NAME Kirkland_PWM_Bank_avalon
+set_module_property VERSION 1.0
+set_module_property INTERNAL false
+set_module_property OPAQUE_ADDRESS_MAP true
+set_module_property AUTHOR "Grant Kirkland"
+set_module_property DISPLAY_NAME Kirkland_PWM_Bank_avalon
+set_module_property INSTANTIATE_IN_SYSTEM_MODULE true
+set_module_property EDITABLE true
+set_module_property REPORT_TO_TALKBACK false
+set_module_property ALLOW_GREYBOX_GENERATION false
+set_module_property REPORT_HIERARCHY false
+
+
+# 
+# file sets
+# 
+add_fileset QUARTUS_SYNTH QUARTUS_SYNTH "" ""
+set_fileset_property QUARTUS_SYNTH TOP_LEVEL PWM_Bank_avalon
+set_fileset_property QUARTUS_SYNTH ENABLE_RELATIVE_INCLUDE_PATHS false
+set_fileset_property QUARTUS_SYNTH ENABLE_FILE_OVERWRITE_MODE false
+add_fileset_file PWM_Bank_avalon.vhdl VHDL PATH ../../hdl/Kirkland_PWM/PWM_Bank_avalon.vhdl TOP_LEVEL_FILE
+add_fileset_file PWM_Controller.vhdl VHDL PATH ../../hdl/Kirkland_PWM/PWM_Controller.vhdl
+
+
+# 
+# parameters
+# 
+add_parameter N_CHANNELS INTEGER 16
+set_parameter_property N_CHANNELS DEFAULT_VALUE 16
+set_parameter_property N_CHANNELS DISPLAY_NAME N_CHANNELS
+set_parameter_property N_CHANNELS TYPE INTEGER
+set_parameter_property N_CHANNELS UNITS None
+set_parameter_property N_CHANNELS ALLOWED_RANGES 1:64
+set_parameter_property N_CHANNELS HDL_PARAMETER true
+add_parameter N_GROUPS INTEGER 1
+set_parameter_property N_GROUPS DEFAULT_VALUE 1
+set_parameter_property N_GROUPS DISPLAY_NAME N_GROUPS
+set_parameter_property N_GROUPS TYPE INTEGER
+set_parameter_property N_GROUPS UNITS None
+set_parameter_property N_GROUPS ALLOWED_RANGES 1:64
+set_parameter_property N_GROUPS HDL_PARAMETER true
+
+
+# 
+# display items
+# 
+
+
+# 
+# connection point avalon_slave_0
+# 
+add_interface avalon_slave_0 avalon end
+set_interface_property avalon_slave_0 addressUnits WORDS
+set_interface_property avalon_slave_0 associatedClock clk
+set_interface_property avalon_slave_0 associatedReset rst
+set_interface_property avalon_slave_0 bitsPerSymbol 8
+set_interface_property avalon_slave_0 burstOnBurstBoundariesOnly false
+set_interface_property avalon_slave_0 burstcountUnits WORDS
+set_interface_property avalon_slave_0 explicitAddressSpan 0
+set_interface_property avalon_slave_0 holdTime 0
+set_interface_property avalon_slave_0 linewrapBursts false
+set_interface_property avalon_slave_0 maximumPendingReadTransactions 0
+set_interface_property avalon_slave_0 maximumPendingWriteTransactions 0
+set_interface_property avalon_slave_0 readLatency 0
+set_interface_property avalon_slave_0 readWaitTime 1
+set_interface_property avalon_slave_0 setupTime 0
+set_interface_property avalon_slave_0 timingUnits Cycles
+set_interface_property avalon_slave_0 writeWaitTime 0
+set_interface_property avalon_slave_0 ENABLED true
+set_interface_property avalon_slave_0 EXPORT_OF ""
+set_interface_property avalon_slave_0 PORT_NAME_MAP ""
+set_interface_property avalon_slave_0 CMSIS_SVD_VARIABLES ""
+set_interface_property avalon_slave_0 SVD_ADDRESS_GROUP ""
+
+add_interface_port avalon_slave_0 avs_read read Input 1
+add_interface_port avalon_slave_0 avs_write write Input 1
+add_interface_port avalon_slave_0 avs_address address Input 8
+add_interface_port avalon_slave_0 avs_readdata readdata Output 32
+add_interface_port avalon_slave_0 avs_writedata writedata Input 32
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isFlash 0
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isMemoryDevice 0
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isNonVolatileStorage 0
+set_interface_assignment avalon_slave_0 embeddedsw.configuration.isPrintableDevice 0
+
+
+# 
+# connection point gpio
+# 
+add_interface gpio conduit end
+set_interface_property gpio associatedClock clk
+set_interface_property gpio associatedReset ""
+set_interface_property gpio ENABLED true
+set_interface_property gpio EXPORT_OF ""
+set_interface_property gpio PORT_NAME_MAP ""
+set_interface_property gpio CMSIS_SVD_VARIABLES ""
+set_interface_property gpio SVD_ADDRESS_GROUP ""
+
+add_interface_port gpio GPIO gpio Output "((N_CHANNELS - 1)) - (0) + 1"
+
+
+# 
+# connection point rst
+# 
+add_interface rst reset end
+set_interface_property rst associatedClock clk
+set_interface_property rst synchronousEdges DEASSERT
+set_interface_property rst ENABLED true
+set_interface_property rst EXPORT_OF ""
+set_interface_property rst PORT_NAME_MAP ""
+set_interface_property rst CMSIS_SVD_VARIABLES ""
+set_interface_property rst SVD_ADDRESS_GROUP ""
+
+add_interface_port rst rst reset Input 1
+
+
+# 
+# connection point clk
+# 
+add_interface clk clock end
+set_interface_property clk clockRate 0
+set_interface_property clk ENABLED true
+set_interface_property clk EXPORT_OF ""
+set_interface_property clk PORT_NAME_MAP ""
+set_interface_property clk CMSIS_SVD_VARIABLES ""
+set_interface_property clk SVD_ADDRESS_GROUP ""
+
+add_interface_port clk clk clk Input 1
+
@@ -20,13 +20,25 @@ entity PWM_Controller is
 	port (
 		clk			: in	std_logic;
 		rst			: in	std_logic;
-		-- PWM repitition period in milliseconds;
+		-- PWM repitition period in seconds (1/128 s units; 0x80 is 1 Hz);
 		-- datatype (W.F) is individually assigned
 		period		: in	unsigned(W_PERIOD - 1 downto 0);
 		-- PWM duty cycle between [0 1]; out-of-range values are hard-limited
 		-- datatype (W.F) is individually assigned
 		duty_cycle	: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
-		output		: out	std_logic := '0'
+		-- How far the duty cycle moves toward duty_cycle each PWM period, in
+		-- the same units as duty_cycle; 0 jumps straight to the new value
+		step			: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
+		-- '1' dithers the high time: the part of a clock it can't show is
+		-- carried from period to period, so the average duty cycle keeps the
+		-- full resolution of duty_cycle
+		dither		: in	std_logic := '0';
+		output		: out	std_logic := '0';
+		-- high for the one clock cycle where period and duty_cycle are sampled
+		-- for the next PWM period
+		period_start	: out	std_logic;
+		-- high while the duty cycle in use hasn't reached duty_cycle yet
+		ramping		: out	std_logic
 	);
 end entity PWM_Controller;
 
@@ -36,27 +48,90 @@ architecture PWM_Controller_arch of PWM_Controller is
 	signal PWM_output : std_ulogic := '0';
 	signal high_counter : integer := 0;
 	signal period_counter : integer := 0;
+	-- duty cycle in use for the current PWM period
+	signal duty_current : unsigned(W_DUTY_CYCLE - 1 downto 0) := (others => '0');
+
+	-- Terminal count pipeline, so the counters reload from registers rather
+	-- than from the end of a multiplier. Stage 1 holds the period in clocks
+	-- before the shift, and the duty cycle the next period will use; stage 2
+	-- holds the counts the next period loads.
+	signal period_product : unsigned(31 + W_PERIOD downto 0) := (others => '0');
+	signal next_duty : unsigned(W_DUTY_CYCLE - 1 downto 0) := (others => '0');
+	signal period_count : integer := 0;
+	signal high_count : integer := 0;
+	signal load_duty : unsigned(W_DUTY_CYCLE - 1 downto 0) := (others => '0');
+	-- Stage 2 also holds the high time below one clock, 0 unless dithering
+	signal high_fraction : unsigned(27 downto 0) := (others => '0');
+	-- First-order sigma-delta accumulator of the high time fractions
+	signal residue : unsigned(27 downto 0) := (others => '0');
 	
 begin
 
+	-- Works out the next PWM period two clocks ahead: the duty cycle moves up to one step toward duty_cycle, then the period and high time are multiplied out
+	-- duty_current only changes when the counters reload, so both stages have caught up with it by the next reload as long as a period is at least three clocks
+	terminal_counts : process(clk)
+		variable duty : unsigned(W_DUTY_CYCLE - 1 downto 0);
+		variable high_product : unsigned(31 + W_PERIOD + W_DUTY_CYCLE downto 0);
+	begin
+		if (rising_edge(clk)) then
+			if (step = 0) then
+				duty := duty_cycle;
+			elsif (duty_current < duty_cycle) then
+				if (duty_cycle - duty_current > step) then
+					duty := duty_current + step;
+				else
+					duty := duty_cycle;
+				end if;
+			else
+				if (duty_current - duty_cycle > step) then
+					duty := duty_current - step;
+				else
+					duty := duty_cycle;
+				end if;
+			end if;
+			next_duty <= duty;
+			period_product <= to_unsigned(system_clock_frequency, 32) * period;
+
+			load_duty <= next_duty;
+			period_count <= to_integer(shift_right(period_product, 7));
+			if (next_duty > "1000000000000000000000") then
+				high_count <= to_integer(shift_right(period_product, 7));
+				high_fraction <= (others => '0');
+			else
+				high_product := period_product * next_duty;
+				high_count <= to_integer(shift_right(high_product, 28));
+				if (dither = '1') then
+					high_fraction <= high_product(27 downto 0);
+				else
+					high_fraction <= (others => '0');
+				end if;
+			end if;
+		end if;
+	end process terminal_counts;
+
 	-- Repeatedly cycles through the period and high counters, outputting 1 while high is counting down, and 0 after high is finished and period is still counting
+	-- At each period boundary the duty cycle in use moves up to one step toward duty_cycle, so the fabric ramps the LED without the CPU writing every intermediate value
+	-- Reset leaves period_counter at 0, so the first clock after reset loads the counters; reset has to last two clocks for terminal_counts to be ready
+	-- With dither, each reload adds the high time fraction to residue, and a carry out of it makes this period's high time one clock longer
 	modulator : process(clk, rst)
+		variable sum : unsigned(28 downto 0);
 	begin
 
 		if (rst = '1') then
+			duty_current <= duty_cycle;
 			PWM_output <= '1';
-			period_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 7)) - 1;
-			if (duty_cycle > "1000000000000000000000") then
-				high_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 7)) - 1;
-			else
-				high_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32)* period * duty_cycle, 28)) - 1;
-			end if;
+			period_counter <= 0;
+			high_counter <= 0;
+			residue <= (others => '0');
 		elsif (rising_edge(clk) and period_counter = 0) then
-			period_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 7)) - 1;
-			if (duty_cycle > "1000000000000000000000") then
-				high_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32) * period, 7)) - 1;
+			sum := ('0' & residue) + ('0' & high_fraction);
+			residue <= sum(27 downto 0);
+			duty_current <= load_duty;
+			period_counter <= period_count - 1;
+			if (sum(28) = '1') then
+				high_counter <= high_count;
 			else
-				high_counter <= to_integer(shift_right(to_unsigned(system_clock_frequency, 32)* period * duty_cycle, 28)) - 1;
+				high_counter <= high_count - 1;
 			end if;
 			PWM_output <= '1';
 		elsif (rising_edge(clk) and high_counter > 0) then
@@ -69,6 +144,10 @@ begin
 		end if;
 	end process modulator;
 	
+	-- period and duty_cycle are only sampled when period_counter reloads
+	period_start <= '1' when period_counter = 0 else '0';
+	ramping <= '0' when duty_current = duty_cycle else '1';
+
 	-- Forwards output to output port
 	output_logic: process(clk, rst)
 	begin
@@ -13,6 +13,9 @@ use ieee.math_real.all;
 use ieee.numeric_std.all;
 
 entity PWM_controller_avalon is 
+	generic (
+		CLK_PERIOD		: time := 20 ns
+	);
 	port (
 		clk				: in	std_ulogic;
 		rst				: in	std_ulogic;
@@ -20,7 +23,7 @@ entity PWM_controller_avalon is
 		-- avalon memory-mapped slave interface
 		avs_read			: in	std_logic;
 		avs_write		: in	std_logic;
-		avs_address		: in	std_logic_vector(1 downto 0);
+		avs_address		: in	std_logic_vector(2 downto 0);
 		avs_readdata	: out	std_logic_vector(31 downto 0);
 		avs_writedata	: in	std_logic_vector(31 downto 0);
 		
@@ -30,18 +33,52 @@ entity PWM_controller_avalon is
 end entity PWM_controller_avalon;
 
 architecture PWM_controller_avalon_arch of PWM_controller_avalon is
-	signal clk_period : time := 20 ns;
 	signal duty_cycle_width : integer := 22;
 	signal period_width : integer := 13;
 	
 	signal period_reg: std_ulogic_vector(31 downto 0) 		:= "00000000000000000000000010000000";
+	-- Bit 31 of a duty cycle register turns on that channel's dither; the
+	-- controllers only use bits 21:0 as the duty cycle
 	signal red_dc_reg: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000"; -- 50%
 	signal grn_dc_reg: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000"; -- 50%
 	signal blu_dc_reg: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000"; -- 50%
+	-- Ramp steps; 0 (the default) changes the duty cycle immediately
+	signal red_step_reg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+	signal grn_step_reg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+	signal blu_step_reg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+
+	-- Copies of the shadow set taken when the commit register is written.
+	-- The next period boundary applies these rather than the shadow set, so
+	-- shadow writes after a commit can't sneak into it half done.
+	signal period_stg: std_ulogic_vector(31 downto 0) 		:= "00000000000000000000000010000000";
+	signal red_dc_stg: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000";
+	signal grn_dc_stg: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000";
+	signal blu_dc_stg: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000";
+	signal red_step_stg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+	signal grn_step_stg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+	signal blu_step_stg: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+
+	-- Active copies of the registers above; these drive the PWM controllers.
+	-- Writes from the bus only land in the registers above (the shadow set)
+	-- and are copied here together when a commit is latched, so a new colour
+	-- never shows up one channel at a time.
+	signal period_act: std_ulogic_vector(31 downto 0) 		:= "00000000000000000000000010000000";
+	signal red_dc_act: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000";
+	signal grn_dc_act: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000";
+	signal blu_dc_act: std_ulogic_vector(31 downto 0) 		:= "00000000000100000000000000000000";
+	signal red_step_act: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+	signal grn_step_act: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+	signal blu_step_act: std_ulogic_vector(31 downto 0) 	:= (others => '0');
+
+	-- Set by writing 1 to the commit register, cleared once the staged set
+	-- has been copied to the active set at the next PWM period boundary
+	signal commit_pending : std_ulogic := '0';
+	signal period_start : std_logic;
+	signal ramping : std_logic_vector(2 downto 0);
 		
 	component PWM_Controller is
 		generic (
-			CLK_PERIOD		: time := clk_period;
+			CLK_PERIOD		: time := 20 ns;
 			W_DUTY_CYCLE	: integer := duty_cycle_width; -- 22.21;
 			W_PERIOD			: integer := period_width  -- 13.7
 		);
@@ -50,37 +87,62 @@ architecture PWM_controller_avalon_arch of PWM_controller_avalon is
 			rst			: in	std_logic;
 			period		: in	unsigned(W_PERIOD - 1 downto 0);
 			duty_cycle	: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
-			output		: out	std_logic := '0'
+			step			: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
+			dither		: in	std_logic := '0';
+			output		: out	std_logic := '0';
+			period_start	: out	std_logic;
+			ramping		: out	std_logic
 		);
 	end component PWM_Controller;
 	
 begin
 	
 	PWM00_Red : PWM_Controller
+	generic map (
+		CLK_PERIOD => CLK_PERIOD
+	)
 	port map (
 		clk => clk,
 		rst => rst,
-		period => unsigned(period_reg(period_width - 1 downto 0)),
-		duty_cycle => unsigned(red_dc_reg(duty_cycle_width - 1 DOWNTO 0)),
-		output => GPIO(0)
+		period => unsigned(period_act(period_width - 1 downto 0)),
+		duty_cycle => unsigned(red_dc_act(duty_cycle_width - 1 DOWNTO 0)),
+		step => unsigned(red_step_act(duty_cycle_width - 1 DOWNTO 0)),
+		dither => red_dc_act(31),
+		output => GPIO(0),
+		period_start => period_start,
+		ramping => ramping(0)
 	);
 	
 	PWM01_Green : PWM_Controller
+	generic map (
+		CLK_PERIOD => CLK_PERIOD
+	)
 	port map (
 		clk => clk,
 		rst => rst,
-		period => unsigned(period_reg(period_width - 1 downto 0)),
-		duty_cycle => unsigned(grn_dc_reg(duty_cycle_width - 1 DOWNTO 0)),
-		output => GPIO(1)
+		period => unsigned(period_act(period_width - 1 downto 0)),
+		duty_cycle => unsigned(grn_dc_act(duty_cycle_width - 1 DOWNTO 0)),
+		step => unsigned(grn_step_act(duty_cycle_width - 1 DOWNTO 0)),
+		dither => grn_dc_act(31),
+		output => GPIO(1),
+		period_start => open,
+		ramping => ramping(1)
 	);
 	
 	PWM02_Blue : PWM_Controller
+	generic map (
+		CLK_PERIOD => CLK_PERIOD
+	)
 	port map (
 		clk => clk,
 		rst => rst,
-		period => unsigned(period_reg(period_width - 1 downto 0)),
-		duty_cycle => unsigned(blu_dc_reg(duty_cycle_width - 1 DOWNTO 0)),
-		output => GPIO(2)
+		period => unsigned(period_act(period_width - 1 downto 0)),
+		duty_cycle => unsigned(blu_dc_act(duty_cycle_width - 1 DOWNTO 0)),
+		step => unsigned(blu_step_act(duty_cycle_width - 1 DOWNTO 0)),
+		dither => blu_dc_act(31),
+		output => GPIO(2),
+		period_start => open,
+		ramping => ramping(2)
 	);
 
 	-- Checks if read was sent, if so, checks register and reads out data
@@ -88,16 +150,25 @@ begin
 	begin
 		if (rising_edge(clk) and avs_read = '1') then
 			case avs_address is 
-				when "00" => avs_readdata <= std_logic_vector(period_reg);
-				when "01" => avs_readdata <= std_logic_vector(red_dc_reg);
-				when "10" => avs_readdata <= std_logic_vector(grn_dc_reg);
-				when "11" => avs_readdata <= std_logic_vector(blu_dc_reg);
+				when "000" => avs_readdata <= std_logic_vector(period_reg);
+				when "001" => avs_readdata <= std_logic_vector(red_dc_reg);
+				when "010" => avs_readdata <= std_logic_vector(grn_dc_reg);
+				when "011" => avs_readdata <= std_logic_vector(blu_dc_reg);
+				when "100" => avs_readdata <= (0 => commit_pending, 1 => ramping(0), 2 => ramping(1), 3 => ramping(2), others => '0');
+				when "101" => avs_readdata <= std_logic_vector(red_step_reg);
+				when "110" => avs_readdata <= std_logic_vector(grn_step_reg);
+				when "111" => avs_readdata <= std_logic_vector(blu_step_reg);
 				when others => avs_readdata <= (others => '0');
 			end case;
 		end if;
 	end process avalon_register_read;
 
-	-- Checks if write was sent, if so checks address and writes to appropriate register
+	-- Checks if write was sent, if so checks address and writes to appropriate register.
+	-- Writing the commit register stages a copy of the shadow registers, and
+	-- the staged copy goes to the active registers on the clock where the
+	-- controllers sample them, so all three channels switch together at the
+	-- start of a PWM period. A second commit before that replaces the staged
+	-- copy as a whole.
 	avalon_register_write : process(clk, rst)
 	begin
 		if (rst = '1') then
@@ -105,14 +176,59 @@ begin
 			red_dc_reg <= "00000000000100000000000000000000";
 			grn_dc_reg <= "00000000000100000000000000000000";
 			blu_dc_reg <= "00000000000100000000000000000000";
-		elsif (rising_edge(clk) and avs_write = '1') then
-			case avs_address is 
-				when "00" => period_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
-				when "01" => red_dc_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
-				when "10" => grn_dc_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
-				when "11" => blu_dc_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
-				when others => null;
-			end case;
+			period_stg <= "00000000000000000000000010000000";
+			red_dc_stg <= "00000000000100000000000000000000";
+			grn_dc_stg <= "00000000000100000000000000000000";
+			blu_dc_stg <= "00000000000100000000000000000000";
+			period_act <= "00000000000000000000000010000000";
+			red_dc_act <= "00000000000100000000000000000000";
+			grn_dc_act <= "00000000000100000000000000000000";
+			blu_dc_act <= "00000000000100000000000000000000";
+			red_step_reg <= (others => '0');
+			grn_step_reg <= (others => '0');
+			blu_step_reg <= (others => '0');
+			red_step_stg <= (others => '0');
+			grn_step_stg <= (others => '0');
+			blu_step_stg <= (others => '0');
+			red_step_act <= (others => '0');
+			grn_step_act <= (others => '0');
+			blu_step_act <= (others => '0');
+			commit_pending <= '0';
+		elsif (rising_edge(clk)) then
+			if (commit_pending = '1' and period_start = '1') then
+				period_act <= period_stg;
+				red_dc_act <= red_dc_stg;
+				grn_dc_act <= grn_dc_stg;
+				blu_dc_act <= blu_dc_stg;
+				red_step_act <= red_step_stg;
+				grn_step_act <= grn_step_stg;
+				blu_step_act <= blu_step_stg;
+				commit_pending <= '0';
+			end if;
+
+			if (avs_write = '1') then
+				case avs_address is 
+					when "000" => period_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "001" => red_dc_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "010" => grn_dc_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "011" => blu_dc_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "100" =>
+						if (avs_writedata(0) = '1') then
+							period_stg <= period_reg;
+							red_dc_stg <= red_dc_reg;
+							grn_dc_stg <= grn_dc_reg;
+							blu_dc_stg <= blu_dc_reg;
+							red_step_stg <= red_step_reg;
+							grn_step_stg <= grn_step_reg;
+							blu_step_stg <= blu_step_reg;
+							commit_pending <= '1';
+						end if;
+					when "101" => red_step_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "110" => grn_step_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when "111" => blu_step_reg <= std_ulogic_vector(avs_writedata(31 downto 0));
+					when others => null;
+				end case;
+			end if;
 		end if;
 	end process;
 
@@ -26,19 +26,30 @@ architecture PWM of pwm_controller is
 	-- 50 Mhz "10111110101111000010000000"
 	-- TEST "00000000000000000111110100"
 	signal p_clk_temp : std_ulogic := '1';
-	signal period_base : unsigned(51 downto 0);
+	-- period_base and high_time are registered one after the other, with
+	-- duty_reg and trunkp lined up with them, so the counter compares against
+	-- registers rather than the end of a 67-bit multiply. A new period or
+	-- duty cycle reaches the counter two clocks after it changes.
+	signal period_base : unsigned(51 downto 0) := (others => '0');
+	signal duty_reg : unsigned(14 downto 0) := (others => '0');
 	signal trunk  : unsigned(31 downto 0);
 	signal trunk2  : unsigned(32 downto 0);
-	signal trunkp : unsigned(30 downto 0);
+	signal trunkp : unsigned(30 downto 0) := (others => '0');
 	signal trunkp2 : unsigned(31 downto 0);
-	signal high_time : unsigned(66 downto 0);
+	signal high_time : unsigned(66 downto 0) := (others => '0');
 	
 	begin
-	period_base <=  clk_freq * period;
-	high_time <= duty_cycle * period_base;
+	terminal_counts : process (clk)
+			begin
+				if(clk'event and clk = '1') then
+					period_base <= clk_freq * period;
+					duty_reg <= duty_cycle;
+					high_time <= duty_reg * period_base;
+					trunkp <= period_base(51 downto 21);
+				end if;
+		end process;
 	trunk <= high_time(66 downto 35);
 	trunk2 <= trunk & "0";
-	trunkp <= period_base(51 downto 21);
 	trunkp2 <= trunkp & "0";
 	clk_counter : process (clk, rst)
 			begin
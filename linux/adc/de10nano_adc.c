@@ -6,7 +6,32 @@
 #include <linux/types.h>
 #include <linux/mutex.h>
 #include <linux/miscdevice.h>
+#include <linux/idr.h>
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/wait.h>
+#include <linux/uaccess.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
+#include <linux/atomic.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+#include <linux/property.h>
+#include <linux/math64.h>
+#include <linux/bitops.h>
+#include <linux/interrupt.h>
+#include <linux/notifier.h>
+#include <linux/export.h>
+#include <linux/sort.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
+
+#include "de10nano_adc.h"
+#include "../include/kirkland_regio.h"
 
 // ADC channel register addresses
 static u32 CH0 = 0x0;
@@ -24,266 +49,2209 @@ static u32 CH7 = 0x1c;
 
 #define SPAN 32
 
+// Only the update and auto_update registers can be written
+#define WRITE_SPAN (AUTO_UPDATE + sizeof(u32))
+
 // ADC values are in the 12 least-significant bits of the registers
 #define ADC_VALUE_BITMASK 0xfff
 
 static unsigned long VOLTAGE_SCALE_MV = 1;
 
+// Full-scale input voltage (VREFCOMP) and resolution, for the IIO scale
+#define ADC_VREF_MV 4096
+#define ADC_RESOLUTION_BITS 12
+
+// Number of scans the streaming ring buffer holds; must be a power of 2
+#define ADC_RING_SCANS 2048
+
+/*
+ * The shared ring is one header page followed by the scans, so the header
+ * and the scans can be mapped into user space with a single mmap().
+ */
+#define ADC_RING_DATA_OFFSET PAGE_SIZE
+#define ADC_RING_SIZE \
+	(ADC_RING_DATA_OFFSET + ADC_RING_SCANS * sizeof(struct adc_scan))
+
+// Number of scans read() copies out of the ring per validated chunk
+#define ADC_BOUNCE_SCANS 64
+
+// Captured scans per output scan, and the default IIR shift (alpha = 1/16)
+#define ADC_MAX_DECIMATION 64
+#define ADC_MAX_IIR_SHIFT 12
+#define ADC_DEFAULT_IIR_SHIFT 4
+
+// Shortest median window, so the median filter still works without decimation
+#define ADC_MIN_MEDIAN_LEN 3
+
+// IIR state is kept with this many fractional bits
+#define ADC_IIR_FRAC_BITS 16
+
+/*
+ * Per-channel filters applied to captured scans. The order matches
+ * adc_filter_names.
+ */
+enum adc_filter_type {
+	ADC_FILTER_NONE,
+	ADC_FILTER_BOXCAR,
+	ADC_FILTER_IIR,
+	ADC_FILTER_MEDIAN,
+};
+
+static const char * const adc_filter_names[] = {
+	[ADC_FILTER_NONE] = "none",
+	[ADC_FILTER_BOXCAR] = "boxcar",
+	[ADC_FILTER_IIR] = "iir",
+	[ADC_FILTER_MEDIAN] = "median",
+};
+
+/**
+ * struct adc_filter - State of one channel's filter.
+ * @type: Which filter the channel uses.
+ * @sum: Boxcar: sum of the samples since the last output.
+ * @nr_samples: Boxcar and median: samples in @sum or @window.
+ * @iir: IIR: filtered value with ADC_IIR_FRAC_BITS fractional bits.
+ * @primed: IIR: @iir has been seeded with a first sample.
+ * @pos: Median: where the next sample goes in @window.
+ * @window: Median: the latest samples.
+ */
+struct adc_filter {
+	enum adc_filter_type type;
+	u32 sum;
+	u32 nr_samples;
+	s32 iir;
+	bool primed;
+	u32 pos;
+	u16 window[ADC_MAX_DECIMATION];
+};
+
+/*
+ * Layout of alarm_status: bit n latches a high-threshold crossing on channel
+ * n, bit (n + 8) latches a low-threshold crossing on channel n.
+ */
+#define ADC_ALARM_HIGH(ch) BIT(ch)
+#define ADC_ALARM_LOW(ch) BIT((ch) + ADC_NUM_CHANNELS)
+#define ADC_ALARM_MASK (BIT(2 * ADC_NUM_CHANNELS) - 1)
+
+// Rate the alarm timer checks thresholds at while nothing else is taking scans
+#define ADC_ALARM_RATE_HZ 100
+
+// Streaming sample rate limits and default, in scans per second
+#define ADC_MIN_SAMPLE_RATE_HZ 1
+#define ADC_MAX_SAMPLE_RATE_HZ 20000
+#define ADC_DEFAULT_SAMPLE_RATE_HZ 1000
+
+/*
+ * Registers of the ADC_Sampler component, which follow its latest-value
+ * registers (at the same offsets as the Terasic channel registers).
+ */
+#define SAMPLER_CTRL 0x20
+#define SAMPLER_RATE 0x24
+#define SAMPLER_STATUS 0x28
+#define SAMPLER_DATA 0x2c
+#define SAMPLER_TIME 0x30
+#define SAMPLER_IRQ_ENABLE 0x34
+#define SAMPLER_IRQ_STATUS 0x38
+#define SAMPLER_WATERMARK 0x3c
+#define SAMPLER_THRESH(ch) (0x40 + (ch) * 4)
+
+#define SAMPLER_CTRL_SCAN BIT(0)
+#define SAMPLER_CTRL_FIFO BIT(1)
+#define SAMPLER_CTRL_MASK_SHIFT 8
+#define SAMPLER_STATUS_LEVEL 0xffff
+#define SAMPLER_STATUS_FLUSH BIT(30)
+#define SAMPLER_STATUS_OVERFLOW BIT(31)
+#define SAMPLER_DATA_VALID BIT(15)
+#define SAMPLER_DATA_CH(word) (((word) >> 12) & 0x7)
+#define SAMPLER_DATA_TIME(word) ((u16)((word) >> 16))
+
+/*
+ * IRQ_STATUS and IRQ_ENABLE: bits 15:0 are threshold crossings laid out like
+ * alarm_status, bit 16 is the FIFO watermark.
+ */
+#define SAMPLER_IRQ_WATERMARK BIT(16)
+#define SAMPLER_THRESH_HIGH_SHIFT 16
+
+#define SAMPLER_FIFO_DEPTH 512
+#define SAMPLER_CLK_HZ 50000000
+
+// The sampler does a full 8-channel scan in about 22 us
+#define SAMPLER_MAX_SAMPLE_RATE_HZ 40000
+
+/*
+ * FIFO timestamps are 16 bits of microseconds, so the FIFO has to be drained
+ * well within 65 ms to rebuild them. With the interrupt, the watermark is set
+ * so it's reached at least every SAMPLER_MAX_DRAIN_NS.
+ */
+#define SAMPLER_MIN_DRAIN_NS (1 * NSEC_PER_MSEC)
+#define SAMPLER_MAX_DRAIN_NS (20 * NSEC_PER_MSEC)
+
+/**
+ * struct adc_variant - What the ADC component in the FPGA can do.
+ * @has_fifo: It's the ADC_Sampler, which scans on its own and queues
+ *            samples in a FIFO; otherwise it's the Terasic controller.
+ * @max_sample_rate_hz: Highest streaming scan rate we allow.
+ */
+struct adc_variant {
+	bool has_fifo;
+	unsigned long max_sample_rate_hz;
+};
+
+static const struct adc_variant adc_terasic = {
+	.has_fifo = false,
+	.max_sample_rate_hz = ADC_MAX_SAMPLE_RATE_HZ,
+};
+
+static const struct adc_variant adc_sampler = {
+	.has_fifo = true,
+	.max_sample_rate_hz = SAMPLER_MAX_SAMPLE_RATE_HZ,
+};
+
+static struct platform_driver adc_driver;
+
 /**
  * struct adc_dev - Private led patterns device struct.
+ * @dev: The platform device's struct device; used for sysfs notifications
  * @base_addr: Pointer to the component's base address 
- * @hps_led_control: Pointer to the hps_led_control register 
- * @base_period: Pointer to the base_period register 
- * @led_reg: Pointer to the led_reg register 
+ * @variant: Which ADC component we're driving
+ * @auto_update: Shadow copy of the write-only auto_update register
  * @miscdev: miscdevice used to create a character device
- * @lock: mutex used to prevent concurrent writes to memory 
+ * @id: Instance number from adc_ida
+ * @name: Name of the device node; adc for instance 0 and adcN for instance N
+ * @lock: mutex used to prevent concurrent writes to memory and to
+ *        serialize streaming readers
+ * @streaming: True while scans are going into the ring buffer
+ * @channel_mask: Channels sampled in each streaming scan; bit n is channel n
+ * @capturing: True while the timer or sampler is taking scans, which it does
+ *             while streaming or while another driver is listening
+ * @capture_mask: Channels each scan samples: @channel_mask plus every
+ *                channel another driver is listening to, and without @irq,
+ *                every channel with a threshold set
+ * @listeners: Number of notifier listeners on each channel
+ * @notifier: Chain called with every scan; see
+ *            de10nano_adc_register_notifier()
+ * @filter: Per-channel filters; only touched by the timer or IRQ thread
+ *          while capturing
+ * @filtering: True if any channel is filtered or @decimation is above 1
+ * @decimation: Captured scans per output scan
+ * @decimation_count: Captured scans since the last output scan
+ * @iir_shift: IIR filters move 1/2^@iir_shift of the way to each sample
+ * @scan_period: Timer period; 1 / @sample_rate_hz, or with the sampler, how
+ *               often its FIFO is drained
+ * @timer: hrtimer that takes a scan every @scan_period, or with the
+ *         sampler, drains its FIFO every @scan_period
+ * @ring_mem: vmalloc'd memory holding @hdr and @ring; mapped by mmap()
+ * @hdr: Header page of the shared ring; holds the head and tail indices
+ * @ring: Ring buffer of ADC_RING_SCANS scans
+ * @read_pos: Sequence number of the next scan read() will return
+ * @bounce: Staging buffer read() validates scans in before copying them out
+ * @overruns: Number of scans read() missed because the timer overwrote them
+ * @fifo_overflows: Number of times the sampler's FIFO filled up and dropped
+ *                  samples before we drained it
+ * @pending: Scan being assembled from sampler FIFO words; only touched by
+ *           the drain timer or IRQ thread
+ * @irq: The sampler's interrupt, or 0 if it doesn't have one. With it, the
+ *       FIFO is drained on the watermark interrupt instead of by @timer,
+ *       and thresholds are checked by the sampler instead of by us.
+ * @irq_enable: Copy of the sampler's IRQ_ENABLE register
+ * @wait: Wait queue for readers blocked on an empty ring and for pollers
+ * @high_threshold: Per-channel value a scan must exceed to raise a high alarm
+ * @low_threshold: Per-channel value a scan must drop below to raise a low alarm
+ * @outside: Channels whose last scan was outside their threshold window,
+ *           laid out like @alarm_status; only touched by the sampling timer,
+ *           or while not capturing, by @alarm_timer
+ * @alarm_timer: Without @irq, checks the thresholds every 1/ADC_ALARM_RATE_HZ
+ *               while thresholds are set and nothing is capturing
+ * @alarm_status: Latched threshold crossings that user space hasn't
+ *                acknowledged yet
+ * @alarm_work: Notifies sysfs pollers of alarm_status from process context
+ * @indio_dev: IIO front end for the same channels
+ * @iio_scan: Staging buffer for one IIO buffer scan; the enabled channels
+ *            are packed at the front and the timestamp is placed after them
  *
  * An adc_dev struct gets created for each led patterns component.
  */
 struct adc_dev {
+	struct device *dev;
 	void __iomem *base_addr;
+	const struct adc_variant *variant;
 	bool auto_update;
 	struct miscdevice miscdev;
+	int id;
+	const char *name;
 	struct mutex lock;
+	bool streaming;
+	u32 channel_mask;
+	bool capturing;
+	u32 capture_mask;
+	unsigned int listeners[ADC_NUM_CHANNELS];
+	struct atomic_notifier_head notifier;
+	struct adc_filter filter[ADC_NUM_CHANNELS];
+	bool filtering;
+	u32 decimation;
+	u32 decimation_count;
+	u32 iir_shift;
+	unsigned long sample_rate_hz;
+	ktime_t scan_period;
+	struct hrtimer timer;
+	void *ring_mem;
+	struct adc_ring_header *hdr;
+	struct adc_scan *ring;
+	u32 read_pos;
+	struct adc_scan *bounce;
+	u32 overruns;
+	u32 fifo_overflows;
+	struct adc_scan pending;
+	int irq;
+	u32 irq_enable;
+	wait_queue_head_t wait;
+	u16 high_threshold[ADC_NUM_CHANNELS];
+	u16 low_threshold[ADC_NUM_CHANNELS];
+	u32 outside;
+	struct hrtimer alarm_timer;
+	atomic_t alarm_status;
+	struct work_struct alarm_work;
+	struct iio_dev *indio_dev;
+	struct {
+		u16 ch[ADC_NUM_CHANNELS];
+		s64 timestamp __aligned(8);
+	} iio_scan;
 };
 
 /**
- * adc_read() - Read method for the adc char device
- * @file: Pointer to the char device file struct.
- * @buf: User-space buffer to read the value into.
- * @count: The number of bytes being requested.
- * @offset: The byte offset in the file being read from.
+ * adc_take_scan() - Sample a set of channels and timestamp the result.
+ * @priv: The adc device.
+ * @mask: Channels to sample; bit n is channel n.
+ * @scan: Scan to fill in. Channels not in @mask are set to 0.
+ */
+static void adc_take_scan(struct adc_dev *priv, u32 mask,
+	struct adc_scan *scan)
+{
+	unsigned int ch;
+
+	scan->timestamp_ns = ktime_get_ns();
+	scan->channel_mask = mask;
+
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		if (mask & BIT(ch)) {
+			scan->ch[ch] = ioread32(priv->base_addr + ch * sizeof(u32))
+				& ADC_VALUE_BITMASK;
+		}
+		else {
+			scan->ch[ch] = 0;
+		}
+	}
+}
+
+/**
+ * adc_latch_alarms() - Latch threshold crossings into alarm_status.
+ * @priv: The adc device.
+ * @crossed: New crossings, laid out like alarm_status.
  *
- * Return: On success, the number of bytes written is returned and the
- * offset @offset is advanced by this number. On error, a negative error
- * value is returned.
+ * Pollers waiting for EPOLLPRI are only woken when a crossing sets a bit
+ * that wasn't already latched in alarm_status.
  */
-static ssize_t adc_read(struct file *file, char __user *buf,
-	size_t count, loff_t *offset)
+static void adc_latch_alarms(struct adc_dev *priv, u32 crossed)
 {
-	size_t ret;
-	u32 val;
+	if (crossed && (atomic_fetch_or(crossed, &priv->alarm_status) & crossed)
+			!= crossed) {
+		wake_up_interruptible_poll(&priv->wait, EPOLLPRI);
+		schedule_work(&priv->alarm_work);
+	}
+}
 
-	/*
-	 * Get the device's private data from the file struct's private_data
-	 * field. The private_data field is equal to the miscdev field in the
-	 * adc_dev struct. container_of returns the 
-     * adc_dev struct that contains the miscdev in private_data.
-	 */
-	struct adc_dev *priv = container_of(file->private_data,
-	                            struct adc_dev, miscdev);
+/**
+ * adc_check_thresholds() - Latch threshold crossings in a new scan.
+ * @priv: The adc device.
+ * @scan: The scan that was just taken.
+ *
+ * A crossing is a channel going from inside its threshold window to above
+ * the high threshold or below the low threshold. Staying outside the window
+ * doesn't raise another alarm; the channel has to come back inside first.
+ */
+static void adc_check_thresholds(struct adc_dev *priv,
+	const struct adc_scan *scan)
+{
+	u32 outside = 0;
+	u32 crossed;
+	unsigned int ch;
 
-	// Check file offset to make sure we are reading from a valid location.
-	if (*offset < 0) {
-		// We can't read from a negative file position.
-		return -EINVAL;
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		if (!(scan->channel_mask & BIT(ch))) {
+			continue;
+		}
+		if (scan->ch[ch] > READ_ONCE(priv->high_threshold[ch])) {
+			outside |= ADC_ALARM_HIGH(ch);
+		}
+		else if (scan->ch[ch] < READ_ONCE(priv->low_threshold[ch])) {
+			outside |= ADC_ALARM_LOW(ch);
+		}
 	}
-	if (*offset >= SPAN) {
-		// We can't read from a position past the end of our device.
-		return 0;
+
+	crossed = outside & ~priv->outside;
+	priv->outside = outside;
+
+	adc_latch_alarms(priv, crossed);
+}
+
+/**
+ * adc_alarm_channels() - Find the channels with a threshold set.
+ * @priv: The adc device.
+ *
+ * Return: Channels whose high threshold is below 4095 or whose low threshold
+ * is above 0; the others can never raise an alarm.
+ */
+static u32 adc_alarm_channels(struct adc_dev *priv)
+{
+	u32 mask = 0;
+	unsigned int ch;
+
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		if (READ_ONCE(priv->high_threshold[ch]) < ADC_VALUE_BITMASK ||
+		    READ_ONCE(priv->low_threshold[ch]) > 0) {
+			mask |= BIT(ch);
+		}
 	}
-	if ((*offset % 0x4) != 0) {
-		// Prevent unaligned access.
-		pr_warn("adc_read: unaligned access\n");
-		return -EFAULT;
+
+	return mask;
+}
+
+/**
+ * adc_alarm_timer() - Check the thresholds while nothing is capturing.
+ * @timer: The adc device's alarm timer.
+ *
+ * Reads the latest value of every channel with a threshold set, so alarm
+ * pollers get woken without anyone streaming. While capturing, the scans
+ * already include those channels and this timer is stopped.
+ *
+ * Return: HRTIMER_RESTART so the timer keeps running.
+ */
+static enum hrtimer_restart adc_alarm_timer(struct hrtimer *timer)
+{
+	struct adc_dev *priv = container_of(timer, struct adc_dev, alarm_timer);
+	struct adc_scan scan;
+
+	adc_take_scan(priv, adc_alarm_channels(priv), &scan);
+	adc_check_thresholds(priv, &scan);
+
+	hrtimer_forward_now(timer, ns_to_ktime(NSEC_PER_SEC / ADC_ALARM_RATE_HZ));
+	return HRTIMER_RESTART;
+}
+
+/**
+ * adc_update_alarm_timer() - Run the alarm timer only when it's needed.
+ * @priv: The adc device; the caller holds @priv->lock.
+ *
+ * It's needed when a threshold is set, nothing is capturing, and the
+ * sampler can't check thresholds itself.
+ */
+static void adc_update_alarm_timer(struct adc_dev *priv)
+{
+	bool want = !priv->irq && !priv->capturing && adc_alarm_channels(priv);
+
+	if (want && !hrtimer_active(&priv->alarm_timer)) {
+		hrtimer_start(&priv->alarm_timer,
+			ns_to_ktime(NSEC_PER_SEC / ADC_ALARM_RATE_HZ), HRTIMER_MODE_REL);
+	}
+	else if (!want) {
+		hrtimer_cancel(&priv->alarm_timer);
+	}
+}
+
+/**
+ * adc_alarm_work() - Wake sysfs pollers of alarm_status.
+ * @work: The adc device's alarm work item.
+ *
+ * sysfs_notify() can sleep, so the sampling timer defers it to here.
+ */
+static void adc_alarm_work(struct work_struct *work)
+{
+	struct adc_dev *priv = container_of(work, struct adc_dev, alarm_work);
+
+	sysfs_notify(&priv->dev->kobj, NULL, "alarm_status");
+}
+
+/**
+ * adc_ring_push() - Push a scan into the shared ring.
+ * @priv: The adc device.
+ * @src: The scan; channels outside @priv->channel_mask are dropped, and its
+ *       seq is filled in here.
+ *
+ * The streaming timer (or with the sampler's interrupt, the IRQ thread) is
+ * the only writer of the shared ring. When the ring
+ * is full, the oldest scan is retired by advancing the tail *before* its slot
+ * is overwritten, so readers can detect a torn copy by re-checking the tail
+ * afterwards.
+ */
+static void adc_ring_push(struct adc_dev *priv, const struct adc_scan *src)
+{
+	struct adc_ring_header *hdr = priv->hdr;
+	u32 head = hdr->head;
+	struct adc_scan *scan = &priv->ring[head & (ADC_RING_SCANS - 1)];
+	unsigned int ch;
+	u32 mask;
+
+	if (head - hdr->tail == ADC_RING_SCANS) {
+		WRITE_ONCE(hdr->tail, head - ADC_RING_SCANS + 1);
+		smp_wmb();
+	}
+
+	*scan = *src;
+	scan->seq = head;
+
+	// Drop channels that are only being sampled for in-kernel listeners.
+	mask = READ_ONCE(priv->channel_mask);
+	if (scan->channel_mask & ~mask) {
+		scan->channel_mask &= mask;
+		for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+			if (!(mask & BIT(ch))) {
+				scan->ch[ch] = 0;
+			}
+		}
+	}
+
+	// Publish the scan before telling the readers about it.
+	smp_store_release(&hdr->head, head + 1);
+	wake_up_interruptible_poll(&priv->wait, EPOLLIN | EPOLLRDNORM);
+}
+
+/**
+ * adc_cmp_u16() - sort() comparison for u16 samples.
+ * @a: First sample.
+ * @b: Second sample.
+ *
+ * Return: <0, 0 or >0 as @a is below, equal to or above @b.
+ */
+static int adc_cmp_u16(const void *a, const void *b)
+{
+	return *(const u16 *)a - *(const u16 *)b;
+}
+
+/**
+ * adc_median_len() - Number of samples the median filter looks at.
+ * @priv: The adc device.
+ *
+ * Return: The decimation factor, but at least ADC_MIN_MEDIAN_LEN.
+ */
+static u32 adc_median_len(struct adc_dev *priv)
+{
+	return max_t(u32, priv->decimation, ADC_MIN_MEDIAN_LEN);
+}
+
+/**
+ * adc_filter_reset() - Throw away every channel's filter state.
+ * @priv: The adc device; capture is stopped.
+ */
+static void adc_filter_reset(struct adc_dev *priv)
+{
+	unsigned int ch;
+
+	priv->filtering = priv->decimation > 1;
+	priv->decimation_count = 0;
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		struct adc_filter *f = &priv->filter[ch];
+
+		f->sum = 0;
+		f->nr_samples = 0;
+		f->primed = false;
+		f->pos = 0;
+		if (f->type != ADC_FILTER_NONE) {
+			priv->filtering = true;
+		}
+	}
+}
+
+/**
+ * adc_filter_scan() - Run a captured scan through the channel filters.
+ * @priv: The adc device.
+ * @raw: The captured scan.
+ * @out: Where to put the output scan.
+ *
+ * Every captured sample goes into its channel's filter, and every
+ * @priv->decimation captured scans an output scan is produced with the
+ * newest scan's timestamp and channels. Unfiltered channels decimate by
+ * keeping the newest sample; boxcar channels output the mean of the samples
+ * since the last output; IIR channels output the filter's current value;
+ * and median channels output the median of the last adc_median_len()
+ * samples.
+ *
+ * Return: True if @out holds a new output scan.
+ */
+static bool adc_filter_scan(struct adc_dev *priv, const struct adc_scan *raw,
+	struct adc_scan *out)
+{
+	u16 sorted[ADC_MAX_DECIMATION];
+	u32 median_len = adc_median_len(priv);
+	unsigned int ch;
+	s32 x;
+
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		struct adc_filter *f = &priv->filter[ch];
+
+		if (!(raw->channel_mask & BIT(ch))) {
+			continue;
+		}
+		x = raw->ch[ch];
+
+		switch (f->type) {
+		case ADC_FILTER_BOXCAR:
+			f->sum += x;
+			f->nr_samples++;
+			break;
+		case ADC_FILTER_IIR:
+			x <<= ADC_IIR_FRAC_BITS;
+			if (!f->primed) {
+				f->iir = x;
+				f->primed = true;
+			}
+			else {
+				f->iir += (x - f->iir) >> priv->iir_shift;
+			}
+			break;
+		case ADC_FILTER_MEDIAN:
+			f->window[f->pos] = x;
+			f->pos = (f->pos + 1) % median_len;
+			if (f->nr_samples < median_len) {
+				f->nr_samples++;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (++priv->decimation_count < priv->decimation) {
+		return false;
+	}
+	priv->decimation_count = 0;
+
+	*out = *raw;
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		struct adc_filter *f = &priv->filter[ch];
+
+		if (!(raw->channel_mask & BIT(ch))) {
+			continue;
+		}
+
+		switch (f->type) {
+		case ADC_FILTER_BOXCAR:
+			out->ch[ch] = (f->sum + f->nr_samples / 2) / f->nr_samples;
+			f->sum = 0;
+			f->nr_samples = 0;
+			break;
+		case ADC_FILTER_IIR:
+			out->ch[ch] = (f->iir + BIT(ADC_IIR_FRAC_BITS - 1)) >>
+				ADC_IIR_FRAC_BITS;
+			break;
+		case ADC_FILTER_MEDIAN:
+			memcpy(sorted, f->window, f->nr_samples * sizeof(u16));
+			sort(sorted, f->nr_samples, sizeof(u16), adc_cmp_u16, NULL);
+			out->ch[ch] = sorted[f->nr_samples / 2];
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * adc_new_scan() - Hand a freshly taken scan to everyone who wants it.
+ * @priv: The adc device.
+ * @raw: The scan, before filtering.
+ *
+ * Runs in the timer's hard interrupt context, or in the IRQ thread with the
+ * sampler's interrupt, so notifier listeners must not sleep. With filtering
+ * or decimation set up, only the filtered output scans go any further.
+ */
+static void adc_new_scan(struct adc_dev *priv, const struct adc_scan *raw)
+{
+	const struct adc_scan *scan = raw;
+	struct adc_scan filtered;
+
+	if (priv->filtering) {
+		if (!adc_filter_scan(priv, raw, &filtered)) {
+			return;
+		}
+		scan = &filtered;
+	}
+
+	if (READ_ONCE(priv->streaming)) {
+		adc_ring_push(priv, scan);
+	}
+
+	// The sampler checks its own thresholds when it can interrupt us.
+	if (!priv->irq) {
+		adc_check_thresholds(priv, scan);
+	}
+
+	atomic_notifier_call_chain(&priv->notifier, ADC_NOTIFY_SCAN,
+		(void *)scan);
+}
+
+/**
+ * adc_sample_timer() - Take a scan.
+ * @timer: The adc device's sampling timer.
+ *
+ * This runs in hard interrupt context once every scan period when the ADC is
+ * the Terasic controller, which can only be sampled by reading its registers.
+ *
+ * Return: HRTIMER_RESTART so the timer keeps running.
+ */
+static enum hrtimer_restart adc_sample_timer(struct hrtimer *timer)
+{
+	struct adc_dev *priv = container_of(timer, struct adc_dev, timer);
+	struct adc_scan scan;
+
+	adc_take_scan(priv, READ_ONCE(priv->capture_mask), &scan);
+	adc_new_scan(priv, &scan);
+
+	hrtimer_forward_now(timer, READ_ONCE(priv->scan_period));
+	return HRTIMER_RESTART;
+}
+
+/**
+ * adc_fifo_drain() - Move samples from the sampler's FIFO into the ring.
+ * @priv: The adc device.
+ *
+ * Samples come out of the FIFO one channel at a time, tagged with their
+ * channel and the low 16 bits of the sampler's microsecond counter. They're
+ * gathered into @pending until it holds every captured channel, or until a
+ * channel it already has shows up, and then pushed as one scan. Only the
+ * words that were in the FIFO when we read its level are popped, so every one
+ * of them is older than the time we read, and its age fits in 16 bits as long
+ * as we drain at least every 65 ms.
+ */
+static void adc_fifo_drain(struct adc_dev *priv)
+{
+	struct adc_scan *pending = &priv->pending;
+	u32 mask = READ_ONCE(priv->capture_mask);
+	u32 status, level, word, now_us;
+	u64 now_ns;
+	u16 age_us;
+	unsigned int ch;
+
+	status = ioread32(priv->base_addr + SAMPLER_STATUS);
+	if (status & SAMPLER_STATUS_OVERFLOW) {
+		priv->fifo_overflows++;
+		iowrite32(SAMPLER_STATUS_OVERFLOW, priv->base_addr + SAMPLER_STATUS);
+	}
+	level = status & SAMPLER_STATUS_LEVEL;
+
+	now_us = ioread32(priv->base_addr + SAMPLER_TIME);
+	now_ns = ktime_get_ns();
+
+	while (level--) {
+		word = ioread32(priv->base_addr + SAMPLER_DATA);
+		if (!(word & SAMPLER_DATA_VALID)) {
+			break;
+		}
+		ch = SAMPLER_DATA_CH(word);
+
+		// A channel we already have starts the next scan.
+		if (pending->channel_mask & BIT(ch)) {
+			adc_new_scan(priv, pending);
+			pending->channel_mask = 0;
+		}
+		if (!pending->channel_mask) {
+			memset(pending->ch, 0, sizeof(pending->ch));
+			age_us = (u16)now_us - SAMPLER_DATA_TIME(word);
+			pending->timestamp_ns = now_ns - (u64)age_us * NSEC_PER_USEC;
+		}
+
+		pending->ch[ch] = word & ADC_VALUE_BITMASK;
+		pending->channel_mask |= BIT(ch);
+
+		if (pending->channel_mask == mask) {
+			adc_new_scan(priv, pending);
+			pending->channel_mask = 0;
+		}
+	}
+}
+
+/**
+ * adc_fifo_timer() - Drain the sampler's FIFO.
+ * @timer: The adc device's streaming timer.
+ *
+ * With the sampler, the FPGA times the scans, so this only has to run often
+ * enough to keep the FIFO from filling up; see adc_update_rate().
+ *
+ * Return: HRTIMER_RESTART so the timer keeps running.
+ */
+static enum hrtimer_restart adc_fifo_timer(struct hrtimer *timer)
+{
+	struct adc_dev *priv = container_of(timer, struct adc_dev, timer);
+
+	adc_fifo_drain(priv);
+
+	hrtimer_forward_now(timer, READ_ONCE(priv->scan_period));
+	return HRTIMER_RESTART;
+}
+
+/**
+ * adc_irq_thread() - Handle an interrupt from the sampler.
+ * @irq: Unused.
+ * @dev_id: The adc device.
+ *
+ * Runs in a kernel thread with the line masked until we return, so it's the
+ * only one touching the FIFO and the ring while streaming. The sampler has
+ * already filtered threshold crossings the same way adc_check_thresholds()
+ * does, so they go straight into alarm_status.
+ *
+ * Return: IRQ_HANDLED, or IRQ_NONE if nothing we enabled was pending.
+ */
+static irqreturn_t adc_irq_thread(int irq, void *dev_id)
+{
+	struct adc_dev *priv = dev_id;
+	u32 status;
+
+	status = ioread32(priv->base_addr + SAMPLER_IRQ_STATUS) &
+		READ_ONCE(priv->irq_enable);
+	if (!status) {
+		return IRQ_NONE;
+	}
+
+	if (status & ADC_ALARM_MASK) {
+		iowrite32(status & ADC_ALARM_MASK,
+			priv->base_addr + SAMPLER_IRQ_STATUS);
+		adc_latch_alarms(priv, status & ADC_ALARM_MASK);
+	}
+
+	// The watermark bit clears itself once we've drained the FIFO.
+	if (status & SAMPLER_IRQ_WATERMARK) {
+		adc_fifo_drain(priv);
+	}
+
+	return IRQ_HANDLED;
+}
+
+/**
+ * adc_set_irq_enable() - Program the sampler's interrupt enables.
+ * @priv: The adc device; the caller holds @priv->lock, except in probe.
+ * @enable: New IRQ_ENABLE value.
+ */
+static void adc_set_irq_enable(struct adc_dev *priv, u32 enable)
+{
+	WRITE_ONCE(priv->irq_enable, enable);
+	iowrite32(enable, priv->base_addr + SAMPLER_IRQ_ENABLE);
+}
+
+/**
+ * adc_write_threshold() - Copy a channel's threshold window to the sampler.
+ * @priv: The adc device.
+ * @ch: The channel.
+ */
+static void adc_write_threshold(struct adc_dev *priv, unsigned int ch)
+{
+	iowrite32(READ_ONCE(priv->low_threshold[ch]) |
+		READ_ONCE(priv->high_threshold[ch]) << SAMPLER_THRESH_HIGH_SHIFT,
+		priv->base_addr + SAMPLER_THRESH(ch));
+}
+
+/**
+ * adc_scanned_channels() - Channels whose latest-value registers are fresh.
+ * @priv: The adc device; the caller holds @priv->lock.
+ *
+ * The Terasic controller and the idle sampler scan every channel. While
+ * capturing, the sampler scans only @priv->capture_mask, and the other
+ * channels keep whatever they last read.
+ *
+ * Return: The scanned channels; bit n is channel n.
+ */
+static u32 adc_scanned_channels(struct adc_dev *priv)
+{
+	if (priv->variant->has_fifo && priv->capturing) {
+		return priv->capture_mask;
 	}
+	return BIT(ADC_NUM_CHANNELS) - 1;
+}
+
+/**
+ * adc_sampler_ctrl() - Program the sampler's control register.
+ * @priv: The adc device; the caller holds @priv->lock.
+ *
+ * The sampler always scans, so the latest-value registers that sysfs, IIO
+ * and plain read()s use stay fresh. While capturing, it scans only the
+ * captured channels and also queues their samples in the FIFO.
+ */
+static void adc_sampler_ctrl(struct adc_dev *priv)
+{
+	u32 ctrl = SAMPLER_CTRL_SCAN;
+
+	if (priv->capturing) {
+		ctrl |= SAMPLER_CTRL_FIFO;
+	}
+
+	iowrite32(ctrl | adc_scanned_channels(priv) << SAMPLER_CTRL_MASK_SHIFT,
+		priv->base_addr + SAMPLER_CTRL);
+}
+
+/**
+ * adc_update_rate() - Apply a new streaming rate or channel mask.
+ * @priv: The adc device; the caller holds @priv->lock.
+ *
+ * With the Terasic controller the timer takes every scan itself, so its
+ * period is one scan. With the sampler, the rate goes to the hardware and the
+ * timer only has to drain the FIFO before it's half full. With the sampler's
+ * interrupt, the watermark is set to what the FIFO collects in
+ * SAMPLER_MAX_DRAIN_NS, but at least one scan and at most half the FIFO.
+ */
+static void adc_update_rate(struct adc_dev *priv)
+{
+	u64 drain_ns;
+	u32 nr_channels = hweight32(priv->capture_mask);
+	u64 watermark;
+
+	if (!priv->variant->has_fifo) {
+		WRITE_ONCE(priv->scan_period,
+			ns_to_ktime(NSEC_PER_SEC / priv->sample_rate_hz));
+		return;
+	}
+
+	iowrite32(SAMPLER_CLK_HZ / priv->sample_rate_hz,
+		priv->base_addr + SAMPLER_RATE);
+	adc_sampler_ctrl(priv);
+
+	if (priv->irq) {
+		watermark = div64_u64((u64)priv->sample_rate_hz * nr_channels *
+			SAMPLER_MAX_DRAIN_NS, NSEC_PER_SEC);
+		watermark = clamp_t(u64, watermark, nr_channels,
+			SAMPLER_FIFO_DEPTH / 2);
+		iowrite32(watermark, priv->base_addr + SAMPLER_WATERMARK);
+		return;
+	}
+
+	drain_ns = div64_u64((u64)NSEC_PER_SEC * (SAMPLER_FIFO_DEPTH / 2),
+		(u64)priv->sample_rate_hz * nr_channels);
+	drain_ns = clamp_t(u64, drain_ns, SAMPLER_MIN_DRAIN_NS,
+		SAMPLER_MAX_DRAIN_NS);
+	WRITE_ONCE(priv->scan_period, ns_to_ktime(drain_ns));
+}
+
+/**
+ * adc_update_capture_mask() - Work out which channels each scan samples.
+ * @priv: The adc device; the caller holds @priv->lock.
+ */
+static void adc_update_capture_mask(struct adc_dev *priv)
+{
+	u32 mask = priv->channel_mask;
+	unsigned int ch;
+
+	// Without its interrupt, the sampler's thresholds are checked by us
+	if (!priv->irq) {
+		mask |= adc_alarm_channels(priv);
+	}
+
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		if (priv->listeners[ch]) {
+			mask |= BIT(ch);
+		}
+	}
+
+	WRITE_ONCE(priv->capture_mask, mask);
+	adc_update_rate(priv);
+}
+
+/**
+ * adc_capture_start() - Start taking scans.
+ * @priv: The adc device; the caller holds @priv->lock.
+ */
+static void adc_capture_start(struct adc_dev *priv)
+{
+	priv->capturing = true;
+	adc_update_alarm_timer(priv);
+	adc_filter_reset(priv);
+
+	if (priv->variant->has_fifo) {
+		// Start from an empty FIFO and a fresh scan
+		priv->pending.channel_mask = 0;
+		priv->fifo_overflows = 0;
+		iowrite32(SAMPLER_STATUS_FLUSH | SAMPLER_STATUS_OVERFLOW,
+			priv->base_addr + SAMPLER_STATUS);
+		adc_sampler_ctrl(priv);
+	}
+
+	if (priv->irq) {
+		adc_set_irq_enable(priv, priv->irq_enable | SAMPLER_IRQ_WATERMARK);
+	}
+	else {
+		hrtimer_start(&priv->timer, priv->scan_period, HRTIMER_MODE_REL);
+	}
+}
+
+/**
+ * adc_capture_stop() - Stop taking scans.
+ * @priv: The adc device; the caller holds @priv->lock.
+ *
+ * Once this returns, nothing is writing to the ring or calling listeners.
+ */
+static void adc_capture_stop(struct adc_dev *priv)
+{
+	if (priv->irq) {
+		adc_set_irq_enable(priv, priv->irq_enable & ~SAMPLER_IRQ_WATERMARK);
+		synchronize_irq(priv->irq);
+	}
+	else {
+		hrtimer_cancel(&priv->timer);
+	}
+
+	priv->capturing = false;
+
+	if (priv->variant->has_fifo) {
+		adc_sampler_ctrl(priv);
+	}
+
+	adc_update_alarm_timer(priv);
+}
+
+/**
+ * adc_update_capture() - Take scans only while somebody wants them.
+ * @priv: The adc device; the caller holds @priv->lock.
+ */
+static void adc_update_capture(struct adc_dev *priv)
+{
+	bool want = priv->streaming;
+	unsigned int ch;
+
+	for (ch = 0; ch < ADC_NUM_CHANNELS && !want; ch++) {
+		want = priv->listeners[ch];
+	}
+
+	if (want && !priv->capturing) {
+		adc_capture_start(priv);
+	}
+	else if (!want && priv->capturing) {
+		adc_capture_stop(priv);
+	}
+}
+
+/**
+ * de10nano_adc_register_notifier() - Get called with every scan.
+ * @dev: The adc's device.
+ * @nb: Notifier block; its callback gets ADC_NOTIFY_SCAN and a
+ *      const struct adc_scan *.
+ * @channels: Channels the listener needs; bit n is channel n.
+ *
+ * Scans are taken at sample_rate_hz while anyone is listening, whether or
+ * not streaming is enabled, and always include @channels. The callback runs
+ * in atomic context.
+ *
+ * Return: 0 on success, -ENODEV if @dev isn't a bound adc, or -EINVAL for a
+ * bad @channels.
+ */
+int de10nano_adc_register_notifier(struct device *dev,
+	struct notifier_block *nb, u32 channels)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+	unsigned int ch;
+
+	if (!priv || dev->driver != &adc_driver.driver) {
+		return -ENODEV;
+	}
+	if (channels == 0 || channels >= BIT(ADC_NUM_CHANNELS)) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->lock);
+	atomic_notifier_chain_register(&priv->notifier, nb);
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		if (channels & BIT(ch)) {
+			priv->listeners[ch]++;
+		}
+	}
+
+	// Restart capture so the new channels are in every scan from now on.
+	if (priv->capturing) {
+		adc_capture_stop(priv);
+	}
+	adc_update_capture_mask(priv);
+	adc_update_capture(priv);
+	mutex_unlock(&priv->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(de10nano_adc_register_notifier);
+
+/**
+ * de10nano_adc_unregister_notifier() - Stop getting called with scans.
+ * @dev: The adc's device.
+ * @nb: Notifier block passed to de10nano_adc_register_notifier().
+ * @channels: The same channels passed to de10nano_adc_register_notifier().
+ *
+ * Once this returns, @nb's callback isn't running and won't be called again.
+ * If the adc has already been unbound, its notifier chain went with it, and
+ * there's nothing to do.
+ */
+void de10nano_adc_unregister_notifier(struct device *dev,
+	struct notifier_block *nb, u32 channels)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+	unsigned int ch;
+
+	if (!priv || dev->driver != &adc_driver.driver) {
+		return;
+	}
+
+	mutex_lock(&priv->lock);
+	atomic_notifier_chain_unregister(&priv->notifier, nb);
+	for (ch = 0; ch < ADC_NUM_CHANNELS; ch++) {
+		if ((channels & BIT(ch)) && priv->listeners[ch]) {
+			priv->listeners[ch]--;
+		}
+	}
+
+	if (priv->capturing) {
+		adc_capture_stop(priv);
+	}
+	adc_update_capture_mask(priv);
+	adc_update_capture(priv);
+	mutex_unlock(&priv->lock);
+}
+EXPORT_SYMBOL_GPL(de10nano_adc_unregister_notifier);
+
+/**
+ * adc_stream_read() - Drain scans from the streaming ring buffer.
+ * @priv: The adc device.
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to copy the scans into.
+ * @count: Size of @buf in bytes; at least one struct adc_scan.
+ *
+ * read() is one more consumer of the shared ring, with its position kept in
+ * @read_pos. Scans are copied into @bounce a chunk at a time and only handed
+ * to user space once the tail shows the timer didn't overwrite them during
+ * the copy. Scans the timer overwrote before we got to them are skipped and
+ * counted in @overruns.
+ *
+ * If no scans are waiting, this blocks until the timer produces one, unless
+ * the file was opened with O_NONBLOCK.
+ *
+ * Return: The number of bytes copied, 0 if streaming was disabled while
+ * waiting, or a negative error value.
+ */
+static ssize_t adc_stream_read(struct adc_dev *priv, struct file *file,
+	char __user *buf, size_t count)
+{
+	struct adc_ring_header *hdr = priv->hdr;
+	u32 max = count / sizeof(struct adc_scan);
+	u32 done = 0;
+	u32 pos, tail, n, i;
+	ssize_t ret;
+
+	if (max == 0) {
+		return -EINVAL;
+	}
+
+	if (mutex_lock_interruptible(&priv->lock)) {
+		return -ERESTARTSYS;
+	}
+
+	while (smp_load_acquire(&hdr->head) == priv->read_pos) {
+		mutex_unlock(&priv->lock);
+
+		if (file->f_flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		if (wait_event_interruptible(priv->wait,
+				smp_load_acquire(&hdr->head) != READ_ONCE(priv->read_pos) ||
+				!READ_ONCE(priv->streaming))) {
+			return -ERESTARTSYS;
+		}
+		if (!READ_ONCE(priv->streaming)) {
+			return 0;
+		}
+
+		if (mutex_lock_interruptible(&priv->lock)) {
+			return -ERESTARTSYS;
+		}
+	}
+
+	while (done < max) {
+		// Skip anything the timer has already overwritten.
+		tail = READ_ONCE(hdr->tail);
+		if ((s32)(priv->read_pos - tail) < 0) {
+			priv->overruns += tail - priv->read_pos;
+			priv->read_pos = tail;
+		}
+
+		pos = priv->read_pos;
+		n = min3(smp_load_acquire(&hdr->head) - pos, max - done,
+		         (u32)ADC_BOUNCE_SCANS);
+		if (n == 0) {
+			break;
+		}
+
+		for (i = 0; i < n; i++) {
+			priv->bounce[i] = priv->ring[(pos + i) & (ADC_RING_SCANS - 1)];
+		}
+
+		// If the timer lapped us mid-copy, drop the chunk and try again.
+		smp_rmb();
+		if ((s32)(pos - READ_ONCE(hdr->tail)) < 0) {
+			continue;
+		}
+
+		if (copy_to_user(buf + done * sizeof(struct adc_scan), priv->bounce,
+				n * sizeof(struct adc_scan))) {
+			break;
+		}
+
+		priv->read_pos = pos + n;
+		done += n;
+	}
+
+	ret = done ? done * sizeof(struct adc_scan) : -EFAULT;
+
+	mutex_unlock(&priv->lock);
+	return ret;
+}
+
+/**
+ * adc_mmap() - Map the shared scan ring into user space.
+ * @file: Pointer to the char device file struct.
+ * @vma: The user-space mapping being set up.
+ *
+ * The mapping starts with struct adc_ring_header and is followed by the scan
+ * array at data_offset. It must be read-only and start at offset 0; it may
+ * be shorter than the whole ring only if the caller doesn't need all of it.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static int adc_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct adc_dev *priv = container_of(file->private_data,
+	                              struct adc_dev, miscdev);
+
+	if (vma->vm_pgoff != 0 ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(ADC_RING_SIZE)) {
+		return -EINVAL;
+	}
+
+	// Only the driver writes to the ring; readers keep their own position.
+	if (vma->vm_flags & VM_WRITE) {
+		return -EPERM;
+	}
+	vm_flags_clear(vma, VM_MAYWRITE);
+
+	return remap_vmalloc_range(vma, priv->ring_mem, 0);
+}
+
+/**
+ * adc_poll() - Poll method for the adc char device
+ * @file: Pointer to the char device file struct.
+ * @wait: Poll table to register our wait queue with.
+ *
+ * EPOLLIN means read() won't block: either streaming is off and reads go
+ * straight to the registers, or scans are waiting in the ring. EPOLLPRI means
+ * a threshold crossing is latched in alarm_status; it stays set until user
+ * space clears the latched bits through sysfs. Waiting only for EPOLLPRI
+ * sleeps through ordinary scans and wakes on a new crossing, within one scan
+ * period of it happening, or while nothing is capturing, within
+ * 1/ADC_ALARM_RATE_HZ.
+ *
+ * Return: The mask of events that are ready.
+ */
+static __poll_t adc_poll(struct file *file, poll_table *wait)
+{
+	struct adc_dev *priv = container_of(file->private_data,
+	                              struct adc_dev, miscdev);
+	__poll_t mask = 0;
+
+	poll_wait(file, &priv->wait, wait);
+
+	if (!READ_ONCE(priv->streaming) ||
+	    smp_load_acquire(&priv->hdr->head) != READ_ONCE(priv->read_pos)) {
+		mask |= EPOLLIN | EPOLLRDNORM;
+	}
+	if (atomic_read(&priv->alarm_status)) {
+		mask |= EPOLLPRI;
+	}
+
+	return mask;
+}
+
+/**
+ * adc_ioctl() - ioctl method for the adc char device
+ * @file: Pointer to the char device file struct.
+ * @cmd: The ioctl command; see de10nano_adc.h.
+ * @arg: The command's user-space argument.
+ *
+ * ADC_IOC_SNAPSHOT reads the scanned channels under the device lock, so the
+ * channels are sampled back-to-back with a single timestamp and can't be
+ * interleaved with another process's register accesses. One call replaces
+ * eight read()s or eight sysfs reads. While the sampler is capturing, only
+ * the captured channels are fresh, so only those are reported.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long adc_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct adc_dev *priv = container_of(file->private_data,
+	                              struct adc_dev, miscdev);
+	struct adc_scan scan = { 0 };
+
+	switch (cmd) {
+	case ADC_IOC_SNAPSHOT:
+		mutex_lock(&priv->lock);
+		adc_take_scan(priv, adc_scanned_channels(priv), &scan);
+		mutex_unlock(&priv->lock);
+
+		if (copy_to_user((void __user *)arg, &scan, sizeof(scan))) {
+			return -EFAULT;
+		}
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+/**
+ * adc_free_ring() - Free the shared ring when the device goes away.
+ * @ring_mem: The vmalloc'd ring memory.
+ *
+ * Pages still mapped into a process stay alive until it unmaps them.
+ */
+static void adc_free_ring(void *ring_mem)
+{
+	vfree(ring_mem);
+}
+
+// Instance numbers for devm_kirkland_node_name()
+static DEFINE_IDA(adc_ida);
+
+/**
+ * adc_read() - Read method for the adc char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the value into.
+ * @count: The number of bytes being requested.
+ * @offset: The byte offset in the file being read from.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t adc_read(struct file *file, char __user *buf,
+	size_t count, loff_t *offset)
+{
+	u32 vals[SPAN / sizeof(u32)];
+	size_t n, i;
+
+	/*
+	 * Get the device's private data from the file struct's private_data
+	 * field. The private_data field is equal to the miscdev field in the
+	 * adc_dev struct. container_of returns the 
+     * adc_dev struct that contains the miscdev in private_data.
+	 */
+	struct adc_dev *priv = container_of(file->private_data,
+	                            struct adc_dev, miscdev);
+
+	// In streaming mode, reads drain scans instead of reading registers.
+	if (READ_ONCE(priv->streaming)) {
+		return adc_stream_read(priv, file, buf, count);
+	}
+
+	// Check file offset to make sure we are reading from a valid location.
+	if (*offset < 0) {
+		// We can't read from a negative file position.
+		return -EINVAL;
+	}
+	if (*offset >= SPAN) {
+		// We can't read from a position past the end of our device.
+		return 0;
+	}
+	if ((*offset % 0x4) != 0) {
+		// Prevent unaligned access.
+		pr_warn("adc_read: unaligned access\n");
+		return -EFAULT;
+	}
+
+	// Number of whole channel registers requested before the end of the device.
+	n = min_t(size_t, count, SPAN - *offset) / sizeof(u32);
+	if (n == 0) {
+		// We only move whole registers.
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->lock);
+	for (i = 0; i < n; i++) {
+		vals[i] = ioread32(priv->base_addr + *offset + i * sizeof(u32))
+			& ADC_VALUE_BITMASK;
+	}
+	mutex_unlock(&priv->lock);
+
+	// Copy the values to userspace.
+	if (copy_to_user(buf, vals, n * sizeof(u32))) {
+		pr_warn("adc_read: nothing copied\n");
+		return -EFAULT;
+	}
+
+	// Increment the file offset by the number of bytes we read.
+	*offset = *offset + n * sizeof(u32);
+
+	return n * sizeof(u32);
+}
+
+/**
+ * adc_write() - Write method for the adc char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the value from.
+ * @count: The number of bytes being written.
+ * @offset: The byte offset in the file being written to.
+ *
+ * Only the update and auto_update registers are writable, so a write can
+ * cover at most those two words.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t adc_write(struct file *file, const char __user *buf,
+	size_t count, loff_t *offset)
+{
+	u32 vals[WRITE_SPAN / sizeof(u32)];
+	size_t n, i;
+
+	struct adc_dev *priv = container_of(file->private_data,
+	                              struct adc_dev, miscdev);
+
+	if (*offset < 0) {
+		return -EINVAL;
+	}
+	if (*offset >= WRITE_SPAN) {
+		// can't write past to the read-only adc channel registers
+		return -EINVAL;
+	}
+	if ((*offset % 0x4) != 0) {
+		pr_warn("adc_write: unaligned access\n");
+		return -EFAULT;
+	}
+
+	n = min_t(size_t, count, WRITE_SPAN - *offset) / sizeof(u32);
+	if (n == 0) {
+		return -EINVAL;
+	}
+
+	// Get the values from userspace before taking the lock; this can fault.
+	if (copy_from_user(vals, buf, n * sizeof(u32))) {
+		pr_warn("adc_write: nothing copied from user space\n");
+		return -EFAULT;
+	}
+
+	mutex_lock(&priv->lock);
+
+	for (i = 0; i < n; i++) {
+		iowrite32(vals[i], priv->base_addr + *offset + i * sizeof(u32));
+
+		// Keep the shadow copy of the write-only auto_update register in sync.
+		if (*offset + i * sizeof(u32) == AUTO_UPDATE) {
+			priv->auto_update = vals[i] != 0;
+		}
+	}
+
+	mutex_unlock(&priv->lock);
+
+	// Increment the file offset by the number of bytes we wrote.
+	*offset = *offset + n * sizeof(u32);
+
+	// Return the number of bytes we wrote.
+	return n * sizeof(u32);
+}
+
+/** 
+ *  adc_fops - File operations supported by the  
+ *                          adc driver
+ * @owner: The adc driver owns the file operations; this 
+ *         ensures that the driver can't be removed while the 
+ *         character device is still in use.
+ * @read: The read function.
+ * @write: The write function.
+ * @llseek: We use the kernel's default_llseek() function; this allows 
+ *          users to change what position they are writing/reading to/from.
+ * @mmap: Maps the shared streaming scan ring.
+ * @poll: Reports readable scans and latched threshold crossings.
+ * @unlocked_ioctl: Handles ADC_IOC_SNAPSHOT.
+ * @compat_ioctl: The ioctl argument is a plain pointer, so 32-bit callers
+ *                can use the same handler.
+ */
+static const struct file_operations  adc_fops = {
+	.owner = THIS_MODULE,
+	.read = adc_read,
+	.write = adc_write,
+	.llseek = default_llseek,
+	.mmap = adc_mmap,
+	.poll = adc_poll,
+	.unlocked_ioctl = adc_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+};
+
+/**
+ * adc_iio_read_raw() - Read a channel value or the scale through IIO.
+ * @indio_dev: The adc's IIO device.
+ * @chan: The channel being read.
+ * @val: First part of the value.
+ * @val2: Second part of the value.
+ * @mask: Which IIO_CHAN_INFO_* is being read.
+ *
+ * in_voltageN_raw reads the channel register directly, just like chN_raw.
+ * in_voltage_scale is VREFCOMP / 2^12 mV per count.
+ *
+ * Return: An IIO_VAL_* type on success, or -EINVAL.
+ */
+static int adc_iio_read_raw(struct iio_dev *indio_dev,
+	struct iio_chan_spec const *chan, int *val, int *val2, long mask)
+{
+	struct adc_dev *priv = *(struct adc_dev **)iio_priv(indio_dev);
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		*val = ioread32(priv->base_addr + chan->channel * sizeof(u32))
+			& ADC_VALUE_BITMASK;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		*val = ADC_VREF_MV;
+		*val2 = ADC_RESOLUTION_BITS;
+		return IIO_VAL_FRACTIONAL_LOG2;
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * adc_iio_trigger_handler() - Push one scan into the IIO buffer.
+ * @irq: Unused.
+ * @p: The trigger's poll function.
+ *
+ * This runs in the trigger's threaded handler every time the attached
+ * trigger (e.g. an iio-trig-hrtimer instance) fires. Only the channels in
+ * the active scan mask are read, packed in channel order; the IIO core
+ * stores the result in the buffer's kfifo.
+ *
+ * Return: IRQ_HANDLED.
+ */
+static irqreturn_t adc_iio_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct adc_dev *priv = *(struct adc_dev **)iio_priv(indio_dev);
+	unsigned int bit;
+	unsigned int i = 0;
+
+	memset(&priv->iio_scan, 0, sizeof(priv->iio_scan));
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask, ADC_NUM_CHANNELS) {
+		priv->iio_scan.ch[i++] = ioread32(priv->base_addr +
+			bit * sizeof(u32)) & ADC_VALUE_BITMASK;
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, &priv->iio_scan, pf->timestamp);
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
+static const struct iio_info adc_iio_info = {
+	.read_raw = adc_iio_read_raw,
+};
+
+#define ADC_IIO_CHAN(_ch) { \
+	.type = IIO_VOLTAGE, \
+	.indexed = 1, \
+	.channel = (_ch), \
+	.info_mask_separate = BIT(IIO_CHAN_INFO_RAW), \
+	.info_mask_shared_by_type = BIT(IIO_CHAN_INFO_SCALE), \
+	.scan_index = (_ch), \
+	.scan_type = { \
+		.sign = 'u', \
+		.realbits = ADC_RESOLUTION_BITS, \
+		.storagebits = 16, \
+		.endianness = IIO_CPU, \
+	}, \
+}
+
+static const struct iio_chan_spec adc_iio_channels[] = {
+	ADC_IIO_CHAN(0),
+	ADC_IIO_CHAN(1),
+	ADC_IIO_CHAN(2),
+	ADC_IIO_CHAN(3),
+	ADC_IIO_CHAN(4),
+	ADC_IIO_CHAN(5),
+	ADC_IIO_CHAN(6),
+	ADC_IIO_CHAN(7),
+	IIO_CHAN_SOFT_TIMESTAMP(ADC_NUM_CHANNELS),
+};
+
+/**
+ * adc_iio_register() - Register the IIO front end for an adc device.
+ * @pdev: The adc's platform device.
+ * @priv: The adc device.
+ *
+ * The IIO device exposes in_voltageN_raw and in_voltage_scale, and a
+ * triggered buffer over all eight channels plus a timestamp. Everything is
+ * device-managed, so it's torn down automatically when the device goes away.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static int adc_iio_register(struct platform_device *pdev,
+	struct adc_dev *priv)
+{
+	struct iio_dev *indio_dev;
+	int ret;
+
+	indio_dev = devm_iio_device_alloc(&pdev->dev, sizeof(priv));
+	if (!indio_dev) {
+		return -ENOMEM;
+	}
+	*(struct adc_dev **)iio_priv(indio_dev) = priv;
+	priv->indio_dev = indio_dev;
+
+	indio_dev->name = "de10nano_adc";
+	indio_dev->info = &adc_iio_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	indio_dev->channels = adc_iio_channels;
+	indio_dev->num_channels = ARRAY_SIZE(adc_iio_channels);
+
+	ret = devm_iio_triggered_buffer_setup(&pdev->dev, indio_dev,
+		iio_pollfunc_store_time, adc_iio_trigger_handler, NULL);
+	if (ret) {
+		return ret;
+	}
+
+	return devm_iio_device_register(&pdev->dev, indio_dev);
+}
+
+/**
+ * XXX: both update and auto_update appear to be useless. The ADC *always*
+ * auto updates regardless of what settings are used. Not that we can tell
+ * what settings are used since the registers are read-only... :^| stupid!!!
+ * Setting auto_update does set bit 15 high as a "refresh flag" as described
+ * in the VHDL component's datasheet, but the values update every time you read
+ * a channel register even when auto_update is off and bit 15 is low.
+ * (╯°□°）╯︵ ┻━┻
+ * Whatever... the adc channels update when we read, so that's all we want...
+ */
+/**
+ * update_store() - Start new ADC conversions.
+ * 
+ * Writing *any* value to the update register triggers an update.
+ * 
+ * @dev: Device structure for the adc component. This 
+ *       device struct is embedded in the adc's platform 
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the value being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t update_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	/* 
+	 * Since writing any value to the update register triggers an update,
+	 * it doesn't matter what we write or what the user writes. So we ignore
+	 * what the user wants to write and just write a 1 :)
+	 */
+	iowrite32(1, priv->base_addr + UPDATE);
+
+	return 4;
+}
+
+/**
+ * auto_update_store() - Enable/disable auto-update
+ * 
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that contains the value being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t auto_update_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+
+	int ret;
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtobool(buf, &(priv->auto_update));
+	if (ret < 0) {
+		return ret;
+	}
+
+	iowrite32(priv->auto_update, priv->base_addr + AUTO_UPDATE);
+
+	return size;
+}
+
+/**
+ * auto_update_show() - Read the auto_update setting.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t auto_update_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	/*
+	 * The auto_update register is actually a write-only register (dumb!), so
+	 * we return our shadow copy.
+	 */
+	return scnprintf(buf, PAGE_SIZE, "%u\n", priv->auto_update);
+}
+
+/**
+ * adc_ch_show() - Read ADC channel value.
+ * 
+ * @dev: Device structure for the adc component. 
+ * @attr: Which adc channel attribute we're reading from.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t adc_ch_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	u16 adc_value;
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	struct dev_ext_attribute *ch_attr = container_of(attr, 
+		struct dev_ext_attribute, attr);
+
+	u32 ch_offset = *(u32 *)(ch_attr->var);
+
+	adc_value = ioread32(priv->base_addr + ch_offset) & ADC_VALUE_BITMASK;
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", adc_value);
+}
+
+/**
+ * stream_enable_store() - Start or stop streaming mode.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that contains the value being written.
+ * @size: The number of bytes being written.
+ *
+ * Enabling streaming empties the ring buffer, resets the overrun count, and
+ * starts the sampling timer. Scan sequence numbers keep counting up across
+ * restarts so mmap() readers never see the head move backwards. Disabling
+ * streaming stops the timer and wakes any blocked readers, which then
+ * return 0.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t stream_enable_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	int ret;
+	bool enable;
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtobool(buf, &enable);
+	if (ret < 0) {
+		return ret;
+	}
+
+	mutex_lock(&priv->lock);
+
+	if (enable != priv->streaming) {
+		/*
+		 * Capture may be running for in-kernel listeners; stop it so
+		 * nobody else writes to the ring here. It restarts below if
+		 * anyone still wants scans.
+		 */
+		if (priv->capturing) {
+			adc_capture_stop(priv);
+		}
+
+		if (enable) {
+			WRITE_ONCE(priv->hdr->tail, priv->hdr->head);
+			priv->read_pos = priv->hdr->head;
+			priv->overruns = 0;
+		}
+		WRITE_ONCE(priv->streaming, enable);
+		adc_update_capture(priv);
+
+		if (!enable) {
+			wake_up_interruptible(&priv->wait);
+		}
+	}
+
+	mutex_unlock(&priv->lock);
+
+	return size;
+}
+
+/**
+ * stream_enable_show() - Read whether streaming mode is enabled.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t stream_enable_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->streaming));
+}
+
+/**
+ * sample_rate_hz_store() - Set the streaming scan rate.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that contains the rate in scans per second.
+ * @size: The number of bytes being written.
+ *
+ * The new rate takes effect after the next scan if streaming is running.
+ *
+ * Return: The number of bytes stored, or -EINVAL if the rate is outside
+ * ADC_MIN_SAMPLE_RATE_HZ up to the variant's maximum (ADC_MAX_SAMPLE_RATE_HZ
+ * for the Terasic controller, SAMPLER_MAX_SAMPLE_RATE_HZ for the sampler).
+ */
+static ssize_t sample_rate_hz_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	int ret;
+	unsigned long rate;
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtoul(buf, 0, &rate);
+	if (ret < 0) {
+		return ret;
+	}
+	if (rate < ADC_MIN_SAMPLE_RATE_HZ || rate > priv->variant->max_sample_rate_hz) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->lock);
+	priv->sample_rate_hz = rate;
+	adc_update_rate(priv);
+	mutex_unlock(&priv->lock);
+
+	return size;
+}
+
+/**
+ * sample_rate_hz_show() - Read the streaming scan rate.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t sample_rate_hz_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lu\n", priv->sample_rate_hz);
+}
+
+/**
+ * channel_mask_store() - Choose which channels each streaming scan samples.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that contains the mask; bit n enables channel n.
+ * @size: The number of bytes being written.
+ *
+ * Sampling fewer channels makes each scan shorter, since every channel costs
+ * a read across the lightweight HPS-to-FPGA bridge, or with the sampler, a
+ * conversion and a FIFO entry. A running capture is restarted, so no scan
+ * mixes the old and new masks.
+ *
+ * Return: The number of bytes stored, or -EINVAL for an empty mask or a mask
+ * with bits above channel 7.
+ */
+static ssize_t channel_mask_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	int ret;
+	u32 mask;
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtou32(buf, 0, &mask);
+	if (ret < 0) {
+		return ret;
+	}
+	if (mask == 0 || mask >= BIT(ADC_NUM_CHANNELS)) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->lock);
+	WRITE_ONCE(priv->channel_mask, mask);
+
+	// Restart capture so every scan from now on has the new channels
+	if (priv->capturing) {
+		adc_capture_stop(priv);
+	}
+	adc_update_capture_mask(priv);
+	adc_update_capture(priv);
+	mutex_unlock(&priv->lock);
+
+	return size;
+}
+
+/**
+ * channel_mask_show() - Read the streaming channel mask.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t channel_mask_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "0x%02x\n", READ_ONCE(priv->channel_mask));
+}
+
+/**
+ * overruns_show() - Read how many streaming scans have been dropped.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * read() misses scans when it falls a whole ring buffer behind and the
+ * sampling timer overwrites them.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t overruns_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->overruns));
+}
+
+/**
+ * adc_filter_show() - Read a channel's filter.
+ * @dev: Device structure for the adc component. 
+ * @attr: Which channel's filter attribute we're reading from.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t adc_filter_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+	struct dev_ext_attribute *ch_attr = container_of(attr,
+		struct dev_ext_attribute, attr);
+	unsigned int ch = *(u32 *)(ch_attr->var) / sizeof(u32);
 
-	val = ioread32(priv->base_addr + *offset) & ADC_VALUE_BITMASK;
+	return scnprintf(buf, PAGE_SIZE, "%s\n",
+		adc_filter_names[READ_ONCE(priv->filter[ch].type)]);
+}
 
-	// Copy the value to userspace.
-	ret = copy_to_user(buf, &val, sizeof(val));
-	if (ret == sizeof(val)) {
-		pr_warn("adc_read: nothing copied\n");
-		return -EFAULT;
+/**
+ * adc_filter_store() - Choose a channel's filter.
+ * @dev: Device structure for the adc component. 
+ * @attr: Which channel's filter attribute we're writing to.
+ * @buf: Buffer that contains "none", "boxcar", "iir" or "median".
+ * @size: The number of bytes being written.
+ *
+ * Every filter's state starts over, since the scans it was fed so far
+ * belong to the old configuration.
+ *
+ * Return: The number of bytes stored, or -EINVAL for an unknown filter.
+ */
+static ssize_t adc_filter_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	int type;
+	struct adc_dev *priv = dev_get_drvdata(dev);
+	struct dev_ext_attribute *ch_attr = container_of(attr,
+		struct dev_ext_attribute, attr);
+	unsigned int ch = *(u32 *)(ch_attr->var) / sizeof(u32);
+
+	type = sysfs_match_string(adc_filter_names, buf);
+	if (type < 0) {
+		return type;
 	}
 
-	// Increment the file offset by the number of bytes we read.
-	*offset = *offset + sizeof(val);
+	mutex_lock(&priv->lock);
+	if (priv->capturing) {
+		adc_capture_stop(priv);
+	}
+	WRITE_ONCE(priv->filter[ch].type, type);
+	adc_filter_reset(priv);
+	adc_update_capture(priv);
+	mutex_unlock(&priv->lock);
 
-	return sizeof(val);
+	return size;
 }
 
 /**
- * adc_write() - Write method for the adc char device
- * @file: Pointer to the char device file struct.
- * @buf: User-space buffer to read the value from.
- * @count: The number of bytes being written.
- * @offset: The byte offset in the file being written to.
+ * decimation_store() - Set how many captured scans make one output scan.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that contains the decimation factor.
+ * @size: The number of bytes being written.
  *
- * Return: On success, the number of bytes written is returned and the
- * offset @offset is advanced by this number. On error, a negative error
- * value is returned.
+ * Scans are captured at sample_rate_hz, so streaming readers and listeners
+ * get sample_rate_hz / decimation scans per second. This is also the boxcar
+ * length and, from 3 up, the median window.
+ *
+ * Return: The number of bytes stored, or -EINVAL if the factor is outside
+ * 1..ADC_MAX_DECIMATION.
  */
-static ssize_t adc_write(struct file *file, const char __user *buf,
-	size_t count, loff_t *offset)
+static ssize_t decimation_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
 {
-	size_t ret;
-	u32 val;
-
-	struct adc_dev *priv = container_of(file->private_data,
-	                              struct adc_dev, miscdev);
+	int ret;
+	u32 decimation;
+	struct adc_dev *priv = dev_get_drvdata(dev);
 
-	if (*offset < 0) {
-		return -EINVAL;
+	ret = kstrtou32(buf, 0, &decimation);
+	if (ret < 0) {
+		return ret;
 	}
-	if (*offset >= AUTO_UPDATE) {
-		// can't write past to the read-only adc channel registers
+	if (decimation < 1 || decimation > ADC_MAX_DECIMATION) {
 		return -EINVAL;
 	}
-	if ((*offset % 0x4) != 0) {
-		pr_warn("adc_write: unaligned access\n");
-		return -EFAULT;
-	}
 
 	mutex_lock(&priv->lock);
+	if (priv->capturing) {
+		adc_capture_stop(priv);
+	}
+	WRITE_ONCE(priv->decimation, decimation);
+	adc_filter_reset(priv);
+	adc_update_capture(priv);
+	mutex_unlock(&priv->lock);
+
+	return size;
+}
+
+/**
+ * decimation_show() - Read the decimation factor.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t decimation_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
 
-	// Get the value from userspace.
-	ret = copy_from_user(&val, buf, sizeof(val));
-	if (ret != sizeof(val)) {
-		iowrite32(val, priv->base_addr + *offset);
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->decimation));
+}
 
-		// Increment the file offset by the number of bytes we wrote.
-		*offset = *offset + sizeof(val);
+/**
+ * iir_shift_store() - Set the IIR filters' time constant.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that contains the shift.
+ * @size: The number of bytes being written.
+ *
+ * An IIR filter moves 1/2^shift of the way toward each captured sample, so
+ * it settles in roughly 2^shift captured scans.
+ *
+ * Return: The number of bytes stored, or -EINVAL if the shift is outside
+ * 1..ADC_MAX_IIR_SHIFT.
+ */
+static ssize_t iir_shift_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
+{
+	int ret;
+	u32 shift;
+	struct adc_dev *priv = dev_get_drvdata(dev);
 
-		// Return the number of bytes we wrote.
-		ret = sizeof(val);
+	ret = kstrtou32(buf, 0, &shift);
+	if (ret < 0) {
+		return ret;
 	}
-	else {
-		pr_warn("adc_write: nothing copied from user space\n");
-		ret = -EFAULT;
+	if (shift < 1 || shift > ADC_MAX_IIR_SHIFT) {
+		return -EINVAL;
 	}
 
+	mutex_lock(&priv->lock);
+	if (priv->capturing) {
+		adc_capture_stop(priv);
+	}
+	WRITE_ONCE(priv->iir_shift, shift);
+	adc_update_capture(priv);
 	mutex_unlock(&priv->lock);
-	return ret;
-}
 
-/** 
- *  adc_fops - File operations supported by the  
- *                          adc driver
- * @owner: The adc driver owns the file operations; this 
- *         ensures that the driver can't be removed while the 
- *         character device is still in use.
- * @read: The read function.
- * @write: The write function.
- * @llseek: We use the kernel's default_llseek() function; this allows 
- *          users to change what position they are writing/reading to/from.
- */
-static const struct file_operations  adc_fops = {
-	.owner = THIS_MODULE,
-	.read = adc_read,
-	.write = adc_write,
-	.llseek = default_llseek,
-};
+	return size;
+}
 
 /**
- * XXX: both update and auto_update appear to be useless. The ADC *always*
- * auto updates regardless of what settings are used. Not that we can tell
- * what settings are used since the registers are read-only... :^| stupid!!!
- * Setting auto_update does set bit 15 high as a "refresh flag" as described
- * in the VHDL component's datasheet, but the values update every time you read
- * a channel register even when auto_update is off and bit 15 is low.
- * (╯°□°）╯︵ ┻━┻
- * Whatever... the adc channels update when we read, so that's all we want...
+ * iir_shift_show() - Read the IIR filters' shift.
+ * @dev: Device structure for the adc component. 
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
  */
+static ssize_t iir_shift_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->iir_shift));
+}
+
 /**
- * update_store() - Start new ADC conversions.
- * 
- * Writing *any* value to the update register triggers an update.
- * 
- * @dev: Device structure for the adc component. This 
- *       device struct is embedded in the adc's platform 
- *       device struct.
+ * fifo_overflows_show() - Read how often the sampler's FIFO overflowed.
+ * @dev: Device structure for the adc component. 
  * @attr: Unused.
- * @buf: Buffer that contains the value being written.
- * @size: The number of bytes being written.
+ * @buf: Buffer that gets returned to user-space.
  *
- * Return: The number of bytes stored.
+ * Counts drains that found samples had been dropped because the FIFO was
+ * full; always 0 with the Terasic controller.
+ *
+ * Return: The number of bytes read.
  */
-static ssize_t update_store(struct device *dev,
-	struct device_attribute *attr, const char *buf, size_t size)
+static ssize_t fifo_overflows_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
 {
 	struct adc_dev *priv = dev_get_drvdata(dev);
 
-	/* 
-	 * Since writing any value to the update register triggers an update,
-	 * it doesn't matter what we write or what the user writes. So we ignore
-	 * what the user wants to write and just write a 1 :)
-	 */
-	iowrite32(1, priv->base_addr + UPDATE);
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->fifo_overflows));
+}
 
-	return 4;
+/**
+ * adc_threshold_show() - Read a channel's high or low alarm threshold.
+ * @dev: Device structure for the adc component. 
+ * @attr: Which threshold attribute we're reading from.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t adc_threshold_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct adc_dev *priv = dev_get_drvdata(dev);
+	struct dev_ext_attribute *ch_attr = container_of(attr,
+		struct dev_ext_attribute, attr);
+	unsigned int ch = *(u32 *)(ch_attr->var) / sizeof(u32);
+	bool high = strstr(attr->attr.name, "high") != NULL;
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", high ?
+		READ_ONCE(priv->high_threshold[ch]) :
+		READ_ONCE(priv->low_threshold[ch]));
 }
 
 /**
- * auto_update_store() - Enable/disable auto-update
- * 
+ * adc_threshold_store() - Set a channel's high or low alarm threshold.
  * @dev: Device structure for the adc component. 
- * @attr: Unused.
- * @buf: Buffer that contains the value being written.
+ * @attr: Which threshold attribute we're writing to.
+ * @buf: Buffer that contains the raw 12-bit threshold.
  * @size: The number of bytes being written.
  *
- * Return: The number of bytes stored.
+ * A scan raises a high alarm when the channel is above its high threshold
+ * and a low alarm when it's below its low threshold. The defaults (high
+ * 4095, low 0) can never be crossed, so alarms are off until set. Without
+ * the sampler's interrupt, a channel with a threshold set is checked in
+ * every scan, and at ADC_ALARM_RATE_HZ while nothing is capturing.
+ *
+ * Return: The number of bytes stored, or -ERANGE for values wider than
+ * 12 bits.
  */
-static ssize_t auto_update_store(struct device *dev,
+static ssize_t adc_threshold_store(struct device *dev,
 	struct device_attribute *attr, const char *buf, size_t size)
 {
-
 	int ret;
+	u16 threshold;
 	struct adc_dev *priv = dev_get_drvdata(dev);
+	struct dev_ext_attribute *ch_attr = container_of(attr,
+		struct dev_ext_attribute, attr);
+	unsigned int ch = *(u32 *)(ch_attr->var) / sizeof(u32);
 
-	ret = kstrtobool(buf, &(priv->auto_update));
+	ret = kstrtou16(buf, 0, &threshold);
 	if (ret < 0) {
 		return ret;
 	}
+	if (threshold > ADC_VALUE_BITMASK) {
+		return -ERANGE;
+	}
 
-	iowrite32(priv->auto_update, priv->base_addr + AUTO_UPDATE);
+	mutex_lock(&priv->lock);
+	if (strstr(attr->attr.name, "high")) {
+		WRITE_ONCE(priv->high_threshold[ch], threshold);
+	}
+	else {
+		WRITE_ONCE(priv->low_threshold[ch], threshold);
+	}
+
+	if (priv->irq) {
+		adc_write_threshold(priv, ch);
+	}
+	else {
+		// Check the channel in every scan, restarting capture so it's
+		// in all of them, or with nothing capturing, from the alarm
+		// timer
+		if (priv->capturing) {
+			adc_capture_stop(priv);
+		}
+		adc_update_capture_mask(priv);
+		adc_update_capture(priv);
+		adc_update_alarm_timer(priv);
+	}
+	mutex_unlock(&priv->lock);
 
 	return size;
 }
 
 /**
- * auto_update_show() - Read the auto_update setting.
+ * alarm_status_show() - Read the latched threshold crossings.
  * @dev: Device structure for the adc component. 
  * @attr: Unused.
  * @buf: Buffer that gets returned to user-space.
  *
+ * Bits 0-7 are high-threshold crossings on channels 0-7 and bits 8-15 are
+ * low-threshold crossings. This attribute supports sysfs poll(), as an
+ * alternative to polling /dev/adc for EPOLLPRI.
+ *
  * Return: The number of bytes read.
  */
-static ssize_t auto_update_show(struct device *dev,
+static ssize_t alarm_status_show(struct device *dev,
 	struct device_attribute *attr, char *buf)
 {
 	struct adc_dev *priv = dev_get_drvdata(dev);
 
-	/*
-	 * The auto_update register is actually a write-only register (dumb!), so
-	 * we return our shadow copy.
-	 */
-	return scnprintf(buf, PAGE_SIZE, "%u\n", priv->auto_update);
+	return scnprintf(buf, PAGE_SIZE, "0x%04x\n",
+		atomic_read(&priv->alarm_status));
 }
 
 /**
- * adc_ch_show() - Read ADC channel value.
- * 
+ * alarm_status_store() - Acknowledge latched threshold crossings.
  * @dev: Device structure for the adc component. 
- * @attr: Which adc channel attribute we're reading from.
- * @buf: Buffer that gets returned to user-space.
+ * @attr: Unused.
+ * @buf: Buffer that contains the bits to clear.
+ * @size: The number of bytes being written.
  *
- * Return: The number of bytes read.
+ * Like an interrupt status register, writing a 1 to a bit clears it.
+ *
+ * Return: The number of bytes stored.
  */
-static ssize_t adc_ch_show(struct device *dev,
-	struct device_attribute *attr, char *buf)
+static ssize_t alarm_status_store(struct device *dev,
+	struct device_attribute *attr, const char *buf, size_t size)
 {
-	u16 adc_value;
+	int ret;
+	u32 clear;
 	struct adc_dev *priv = dev_get_drvdata(dev);
 
-	struct dev_ext_attribute *ch_attr = container_of(attr, 
-		struct dev_ext_attribute, attr);
-
-	u32 ch_offset = *(u32 *)(ch_attr->var);
+	ret = kstrtou32(buf, 0, &clear);
+	if (ret < 0) {
+		return ret;
+	}
 
-	adc_value = ioread32(priv->base_addr + ch_offset) & ADC_VALUE_BITMASK;
+	atomic_andnot(clear & ADC_ALARM_MASK, &priv->alarm_status);
 
-	return scnprintf(buf, PAGE_SIZE, "%u\n", adc_value);
+	return size;
 }
 
 /*
@@ -297,6 +2265,21 @@ static ssize_t adc_ch_show(struct device *dev,
 	struct dev_ext_attribute dev_attr_##_name = \
 		{ __ATTR(_name, 0444, adc_ch_show, NULL), &(_reg_offset) }
 
+/*
+ * DEVICE_ADC_THRESH_ATTR works the same way; the show and store functions
+ * tell high from low thresholds by the attribute's name.
+ */
+#define DEVICE_ADC_THRESH_ATTR(_name, _reg_offset) \
+	struct dev_ext_attribute dev_attr_##_name = \
+		{ __ATTR(_name, 0644, adc_threshold_show, adc_threshold_store), \
+		  &(_reg_offset) }
+
+// DEVICE_ADC_FILTER_ATTR picks a channel's filter the same way.
+#define DEVICE_ADC_FILTER_ATTR(_name, _reg_offset) \
+	struct dev_ext_attribute dev_attr_##_name = \
+		{ __ATTR(_name, 0644, adc_filter_show, adc_filter_store), \
+		  &(_reg_offset) }
+
 #define DEVICE_ULONG_ATTR_RO(_name, _var) \
 	struct dev_ext_attribute dev_attr_##_name = \
 		{ __ATTR(_name, 0444, device_show_ulong, NULL), &(_var) }
@@ -312,6 +2295,38 @@ static DEVICE_ADC_CH_ATTR(ch5_raw, CH5);
 static DEVICE_ADC_CH_ATTR(ch6_raw, CH6);
 static DEVICE_ADC_CH_ATTR(ch7_raw, CH7);
 static DEVICE_ULONG_ATTR_RO(voltage_scale_mv, VOLTAGE_SCALE_MV);
+static DEVICE_ATTR_RW(stream_enable);
+static DEVICE_ATTR_RW(sample_rate_hz);
+static DEVICE_ATTR_RW(channel_mask);
+static DEVICE_ATTR_RO(overruns);
+static DEVICE_ATTR_RO(fifo_overflows);
+static DEVICE_ATTR_RW(alarm_status);
+static DEVICE_ADC_THRESH_ATTR(ch0_high_threshold, CH0);
+static DEVICE_ADC_THRESH_ATTR(ch1_high_threshold, CH1);
+static DEVICE_ADC_THRESH_ATTR(ch2_high_threshold, CH2);
+static DEVICE_ADC_THRESH_ATTR(ch3_high_threshold, CH3);
+static DEVICE_ADC_THRESH_ATTR(ch4_high_threshold, CH4);
+static DEVICE_ADC_THRESH_ATTR(ch5_high_threshold, CH5);
+static DEVICE_ADC_THRESH_ATTR(ch6_high_threshold, CH6);
+static DEVICE_ADC_THRESH_ATTR(ch7_high_threshold, CH7);
+static DEVICE_ADC_THRESH_ATTR(ch0_low_threshold, CH0);
+static DEVICE_ADC_THRESH_ATTR(ch1_low_threshold, CH1);
+static DEVICE_ADC_THRESH_ATTR(ch2_low_threshold, CH2);
+static DEVICE_ADC_THRESH_ATTR(ch3_low_threshold, CH3);
+static DEVICE_ADC_THRESH_ATTR(ch4_low_threshold, CH4);
+static DEVICE_ADC_THRESH_ATTR(ch5_low_threshold, CH5);
+static DEVICE_ADC_THRESH_ATTR(ch6_low_threshold, CH6);
+static DEVICE_ADC_THRESH_ATTR(ch7_low_threshold, CH7);
+static DEVICE_ADC_FILTER_ATTR(ch0_filter, CH0);
+static DEVICE_ADC_FILTER_ATTR(ch1_filter, CH1);
+static DEVICE_ADC_FILTER_ATTR(ch2_filter, CH2);
+static DEVICE_ADC_FILTER_ATTR(ch3_filter, CH3);
+static DEVICE_ADC_FILTER_ATTR(ch4_filter, CH4);
+static DEVICE_ADC_FILTER_ATTR(ch5_filter, CH5);
+static DEVICE_ADC_FILTER_ATTR(ch6_filter, CH6);
+static DEVICE_ADC_FILTER_ATTR(ch7_filter, CH7);
+static DEVICE_ATTR_RW(decimation);
+static DEVICE_ATTR_RW(iir_shift);
 
 static struct attribute *adc_attrs[] = {
 	&dev_attr_update.attr,
@@ -325,6 +2340,38 @@ static struct attribute *adc_attrs[] = {
 	&dev_attr_ch6_raw.attr.attr,
 	&dev_attr_ch7_raw.attr.attr,
 	&dev_attr_voltage_scale_mv.attr.attr,
+	&dev_attr_stream_enable.attr,
+	&dev_attr_sample_rate_hz.attr,
+	&dev_attr_channel_mask.attr,
+	&dev_attr_overruns.attr,
+	&dev_attr_fifo_overflows.attr,
+	&dev_attr_alarm_status.attr,
+	&dev_attr_ch0_high_threshold.attr.attr,
+	&dev_attr_ch1_high_threshold.attr.attr,
+	&dev_attr_ch2_high_threshold.attr.attr,
+	&dev_attr_ch3_high_threshold.attr.attr,
+	&dev_attr_ch4_high_threshold.attr.attr,
+	&dev_attr_ch5_high_threshold.attr.attr,
+	&dev_attr_ch6_high_threshold.attr.attr,
+	&dev_attr_ch7_high_threshold.attr.attr,
+	&dev_attr_ch0_low_threshold.attr.attr,
+	&dev_attr_ch1_low_threshold.attr.attr,
+	&dev_attr_ch2_low_threshold.attr.attr,
+	&dev_attr_ch3_low_threshold.attr.attr,
+	&dev_attr_ch4_low_threshold.attr.attr,
+	&dev_attr_ch5_low_threshold.attr.attr,
+	&dev_attr_ch6_low_threshold.attr.attr,
+	&dev_attr_ch7_low_threshold.attr.attr,
+	&dev_attr_ch0_filter.attr.attr,
+	&dev_attr_ch1_filter.attr.attr,
+	&dev_attr_ch2_filter.attr.attr,
+	&dev_attr_ch3_filter.attr.attr,
+	&dev_attr_ch4_filter.attr.attr,
+	&dev_attr_ch5_filter.attr.attr,
+	&dev_attr_ch6_filter.attr.attr,
+	&dev_attr_ch7_filter.attr.attr,
+	&dev_attr_decimation.attr,
+	&dev_attr_iir_shift.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(adc);
@@ -343,6 +2390,8 @@ static int adc_probe(struct platform_device *pdev)
 {
 	struct adc_dev *priv;
 	size_t ret;
+	unsigned int i;
+	int irq;
 
 	/*
 	 * Allocate kernel memory for the led patterns device and set it to 0.
@@ -369,13 +2418,101 @@ static int adc_probe(struct platform_device *pdev)
 		return PTR_ERR(priv->base_addr);
 	}
 
+	priv->dev = &pdev->dev;
+	priv->variant = device_get_match_data(&pdev->dev);
+
+	ret = devm_kirkland_node_name(&pdev->dev, &adc_ida, "adc",
+		&priv->id, &priv->name);
+	if (ret) {
+		pr_err("Failed to allocate an instance number\n");
+		return ret;
+	}
+	mutex_init(&priv->lock);
+
+	// Set up streaming mode; it stays off until user space enables it.
+	priv->ring_mem = vmalloc_user(ADC_RING_SIZE);
+	if (!priv->ring_mem) {
+		pr_err("Failed to allocate streaming ring buffer\n");
+		return -ENOMEM;
+	}
+	ret = devm_add_action_or_reset(&pdev->dev, adc_free_ring, priv->ring_mem);
+	if (ret) {
+		return ret;
+	}
+	priv->hdr = priv->ring_mem;
+	priv->hdr->nr_scans = ADC_RING_SCANS;
+	priv->hdr->scan_size = sizeof(struct adc_scan);
+	priv->hdr->data_offset = ADC_RING_DATA_OFFSET;
+	priv->ring = priv->ring_mem + ADC_RING_DATA_OFFSET;
+
+	priv->bounce = devm_kcalloc(&pdev->dev, ADC_BOUNCE_SCANS,
+	                            sizeof(struct adc_scan), GFP_KERNEL);
+	if (!priv->bounce) {
+		pr_err("Failed to allocate memory\n");
+		return -ENOMEM;
+	}
+	priv->channel_mask = BIT(ADC_NUM_CHANNELS) - 1;
+	priv->capture_mask = priv->channel_mask;
+	priv->decimation = 1;
+	priv->iir_shift = ADC_DEFAULT_IIR_SHIFT;
+	ATOMIC_INIT_NOTIFIER_HEAD(&priv->notifier);
+	priv->sample_rate_hz = ADC_DEFAULT_SAMPLE_RATE_HZ;
+	init_waitqueue_head(&priv->wait);
+	for (i = 0; i < ADC_NUM_CHANNELS; i++) {
+		priv->high_threshold[i] = ADC_VALUE_BITMASK;
+		priv->low_threshold[i] = 0;
+	}
+	INIT_WORK(&priv->alarm_work, adc_alarm_work);
+	hrtimer_init(&priv->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->timer.function = priv->variant->has_fifo ? adc_fifo_timer :
+		adc_sample_timer;
+	hrtimer_init(&priv->alarm_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->alarm_timer.function = adc_alarm_timer;
+
+	/*
+	 * If the sampler's interrupt is wired up, drain the FIFO and take
+	 * threshold alarms from it instead of polling. Quiet the sampler first
+	 * in case a previous load left interrupts enabled.
+	 */
+	if (priv->variant->has_fifo) {
+		irq = platform_get_irq_optional(pdev, 0);
+		if (irq > 0) {
+			adc_set_irq_enable(priv, 0);
+			iowrite32(ADC_ALARM_MASK, priv->base_addr + SAMPLER_IRQ_STATUS);
+			ret = devm_request_threaded_irq(&pdev->dev, irq, NULL,
+				adc_irq_thread, IRQF_ONESHOT, dev_name(&pdev->dev), priv);
+			if (ret) {
+				pr_err("Failed to request ADC interrupt\n");
+				return ret;
+			}
+			priv->irq = irq;
+			for (i = 0; i < ADC_NUM_CHANNELS; i++) {
+				adc_write_threshold(priv, i);
+			}
+		}
+		else if (irq != -ENXIO) {
+			return irq;
+		}
+	}
+
+	// With the sampler, this also starts background scanning.
+	adc_update_rate(priv);
+
 	// Initialize the misc device parameters
 	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-	priv->miscdev.name = "adc";
+	priv->miscdev.name = priv->name;
 	priv->miscdev.fops = &adc_fops;
 	priv->miscdev.parent = &pdev->dev;
 
-	// Register the misc device; this creates a char dev at /dev/adc
+	// Register the IIO front end; this creates /sys/bus/iio/devices/iio:deviceN
+	ret = adc_iio_register(pdev, priv);
+	if (ret) {
+		pr_err("Failed to register IIO device\n");
+		return ret;
+	}
+
+	// Register the misc device; this creates a char dev at /dev/adc for the
+	// first instance and /dev/adcN for the others
 	ret = misc_register(&priv->miscdev);
 	if (ret) {
 		pr_err("Failed to register misc device");
@@ -388,6 +2525,11 @@ static int adc_probe(struct platform_device *pdev)
 	 */
 	platform_set_drvdata(pdev, priv);
 
+	// Everything the IRQ thread uses is set up; let alarms through.
+	if (priv->irq) {
+		adc_set_irq_enable(priv, ADC_ALARM_MASK);
+	}
+
 	pr_info("adc_probe successful\n");
 
 	return 0;
@@ -405,7 +2547,20 @@ static int adc_remove(struct platform_device *pdev)
 	// Get the led patterns's private data from the platform device.
 	struct adc_dev *priv = platform_get_drvdata(pdev);
 
-	// Deregister the misc device and remove the /dev/adc file.
+	// Make sure the timers aren't running when our memory goes away.
+	hrtimer_cancel(&priv->timer);
+	hrtimer_cancel(&priv->alarm_timer);
+	if (priv->irq) {
+		adc_set_irq_enable(priv, 0);
+		synchronize_irq(priv->irq);
+	}
+	cancel_work_sync(&priv->alarm_work);
+
+	if (priv->variant->has_fifo) {
+		iowrite32(0, priv->base_addr + SAMPLER_CTRL);
+	}
+
+	// Deregister the misc device and remove its /dev/adc* file.
 	misc_deregister(&priv->miscdev);
 
 	pr_info("adc_remove successful\n");
@@ -421,7 +2576,8 @@ static int adc_remove(struct platform_device *pdev)
  * compatible string as defined here.
  */
 static const struct of_device_id adc_of_match[] = {
-	{ .compatible = "adsd,de10nano_adc", },
+	{ .compatible = "Kirkland,adc_sampler", .data = &adc_sampler, },
+	{ .compatible = "adsd,de10nano_adc", .data = &adc_terasic, },
 	{ }
 };
 MODULE_DEVICE_TABLE(of, adc_of_match);
@@ -0,0 +1,121 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * User-space interface for the de10nano_adc driver. This header is shared by
+ * the driver and by user-space programs that read from /dev/adc. The
+ * __KERNEL__ section is the interface for other drivers.
+ */
+#ifndef DE10NANO_ADC_H
+#define DE10NANO_ADC_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+// The LTC2308 has eight single-ended input channels
+#define ADC_NUM_CHANNELS 8
+
+/**
+ * struct adc_scan - One timestamped scan of the enabled ADC channels.
+ * @timestamp_ns: CLOCK_MONOTONIC time the scan was taken, in nanoseconds.
+ * @channel_mask: Which entries of @ch hold samples; bit n is channel n.
+ * @seq: Scan sequence number. It increments once per scan, so a gap in @seq
+ *       tells the reader how many scans it missed.
+ * @ch: 12-bit channel values; channels not in @channel_mask read as 0.
+ *
+ * While streaming is enabled, every read() of /dev/adc returns a whole
+ * number of these structs.
+ */
+struct adc_scan {
+	__u64 timestamp_ns;
+	__u32 channel_mask;
+	__u32 seq;
+	__u16 ch[ADC_NUM_CHANNELS];
+};
+
+#define ADC_IOC_MAGIC 'a'
+
+/*
+ * ADC_IOC_SNAPSHOT - Read the latest value of each channel in one call.
+ *
+ * Fills in a struct adc_scan with the channels and the time the scan started;
+ * seq is always 0. channel_mask is normally 0xff. While the ADC_Sampler is
+ * streaming, it only scans the streamed channels, and channel_mask is limited
+ * to those. This works whether or not streaming is enabled and doesn't touch
+ * the streaming ring.
+ */
+#define ADC_IOC_SNAPSHOT _IOR(ADC_IOC_MAGIC, 1, struct adc_scan)
+
+/**
+ * struct adc_ring_header - Header page of the mmap()-able scan ring.
+ * @nr_scans: Number of scans the ring holds; always a power of 2.
+ * @scan_size: sizeof(struct adc_scan).
+ * @data_offset: Byte offset of the first scan from the start of the mapping.
+ * @head: Sequence number of the next scan the driver will write.
+ * @tail: Sequence number of the oldest scan still in the ring.
+ *
+ * mmap()ing /dev/adc read-only maps this header page followed by the scan
+ * array. The driver is the only writer: scan number s lives in slot
+ * (s & (nr_scans - 1)), and the driver overwrites the oldest scan when the
+ * ring is full instead of waiting for readers. Any number of processes can
+ * therefore read the same stream; each one keeps its own position and never
+ * writes to the mapping.
+ *
+ * Before overwriting a slot, the driver advances @tail past the scan it's
+ * about to destroy, so a reader that copies a scan and then still finds it
+ * at or after @tail knows the copy wasn't torn. adc_ring_copy() implements
+ * this for user space.
+ */
+struct adc_ring_header {
+	__u32 nr_scans;
+	__u32 scan_size;
+	__u32 data_offset;
+	__u32 head;
+	__u32 tail;
+};
+
+#ifdef __KERNEL__
+struct device;
+struct notifier_block;
+
+// Notifier action for every new scan; the data is a const struct adc_scan *
+#define ADC_NOTIFY_SCAN 1
+
+int de10nano_adc_register_notifier(struct device *dev,
+	struct notifier_block *nb, u32 channels);
+void de10nano_adc_unregister_notifier(struct device *dev,
+	struct notifier_block *nb, u32 channels);
+#endif
+
+#ifndef __KERNEL__
+/**
+ * adc_ring_copy() - Copy one scan out of the mmap()ed scan ring.
+ * @hdr: Start of the mapping.
+ * @seq: Sequence number of the scan to copy.
+ * @scan: Where to put the copy.
+ *
+ * Return: 0 on success, 1 if scan @seq hasn't been taken yet, or -1 if it
+ * was overwritten before or during the copy. After -1, resume from @tail.
+ */
+static inline int adc_ring_copy(const struct adc_ring_header *hdr, __u32 seq,
+	struct adc_scan *scan)
+{
+	const struct adc_scan *ring = (const struct adc_scan *)
+		((const char *)hdr + hdr->data_offset);
+	__u32 head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+
+	if ((__s32)(seq - head) >= 0) {
+		return 1;
+	}
+
+	*scan = ring[seq & (hdr->nr_scans - 1)];
+
+	// Re-check the tail only after the copy is complete.
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if ((__s32)(seq - __atomic_load_n(&hdr->tail, __ATOMIC_RELAXED)) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+#endif
+
+#endif /* DE10NANO_ADC_H */
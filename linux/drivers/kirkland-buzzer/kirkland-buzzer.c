@@ -3,14 +3,45 @@
 #include <linux/mod_devicetable.h>
 #include <linux/io.h> //iowrite32/ioread32 functions
 #include <linux/mutex.h> // mutex definitions
+#include <linux/spinlock.h> // spinlock definitions
+#include <linux/hrtimer.h> // hrtimer definitions
+#include <linux/kfifo.h> // kfifo definitions
+#include <linux/wait.h> // wait queues
+#include <linux/poll.h> // poll definitions
+#include <linux/property.h> // device_get_match_data
 #include <linux/miscdevice.h> // miscdevice definitions
+#include <linux/idr.h> // ida_alloc, ida_free
 #include <linux/types.h> // data types like u32, u16, etc.
 #include <linux/fs.h> // copy_to_user, etc
 #include <linux/kstrtox.h> // kstrtou8, etc
+#include <linux/export.h> // EXPORT_SYMBOL_GPL
+
+#include "kirkland-buzzer.h"
+#include "../../include/kirkland_regio.h"
 
 
 #define PERIOD_REG_OFFSET 0
+#define DURATION_REG_OFFSET 4
+#define NOTE_PUSH_OFFSET 8
+#define FIFO_STATUS_OFFSET 12
 #define SPAN 4
+#define FIFO_SPAN 16
+
+// Variants listed in kirkland_buzzer_of_match
+#define KIRKLAND_BUZZER_HAS_FIFO 1
+
+// Note sequencer FIFO in the fabric
+#define FIFO_DEPTH 32
+#define FIFO_LEVEL_MASK 0x3f
+#define FIFO_PLAYING BIT(8)
+#define FIFO_UNDERRUN BIT(9)
+#define FIFO_FLUSH BIT(10)
+
+// The component runs from the 50 MHz fabric clock
+#define CLOCKS_PER_MS 50000
+
+// Top up the FIFO this long before it's due to run dry
+#define FIFO_LEAD_MS 20
 
 static struct platform_driver kirkland_buzzer_driver;
 static const struct of_device_id kirkland_buzzer_of_match[];
@@ -19,18 +50,25 @@ static int kirkland_buzzer_probe(struct platform_device *pdev);
 static int kirkland_buzzer_remove(struct platform_device *pdev);
 static ssize_t kirkland_buzzer_read(struct file *file, char __user *buf, size_t count, loff_t *offset);
 static ssize_t kirkland_buzzer_write(struct file *file, const char __user *buf, size_t count, loff_t *offset);
+static __poll_t kirkland_buzzer_poll(struct file *file, poll_table *wait);
+static long kirkland_buzzer_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+static enum hrtimer_restart kirkland_buzzer_note_timer(struct hrtimer *timer);
+static enum hrtimer_restart kirkland_buzzer_fifo_timer(struct hrtimer *timer);
 
 static ssize_t period_reg_show(struct device *dev, struct device_attribute *attr, char *buf);
 static ssize_t period_reg_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t queue_level_show(struct device *dev, struct device_attribute *attr, char *buf);
 static struct attribute *kirkland_buzzer_attrs[];
 
 // Define sysfs attributes
 static DEVICE_ATTR_RW(period_reg);
+static DEVICE_ATTR_RO(queue_level);
 
 // Create an attribute group so the device core can
 // export the attributes for us.
 static struct attribute *kirkland_buzzer_attrs[] = {
 	&dev_attr_period_reg.attr,
+	&dev_attr_queue_level.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(kirkland_buzzer);
@@ -44,15 +82,45 @@ ATTRIBUTE_GROUPS(kirkland_buzzer);
 /**
  * struct kirkland_buzzer_dev - Private led patterns device struct.
  * @base_addr: Pointer to the component's base address
- * @period_reg: Address of the period_reg register
+ * @note_push: Address of the note_push register (note FIFO only)
+ * @fifo_status: Address of the status_reg register (note FIFO only)
+ * @has_fifo: The component has the note sequencer FIFO
+ * @regs: Register window, with a shadow copy of period_reg and
+ *	duration_reg; its span is the size of the component's register space
+ * @miscdev: miscdevice used to create a character device
+ * @id: Instance number from kirkland_buzzer_ida
+ * @name: Name of the device node; kirkland_buzzer for instance 0 and kirkland_buzzerN
+ *	for instance N
+ * @lock: spinlock for register access and the playback state; a spinlock
+ *	because the note timer takes it too
+ * @queue_lock: mutex that serializes processes queueing notes
+ * @timer: hrtimer that ends each note and starts the next
+ * @queue: Notes waiting to be played
+ * @playing: True while @timer is running through @queue
+ * @fifo_end: When the notes pushed into the note FIFO will have finished
+ * @alert_period: Period of the alert tone another driver is sounding, or 0;
+ *	see kirkland_buzzer_set_alert()
+ * @wait: Wait queue for processes waiting for room in, or the end of, @queue
  *
  * A kirkland_buzzer_dev struct gets created for each buzzer controller component.
  */
 struct kirkland_buzzer_dev {
 	void __iomem *base_addr;
-	void __iomem *period_reg;
+	void __iomem *note_push;
+	void __iomem *fifo_status;
+	bool has_fifo;
+	struct kirkland_regs regs;
 	struct miscdevice miscdev;
-	struct mutex lock;
+	int id;
+	const char *name;
+	spinlock_t lock;
+	struct mutex queue_lock;
+	struct hrtimer timer;
+	DECLARE_KFIFO(queue, struct kirkland_buzzer_note, KIRKLAND_BUZZER_QUEUE_LEN);
+	bool playing;
+	ktime_t fifo_end;
+	u32 alert_period;
+	wait_queue_head_t wait;
 };
 
 /**
@@ -85,14 +153,25 @@ static struct platform_driver kirkland_buzzer_driver = {
  * @write: The write function
  * @llseek: We use the kernel's default_llseek() function; this allows
  * users to change what position they are writing/reading to/from.
+ * @poll: Reports room in the note queue and the end of playback.
+ * @unlocked_ioctl: Queues and flushes notes, and applies batched register
+ * access.
+ * @compat_ioctl: The ioctl arguments have the same layout for 32-bit
+ * callers, so their pointers only need converting.
  */
  static const struct file_operations kirkland_buzzer_fops = {
 	.owner = THIS_MODULE,
 	.read = kirkland_buzzer_read,
 	.write = kirkland_buzzer_write,
 	.llseek = default_llseek,
+	.poll = kirkland_buzzer_poll,
+	.unlocked_ioctl = kirkland_buzzer_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
  };
 
+// Instance numbers for devm_kirkland_node_name()
+static DEFINE_IDA(kirkland_buzzer_ida);
+
 /**
  * kirkland_buzzer_probe() - Initialize device when a match is found
  * @pdev: Platform device structure associated with our buzzer controller device;
@@ -105,7 +184,7 @@ static struct platform_driver kirkland_buzzer_driver = {
  */
 static int kirkland_buzzer_probe(struct platform_device *pdev) {
 	struct kirkland_buzzer_dev *priv;
-	size_t ret;
+	int ret;
 
 	/*
 	 * Allocate kernel memory for the led patterns device and set it to 0.
@@ -134,19 +213,58 @@ static int kirkland_buzzer_probe(struct platform_device *pdev) {
 		return PTR_ERR(priv->base_addr);
 	}
 
+	ret = devm_kirkland_node_name(&pdev->dev, &kirkland_buzzer_ida, "kirkland_buzzer", &priv->id, &priv->name);
+	if (ret) {
+		pr_err("Failed to allocate an instance number\n");
+		return ret;
+	}
+
+	spin_lock_init(&priv->lock);
+	mutex_init(&priv->queue_lock);
+	INIT_KFIFO(priv->queue);
+	init_waitqueue_head(&priv->wait);
+	hrtimer_init(&priv->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	priv->timer.function = kirkland_buzzer_note_timer;
+
+	// Newer components play queued notes from a FIFO in the fabric; the
+	// driver then only has to keep that FIFO topped up.
+	priv->has_fifo = (uintptr_t)device_get_match_data(&pdev->dev) & KIRKLAND_BUZZER_HAS_FIFO;
+	priv->regs.name = priv->name;
+	priv->regs.base = priv->base_addr;
+	priv->regs.span = SPAN;
+	if (priv->has_fifo) {
+		priv->regs.span = FIFO_SPAN;
+		priv->timer.function = kirkland_buzzer_fifo_timer;
+	}
+
 	// Set the memory addresses for each register.
-	priv->period_reg = priv->base_addr + PERIOD_REG_OFFSET;
+	priv->note_push = priv->base_addr + NOTE_PUSH_OFFSET;
+	priv->fifo_status = priv->base_addr + FIFO_STATUS_OFFSET;
+
+	// period_reg and duration_reg are plain storage, so they can be served
+	// from the shadow cache; note_push and status_reg have side effects.
+	ret = devm_kirkland_regs_cache(&pdev->dev, &priv->regs, DURATION_REG_OFFSET / sizeof(u32) + 1);
+	if (ret) {
+		pr_err("Failed to allocate memory\n");
+		return ret;
+	}
+	kirkland_regs_cache(&priv->regs, PERIOD_REG_OFFSET, 1);
+	if (priv->has_fifo) {
+		kirkland_regs_cache(&priv->regs, DURATION_REG_OFFSET, 1);
+	}
+	kirkland_regs_sync(&priv->regs);
 
 	// Set default register values
-	iowrite32(0x80, priv->period_reg);
+	kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, 0x80);
 
 	// Initialize the misc device paramters
 	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-	priv->miscdev.name = "kirkland_buzzer";
+	priv->miscdev.name = priv->name;
 	priv->miscdev.fops = &kirkland_buzzer_fops;
 	priv->miscdev.parent = &pdev->dev;
 
 	// Register the misc device; this creates a char dev at /dev/kirkland_buzzer
+	// for the first instance and /dev/kirkland_buzzerN for the others
 	ret = misc_register(&priv->miscdev);
 	if (ret) {
 		pr_err("Failed to register misc device");
@@ -174,9 +292,12 @@ static int kirkland_buzzer_remove(struct platform_device *pdev) {
 	// get the led patterns's private data from the platform device.
 	struct kirkland_buzzer_dev *priv = platform_get_drvdata(pdev);
 
-	// Deregister the misc device and remove the /dev/kirkland_buzzer file.
+	// Deregister the misc device and remove its /dev/kirkland_buzzer* file.
 	misc_deregister(&priv->miscdev);
 
+	// Stop playback before the registers go away
+	hrtimer_cancel(&priv->timer);
+
 	pr_info("kirkland_buzzer_remove successful\n");
 
 	return 0;
@@ -189,13 +310,18 @@ static int kirkland_buzzer_remove(struct platform_device *pdev) {
  * @count: The number of bytes being requested.
  * @offset: The byte offset in the file being read from.
  * 
+ * Reads as many whole registers as @count asks for, up to the end of the
+ * device, under a single lock acquisition, so a full register dump is one
+ * syscall.
+ *
  * Return: On success, the number of bytes written is returned and the
  * offset @offset is advanced by this number. On error, a negative error
  * value is returned.
  */
  static ssize_t kirkland_buzzer_read(struct file *file, char __user *buf, size_t count, loff_t *offset) {
-	size_t ret;
-	u32 val;
+	u32 vals[FIFO_SPAN / sizeof(u32)];
+	ssize_t n;
+	unsigned long flags;
 
 	/* Get the device's private data from the file struct's private_data field.
 	 * The private_data field is equal to the miscdev field in the kirkland_buzzer_dev
@@ -203,35 +329,27 @@ static int kirkland_buzzer_remove(struct platform_device *pdev) {
 	 * miscdev in private_data. 
 	 */
 	 struct kirkland_buzzer_dev *priv = container_of(file->private_data, struct kirkland_buzzer_dev, miscdev);
-	 
-	 // Check the file offset to make sure we are reading from a valid location.
-	 if (*offset < 0) {
-		// We can't read from a negative file position.
-		return -EINVAL;
-	 }
-	 if (*offset >= SPAN) {
-		// We can't read from a position past the end of our device.
-		return 0;
-	 }
-	 if ((*offset % 0x4) != 0) {
-		// Prevent unaligned access.
-		pr_warn("kirkland_buzzer_read: unaligned access\n");
-		return -EFAULT;
+
+	 // Check the file offset and work out how many whole registers to read.
+	 n = kirkland_regs_count(&priv->regs, *offset, count);
+	 if (n <= 0) {
+		return n;
 	 }
 
-	 val = ioread32(priv->base_addr + *offset);
+	 spin_lock_irqsave(&priv->lock, flags);
+	 kirkland_regs_read(&priv->regs, *offset, vals, n);
+	 spin_unlock_irqrestore(&priv->lock, flags);
 
-	 // Copy the value to userspace.
-	 ret = copy_to_user(buf, &val, sizeof(val));
-	 if (ret == sizeof(val)) {
+	 // Copy the values to userspace.
+	 if (copy_to_user(buf, vals, n * sizeof(u32))) {
 		pr_warn("kirkland_buzzer_read: nothing copied\n");
 		return -EFAULT;
 	 }
 
 	 // Increment the file offset by the number of bytes we read.
-	 *offset = *offset + sizeof(val);
+	 *offset = *offset + n * sizeof(u32);
 	 
-	 return sizeof(val);
+	 return n * sizeof(u32);
  }
 
 /**
@@ -241,47 +359,357 @@ static int kirkland_buzzer_remove(struct platform_device *pdev) {
  * @count: The number of bytes being written.
  * @offset: The byte offset in the file being written to.
  *
+ * Writes as many whole registers as @count holds, up to the end of the
+ * device, under a single lock acquisition.
+ *
  * Return: On success, the number of bytes written is returned and the
  * offset @offset is advanced by this number. On error, a negative error
  * value is returned.
  */
 static ssize_t kirkland_buzzer_write(struct file *file, const char __user *buf, size_t count, loff_t *offset) {
-	size_t ret;
-	u32 val;
+	u32 vals[FIFO_SPAN / sizeof(u32)];
+	ssize_t n;
+	unsigned long flags;
 
 	struct kirkland_buzzer_dev *priv = container_of(file->private_data, struct kirkland_buzzer_dev, miscdev);
 
-	if (*offset < 0) {
-		return -EINVAL;
+	n = kirkland_regs_count(&priv->regs, *offset, count);
+	if (n <= 0) {
+		return n;
 	}
-	if (*offset >= SPAN) {
-		return 0;
+
+	// Get the values from userspace before taking the lock; this can fault.
+	if (copy_from_user(vals, buf, n * sizeof(u32))) {
+		pr_warn("kirkland_buzzer_write: nothing copied from user space\n");
+		return -EFAULT;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_regs_write(&priv->regs, *offset, vals, n);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	// Increment the file offset by the number of bytes we wrote.
+	*offset = *offset + n * sizeof(u32);
+
+	// Return the number of bytes we wrote.
+	return n * sizeof(u32);
+}
+
+/**
+ * kirkland_buzzer_regio() - Apply a KIRKLAND_IOC_REGIO batch.
+ * @priv: The buzzer.
+ * @arg: User-space pointer to the struct kirkland_regio.
+ *
+ * With the note FIFO, a batch of (duration_reg, note_push) pairs pushes a
+ * whole phrase of notes in one call.
+ *
+ * Return: 0, or a negative error from kirkland_regio_get()/_put().
+ */
+static long kirkland_buzzer_regio(struct kirkland_buzzer_dev *priv, unsigned long arg) {
+	struct kirkland_regio_batch batch;
+	unsigned long flags;
+	int ret;
+
+	ret = kirkland_regio_get(&priv->regs, &batch, arg);
+	if (ret) {
+		return ret;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_regio_apply_writes(&priv->regs, &batch);
+	kirkland_regio_apply_reads(&priv->regs, &batch);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return kirkland_regio_put(&batch);
+}
+
+/**
+ * kirkland_buzzer_note_timer() - End the current note and start the next.
+ * @timer: The note hrtimer embedded in our kirkland_buzzer_dev.
+ *
+ * Each note's end is measured from the previous note's end rather than from
+ * when this callback ran, so timer latency doesn't accumulate over a melody.
+ * When the queue is empty the buzzer is silenced and playback stops.
+ *
+ * Return: HRTIMER_RESTART while there are notes to play, HRTIMER_NORESTART
+ * once the queue has drained.
+ */
+static enum hrtimer_restart kirkland_buzzer_note_timer(struct hrtimer *timer) {
+	struct kirkland_buzzer_dev *priv = container_of(timer, struct kirkland_buzzer_dev, timer);
+	struct kirkland_buzzer_note note;
+	ktime_t now = ktime_get();
+	ktime_t next;
+	bool more;
+
+	spin_lock(&priv->lock);
+	more = kfifo_get(&priv->queue, &note);
+	if (!more) {
+		priv->playing = false;
+	}
+	// An alert tone mutes the melody, which keeps time underneath it
+	if (!priv->alert_period) {
+		kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, more ? note.period : 0);
+	}
+	spin_unlock(&priv->lock);
+
+	// There's room in the queue now, or it has drained
+	wake_up_interruptible(&priv->wait);
+
+	if (!more) {
+		return HRTIMER_NORESTART;
+	}
+
+	// If we're more than a note behind, start timing again from now
+	next = ktime_add_ms(hrtimer_get_expires(timer), note.duration_ms);
+	if (ktime_before(next, now)) {
+		next = ktime_add_ms(now, note.duration_ms);
+	}
+	hrtimer_set_expires(timer, next);
+
+	return HRTIMER_RESTART;
+}
+
+/**
+ * kirkland_buzzer_fifo_timer() - Keep the component's note FIFO topped up.
+ * @timer: The note hrtimer embedded in our kirkland_buzzer_dev.
+ *
+ * Used instead of kirkland_buzzer_note_timer() when the component has a note
+ * FIFO. The fabric times the notes to the clock cycle; we only move notes
+ * from our queue into the FIFO, waking up shortly before the FIFO is due to
+ * run dry, so a whole melody costs a handful of timer interrupts.
+ *
+ * Return: HRTIMER_RESTART until every note has been played.
+ */
+static enum hrtimer_restart kirkland_buzzer_fifo_timer(struct hrtimer *timer) {
+	struct kirkland_buzzer_dev *priv = container_of(timer, struct kirkland_buzzer_dev, timer);
+	struct kirkland_buzzer_note note;
+	ktime_t now = ktime_get();
+	ktime_t next, soonest;
+	u32 status, level;
+	bool done;
+
+	spin_lock(&priv->lock);
+	status = ioread32(priv->fifo_status);
+	level = status & FIFO_LEVEL_MASK;
+
+	// Running dry while we still had notes means we topped it up too late
+	if ((status & FIFO_UNDERRUN) && !kfifo_is_empty(&priv->queue)) {
+		pr_warn_ratelimited("kirkland_buzzer: note FIFO underrun\n");
+	}
+	iowrite32(FIFO_UNDERRUN, priv->fifo_status);
+
+	// The FIFO hands the buzzer back to period_reg when it runs dry
+	if (!priv->alert_period) {
+		kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, 0);
 	}
-	if ((*offset % 0x4) != 0) {
-		pr_warn("kirkland_buzzer_write: unaligned access\n");
+
+	if (ktime_before(priv->fifo_end, now)) {
+		priv->fifo_end = now;
+	}
+	while (level < FIFO_DEPTH && kfifo_get(&priv->queue, &note)) {
+		// An alert tone mutes the melody: its notes are used up on time
+		// but never reach the FIFO.
+		if (!priv->alert_period) {
+			kirkland_reg_write(&priv->regs, DURATION_REG_OFFSET, note.duration_ms * CLOCKS_PER_MS);
+			iowrite32(note.period, priv->note_push);
+		}
+		priv->fifo_end = ktime_add_ms(priv->fifo_end, note.duration_ms);
+		level++;
+	}
+
+	done = level == 0 && !(status & FIFO_PLAYING);
+	if (done) {
+		priv->playing = false;
+	}
+	spin_unlock(&priv->lock);
+
+	// There's room in the queue now, or it has drained
+	wake_up_interruptible(&priv->wait);
+
+	if (done) {
+		return HRTIMER_NORESTART;
+	}
+
+	// With more to push, come back just before the FIFO runs dry; otherwise
+	// come back when it has, to report the end of playback.
+	next = priv->fifo_end;
+	if (!kfifo_is_empty(&priv->queue)) {
+		next = ktime_sub_ms(next, FIFO_LEAD_MS);
+	}
+	soonest = ktime_add_ms(now, 1);
+	if (ktime_before(next, soonest)) {
+		next = soonest;
+	}
+	hrtimer_set_expires(timer, next);
+
+	return HRTIMER_RESTART;
+}
+
+/**
+ * kirkland_buzzer_set_alert() - Sound an alert tone from another driver.
+ * @dev: The buzzer's device.
+ * @period: Period register value of the tone, or 0 to stop it.
+ *
+ * The tone starts immediately and overrides any melody, which carries on
+ * silently underneath so it's back in time when the tone stops. This only
+ * takes the spinlock, so it's safe in atomic context.
+ *
+ * Return: 0, or -ENODEV if @dev isn't a bound buzzer.
+ */
+int kirkland_buzzer_set_alert(struct device *dev, u32 period) {
+	struct kirkland_buzzer_dev *priv = dev_get_drvdata(dev);
+	unsigned long flags;
+
+	if (!priv || dev->driver != &kirkland_buzzer_driver.driver) {
+		return -ENODEV;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	// Notes already in the FIFO would play over the tone
+	if (period && priv->has_fifo) {
+		iowrite32(FIFO_FLUSH, priv->fifo_status);
+	}
+	kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, period);
+	priv->alert_period = period;
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(kirkland_buzzer_set_alert);
+
+/**
+ * kirkland_buzzer_queue() - Append notes from user space to the queue.
+ * @priv: The buzzer device.
+ * @file: The file the notes came through; decides whether we may block.
+ * @umelody: User-space melody description.
+ *
+ * Return: The number of notes queued, or a negative error value.
+ */
+static long kirkland_buzzer_queue(struct kirkland_buzzer_dev *priv, struct file *file, const struct kirkland_buzzer_melody __user *umelody) {
+	struct kirkland_buzzer_melody melody;
+	struct kirkland_buzzer_note __user *unotes;
+	struct kirkland_buzzer_note note;
+	unsigned long flags;
+	long queued = 0;
+	int ret = 0;
+
+	if (copy_from_user(&melody, umelody, sizeof(melody))) {
 		return -EFAULT;
 	}
+	if (melody.reserved) {
+		return -EINVAL;
+	}
+	unotes = u64_to_user_ptr(melody.notes);
+
+	mutex_lock(&priv->queue_lock);
+	while (queued < melody.nr_notes) {
+		if (copy_from_user(&note, &unotes[queued], sizeof(note))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (note.duration_ms == 0 || note.duration_ms > KIRKLAND_BUZZER_MAX_DURATION_MS) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (kfifo_is_full(&priv->queue)) {
+			if (file->f_flags & O_NONBLOCK) {
+				ret = -EAGAIN;
+				break;
+			}
+			ret = wait_event_interruptible(priv->wait, !kfifo_is_full(&priv->queue));
+			if (ret) {
+				break;
+			}
+		}
+
+		// We're the only producer, so the queue can't have filled up again
+		kfifo_put(&priv->queue, note);
+		queued++;
+
+		// Start playing as soon as there's a note to play
+		spin_lock_irqsave(&priv->lock, flags);
+		if (!priv->playing) {
+			priv->playing = true;
+			hrtimer_start(&priv->timer, ktime_get(), HRTIMER_MODE_ABS);
+		}
+		spin_unlock_irqrestore(&priv->lock, flags);
+	}
+	mutex_unlock(&priv->queue_lock);
+
+	// Report partial success; the caller can queue the rest later
+	return queued ? queued : ret;
+}
+
+/**
+ * kirkland_buzzer_flush() - Drop every queued note and go silent.
+ * @priv: The buzzer device.
+ */
+static void kirkland_buzzer_flush(struct kirkland_buzzer_dev *priv) {
+	unsigned long flags;
+
+	mutex_lock(&priv->queue_lock);
+	hrtimer_cancel(&priv->timer);
+
+	spin_lock_irqsave(&priv->lock, flags);
+	kfifo_reset(&priv->queue);
+	priv->playing = false;
+	if (priv->has_fifo) {
+		iowrite32(FIFO_FLUSH | FIFO_UNDERRUN, priv->fifo_status);
+	}
+	kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, 0);
+	spin_unlock_irqrestore(&priv->lock, flags);
+	mutex_unlock(&priv->queue_lock);
 
-	mutex_lock(&priv->lock);
+	wake_up_interruptible(&priv->wait);
+}
 
-	// Get the value from userspace.
-	ret = copy_from_user(&val, buf, sizeof(val));
-	if (ret != sizeof(val)) {
-		iowrite32(val, priv->base_addr + *offset);
+/**
+ * kirkland_buzzer_poll() - Poll method for the kirkland_buzzer char device
+ * @file: Pointer to the char device file struct.
+ * @wait: Poll table to add our wait queue to.
+ *
+ * Return: EPOLLOUT when there's room for at least one more note, and EPOLLPRI
+ * once the queue has drained and the last note has finished.
+ */
+static __poll_t kirkland_buzzer_poll(struct file *file, poll_table *wait) {
+	struct kirkland_buzzer_dev *priv = container_of(file->private_data, struct kirkland_buzzer_dev, miscdev);
+	__poll_t mask = 0;
 
-		// Increment the file offset by the number of bytes we wrote.
-		*offset = *offset + sizeof(val);
+	poll_wait(file, &priv->wait, wait);
 
-		// Return the number of bytes we wrote.
-		ret = sizeof(val);
-	} else {
-		pr_warn("kirkland_buzzer_write: nothing copied from user space\n");
-		ret = -EFAULT;
+	if (!kfifo_is_full(&priv->queue)) {
+		mask |= EPOLLOUT | EPOLLWRNORM;
+	}
+	if (!READ_ONCE(priv->playing)) {
+		mask |= EPOLLPRI;
 	}
 
-	mutex_unlock(&priv->lock);
-	
-	return ret;
+	return mask;
+}
+
+/**
+ * kirkland_buzzer_ioctl() - ioctl method for the kirkland_buzzer char device
+ * @file: Pointer to the char device file struct.
+ * @cmd: The ioctl command; see kirkland-buzzer.h.
+ * @arg: The command's user-space argument.
+ *
+ * Return: 0 or a non-negative count on success, or a negative error value.
+ */
+static long kirkland_buzzer_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+	struct kirkland_buzzer_dev *priv = container_of(file->private_data, struct kirkland_buzzer_dev, miscdev);
+
+	switch (cmd) {
+	case KIRKLAND_BUZZER_IOC_QUEUE:
+		return kirkland_buzzer_queue(priv, file, (const struct kirkland_buzzer_melody __user *)arg);
+	case KIRKLAND_BUZZER_IOC_FLUSH:
+		kirkland_buzzer_flush(priv);
+		return 0;
+	case KIRKLAND_IOC_REGIO:
+		return kirkland_buzzer_regio(priv, arg);
+	default:
+		return -ENOTTY;
+	}
 }
 
 /**
@@ -298,7 +726,7 @@ static ssize_t period_reg_show(struct device *dev, struct device_attribute *attr
 	u32 period_reg;
 	struct kirkland_buzzer_dev *priv = dev_get_drvdata(dev);
 
-	period_reg = ioread32(priv->period_reg);
+	period_reg = kirkland_reg_read(&priv->regs, PERIOD_REG_OFFSET);
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", period_reg);
 }
@@ -317,6 +745,7 @@ static ssize_t period_reg_show(struct device *dev, struct device_attribute *attr
 static ssize_t period_reg_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
 	u32 period_reg;
 	int ret;
+	unsigned long flags;
 	struct kirkland_buzzer_dev *priv = dev_get_drvdata(dev);
 
 	// Parse the string we received as a u8
@@ -326,12 +755,38 @@ static ssize_t period_reg_store(struct device *dev, struct device_attribute *att
 		return ret;
 	}
 
-	iowrite32(period_reg, priv->period_reg);
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, period_reg);
+	spin_unlock_irqrestore(&priv->lock, flags);
 
 	// Write was successful, so we return the number of bytes we wrote.
 	return size;
 } 
 
+/**
+ * queue_level_show() - Return the number of notes waiting to be played.
+ * @dev: Device structure for the kirkland_buzzer component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t queue_level_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	u32 level;
+	unsigned long flags;
+	struct kirkland_buzzer_dev *priv = dev_get_drvdata(dev);
+
+	spin_lock_irqsave(&priv->lock, flags);
+	level = kfifo_len(&priv->queue);
+	if (priv->has_fifo) {
+		// Include the notes already handed to the fabric
+		level += ioread32(priv->fifo_status) & FIFO_LEVEL_MASK;
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", level);
+}
+
 
 
 
@@ -343,6 +798,7 @@ static ssize_t period_reg_store(struct device *dev, struct device_attribute *att
  * compatible string as defined here.
  */
 static const struct of_device_id kirkland_buzzer_of_match[] = {
+	{ .compatible = "Kirkland,kirkland_buzzer_fifo", .data = (void *)KIRKLAND_BUZZER_HAS_FIFO, },
 	{ .compatible = "Kirkland,kirkland_buzzer", },
 	{ }	
 };
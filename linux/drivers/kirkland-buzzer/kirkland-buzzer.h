@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * User-space interface for the kirkland_buzzer driver. This header is shared
+ * by the driver and by user-space programs that open /dev/kirkland_buzzer.
+ * The __KERNEL__ section is the interface for other drivers.
+ */
+#ifndef KIRKLAND_BUZZER_H
+#define KIRKLAND_BUZZER_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+// Number of notes the driver's queue holds
+#define KIRKLAND_BUZZER_QUEUE_LEN 64
+
+// Longest single note, in milliseconds
+#define KIRKLAND_BUZZER_MAX_DURATION_MS 60000
+
+/**
+ * struct kirkland_buzzer_note - One note of a melody.
+ * @period: Value for the period register while the note plays; 0 is a rest.
+ * @duration_ms: How long the note lasts; 1 to KIRKLAND_BUZZER_MAX_DURATION_MS.
+ */
+struct kirkland_buzzer_note {
+	__u32 period;
+	__u32 duration_ms;
+};
+
+/**
+ * struct kirkland_buzzer_melody - Argument of KIRKLAND_BUZZER_IOC_QUEUE.
+ * @nr_notes: Number of notes at @notes.
+ * @notes: User-space pointer to the note array.
+ */
+struct kirkland_buzzer_melody {
+	__u32 nr_notes;
+	__u32 reserved;
+	__u64 notes;
+};
+
+#define KIRKLAND_BUZZER_IOC_MAGIC 'b'
+
+/*
+ * KIRKLAND_BUZZER_IOC_QUEUE - Append notes to the playback queue.
+ *
+ * Playback starts as soon as the first note is queued. If the queue fills up,
+ * the call waits for room, or with O_NONBLOCK returns early. Returns the
+ * number of notes queued, or -EAGAIN if O_NONBLOCK is set and none fit.
+ * When the queue drains the buzzer goes silent.
+ */
+#define KIRKLAND_BUZZER_IOC_QUEUE \
+	_IOW(KIRKLAND_BUZZER_IOC_MAGIC, 1, struct kirkland_buzzer_melody)
+
+/*
+ * KIRKLAND_BUZZER_IOC_FLUSH - Drop every queued note and go silent.
+ */
+#define KIRKLAND_BUZZER_IOC_FLUSH _IO(KIRKLAND_BUZZER_IOC_MAGIC, 2)
+
+#ifdef __KERNEL__
+struct device;
+
+int kirkland_buzzer_set_alert(struct device *dev, __u32 period);
+#endif
+
+#endif /* KIRKLAND_BUZZER_H */
@@ -0,0 +1,685 @@
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/mod_devicetable.h>
+#include <linux/io.h> //iowrite32/ioread32 functions
+#include <linux/mutex.h> // mutex definitions
+#include <linux/slab.h> // kmalloc_array, kfree
+#include <linux/miscdevice.h> // miscdevice definitions
+#include <linux/idr.h> // ida_alloc, ida_free
+#include <linux/types.h> // data types like u32, u16, etc.
+#include <linux/fs.h> // copy_to_user, etc
+#include <linux/kstrtox.h> // kstrtou32, etc
+#include <linux/string.h> // skip_spaces, strcspn
+
+#include "../../include/kirkland_regio.h"
+
+
+#define INFO_OFFSET 0x000
+#define COMMIT_OFFSET 0x004
+#define RAMPING_LO_OFFSET 0x008
+#define RAMPING_HI_OFFSET 0x00C
+#define PERIOD_OFFSET 0x100
+#define DUTY_CYCLE_OFFSET 0x200
+#define RAMP_STEP_OFFSET 0x300
+#define SPAN 0x400
+
+// Most channels, and most period groups, a bank can have
+#define MAX_CHANNELS 64
+
+// Writing this to the commit register latches the shadow registers
+#define COMMIT 1
+
+// Bits of a period, and of a duty cycle or ramp step, the component stores
+#define PERIOD_BITS GENMASK(12, 0)
+#define DUTY_CYCLE_BITS GENMASK(21, 0)
+
+static struct platform_driver kirkland_pwm_bank_driver;
+static const struct of_device_id kirkland_pwm_bank_of_match[];
+static int kirkland_pwm_bank_probe(struct platform_device *pdev);
+static int kirkland_pwm_bank_remove(struct platform_device *pdev);
+static ssize_t kirkland_pwm_bank_read(struct file *file, char __user *buf, size_t count, loff_t *offset);
+static ssize_t kirkland_pwm_bank_write(struct file *file, const char __user *buf, size_t count, loff_t *offset);
+static long kirkland_pwm_bank_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+
+static ssize_t channels_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t groups_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t period_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t period_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t duty_cycle_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t ramping_show(struct device *dev, struct device_attribute *attr, char *buf);
+static struct attribute *kirkland_pwm_bank_attrs[];
+
+// Define sysfs attributes
+static DEVICE_ATTR_RO(channels);
+static DEVICE_ATTR_RO(groups);
+static DEVICE_ATTR_RW(period);
+static DEVICE_ATTR_RW(duty_cycle);
+static DEVICE_ATTR_RW(ramp_step);
+static DEVICE_ATTR_RO(ramping);
+
+// Create an attribute group so the device core can
+// export the attributes for us.
+static struct attribute *kirkland_pwm_bank_attrs[] = {
+	&dev_attr_channels.attr,
+	&dev_attr_groups.attr,
+	&dev_attr_period.attr,
+	&dev_attr_duty_cycle.attr,
+	&dev_attr_ramp_step.attr,
+	&dev_attr_ramping.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(kirkland_pwm_bank);
+
+/**
+ * struct kirkland_pwm_bank_dev - Private pwm bank device struct.
+ * @base_addr: Pointer to the component's base address
+ * @regs: Register window for read(), write() and KIRKLAND_IOC_REGIO
+ * @commit: Address of the commit register
+ * @miscdev: miscdevice used to create a character device
+ * @id: Instance number from kirkland_pwm_bank_ida
+ * @name: Name of the device node; kirkland_pwm_bank for instance 0 and
+ *	kirkland_pwm_bankN for instance N
+ * @lock: mutex that keeps register updates and their commit together
+ * @nr_channels: Number of PWM channels, read from the component
+ * @nr_groups: Number of period registers, read from the component
+ *
+ * The period, duty cycle and ramp step registers are shadow registers, like
+ * the rgb controller's: writes reach the outputs when the commit register is
+ * written, and each period group then switches at its next period boundary.
+ * They're plain storage, so @regs keeps the ones the component has in its
+ * shadow cache. Writes of the value a register already holds are skipped,
+ * and the driver commits after every update that changed a register.
+ *
+ * A kirkland_pwm_bank_dev struct gets created for each pwm bank component.
+ */
+struct kirkland_pwm_bank_dev {
+	void __iomem *base_addr;
+	struct kirkland_regs regs;
+	void __iomem *commit;
+	struct miscdevice miscdev;
+	int id;
+	const char *name;
+	struct mutex lock;
+	u32 nr_channels;
+	u32 nr_groups;
+};
+
+/**
+ * struct kirkland_pwm_bank_driver - Platform driver struct for the kirkland_pwm_bank driver
+ * @probe: Function that's called when a device is found
+ * @remove: Function that's called when a device is removed
+ * @driver.owner: Which module owns this driver
+ * @driver.name: Name of the kirkland_pwm_bank driver
+ * @driver.of_match_table: Device tree match table
+ * @driver.dev_groups: sysfs attribute group
+ */
+static struct platform_driver kirkland_pwm_bank_driver = {
+	.probe = kirkland_pwm_bank_probe,
+	.remove = kirkland_pwm_bank_remove,
+	.driver = {
+		.owner = THIS_MODULE,
+		.name = "kirkland_pwm_bank",
+		.of_match_table = kirkland_pwm_bank_of_match,
+		.dev_groups = kirkland_pwm_bank_groups,
+	},
+};
+
+/**
+ * kirkland_pwm_bank_fops - File operations supported by the kirkland_pwm_bank driver
+ *
+ * @owner: The kirkland_pwm_bank driver owns the file operations; this
+ * ensures that the driver can't be removed while the character
+ * device is still in use.
+ * @read: The read function.
+ * @write: The write function
+ * @llseek: We use the kernel's default_llseek() function; this allows
+ * users to change what position they are writing/reading to/from.
+ * @unlocked_ioctl: Applies batched register access.
+ * @compat_ioctl: The ioctl arguments have the same layout for 32-bit
+ * callers, so their pointers only need converting.
+ */
+static const struct file_operations kirkland_pwm_bank_fops = {
+	.owner = THIS_MODULE,
+	.read = kirkland_pwm_bank_read,
+	.write = kirkland_pwm_bank_write,
+	.llseek = default_llseek,
+	.unlocked_ioctl = kirkland_pwm_bank_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+};
+
+// Instance numbers for devm_kirkland_node_name()
+static DEFINE_IDA(kirkland_pwm_bank_ida);
+
+/**
+ * kirkland_pwm_bank_probe() - Initialize device when a match is found
+ * @pdev: Platform device structure associated with our pwm bank device;
+ * 	pdev is automatically created by the driver core based upon our
+ * 	pwm bank device tree node.
+ *
+ * The number of channels and period groups is read from the component's
+ * info register, so the same driver handles every size of bank.
+ */
+static int kirkland_pwm_bank_probe(struct platform_device *pdev) {
+	struct kirkland_pwm_bank_dev *priv;
+	u32 info;
+	int ret;
+
+	/*
+	 * Allocate kernel memory for the pwm bank device and set it to 0.
+	 * GFP_KERNEL specifies that we are allocating normal kernel RAM;
+	 * see the kmalloc documentation for more info. The allocated memory
+	 * is automatically freed when the device is removed.
+	 */
+	priv = devm_kzalloc(&pdev->dev, sizeof(struct kirkland_pwm_bank_dev), GFP_KERNEL);
+
+	if (!priv) {
+		pr_err("Failed to allocate memory\n");
+		return -ENOMEM;
+	}
+
+	/*
+	 * Request and remap the device's memory region. Requesting the region
+	 * makes sure nobody else can use that memory. The memory is remapped
+	 * into the kernel's virtual address space because we don't have access
+	 * to physical memory locations.
+	 */
+	priv->base_addr = devm_platform_ioremap_resource(pdev, 0);
+
+	if (IS_ERR(priv->base_addr)) {
+		pr_err("Failed to request/remap platform device resource\n");
+		return PTR_ERR(priv->base_addr);
+	}
+
+	ret = devm_kirkland_node_name(&pdev->dev, &kirkland_pwm_bank_ida, "kirkland_pwm_bank", &priv->id, &priv->name);
+	if (ret) {
+		pr_err("Failed to allocate an instance number\n");
+		return ret;
+	}
+
+	// Size the driver from the component: [7:0] channels, [15:8] groups
+	info = ioread32(priv->base_addr + INFO_OFFSET);
+	priv->nr_channels = info & 0xff;
+	priv->nr_groups = (info >> 8) & 0xff;
+	if (priv->nr_channels == 0 || priv->nr_channels > MAX_CHANNELS ||
+		priv->nr_groups == 0 || priv->nr_groups > priv->nr_channels) {
+		pr_err("%s: unexpected info register 0x%08x\n", priv->name, info);
+		return -ENODEV;
+	}
+
+	mutex_init(&priv->lock);
+
+	priv->regs.name = priv->name;
+	priv->regs.base = priv->base_addr;
+	priv->regs.span = SPAN;
+
+	// Cache the periods, duty cycles and ramp steps the component has; the
+	// ramp steps are last, so the cache ends with the last channel's.
+	ret = devm_kirkland_regs_cache(&pdev->dev, &priv->regs, RAMP_STEP_OFFSET / sizeof(u32) + priv->nr_channels);
+	if (ret) {
+		pr_err("Failed to allocate memory\n");
+		return ret;
+	}
+	kirkland_regs_cache(&priv->regs, PERIOD_OFFSET, priv->nr_groups);
+	kirkland_regs_cache(&priv->regs, DUTY_CYCLE_OFFSET, priv->nr_channels);
+	kirkland_regs_cache(&priv->regs, RAMP_STEP_OFFSET, priv->nr_channels);
+	kirkland_regs_sync(&priv->regs);
+
+	priv->commit = priv->base_addr + COMMIT_OFFSET;
+
+	// Initialize the misc device paramters
+	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
+	priv->miscdev.name = priv->name;
+	priv->miscdev.fops = &kirkland_pwm_bank_fops;
+	priv->miscdev.parent = &pdev->dev;
+
+	// Register the misc device; this creates a char dev at /dev/kirkland_pwm_bank
+	// for the first instance and /dev/kirkland_pwm_bankN for the others
+	ret = misc_register(&priv->miscdev);
+	if (ret) {
+		pr_err("Failed to register misc device");
+		return ret;
+	}
+
+	/* Attach the pwm bank's private data to the platform device's struct.
+	 * This is so we can access our state container in the other functions.
+	 */
+	platform_set_drvdata(pdev, priv);
+
+	pr_info("%s: %u channels, %u period groups\n", priv->name, priv->nr_channels, priv->nr_groups);
+
+	return 0;
+}
+
+/**
+ * kirkland_pwm_bank_remove() - Remove a pwm bank device.
+ * @pdev: Platform device structure associated with our pwm bank device.
+ *
+ * This function is called when a pwm bank device is removed or
+ * the driver is removed
+ */
+static int kirkland_pwm_bank_remove(struct platform_device *pdev) {
+	// get the pwm bank's private data from the platform device.
+	struct kirkland_pwm_bank_dev *priv = platform_get_drvdata(pdev);
+
+	// Deregister the misc device and remove its /dev/kirkland_pwm_bank* file.
+	misc_deregister(&priv->miscdev);
+
+	pr_info("kirkland_pwm_bank_remove successful\n");
+
+	return 0;
+}
+
+/**
+ * kirkland_pwm_bank_reg_bits() - Trim a value to the bits its register keeps.
+ * @offset: Byte offset of the register.
+ * @val: The value being written.
+ *
+ * The component drops the bits its controllers don't use, so a value has to
+ * be trimmed the same way before it goes in the shadow cache, or a cached
+ * read would return bits the hardware doesn't have.
+ *
+ * Return: @val as the register will read back.
+ */
+static u32 kirkland_pwm_bank_reg_bits(u32 offset, u32 val) {
+	if (offset >= PERIOD_OFFSET && offset < DUTY_CYCLE_OFFSET) {
+		return val & PERIOD_BITS;
+	}
+	if (offset >= DUTY_CYCLE_OFFSET) {
+		return val & DUTY_CYCLE_BITS;
+	}
+
+	return val;
+}
+
+/**
+ * kirkland_pwm_bank_read() - Read method for the kirkland_pwm_bank char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the value into.
+ * @count: The number of bytes being requested.
+ * @offset: The byte offset in the file being read from.
+ *
+ * Reads as many whole registers as @count asks for, up to the end of the
+ * device, under a single lock acquisition. Reading 4 * channels bytes at
+ * 0x200 returns every duty cycle in one syscall.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t kirkland_pwm_bank_read(struct file *file, char __user *buf, size_t count, loff_t *offset) {
+	u32 *vals;
+	ssize_t n;
+
+	/* Get the device's private data from the file struct's private_data field.
+	 * The private_data field is equal to the miscdev field in the
+	 * kirkland_pwm_bank_dev struct. container_of returns the
+	 * kirkland_pwm_bank_dev struct that contains the miscdev in private_data.
+	 */
+	struct kirkland_pwm_bank_dev *priv = container_of(file->private_data, struct kirkland_pwm_bank_dev, miscdev);
+
+	// Check the file offset and work out how many whole registers to read.
+	n = kirkland_regs_count(&priv->regs, *offset, count);
+	if (n <= 0) {
+		return n;
+	}
+
+	// The whole window is 1 KiB, too much for the stack
+	vals = kmalloc_array(n, sizeof(u32), GFP_KERNEL);
+	if (!vals) {
+		return -ENOMEM;
+	}
+
+	mutex_lock(&priv->lock);
+	kirkland_regs_read(&priv->regs, *offset, vals, n);
+	mutex_unlock(&priv->lock);
+
+	// Copy the values to userspace.
+	if (copy_to_user(buf, vals, n * sizeof(u32))) {
+		pr_warn("kirkland_pwm_bank_read: nothing copied\n");
+		kfree(vals);
+		return -EFAULT;
+	}
+	kfree(vals);
+
+	// Increment the file offset by the number of bytes we read.
+	*offset = *offset + n * sizeof(u32);
+
+	return n * sizeof(u32);
+}
+
+/**
+ * kirkland_pwm_bank_write() - Write method for the kirkland_pwm_bank char device
+ * @file: Pointer to the char device file struct.
+ * @buf: User-space buffer to read the value from.
+ * @count: The number of bytes being written.
+ * @offset: The byte offset in the file being written to.
+ *
+ * Writes as many whole registers as @count holds, up to the end of the
+ * device, under a single lock acquisition, then commits them, so a block of
+ * duty cycles takes effect together. Nothing is committed if no register
+ * changed.
+ *
+ * Return: On success, the number of bytes written is returned and the
+ * offset @offset is advanced by this number. On error, a negative error
+ * value is returned.
+ */
+static ssize_t kirkland_pwm_bank_write(struct file *file, const char __user *buf, size_t count, loff_t *offset) {
+	u32 *vals;
+	ssize_t n, i;
+
+	struct kirkland_pwm_bank_dev *priv = container_of(file->private_data, struct kirkland_pwm_bank_dev, miscdev);
+
+	n = kirkland_regs_count(&priv->regs, *offset, count);
+	if (n <= 0) {
+		return n;
+	}
+
+	// Get the values from userspace before taking the lock; this can fault.
+	vals = memdup_user(buf, n * sizeof(u32));
+	if (IS_ERR(vals)) {
+		pr_warn("kirkland_pwm_bank_write: nothing copied from user space\n");
+		return PTR_ERR(vals);
+	}
+	for (i = 0; i < n; i++) {
+		vals[i] = kirkland_pwm_bank_reg_bits(*offset + i * sizeof(u32), vals[i]);
+	}
+
+	mutex_lock(&priv->lock);
+	if (kirkland_regs_write(&priv->regs, *offset, vals, n)) {
+		iowrite32(COMMIT, priv->commit);
+	}
+	mutex_unlock(&priv->lock);
+	kfree(vals);
+
+	// Increment the file offset by the number of bytes we wrote.
+	*offset = *offset + n * sizeof(u32);
+
+	// Return the number of bytes we wrote.
+	return n * sizeof(u32);
+}
+
+/**
+ * kirkland_pwm_bank_ioctl() - ioctl method for the kirkland_pwm_bank char device
+ * @file: Pointer to the char device file struct.
+ * @cmd: KIRKLAND_IOC_REGIO.
+ * @arg: User-space pointer to the command's argument.
+ *
+ * Like write(), the batch's writes are committed together before the reads.
+ *
+ * Return: 0 on success, -ENOTTY for an unknown command, or another negative
+ * error code.
+ */
+static long kirkland_pwm_bank_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+	struct kirkland_pwm_bank_dev *priv = container_of(file->private_data, struct kirkland_pwm_bank_dev, miscdev);
+	struct kirkland_regio_batch batch;
+	u32 i;
+	int ret;
+
+	if (cmd != KIRKLAND_IOC_REGIO) {
+		return -ENOTTY;
+	}
+
+	ret = kirkland_regio_get(&priv->regs, &batch, arg);
+	if (ret) {
+		return ret;
+	}
+	for (i = 0; i < batch.req.nr_writes; i++) {
+		batch.writes[i].value = kirkland_pwm_bank_reg_bits(batch.writes[i].offset, batch.writes[i].value);
+	}
+
+	mutex_lock(&priv->lock);
+	if (kirkland_regio_apply_writes(&priv->regs, &batch)) {
+		iowrite32(COMMIT, priv->commit);
+	}
+	kirkland_regio_apply_reads(&priv->regs, &batch);
+	mutex_unlock(&priv->lock);
+
+	return kirkland_regio_put(&batch);
+}
+
+/**
+ * kirkland_pwm_bank_show_list() - Print a block of registers for sysfs.
+ * @priv: The pwm bank.
+ * @offset: Byte offset of the first register.
+ * @n: Number of registers.
+ * @buf: sysfs buffer.
+ *
+ * Return: The number of bytes put in @buf.
+ */
+static ssize_t kirkland_pwm_bank_show_list(struct kirkland_pwm_bank_dev *priv, u32 offset, u32 n, char *buf) {
+	u32 vals[MAX_CHANNELS];
+	ssize_t len = 0;
+	u32 i;
+
+	// Under the lock, so the values are from the same update
+	mutex_lock(&priv->lock);
+	kirkland_regs_read(&priv->regs, offset, vals, n);
+	mutex_unlock(&priv->lock);
+
+	for (i = 0; i < n; i++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, i ? " %u" : "%u", vals[i]);
+	}
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+/**
+ * kirkland_pwm_bank_store_list() - Write a block of registers from sysfs.
+ * @priv: The pwm bank.
+ * @offset: Byte offset of the first register.
+ * @max: Number of registers in the block.
+ * @buf: Space-separated values, for registers 0, 1, ... of the block.
+ *
+ * Fewer than @max values leave the remaining registers alone. The values are
+ * committed together, if any of them changed a register.
+ *
+ * Return: 0, or -EINVAL for no values, too many, or one that doesn't parse.
+ */
+static int kirkland_pwm_bank_store_list(struct kirkland_pwm_bank_dev *priv, u32 offset, u32 max, const char *buf) {
+	u32 vals[MAX_CHANNELS];
+	char tok[16];
+	size_t len;
+	u32 n = 0;
+	int ret;
+
+	// Like the other drivers' attributes, hex is accepted
+	for (buf = skip_spaces(buf); *buf != '\0'; buf = skip_spaces(buf + len)) {
+		len = strcspn(buf, " \t\n");
+		if (n == max || len >= sizeof(tok)) {
+			return -EINVAL;
+		}
+		memcpy(tok, buf, len);
+		tok[len] = '\0';
+		ret = kstrtou32(tok, 0, &vals[n]);
+		if (ret < 0) {
+			return ret;
+		}
+		vals[n] = kirkland_pwm_bank_reg_bits(offset + n * sizeof(u32), vals[n]);
+		n++;
+	}
+	if (n == 0) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&priv->lock);
+	if (kirkland_regs_write(&priv->regs, offset, vals, n)) {
+		iowrite32(COMMIT, priv->commit);
+	}
+	mutex_unlock(&priv->lock);
+
+	return 0;
+}
+
+/**
+ * channels_show() - Return the number of PWM channels.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t channels_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", priv->nr_channels);
+}
+
+/**
+ * groups_show() - Return the number of period groups.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t groups_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", priv->nr_groups);
+}
+
+/**
+ * period_show() - Return every group's period.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t period_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+
+	return kirkland_pwm_bank_show_list(priv, PERIOD_OFFSET, priv->nr_groups, buf);
+}
+
+/**
+ * period_store() - Set group periods, starting at group 0.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that contains up to one period per group, in 1/128 s.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t period_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+	int ret;
+
+	ret = kirkland_pwm_bank_store_list(priv, PERIOD_OFFSET, priv->nr_groups, buf);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return size;
+}
+
+/**
+ * duty_cycle_show() - Return every channel's duty cycle.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t duty_cycle_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+
+	return kirkland_pwm_bank_show_list(priv, DUTY_CYCLE_OFFSET, priv->nr_channels, buf);
+}
+
+/**
+ * duty_cycle_store() - Set duty cycles, starting at channel 0.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that contains up to one 22.21 duty cycle per channel.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+	int ret;
+
+	ret = kirkland_pwm_bank_store_list(priv, DUTY_CYCLE_OFFSET, priv->nr_channels, buf);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return size;
+}
+
+/**
+ * ramp_step_show() - Return every channel's ramp step.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+
+	return kirkland_pwm_bank_show_list(priv, RAMP_STEP_OFFSET, priv->nr_channels, buf);
+}
+
+/**
+ * ramp_step_store() - Set ramp steps, starting at channel 0.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that contains up to one ramp step per channel.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+	int ret;
+
+	ret = kirkland_pwm_bank_store_list(priv, RAMP_STEP_OFFSET, priv->nr_channels, buf);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return size;
+}
+
+/**
+ * ramping_show() - Return which channels are still ramping.
+ * @dev: Device structure for the kirkland_pwm_bank component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read; a hex mask where bit n is channel n.
+ */
+static ssize_t ramping_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_pwm_bank_dev *priv = dev_get_drvdata(dev);
+	u64 ramping;
+
+	ramping = ioread32(priv->base_addr + RAMPING_LO_OFFSET);
+	if (priv->nr_channels > 32) {
+		ramping |= (u64)ioread32(priv->base_addr + RAMPING_HI_OFFSET) << 32;
+	}
+
+	return scnprintf(buf, PAGE_SIZE, "0x%llx\n", ramping);
+}
+
+/**
+ * Define the compatible property used for matching devices to this driver,
+ * then add our device id structure to the kernel's device table. For a device
+ * to be matched with this driver, its device tree node must use the same
+ * compatible string as defined here.
+ */
+static const struct of_device_id kirkland_pwm_bank_of_match[] = {
+	{ .compatible = "Kirkland,kirkland_pwm_bank", },
+	{ }
+};
+
+module_platform_driver(kirkland_pwm_bank_driver);
+MODULE_DEVICE_TABLE(of, kirkland_pwm_bank_of_match);
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_AUTHOR("Grant Kirkland");
+MODULE_DESCRIPTION("kirkland_pwm_bank driver");
@@ -3,17 +3,40 @@
 #include <linux/mod_devicetable.h>
 #include <linux/io.h> //iowrite32/ioread32 functions
 #include <linux/mutex.h> // mutex definitions
+#include <linux/spinlock.h> // spinlock definitions
+#include <linux/hrtimer.h> // hrtimer definitions
+#include <linux/slab.h> // kmalloc_array, kfree
+#include <linux/math64.h> // div64_s64
 #include <linux/miscdevice.h> // miscdevice definitions
+#include <linux/idr.h> // ida_alloc, ida_free
 #include <linux/types.h> // data types like u32, u16, etc.
 #include <linux/fs.h> // copy_to_user, etc
 #include <linux/kstrtox.h> // kstrtou8, etc
+#include <linux/export.h> // EXPORT_SYMBOL_GPL
+
+#include "kirkland-rgb.h"
+#include "../../include/kirkland_regio.h"
 
 
 #define PERIOD_REG_OFFSET 0
 #define RED_DUTY_CYCLE_OFFSET 4
 #define GRN_DUTY_CYCLE_OFFSET 8
 #define BLU_DUTY_CYCLE_OFFSET 12
-#define SPAN 16
+#define COMMIT_OFFSET 16
+#define RED_RAMP_STEP_OFFSET 20
+#define GRN_RAMP_STEP_OFFSET 24
+#define BLU_RAMP_STEP_OFFSET 28
+#define SPAN 32
+
+// Writing this to the commit register latches the shadow registers
+#define COMMIT 1
+
+// Duty cycle register bit that dithers the channel's high time
+#define DUTY_CYCLE_HIRES BIT(31)
+
+// Rate the sequencer updates the LED at while fading, in Hz
+#define FRAME_RATE_DEFAULT 200
+#define FRAME_RATE_MAX 1000
 
 static struct platform_driver kirkland_rgb_driver;
 static const struct of_device_id kirkland_rgb_of_match[];
@@ -22,6 +45,8 @@ static int kirkland_rgb_probe(struct platform_device *pdev);
 static int kirkland_rgb_remove(struct platform_device *pdev);
 static ssize_t kirkland_rgb_read(struct file *file, char __user *buf, size_t count, loff_t *offset);
 static ssize_t kirkland_rgb_write(struct file *file, const char __user *buf, size_t count, loff_t *offset);
+static long kirkland_rgb_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+static enum hrtimer_restart kirkland_rgb_seq_timer(struct hrtimer *timer);
 
 static ssize_t period_reg_show(struct device *dev, struct device_attribute *attr, char *buf);
 static ssize_t period_reg_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
@@ -31,6 +56,21 @@ static ssize_t grn_duty_cycle_show(struct device *dev, struct device_attribute *
 static ssize_t grn_duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
 static ssize_t blu_duty_cycle_show(struct device *dev, struct device_attribute *attr, char *buf);
 static ssize_t blu_duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t color_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t color_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t red_ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t red_ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t grn_ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t grn_ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t blu_ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t blu_ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t hw_fade_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t hw_fade_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t sequence_running_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t frame_rate_hz_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t frame_rate_hz_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t hires_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t hires_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
 static struct attribute *kirkland_rgb_attrs[];
 
 // Define sysfs attributes
@@ -38,6 +78,14 @@ static DEVICE_ATTR_RW(period_reg);
 static DEVICE_ATTR_RW(red_duty_cycle);
 static DEVICE_ATTR_RW(grn_duty_cycle);
 static DEVICE_ATTR_RW(blu_duty_cycle);
+static DEVICE_ATTR_RW(color);
+static DEVICE_ATTR_RW(red_ramp_step);
+static DEVICE_ATTR_RW(grn_ramp_step);
+static DEVICE_ATTR_RW(blu_ramp_step);
+static DEVICE_ATTR_RW(hw_fade);
+static DEVICE_ATTR_RO(sequence_running);
+static DEVICE_ATTR_RW(frame_rate_hz);
+static DEVICE_ATTR_RW(hires);
 
 // Create an attribute group so the device core can
 // export the attributes for us.
@@ -46,6 +94,14 @@ static struct attribute *kirkland_rgb_attrs[] = {
 	&dev_attr_red_duty_cycle.attr,
 	&dev_attr_grn_duty_cycle.attr,
 	&dev_attr_blu_duty_cycle.attr,
+	&dev_attr_color.attr,
+	&dev_attr_red_ramp_step.attr,
+	&dev_attr_grn_ramp_step.attr,
+	&dev_attr_blu_ramp_step.attr,
+	&dev_attr_hw_fade.attr,
+	&dev_attr_sequence_running.attr,
+	&dev_attr_frame_rate_hz.attr,
+	&dev_attr_hires.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(kirkland_rgb);
@@ -59,23 +115,74 @@ ATTRIBUTE_GROUPS(kirkland_rgb);
 /**
  * struct kirkland_rgb_dev - Private led patterns device struct.
  * @base_addr: Pointer to the component's base address
- * @period_reg: Address of the period_reg register
- * @red_duty_cycle: Address of the red_duty_cycle register
- * @grn_duty_cycle: Address of the grn_duty_cycle register
- * @blu_duty_cycle: Address of the blu_duty_cycle register
+ * @regs: Register window, with a shadow copy of every register but commit;
+ *	all register access goes through it
+ * @commit: Address of the commit register
+ * @miscdev: miscdevice used to create a character device
+ * @id: Instance number from kirkland_rgb_ida
+ * @name: Name of the device node; kirkland_rgb for instance 0 and kirkland_rgbN
+ *	for instance N
+ * @lock: spinlock that keeps register updates and their commit together; a
+ *	spinlock because the sequencer timer writes the registers too
+ * @seq_lock: mutex that serializes starting and stopping sequences
+ * @timer: hrtimer that plays the keyframe sequence
+ * @frames: Keyframe table of the current sequence, or NULL
+ * @nr_frames: Number of entries in @frames
+ * @loops_left: Plays of @frames still to go; 0 means forever
+ * @frame: Index of the keyframe being played
+ * @frame_start: When the keyframe being played started
+ * @from: Colour the keyframe being played fades from, as {red, grn, blu}
+ * @pass_ns: Length of one pass through @frames, in nanoseconds
+ * @saved_step: Ramp steps from before the sequence started, restored after
+ * @frame_rate_hz: How often the LED is updated during a software fade
+ * @hw_fade: Fade with the controller's ramp engine instead of in software
+ * @hires: Set DUTY_CYCLE_HIRES in every duty cycle the driver writes
+ * @running: True while a sequence is playing
+ * @alert: True while another driver has taken over the LED; see
+ *	kirkland_rgb_set_alert()
+ * @alert_saved: Duty cycles and ramp steps to put back after the alert, as
+ *	{red, grn, blu, red step, grn step, blu step}
+ *
+ * The period, duty cycle and ramp step registers are shadow registers:
+ * writes to them don't reach the LED until the commit register is written,
+ * and then all of them take effect together at the next PWM period boundary.
+ * With a non-zero ramp step, the controller then moves that channel's duty
+ * cycle toward the new value by one step per PWM period.
+ *
+ * The driver always commits after writing, so @regs' cache also matches the
+ * active registers. Writes that don't change anything are skipped, and so
+ * is the commit when no register changed.
  *
  * A kirkland_rgb_dev struct gets created for each rgb controller component.
  */
 struct kirkland_rgb_dev {
 	void __iomem *base_addr;
-	void __iomem *period_reg;
-	void __iomem *red_duty_cycle;
-	void __iomem *grn_duty_cycle;
-	void __iomem *blu_duty_cycle;
+	struct kirkland_regs regs;
+	void __iomem *commit;
 	struct miscdevice miscdev;
-	struct mutex lock;
+	int id;
+	const char *name;
+	spinlock_t lock;
+	struct mutex seq_lock;
+	struct hrtimer timer;
+	struct kirkland_rgb_keyframe *frames;
+	u32 nr_frames;
+	u32 loops_left;
+	u32 frame;
+	ktime_t frame_start;
+	u32 from[3];
+	s64 pass_ns;
+	u32 saved_step[3];
+	u32 frame_rate_hz;
+	bool hw_fade;
+	bool hires;
+	bool running;
+	bool alert;
+	u32 alert_saved[6];
 };
 
+static void kirkland_rgb_seq_stop(struct kirkland_rgb_dev *priv);
+
 /**
  * struct kirkland_rgb_driver - Platform driver struct for the kirkland_rgb driver
  * @probe: Function that's called when a device is found
@@ -106,14 +213,23 @@ static struct platform_driver kirkland_rgb_driver = {
  * @write: The write function
  * @llseek: We use the kernel's default_llseek() function; this allows
  * users to change what position they are writing/reading to/from.
+ * @unlocked_ioctl: Starts and stops keyframe sequences, and applies
+ * batched register access.
+ * @compat_ioctl: The ioctl arguments have the same layout for 32-bit
+ * callers, so their pointers only need converting.
  */
  static const struct file_operations kirkland_rgb_fops = {
 	.owner = THIS_MODULE,
 	.read = kirkland_rgb_read,
 	.write = kirkland_rgb_write,
 	.llseek = default_llseek,
+	.unlocked_ioctl = kirkland_rgb_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
  };
 
+// Instance numbers for devm_kirkland_node_name()
+static DEFINE_IDA(kirkland_rgb_ida);
+
 /**
  * kirkland_rgb_probe() - Initialize device when a match is found
  * @pdev: Platform device structure associated with our rgb controller device;
@@ -126,7 +242,7 @@ static struct platform_driver kirkland_rgb_driver = {
  */
 static int kirkland_rgb_probe(struct platform_device *pdev) {
 	struct kirkland_rgb_dev *priv;
-	size_t ret;
+	int ret;
 
 	/*
 	 * Allocate kernel memory for the led patterns device and set it to 0.
@@ -155,25 +271,55 @@ static int kirkland_rgb_probe(struct platform_device *pdev) {
 		return PTR_ERR(priv->base_addr);
 	}
 
-	// Set the memory addresses for each register.
-	priv->period_reg = priv->base_addr + PERIOD_REG_OFFSET;
-	priv->red_duty_cycle = priv->base_addr + RED_DUTY_CYCLE_OFFSET;
-	priv->grn_duty_cycle = priv->base_addr + GRN_DUTY_CYCLE_OFFSET;
-	priv->blu_duty_cycle = priv->base_addr + BLU_DUTY_CYCLE_OFFSET;
+	ret = devm_kirkland_node_name(&pdev->dev, &kirkland_rgb_ida, "kirkland_rgb", &priv->id, &priv->name);
+	if (ret) {
+		pr_err("Failed to allocate an instance number\n");
+		return ret;
+	}
+
+	spin_lock_init(&priv->lock);
+	mutex_init(&priv->seq_lock);
+	hrtimer_init(&priv->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	priv->timer.function = kirkland_rgb_seq_timer;
+	priv->frame_rate_hz = FRAME_RATE_DEFAULT;
+	priv->hw_fade = true;
+
+	priv->regs.name = priv->name;
+	priv->regs.base = priv->base_addr;
+	priv->regs.span = SPAN;
+
+	priv->commit = priv->base_addr + COMMIT_OFFSET;
+
+	// Everything but the commit register is plain storage, so it can be
+	// served from the shadow cache. Load the cache before the defaults go
+	// in, so a default that matches what the hardware holds is still right.
+	ret = devm_kirkland_regs_cache(&pdev->dev, &priv->regs, SPAN / sizeof(u32));
+	if (ret) {
+		pr_err("Failed to allocate memory\n");
+		return ret;
+	}
+	kirkland_regs_cache(&priv->regs, PERIOD_REG_OFFSET, 4);
+	kirkland_regs_cache(&priv->regs, RED_RAMP_STEP_OFFSET, 3);
+	kirkland_regs_sync(&priv->regs);
 
 	// Set default register values
-	iowrite32(0x80, priv->period_reg);
-	iowrite32(0x100000, priv->red_duty_cycle);
-	iowrite32(0x80000, priv->grn_duty_cycle);
-	iowrite32(0x40000, priv->blu_duty_cycle);
+	kirkland_reg_write(&priv->regs, PERIOD_REG_OFFSET, 0x80);
+	kirkland_reg_write(&priv->regs, RED_DUTY_CYCLE_OFFSET, 0x100000);
+	kirkland_reg_write(&priv->regs, GRN_DUTY_CYCLE_OFFSET, 0x80000);
+	kirkland_reg_write(&priv->regs, BLU_DUTY_CYCLE_OFFSET, 0x40000);
+	kirkland_reg_write(&priv->regs, RED_RAMP_STEP_OFFSET, 0);
+	kirkland_reg_write(&priv->regs, GRN_RAMP_STEP_OFFSET, 0);
+	kirkland_reg_write(&priv->regs, BLU_RAMP_STEP_OFFSET, 0);
+	iowrite32(COMMIT, priv->commit);
 
 	// Initialize the misc device paramters
 	priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-	priv->miscdev.name = "kirkland_rgb";
+	priv->miscdev.name = priv->name;
 	priv->miscdev.fops = &kirkland_rgb_fops;
 	priv->miscdev.parent = &pdev->dev;
 
 	// Register the misc device; this creates a char dev at /dev/kirkland_rgb
+	// for the first instance and /dev/kirkland_rgbN for the others
 	ret = misc_register(&priv->miscdev);
 	if (ret) {
 		pr_err("Failed to register misc device");
@@ -201,9 +347,14 @@ static int kirkland_rgb_remove(struct platform_device *pdev) {
 	// get the led patterns's private data from the platform device.
 	struct kirkland_rgb_dev *priv = platform_get_drvdata(pdev);
 
-	// Deregister the misc device and remove the /dev/kirkland_rgb file.
+	// Deregister the misc device and remove its /dev/kirkland_rgb* file.
 	misc_deregister(&priv->miscdev);
 
+	// Stop the sequencer before the registers go away
+	mutex_lock(&priv->seq_lock);
+	kirkland_rgb_seq_stop(priv);
+	mutex_unlock(&priv->seq_lock);
+
 	pr_info("kirkland_rgb_remove successful\n");
 
 	return 0;
@@ -216,13 +367,18 @@ static int kirkland_rgb_remove(struct platform_device *pdev) {
  * @count: The number of bytes being requested.
  * @offset: The byte offset in the file being read from.
  * 
+ * Reads as many whole registers as @count asks for, up to the end of the
+ * device, under a single lock acquisition, so a full register dump is one
+ * syscall.
+ *
  * Return: On success, the number of bytes written is returned and the
  * offset @offset is advanced by this number. On error, a negative error
  * value is returned.
  */
  static ssize_t kirkland_rgb_read(struct file *file, char __user *buf, size_t count, loff_t *offset) {
-	size_t ret;
-	u32 val;
+	u32 vals[SPAN / sizeof(u32)];
+	ssize_t n;
+	unsigned long flags;
 
 	/* Get the device's private data from the file struct's private_data field.
 	 * The private_data field is equal to the miscdev field in the kirkland_rgb_dev
@@ -230,35 +386,27 @@ static int kirkland_rgb_remove(struct platform_device *pdev) {
 	 * miscdev in private_data. 
 	 */
 	 struct kirkland_rgb_dev *priv = container_of(file->private_data, struct kirkland_rgb_dev, miscdev);
-	 
-	 // Check the file offset to make sure we are reading from a valid location.
-	 if (*offset < 0) {
-		// We can't read from a negative file position.
-		return -EINVAL;
-	 }
-	 if (*offset >= SPAN) {
-		// We can't read from a position past the end of our device.
-		return 0;
-	 }
-	 if ((*offset % 0x4) != 0) {
-		// Prevent unaligned access.
-		pr_warn("kirkland_rgb_read: unaligned access\n");
-		return -EFAULT;
+
+	 // Check the file offset and work out how many whole registers to read.
+	 n = kirkland_regs_count(&priv->regs, *offset, count);
+	 if (n <= 0) {
+		return n;
 	 }
 
-	 val = ioread32(priv->base_addr + *offset);
+	 spin_lock_irqsave(&priv->lock, flags);
+	 kirkland_regs_read(&priv->regs, *offset, vals, n);
+	 spin_unlock_irqrestore(&priv->lock, flags);
 
-	 // Copy the value to userspace.
-	 ret = copy_to_user(buf, &val, sizeof(val));
-	 if (ret == sizeof(val)) {
+	 // Copy the values to userspace.
+	 if (copy_to_user(buf, vals, n * sizeof(u32))) {
 		pr_warn("kirkland_rgb_read: nothing copied\n");
 		return -EFAULT;
 	 }
 
 	 // Increment the file offset by the number of bytes we read.
-	 *offset = *offset + sizeof(val);
+	 *offset = *offset + n * sizeof(u32);
 	 
-	 return sizeof(val);
+	 return n * sizeof(u32);
  }
 
 /**
@@ -268,47 +416,468 @@ static int kirkland_rgb_remove(struct platform_device *pdev) {
  * @count: The number of bytes being written.
  * @offset: The byte offset in the file being written to.
  *
+ * Writes as many whole registers as @count holds, up to the end of the
+ * device, under a single lock acquisition, then commits them. A 16-byte
+ * write at offset 0 therefore sets the period and all three duty cycles and
+ * makes them take effect together, in one syscall. Registers that already
+ * hold the value written are skipped, and if none changed, so is the commit.
+ *
  * Return: On success, the number of bytes written is returned and the
  * offset @offset is advanced by this number. On error, a negative error
  * value is returned.
  */
 static ssize_t kirkland_rgb_write(struct file *file, const char __user *buf, size_t count, loff_t *offset) {
-	size_t ret;
-	u32 val;
+	u32 vals[SPAN / sizeof(u32)];
+	ssize_t n;
+	unsigned long flags;
 
 	struct kirkland_rgb_dev *priv = container_of(file->private_data, struct kirkland_rgb_dev, miscdev);
 
-	if (*offset < 0) {
-		return -EINVAL;
+	n = kirkland_regs_count(&priv->regs, *offset, count);
+	if (n <= 0) {
+		return n;
+	}
+
+	// Get the values from userspace before taking the lock; this can fault.
+	if (copy_from_user(vals, buf, n * sizeof(u32))) {
+		pr_warn("kirkland_rgb_write: nothing copied from user space\n");
+		return -EFAULT;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (kirkland_regs_write(&priv->regs, *offset, vals, n)) {
+		iowrite32(COMMIT, priv->commit);
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	// Increment the file offset by the number of bytes we wrote.
+	*offset = *offset + n * sizeof(u32);
+
+	// Return the number of bytes we wrote.
+	return n * sizeof(u32);
+}
+
+/**
+ * kirkland_rgb_regio() - Apply a KIRKLAND_IOC_REGIO batch.
+ * @priv: The rgb controller.
+ * @arg: User-space pointer to the struct kirkland_regio.
+ *
+ * Like write(), the batch's writes are committed together, so a colour and
+ * its ramp steps set in one call take effect at the same period boundary.
+ * The reads come after the commit.
+ *
+ * Return: 0, or a negative error from kirkland_regio_get()/_put().
+ */
+static long kirkland_rgb_regio(struct kirkland_rgb_dev *priv, unsigned long arg) {
+	struct kirkland_regio_batch batch;
+	unsigned long flags;
+	int ret;
+
+	ret = kirkland_regio_get(&priv->regs, &batch, arg);
+	if (ret) {
+		return ret;
 	}
-	if (*offset >= SPAN) {
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (kirkland_regio_apply_writes(&priv->regs, &batch)) {
+		iowrite32(COMMIT, priv->commit);
+	}
+	kirkland_regio_apply_reads(&priv->regs, &batch);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return kirkland_regio_put(&batch);
+}
+
+/**
+ * kirkland_rgb_write_reg() - Write one register and commit it.
+ * @priv: The rgb device; the caller holds @priv->lock.
+ * @offset: Byte offset of the register.
+ * @val: The value.
+ *
+ * Nothing is written or committed if the register already holds @val.
+ */
+static void kirkland_rgb_write_reg(struct kirkland_rgb_dev *priv, u32 offset, u32 val) {
+	if (kirkland_reg_write(&priv->regs, offset, val)) {
+		iowrite32(COMMIT, priv->commit);
+	}
+}
+
+/**
+ * kirkland_rgb_duty() - Put the hires setting into a duty cycle.
+ * @priv: The rgb device; the caller holds @priv->lock.
+ * @duty: The duty cycle; DUTY_CYCLE_HIRES is ignored.
+ *
+ * Return: @duty with DUTY_CYCLE_HIRES set if hires is on, and clear if not.
+ */
+static u32 kirkland_rgb_duty(struct kirkland_rgb_dev *priv, u32 duty) {
+	duty &= ~DUTY_CYCLE_HIRES;
+
+	return priv->hires ? duty | DUTY_CYCLE_HIRES : duty;
+}
+
+/**
+ * kirkland_rgb_read_color() - Read the three duty cycles.
+ * @priv: The rgb device; the caller holds @priv->lock.
+ * @color: Where to put them, as {red, grn, blu}, without DUTY_CYCLE_HIRES.
+ */
+static void kirkland_rgb_read_color(struct kirkland_rgb_dev *priv, u32 *color) {
+	int i;
+
+	kirkland_regs_read(&priv->regs, RED_DUTY_CYCLE_OFFSET, color, 3);
+	for (i = 0; i < 3; i++) {
+		color[i] &= ~DUTY_CYCLE_HIRES;
+	}
+}
+
+/**
+ * kirkland_rgb_update() - Write duty cycles and ramp steps and commit them.
+ * @priv: The rgb device; the caller holds @priv->lock.
+ * @color: Duty cycles as {red, grn, blu}, or NULL to leave them. The
+ *	hires setting replaces their DUTY_CYCLE_HIRES bits.
+ * @step: Ramp steps as {red, grn, blu}, or NULL to leave them.
+ *
+ * Registers that already hold their new value aren't written, and if none
+ * changed there's nothing to commit. While a colour is held, the sequencer
+ * therefore doesn't touch the bridge at all.
+ */
+static void kirkland_rgb_update(struct kirkland_rgb_dev *priv, const u32 *color, const u32 *step) {
+	u32 duty[3];
+	bool changed = false;
+	int i;
+
+	if (step) {
+		changed |= kirkland_regs_write(&priv->regs, RED_RAMP_STEP_OFFSET, step, 3);
+	}
+	if (color) {
+		for (i = 0; i < 3; i++) {
+			duty[i] = kirkland_rgb_duty(priv, color[i]);
+		}
+		changed |= kirkland_regs_write(&priv->regs, RED_DUTY_CYCLE_OFFSET, duty, 3);
+	}
+	if (changed) {
+		iowrite32(COMMIT, priv->commit);
+	}
+}
+
+/**
+ * kirkland_rgb_ramp_step() - Work out a ramp step for a hardware fade.
+ * @from: Duty cycle the fade starts at.
+ * @to: Duty cycle the fade ends at.
+ * @periods: Number of PWM periods the fade should take.
+ *
+ * Return: The per-period step, rounded up so the ramp finishes in time, or 0
+ * (change immediately) if there's no time for a ramp.
+ */
+static u32 kirkland_rgb_ramp_step(u32 from, u32 to, u32 periods) {
+	u32 delta = from > to ? from - to : to - from;
+
+	if (periods == 0) {
 		return 0;
 	}
-	if ((*offset % 0x4) != 0) {
-		pr_warn("kirkland_rgb_write: unaligned access\n");
-		return -EFAULT;
+
+	return delta / periods + (delta % periods != 0);
+}
+
+/**
+ * kirkland_rgb_seq_timer() - Play the next step of the keyframe sequence.
+ * @timer: The sequencer hrtimer embedded in our kirkland_rgb_dev.
+ *
+ * Works out where in the sequence we are from the time since the current
+ * keyframe started, so a late timer never makes the sequence run slow. While
+ * one holds, the timer sleeps until the keyframe ends. A fade is handed to
+ * the controller's ramp engine when hw_fade is set, so it costs one register
+ * update; otherwise the LED is updated every 1/frame_rate_hz seconds.
+ *
+ * Return: HRTIMER_RESTART while the sequence is playing, HRTIMER_NORESTART
+ * once a finite sequence has finished.
+ */
+static enum hrtimer_restart kirkland_rgb_seq_timer(struct hrtimer *timer) {
+	struct kirkland_rgb_dev *priv = container_of(timer, struct kirkland_rgb_dev, timer);
+	const struct kirkland_rgb_keyframe *kf = &priv->frames[priv->frame];
+	ktime_t now = ktime_get();
+	ktime_t frame_end, next;
+	s64 elapsed, duration, frac;
+	u32 to[3], color[3], step[3] = { 0 };
+	u32 period, periods;
+	bool done = false;
+	bool hw_fade;
+	int i;
+
+	elapsed = ktime_to_ns(ktime_sub(now, priv->frame_start));
+	duration = (s64)kf->duration_ms * NSEC_PER_MSEC;
+
+	// If we fell a whole pass behind (e.g. across a suspend), pick up from
+	// here instead of replaying everything we missed.
+	if (elapsed > priv->pass_ns) {
+		priv->frame_start = now;
+		elapsed = 0;
 	}
 
-	mutex_lock(&priv->lock);
+	// Step past every keyframe that has already ended
+	while (elapsed >= duration) {
+		priv->from[0] = kf->red;
+		priv->from[1] = kf->grn;
+		priv->from[2] = kf->blu;
+		priv->frame_start = ktime_add_ns(priv->frame_start, duration);
+		elapsed -= duration;
+
+		if (++priv->frame == priv->nr_frames) {
+			if (priv->loops_left == 1) {
+				done = true;
+				break;
+			}
+			if (priv->loops_left) {
+				priv->loops_left--;
+			}
+			priv->frame = 0;
+		}
+
+		kf = &priv->frames[priv->frame];
+		duration = (s64)kf->duration_ms * NSEC_PER_MSEC;
+	}
 
-	// Get the value from userspace.
-	ret = copy_from_user(&val, buf, sizeof(val));
-	if (ret != sizeof(val)) {
-		iowrite32(val, priv->base_addr + *offset);
+	hw_fade = !done && (kf->flags & KIRKLAND_RGB_KF_FADE) && READ_ONCE(priv->hw_fade);
+
+	if (done) {
+		// Finish on the last keyframe's colour
+		memcpy(color, priv->from, sizeof(color));
+	} else if ((kf->flags & KIRKLAND_RGB_KF_FADE) && !hw_fade) {
+		to[0] = kf->red;
+		to[1] = kf->grn;
+		to[2] = kf->blu;
+
+		// How far through the fade we are, as a 16-bit fraction
+		frac = div64_s64(elapsed << 16, duration);
+		for (i = 0; i < 3; i++) {
+			color[i] = priv->from[i] + ((((s64)to[i] - priv->from[i]) * frac) >> 16);
+		}
+	} else {
+		color[0] = kf->red;
+		color[1] = kf->grn;
+		color[2] = kf->blu;
+	}
 
-		// Increment the file offset by the number of bytes we wrote.
-		*offset = *offset + sizeof(val);
+	spin_lock(&priv->lock);
+	if (hw_fade) {
+		// Ramp to the keyframe's colour over the PWM periods left in it;
+		// the period register counts 1/128 s. The update is committed at
+		// the next period start and the first step lands at the one
+		// after, so the ramp only has the periods after the first.
+		period = kirkland_reg_read(&priv->regs, PERIOD_REG_OFFSET);
+		periods = 0;
+		if (period) {
+			periods = div64_u64((u64)(duration - elapsed) << 7, (u64)period * NSEC_PER_SEC);
+		}
+		if (periods) {
+			periods--;
+		}
+		for (i = 0; i < 3; i++) {
+			step[i] = kirkland_rgb_ramp_step(priv->from[i], color[i], periods);
+		}
+	} else if (done) {
+		memcpy(step, priv->saved_step, sizeof(step));
+	}
+	if (priv->alert) {
+		// Keep time, but leave the alert colour showing; the LED picks
+		// the sequence up from here when the alert ends
+		memcpy(&priv->alert_saved[0], color, sizeof(color));
+		memcpy(&priv->alert_saved[3], step, sizeof(step));
+	} else {
+		kirkland_rgb_update(priv, color, step);
+	}
+	spin_unlock(&priv->lock);
 
-		// Return the number of bytes we wrote.
-		ret = sizeof(val);
+	if (done) {
+		WRITE_ONCE(priv->running, false);
+		return HRTIMER_NORESTART;
+	}
+
+	// Wake up for the next fade step, or at the end of the keyframe
+	frame_end = ktime_add_ns(priv->frame_start, duration);
+	next = frame_end;
+	if ((kf->flags & KIRKLAND_RGB_KF_FADE) && !hw_fade) {
+		next = ktime_add_ns(now, NSEC_PER_SEC / READ_ONCE(priv->frame_rate_hz));
+		if (ktime_after(next, frame_end)) {
+			next = frame_end;
+		}
+	}
+	hrtimer_set_expires(timer, next);
+
+	return HRTIMER_RESTART;
+}
+
+/**
+ * kirkland_rgb_set_alert() - Take over the LED from another driver.
+ * @dev: The rgb controller's device.
+ * @on: Show the alert colour, or give the LED back.
+ * @red: Red duty cycle while @on.
+ * @grn: Green duty cycle while @on.
+ * @blu: Blue duty cycle while @on.
+ *
+ * The alert colour shows at the next PWM period boundary, without a ramp.
+ * While it's on, a running keyframe sequence keeps time but doesn't touch
+ * the LED; its steps, and the end or stop of the sequence, land in
+ * @priv->alert_saved instead. Turning the alert off puts back the colour and
+ * ramp steps saved there, and a running sequence takes over again at its
+ * next step. This
+ * only takes the spinlock, so it's safe in atomic context.
+ *
+ * Return: 0, or -ENODEV if @dev isn't a bound rgb controller.
+ */
+int kirkland_rgb_set_alert(struct device *dev, bool on, u32 red, u32 grn, u32 blu) {
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+	const u32 color[3] = { red, grn, blu };
+	const u32 no_step[3] = { 0, 0, 0 };
+	unsigned long flags;
+
+	if (!priv || dev->driver != &kirkland_rgb_driver.driver) {
+		return -ENODEV;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (on && !priv->alert) {
+		kirkland_rgb_read_color(priv, &priv->alert_saved[0]);
+		kirkland_regs_read(&priv->regs, RED_RAMP_STEP_OFFSET, &priv->alert_saved[3], 3);
+	}
+	if (on) {
+		kirkland_rgb_update(priv, color, no_step);
+	} else if (priv->alert) {
+		kirkland_rgb_update(priv, &priv->alert_saved[0], &priv->alert_saved[3]);
+	}
+	priv->alert = on;
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(kirkland_rgb_set_alert);
+
+/**
+ * kirkland_rgb_seq_stop() - Stop the running sequence and free its keyframes.
+ * @priv: The rgb device; the caller holds @priv->seq_lock.
+ *
+ * The LED keeps whatever colour the sequence last showed, and the ramp
+ * steps go back to what they were before it started. During an alert, that
+ * happens to the colour and steps the alert puts back.
+ */
+static void kirkland_rgb_seq_stop(struct kirkland_rgb_dev *priv) {
+	unsigned long flags;
+
+	hrtimer_cancel(&priv->timer);
+
+	// Give the ramp steps back to whoever set them before the sequence
+	if (priv->running) {
+		spin_lock_irqsave(&priv->lock, flags);
+		if (priv->alert) {
+			memcpy(&priv->alert_saved[3], priv->saved_step, sizeof(priv->saved_step));
+		} else {
+			kirkland_rgb_update(priv, NULL, priv->saved_step);
+		}
+		spin_unlock_irqrestore(&priv->lock, flags);
+	}
+	WRITE_ONCE(priv->running, false);
+
+	kfree(priv->frames);
+	priv->frames = NULL;
+	priv->nr_frames = 0;
+}
+
+/**
+ * kirkland_rgb_seq_start() - Copy in a keyframe table and start playing it.
+ * @priv: The rgb device.
+ * @useq: User-space sequence description.
+ *
+ * The whole table is copied and checked before the running sequence (if any)
+ * is stopped, so a bad table leaves the LED alone.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static int kirkland_rgb_seq_start(struct kirkland_rgb_dev *priv, const struct kirkland_rgb_sequence __user *useq) {
+	struct kirkland_rgb_sequence seq;
+	struct kirkland_rgb_keyframe *frames;
+	unsigned long flags;
+	s64 pass_ns = 0;
+	u32 i;
+
+	if (copy_from_user(&seq, useq, sizeof(seq))) {
+		return -EFAULT;
+	}
+	if (seq.nr_frames == 0 || seq.nr_frames > KIRKLAND_RGB_MAX_KEYFRAMES) {
+		return -EINVAL;
+	}
+
+	frames = kmalloc_array(seq.nr_frames, sizeof(*frames), GFP_KERNEL);
+	if (!frames) {
+		return -ENOMEM;
+	}
+	if (copy_from_user(frames, u64_to_user_ptr(seq.frames), seq.nr_frames * sizeof(*frames))) {
+		kfree(frames);
+		return -EFAULT;
+	}
+
+	for (i = 0; i < seq.nr_frames; i++) {
+		if (frames[i].duration_ms == 0 ||
+		    frames[i].duration_ms > KIRKLAND_RGB_MAX_DURATION_MS ||
+		    (frames[i].flags & ~KIRKLAND_RGB_KF_FADE)) {
+			kfree(frames);
+			return -EINVAL;
+		}
+		pass_ns += (s64)frames[i].duration_ms * NSEC_PER_MSEC;
+	}
+
+	mutex_lock(&priv->seq_lock);
+	kirkland_rgb_seq_stop(priv);
+
+	priv->frames = frames;
+	priv->nr_frames = seq.nr_frames;
+	priv->loops_left = seq.loop_count;
+	priv->frame = 0;
+	priv->pass_ns = pass_ns;
+
+	// The first keyframe fades from whatever is showing now, or from what
+	// an alert will put back. The sequence owns the ramp steps while it
+	// plays, so save the user's.
+	spin_lock_irqsave(&priv->lock, flags);
+	if (priv->alert) {
+		memcpy(priv->from, &priv->alert_saved[0], sizeof(priv->from));
+		memcpy(priv->saved_step, &priv->alert_saved[3], sizeof(priv->saved_step));
 	} else {
-		pr_warn("kirkland_rgb_write: nothing copied from user space\n");
-		ret = -EFAULT;
+		kirkland_rgb_read_color(priv, priv->from);
+		kirkland_regs_read(&priv->regs, RED_RAMP_STEP_OFFSET, priv->saved_step, 3);
 	}
+	spin_unlock_irqrestore(&priv->lock, flags);
 
-	mutex_unlock(&priv->lock);
-	
-	return ret;
+	priv->frame_start = ktime_get();
+	WRITE_ONCE(priv->running, true);
+	hrtimer_start(&priv->timer, priv->frame_start, HRTIMER_MODE_ABS);
+	mutex_unlock(&priv->seq_lock);
+
+	return 0;
+}
+
+/**
+ * kirkland_rgb_ioctl() - ioctl method for the kirkland_rgb char device
+ * @file: Pointer to the char device file struct.
+ * @cmd: The ioctl command; see kirkland-rgb.h.
+ * @arg: The command's user-space argument.
+ *
+ * Return: 0 on success, or a negative error value.
+ */
+static long kirkland_rgb_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+	struct kirkland_rgb_dev *priv = container_of(file->private_data, struct kirkland_rgb_dev, miscdev);
+
+	switch (cmd) {
+	case KIRKLAND_RGB_IOC_SEQ_START:
+		return kirkland_rgb_seq_start(priv, (const struct kirkland_rgb_sequence __user *)arg);
+	case KIRKLAND_RGB_IOC_SEQ_STOP:
+		mutex_lock(&priv->seq_lock);
+		kirkland_rgb_seq_stop(priv);
+		mutex_unlock(&priv->seq_lock);
+		return 0;
+	case KIRKLAND_IOC_REGIO:
+		return kirkland_rgb_regio(priv, arg);
+	default:
+		return -ENOTTY;
+	}
 }
 
 /**
@@ -325,7 +894,7 @@ static ssize_t period_reg_show(struct device *dev, struct device_attribute *attr
 	u32 period_reg;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
-	period_reg = ioread32(priv->period_reg);
+	period_reg = kirkland_reg_read(&priv->regs, PERIOD_REG_OFFSET);
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", period_reg);
 }
@@ -344,6 +913,7 @@ static ssize_t period_reg_show(struct device *dev, struct device_attribute *attr
 static ssize_t period_reg_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
 	u32 period_reg;
 	int ret;
+	unsigned long flags;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
 	// Parse the string we received as a u8
@@ -353,7 +923,9 @@ static ssize_t period_reg_store(struct device *dev, struct device_attribute *att
 		return ret;
 	}
 
-	iowrite32(period_reg, priv->period_reg);
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, PERIOD_REG_OFFSET, period_reg);
+	spin_unlock_irqrestore(&priv->lock, flags);
 
 	// Write was successful, so we return the number of bytes we wrote.
 	return size;
@@ -370,12 +942,12 @@ static ssize_t period_reg_store(struct device *dev, struct device_attribute *att
  * Return: The number of bytes read.
  */
 static ssize_t red_duty_cycle_show(struct device *dev, struct device_attribute *attr, char *buf) {
-	bool red_duty_cycle;
+	u32 red_duty_cycle;
 
 	// Get the private kirkland_rgb data out of the dev struct
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
-	red_duty_cycle = ioread32(priv->red_duty_cycle);
+	red_duty_cycle = kirkland_reg_read(&priv->regs, RED_DUTY_CYCLE_OFFSET) & ~DUTY_CYCLE_HIRES;
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", red_duty_cycle);
 }
@@ -394,6 +966,7 @@ static ssize_t red_duty_cycle_show(struct device *dev, struct device_attribute *
 static ssize_t red_duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
 	u32 red_duty_cycle;
 	int ret;
+	unsigned long flags;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
 	// Parse the string we received as a bool
@@ -404,7 +977,9 @@ static ssize_t red_duty_cycle_store(struct device *dev, struct device_attribute
 		return ret;
 	}
 
-	iowrite32(red_duty_cycle, priv->red_duty_cycle);
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, RED_DUTY_CYCLE_OFFSET, kirkland_rgb_duty(priv, red_duty_cycle));
+	spin_unlock_irqrestore(&priv->lock, flags);
 
 	// Write was successful, so we return the number of bytes we wrote.
 	return size;
@@ -424,7 +999,7 @@ static ssize_t grn_duty_cycle_show(struct device *dev, struct device_attribute *
 	u32 grn_duty_cycle;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
-	grn_duty_cycle = ioread32(priv->grn_duty_cycle);
+	grn_duty_cycle = kirkland_reg_read(&priv->regs, GRN_DUTY_CYCLE_OFFSET) & ~DUTY_CYCLE_HIRES;
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", grn_duty_cycle);
 }
@@ -443,6 +1018,7 @@ static ssize_t grn_duty_cycle_show(struct device *dev, struct device_attribute *
 static ssize_t grn_duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
 	u32 grn_duty_cycle;
 	int ret;
+	unsigned long flags;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
 	// Parse the string we received as a u8
@@ -453,7 +1029,9 @@ static ssize_t grn_duty_cycle_store(struct device *dev, struct device_attribute
 		return ret;
 	}
 
-	iowrite32(grn_duty_cycle, priv->grn_duty_cycle);
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, GRN_DUTY_CYCLE_OFFSET, kirkland_rgb_duty(priv, grn_duty_cycle));
+	spin_unlock_irqrestore(&priv->lock, flags);
 
 	// Write was successful, so we return the number of bytes we wrote.
 	return size;
@@ -473,7 +1051,7 @@ static ssize_t blu_duty_cycle_show(struct device *dev, struct device_attribute *
 	u32 blu_duty_cycle;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
-	blu_duty_cycle = ioread32(priv->blu_duty_cycle);
+	blu_duty_cycle = kirkland_reg_read(&priv->regs, BLU_DUTY_CYCLE_OFFSET) & ~DUTY_CYCLE_HIRES;
 
 	return scnprintf(buf, PAGE_SIZE, "%u\n", blu_duty_cycle);
 }
@@ -492,6 +1070,7 @@ static ssize_t blu_duty_cycle_show(struct device *dev, struct device_attribute *
 static ssize_t blu_duty_cycle_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
 	u32 blu_duty_cycle;
 	int ret;
+	unsigned long flags;
 	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
 	// Parse the string we received as a u8
@@ -502,20 +1081,389 @@ static ssize_t blu_duty_cycle_store(struct device *dev, struct device_attribute
 		return ret;
 	}
 
-	iowrite32(blu_duty_cycle, priv->blu_duty_cycle);
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, BLU_DUTY_CYCLE_OFFSET, kirkland_rgb_duty(priv, blu_duty_cycle));
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	// Write was successful, so we return the number of bytes we wrote.
+	return size;
+}
+
+
+
+
+
+
+
+
+
+
+/**
+ * color_show() - Return all three duty cycles to user-space via sysfs.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t color_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	u32 color[3];
+	unsigned long flags;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	// Under the lock, so the three values are from the same colour
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_read_color(priv, color);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return scnprintf(buf, PAGE_SIZE, "%u %u %u\n", color[0], color[1], color[2]);
+}
+
+/**
+ * color_store() - Set all three duty cycles and commit them once.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains "red grn blu" duty cycles.
+ * @size: The number of bytes being written.
+ *
+ * The new colour takes effect at the next PWM period boundary with no
+ * intermediate colours, and costs one syscall instead of three.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t color_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	int red, grn, blu;
+	u32 color[3];
+	unsigned long flags;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	// Parse three duty cycles; like the other attributes, hex is accepted
+	if (sscanf(buf, "%i %i %i", &red, &grn, &blu) != 3) {
+		return -EINVAL;
+	}
+	if (red < 0 || grn < 0 || blu < 0) {
+		return -EINVAL;
+	}
+	color[0] = red;
+	color[1] = grn;
+	color[2] = blu;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_update(priv, color, NULL);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	// Write was successful, so we return the number of bytes we wrote.
+	return size;
+}
+
+/**
+ * red_ramp_step_show() - Return the red ramp step to user-space via sysfs.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t red_ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	u32 red_ramp_step;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	red_ramp_step = kirkland_reg_read(&priv->regs, RED_RAMP_STEP_OFFSET);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", red_ramp_step);
+}
+
+/**
+ * red_ramp_step_store() - Store the red ramp step.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the red_ramp_step value being written.
+ * @size: The number of bytes being written.
+ *
+ * Later red_duty_cycle writes ramp by this much per PWM period; 0 makes them
+ * take effect immediately.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t red_ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	u32 red_ramp_step;
+	int ret;
+	unsigned long flags;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtou32(buf, 0, &red_ramp_step);
+	if (ret < 0) {
+		return ret;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, RED_RAMP_STEP_OFFSET, red_ramp_step);
+	spin_unlock_irqrestore(&priv->lock, flags);
 
 	// Write was successful, so we return the number of bytes we wrote.
 	return size;
 }
 
+/**
+ * grn_ramp_step_show() - Return the green ramp step to user-space via sysfs.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t grn_ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	u32 grn_ramp_step;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	grn_ramp_step = kirkland_reg_read(&priv->regs, GRN_RAMP_STEP_OFFSET);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", grn_ramp_step);
+}
+
+/**
+ * grn_ramp_step_store() - Store the green ramp step.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the grn_ramp_step value being written.
+ * @size: The number of bytes being written.
+ *
+ * Later grn_duty_cycle writes ramp by this much per PWM period; 0 makes them
+ * take effect immediately.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t grn_ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	u32 grn_ramp_step;
+	int ret;
+	unsigned long flags;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtou32(buf, 0, &grn_ramp_step);
+	if (ret < 0) {
+		return ret;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, GRN_RAMP_STEP_OFFSET, grn_ramp_step);
+	spin_unlock_irqrestore(&priv->lock, flags);
 
+	// Write was successful, so we return the number of bytes we wrote.
+	return size;
+}
 
+/**
+ * blu_ramp_step_show() - Return the blue ramp step to user-space via sysfs.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t blu_ramp_step_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	u32 blu_ramp_step;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
+	blu_ramp_step = kirkland_reg_read(&priv->regs, BLU_RAMP_STEP_OFFSET);
 
+	return scnprintf(buf, PAGE_SIZE, "%u\n", blu_ramp_step);
+}
 
+/**
+ * blu_ramp_step_store() - Store the blue ramp step.
+ * @dev: Device structure for the kirkland_rgb component. This
+ * device struct is embedded in the kirkland_rgb' platform
+ * device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the blu_ramp_step value being written.
+ * @size: The number of bytes being written.
+ *
+ * Later blu_duty_cycle writes ramp by this much per PWM period; 0 makes them
+ * take effect immediately.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t blu_ramp_step_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	u32 blu_ramp_step;
+	int ret;
+	unsigned long flags;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
 
+	ret = kstrtou32(buf, 0, &blu_ramp_step);
+	if (ret < 0) {
+		return ret;
+	}
 
+	spin_lock_irqsave(&priv->lock, flags);
+	kirkland_rgb_write_reg(priv, BLU_RAMP_STEP_OFFSET, blu_ramp_step);
+	spin_unlock_irqrestore(&priv->lock, flags);
 
+	// Write was successful, so we return the number of bytes we wrote.
+	return size;
+}
+
+/**
+ * hw_fade_show() - Report whether sequences fade in hardware.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t hw_fade_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->hw_fade));
+}
+
+/**
+ * hw_fade_store() - Choose how sequences fade.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that contains a boolean.
+ * @size: The number of bytes being written.
+ *
+ * With hw_fade set (the default), each fade keyframe is one register update
+ * and the controller's ramp engine does the rest. Clearing it makes the
+ * sequencer interpolate in software at frame_rate_hz instead.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t hw_fade_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	bool hw_fade;
+	int ret;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtobool(buf, &hw_fade);
+	if (ret < 0) {
+		return ret;
+	}
+
+	WRITE_ONCE(priv->hw_fade, hw_fade);
+
+	return size;
+}
+
+/**
+ * sequence_running_show() - Report whether a keyframe sequence is playing.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t sequence_running_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->running));
+}
+
+/**
+ * frame_rate_hz_show() - Return the sequencer's fade update rate.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t frame_rate_hz_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->frame_rate_hz));
+}
+
+/**
+ * frame_rate_hz_store() - Set how often the LED is updated while fading.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that contains the rate in Hz, 1 to FRAME_RATE_MAX.
+ * @size: The number of bytes being written.
+ *
+ * Takes effect from the next fade step, including in a running sequence.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t frame_rate_hz_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	u32 frame_rate_hz;
+	int ret;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtou32(buf, 0, &frame_rate_hz);
+	if (ret < 0) {
+		return ret;
+	}
+	if (frame_rate_hz == 0 || frame_rate_hz > FRAME_RATE_MAX) {
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(priv->frame_rate_hz, frame_rate_hz);
+
+	return size;
+}
+
+/**
+ * hires_show() - Report whether the duty cycles are dithered.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t hires_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->hires));
+}
+
+/**
+ * hires_store() - Turn duty cycle dithering on or off.
+ * @dev: Device structure for the kirkland_rgb component.
+ * @attr: Unused.
+ * @buf: Buffer that contains a boolean.
+ * @size: The number of bytes being written.
+ *
+ * With hires set, the controller dithers each channel's high time from one
+ * PWM period to the next, so the average duty cycle keeps all its fraction
+ * bits even when a period is only a few hundred clocks. The current colour
+ * is rewritten with the new setting and committed, and every duty cycle the
+ * driver writes after that gets it too.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t hires_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	bool hires;
+	u32 color[3];
+	int ret;
+	unsigned long flags;
+	struct kirkland_rgb_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtobool(buf, &hires);
+	if (ret < 0) {
+		return ret;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	WRITE_ONCE(priv->hires, hires);
+	kirkland_rgb_read_color(priv, color);
+	kirkland_rgb_update(priv, color, NULL);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return size;
+}
 
 /**
  * Define the compatible property used for matching devices to this driver,
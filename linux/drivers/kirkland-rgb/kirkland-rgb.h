@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * User-space interface for the kirkland_rgb driver. This header is shared by
+ * the driver and by user-space programs that open /dev/kirkland_rgb. The
+ * __KERNEL__ section is the interface for other drivers.
+ */
+#ifndef KIRKLAND_RGB_H
+#define KIRKLAND_RGB_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+// Longest keyframe table the driver accepts
+#define KIRKLAND_RGB_MAX_KEYFRAMES 256
+
+// Longest single keyframe, in milliseconds
+#define KIRKLAND_RGB_MAX_DURATION_MS 600000
+
+// Fade linearly from the previous keyframe's colour instead of jumping
+#define KIRKLAND_RGB_KF_FADE 0x1
+
+/**
+ * struct kirkland_rgb_keyframe - One step of a colour sequence.
+ * @red: Red duty cycle, in the same format as the red_duty_cycle register.
+ * @grn: Green duty cycle.
+ * @blu: Blue duty cycle.
+ * @duration_ms: How long the step lasts; 1 to KIRKLAND_RGB_MAX_DURATION_MS.
+ * @flags: KIRKLAND_RGB_KF_* flags.
+ *
+ * Without KIRKLAND_RGB_KF_FADE the LED jumps to the step's colour and holds
+ * it for @duration_ms. With it, the LED fades from the previous step's colour
+ * (or, for the first step, from whatever was showing when the sequence
+ * started) and reaches the step's colour at the end of @duration_ms.
+ */
+struct kirkland_rgb_keyframe {
+	__u32 red;
+	__u32 grn;
+	__u32 blu;
+	__u32 duration_ms;
+	__u32 flags;
+};
+
+/**
+ * struct kirkland_rgb_sequence - Argument of KIRKLAND_RGB_IOC_SEQ_START.
+ * @nr_frames: Number of keyframes at @frames; 1 to KIRKLAND_RGB_MAX_KEYFRAMES.
+ * @loop_count: How many times to play the table; 0 repeats it until stopped.
+ * @frames: User-space pointer to the keyframe array.
+ */
+struct kirkland_rgb_sequence {
+	__u32 nr_frames;
+	__u32 loop_count;
+	__u64 frames;
+};
+
+#define KIRKLAND_RGB_IOC_MAGIC 'k'
+
+/*
+ * KIRKLAND_RGB_IOC_SEQ_START - Copy in a keyframe table and start playing it.
+ *
+ * Any sequence that is already playing is replaced. When a finite sequence
+ * ends, the LED keeps the last keyframe's colour.
+ */
+#define KIRKLAND_RGB_IOC_SEQ_START \
+	_IOW(KIRKLAND_RGB_IOC_MAGIC, 1, struct kirkland_rgb_sequence)
+
+/*
+ * KIRKLAND_RGB_IOC_SEQ_STOP - Stop the running sequence, if any.
+ *
+ * The LED keeps whatever colour it was showing.
+ */
+#define KIRKLAND_RGB_IOC_SEQ_STOP _IO(KIRKLAND_RGB_IOC_MAGIC, 2)
+
+#ifdef __KERNEL__
+struct device;
+
+int kirkland_rgb_set_alert(struct device *dev, bool on, __u32 red, __u32 grn, __u32 blu);
+#endif
+
+#endif /* KIRKLAND_RGB_H */
@@ -0,0 +1,477 @@
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/mod_devicetable.h>
+#include <linux/of.h> // of_parse_phandle, of_property_read_u32
+#include <linux/of_platform.h> // of_find_device_by_node
+#include <linux/device.h> // device_link_add
+#include <linux/notifier.h> // notifier_block
+#include <linux/spinlock.h> // spinlock definitions
+#include <linux/workqueue.h> // work_struct
+#include <linux/sysfs.h> // sysfs_notify
+#include <linux/types.h> // data types like u32, u16, etc.
+#include <linux/kstrtox.h> // kstrtou8, etc
+
+#include "../../adc/de10nano_adc.h"
+#include "../kirkland-rgb/kirkland-rgb.h"
+#include "../kirkland-buzzer/kirkland-buzzer.h"
+
+
+// Largest 12-bit ADC value
+#define ADC_MAX 4095
+
+// TDS reading above which the water is unsafe
+#define THRESHOLD_DEFAULT 500
+#define HYSTERESIS_DEFAULT 25
+
+// Full-brightness red; duty cycles are 22.21 fixed point
+#define ALARM_RED_DEFAULT 0x200000
+
+// About 1 kHz (4/4096 s, 1024 Hz); the buzzer period is 13.12 fixed point
+// seconds, so 0x1000 would be a 1 Hz click
+#define BUZZER_PERIOD_DEFAULT 4
+
+static struct platform_driver water_alarm_driver;
+static const struct of_device_id water_alarm_of_match[];
+static int water_alarm_probe(struct platform_device *pdev);
+static int water_alarm_remove(struct platform_device *pdev);
+static int water_alarm_scan(struct notifier_block *nb, unsigned long action, void *data);
+
+static ssize_t threshold_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t hysteresis_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t hysteresis_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size);
+static ssize_t value_show(struct device *dev, struct device_attribute *attr, char *buf);
+static ssize_t alarm_show(struct device *dev, struct device_attribute *attr, char *buf);
+static struct attribute *water_alarm_attrs[];
+
+// Define sysfs attributes
+static DEVICE_ATTR_RW(threshold);
+static DEVICE_ATTR_RW(hysteresis);
+static DEVICE_ATTR_RO(value);
+static DEVICE_ATTR_RO(alarm);
+
+// Create an attribute group so the device core can
+// export the attributes for us.
+static struct attribute *water_alarm_attrs[] = {
+	&dev_attr_threshold.attr,
+	&dev_attr_hysteresis.attr,
+	&dev_attr_value.attr,
+	&dev_attr_alarm.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(water_alarm);
+
+/**
+ * struct water_alarm_dev - Private water alarm device struct.
+ * @dev: The water alarm's device
+ * @adc: The ADC the sensor is connected to
+ * @rgb: The RGB LED controller to light up, or NULL
+ * @buzzer: The buzzer to sound, or NULL
+ * @nb: Notifier block the ADC calls with every scan
+ * @channel: ADC channel the sensor is on
+ * @threshold: Reading above which the alarm goes off
+ * @hysteresis: How far below @threshold the reading has to drop before the
+ *	alarm clears again
+ * @alarm_color: LED colour while the alarm is on, as {red, grn, blu}
+ * @buzzer_period: Buzzer period register value while the alarm is on
+ * @lock: spinlock for the alarm state; a spinlock because the ADC calls us
+ *	from interrupt context
+ * @value: Latest reading
+ * @alarm: True while the alarm is on
+ * @notify_work: Wakes sysfs pollers of the alarm attribute
+ *
+ * A water_alarm_dev struct gets created for each water alarm device tree
+ * node.
+ */
+struct water_alarm_dev {
+	struct device *dev;
+	struct device *adc;
+	struct device *rgb;
+	struct device *buzzer;
+	struct notifier_block nb;
+	u32 channel;
+	u32 threshold;
+	u32 hysteresis;
+	u32 alarm_color[3];
+	u32 buzzer_period;
+	spinlock_t lock;
+	u16 value;
+	bool alarm;
+	struct work_struct notify_work;
+};
+
+/**
+ * struct water_alarm_driver - Platform driver struct for the water_alarm driver
+ * @probe: Function that's called when a device is found
+ * @remove: Function that's called when a device is removed
+ * @driver.owner: Which module owns this driver
+ * @driver.name: Name of the water_alarm driver
+ * @driver.of_match_table: Device tree match table
+ * @driver.dev_groups: sysfs attribute group
+ */
+static struct platform_driver water_alarm_driver = {
+	.probe = water_alarm_probe,
+	.remove = water_alarm_remove,
+	.driver = {
+		.owner = THIS_MODULE,
+		.name = "water_alarm",
+		.of_match_table = water_alarm_of_match,
+		.dev_groups = water_alarm_groups,
+	},
+};
+
+/**
+ * water_alarm_put_device() - Drop the reference of_find_device_by_node() took.
+ * @data: The device.
+ */
+static void water_alarm_put_device(void *data) {
+	put_device(data);
+}
+
+/**
+ * water_alarm_get_dev() - Look up one of the devices we drive.
+ * @priv: The water alarm device.
+ * @name: Name of the phandle property pointing at the device.
+ * @optional: Whether a missing property is fine.
+ * @out: Where to put the device, or NULL if it's optional and missing.
+ *
+ * The device link makes the driver core unbind us before the device we
+ * point at goes away, so the pointer stays good for as long as we're bound.
+ *
+ * Return: 0 on success, -EPROBE_DEFER if the device's driver hasn't bound
+ * yet, or another negative error value.
+ */
+static int water_alarm_get_dev(struct water_alarm_dev *priv, const char *name, bool optional, struct device **out) {
+	struct device_node *np;
+	struct platform_device *pdev;
+	int ret;
+
+	*out = NULL;
+	np = of_parse_phandle(priv->dev->of_node, name, 0);
+	if (!np) {
+		if (optional) {
+			return 0;
+		}
+		dev_err(priv->dev, "Missing %s phandle\n", name);
+		return -ENODEV;
+	}
+
+	pdev = of_find_device_by_node(np);
+	of_node_put(np);
+	if (!pdev) {
+		return -EPROBE_DEFER;
+	}
+	ret = devm_add_action_or_reset(priv->dev, water_alarm_put_device, &pdev->dev);
+	if (ret) {
+		return ret;
+	}
+
+	if (!platform_get_drvdata(pdev)) {
+		return -EPROBE_DEFER;
+	}
+	if (!device_link_add(priv->dev, &pdev->dev, DL_FLAG_AUTOREMOVE_CONSUMER)) {
+		return -EINVAL;
+	}
+
+	*out = &pdev->dev;
+	return 0;
+}
+
+/**
+ * water_alarm_notify_work() - Wake sysfs pollers of the alarm attribute.
+ * @work: The water alarm's notify work item.
+ */
+static void water_alarm_notify_work(struct work_struct *work) {
+	struct water_alarm_dev *priv = container_of(work, struct water_alarm_dev, notify_work);
+
+	sysfs_notify(&priv->dev->kobj, NULL, "alarm");
+}
+
+/**
+ * water_alarm_set() - Turn the LED and buzzer alerts on or off.
+ * @priv: The water alarm device; the caller holds @priv->lock.
+ * @on: Whether the alarm is on.
+ */
+static void water_alarm_set(struct water_alarm_dev *priv, bool on) {
+	if (priv->rgb) {
+		kirkland_rgb_set_alert(priv->rgb, on, priv->alarm_color[0],
+			priv->alarm_color[1], priv->alarm_color[2]);
+	}
+	if (priv->buzzer) {
+		kirkland_buzzer_set_alert(priv->buzzer, on ? priv->buzzer_period : 0);
+	}
+	priv->alarm = on;
+	schedule_work(&priv->notify_work);
+}
+
+/**
+ * water_alarm_scan() - Check a new ADC scan against the threshold.
+ * @nb: The water alarm's notifier block.
+ * @action: ADC_NOTIFY_SCAN.
+ * @data: The scan, a const struct adc_scan *.
+ *
+ * Called by the ADC driver in interrupt context as soon as each scan is
+ * taken, so the LED and buzzer react within one scan of the reading
+ * crossing the threshold. The alarm goes off when the reading rises above
+ * the threshold and only clears once it drops below threshold - hysteresis,
+ * so a reading sitting right at the threshold doesn't make it chatter.
+ *
+ * Return: NOTIFY_OK, or NOTIFY_DONE if the scan doesn't have our channel.
+ */
+static int water_alarm_scan(struct notifier_block *nb, unsigned long action, void *data) {
+	struct water_alarm_dev *priv = container_of(nb, struct water_alarm_dev, nb);
+	const struct adc_scan *scan = data;
+	unsigned long flags;
+	u16 value;
+
+	if (action != ADC_NOTIFY_SCAN || !(scan->channel_mask & BIT(priv->channel))) {
+		return NOTIFY_DONE;
+	}
+	value = scan->ch[priv->channel];
+
+	spin_lock_irqsave(&priv->lock, flags);
+	priv->value = value;
+	if (!priv->alarm && value > priv->threshold) {
+		water_alarm_set(priv, true);
+	} else if (priv->alarm && value < priv->threshold - priv->hysteresis) {
+		water_alarm_set(priv, false);
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return NOTIFY_OK;
+}
+
+/**
+ * water_alarm_probe() - Initialize device when a match is found
+ * @pdev: Platform device structure associated with our water alarm device;
+ * 	pdev is automatically created by the driver core based upon our
+ * 	water alarm device tree node.
+ *
+ * Looks up the ADC, LED and buzzer the node points at and starts listening
+ * to the sensor's ADC channel. Probing is deferred until their drivers
+ * have bound.
+ */
+static int water_alarm_probe(struct platform_device *pdev) {
+	struct water_alarm_dev *priv;
+	struct device_node *np = pdev->dev.of_node;
+	int ret;
+
+	priv = devm_kzalloc(&pdev->dev, sizeof(struct water_alarm_dev), GFP_KERNEL);
+	if (!priv) {
+		pr_err("Failed to allocate memory\n");
+		return -ENOMEM;
+	}
+	priv->dev = &pdev->dev;
+	spin_lock_init(&priv->lock);
+	INIT_WORK(&priv->notify_work, water_alarm_notify_work);
+
+	// Read the settings, falling back to the defaults for missing ones
+	priv->threshold = THRESHOLD_DEFAULT;
+	priv->hysteresis = HYSTERESIS_DEFAULT;
+	priv->alarm_color[0] = ALARM_RED_DEFAULT;
+	priv->buzzer_period = BUZZER_PERIOD_DEFAULT;
+	of_property_read_u32(np, "adc-channel", &priv->channel);
+	of_property_read_u32(np, "threshold", &priv->threshold);
+	of_property_read_u32(np, "hysteresis", &priv->hysteresis);
+	of_property_read_u32_array(np, "alarm-color", priv->alarm_color, 3);
+	of_property_read_u32(np, "buzzer-period", &priv->buzzer_period);
+
+	if (priv->channel >= ADC_NUM_CHANNELS || priv->threshold > ADC_MAX ||
+	    priv->hysteresis > priv->threshold) {
+		dev_err(&pdev->dev, "Invalid adc-channel, threshold or hysteresis\n");
+		return -EINVAL;
+	}
+
+	ret = water_alarm_get_dev(priv, "adc", false, &priv->adc);
+	if (ret) {
+		return ret;
+	}
+	ret = water_alarm_get_dev(priv, "rgb", true, &priv->rgb);
+	if (ret) {
+		return ret;
+	}
+	ret = water_alarm_get_dev(priv, "buzzer", true, &priv->buzzer);
+	if (ret) {
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, priv);
+
+	// From here on the ADC calls water_alarm_scan() with every scan
+	priv->nb.notifier_call = water_alarm_scan;
+	ret = de10nano_adc_register_notifier(priv->adc, &priv->nb, BIT(priv->channel));
+	if (ret) {
+		pr_err("Failed to listen to the ADC\n");
+		return ret;
+	}
+
+	pr_info("water_alarm_probe successful\n");
+
+	return 0;
+}
+
+/**
+ * water_alarm_remove() - Remove a water alarm device.
+ * @pdev: Platform device structure associated with our water alarm device.
+ *
+ * Stops listening to the ADC and gives the LED and buzzer back.
+ */
+static int water_alarm_remove(struct platform_device *pdev) {
+	struct water_alarm_dev *priv = platform_get_drvdata(pdev);
+	unsigned long flags;
+
+	de10nano_adc_unregister_notifier(priv->adc, &priv->nb, BIT(priv->channel));
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (priv->alarm) {
+		water_alarm_set(priv, false);
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+	cancel_work_sync(&priv->notify_work);
+
+	pr_info("water_alarm_remove successful\n");
+
+	return 0;
+}
+
+/**
+ * threshold_show() - Return the alarm threshold to user-space via sysfs.
+ * @dev: Device structure for the water alarm.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t threshold_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct water_alarm_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->threshold));
+}
+
+/**
+ * threshold_store() - Set the alarm threshold.
+ * @dev: Device structure for the water alarm.
+ * @attr: Unused.
+ * @buf: Buffer that contains the raw 12-bit threshold.
+ * @size: The number of bytes being written.
+ *
+ * The new threshold applies from the next scan.
+ *
+ * Return: The number of bytes stored, or -EINVAL if the threshold is above
+ * 4095 or below the hysteresis.
+ */
+static ssize_t threshold_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	u32 threshold;
+	int ret;
+	unsigned long flags;
+	struct water_alarm_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtou32(buf, 0, &threshold);
+	if (ret < 0) {
+		return ret;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (threshold > ADC_MAX || threshold < priv->hysteresis) {
+		ret = -EINVAL;
+	} else {
+		priv->threshold = threshold;
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return ret ? ret : size;
+}
+
+/**
+ * hysteresis_show() - Return the alarm hysteresis to user-space via sysfs.
+ * @dev: Device structure for the water alarm.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t hysteresis_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct water_alarm_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->hysteresis));
+}
+
+/**
+ * hysteresis_store() - Set the alarm hysteresis.
+ * @dev: Device structure for the water alarm.
+ * @attr: Unused.
+ * @buf: Buffer that contains the hysteresis, in raw ADC counts.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored, or -EINVAL if the hysteresis is larger
+ * than the threshold.
+ */
+static ssize_t hysteresis_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t size) {
+	u32 hysteresis;
+	int ret;
+	unsigned long flags;
+	struct water_alarm_dev *priv = dev_get_drvdata(dev);
+
+	ret = kstrtou32(buf, 0, &hysteresis);
+	if (ret < 0) {
+		return ret;
+	}
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (hysteresis > priv->threshold) {
+		ret = -EINVAL;
+	} else {
+		priv->hysteresis = hysteresis;
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return ret ? ret : size;
+}
+
+/**
+ * value_show() - Return the latest sensor reading to user-space via sysfs.
+ * @dev: Device structure for the water alarm.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t value_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct water_alarm_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->value));
+}
+
+/**
+ * alarm_show() - Return whether the alarm is on to user-space via sysfs.
+ * @dev: Device structure for the water alarm.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * This attribute supports sysfs poll(), so a program can sleep until the
+ * alarm goes on or off.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t alarm_show(struct device *dev, struct device_attribute *attr, char *buf) {
+	struct water_alarm_dev *priv = dev_get_drvdata(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n", READ_ONCE(priv->alarm));
+}
+
+/**
+ * Define the compatible property used for matching devices to this driver,
+ * then add our device id structure to the kernel's device table. For a device
+ * to be matched with this driver, its device tree node must use the same
+ * compatible string as defined here.
+ */
+static const struct of_device_id water_alarm_of_match[] = {
+	{ .compatible = "Kirkland,water_alarm", },
+	{ }
+};
+
+module_platform_driver(water_alarm_driver);
+MODULE_DEVICE_TABLE(of, water_alarm_of_match);
+MODULE_LICENSE("Dual MIT/GPL");
+MODULE_AUTHOR("Grant Kirkland");
+MODULE_DESCRIPTION("water_alarm driver");
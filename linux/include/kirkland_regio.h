@@ -0,0 +1,541 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * Batched register access shared by the kirkland_rgb, kirkland_buzzer,
+ * kirkland_pwm_bank and pwm drivers. User space gets KIRKLAND_IOC_REGIO on
+ * each driver's device node. The __KERNEL__ section holds the helpers the
+ * drivers build their register access on, including the shadow register
+ * cache, and the device node naming these drivers and the adc driver share.
+ */
+#ifndef KIRKLAND_REGIO_H
+#define KIRKLAND_REGIO_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+// Most writes, and most reads, one KIRKLAND_IOC_REGIO call accepts
+#define KIRKLAND_REGIO_MAX 64
+
+/**
+ * struct kirkland_reg_write - One register write.
+ * @offset: Byte offset of the register.
+ * @value: Value to write.
+ */
+struct kirkland_reg_write {
+	__u32 offset;
+	__u32 value;
+};
+
+/**
+ * struct kirkland_regio - Argument of KIRKLAND_IOC_REGIO.
+ * @nr_writes: Number of writes at @writes; 0 to KIRKLAND_REGIO_MAX.
+ * @nr_reads: Number of registers to read back; 0 to KIRKLAND_REGIO_MAX.
+ * @writes: User-space pointer to an array of struct kirkland_reg_write.
+ * @read_offsets: User-space pointer to @nr_reads __u32 byte offsets.
+ * @read_values: User-space pointer to @nr_reads __u32s that get the values.
+ */
+struct kirkland_regio {
+	__u32 nr_writes;
+	__u32 nr_reads;
+	__u64 writes;
+	__u64 read_offsets;
+	__u64 read_values;
+};
+
+// 'K' keeps clear of the drivers' own ioctl magic numbers
+#define KIRKLAND_REGIO_IOC_MAGIC 'K'
+
+/*
+ * KIRKLAND_IOC_REGIO - Apply a batch of register writes, then read back.
+ *
+ * The writes are applied in order, then the reads are done, all under one
+ * acquisition of the driver's lock, so nothing else touches the registers
+ * in between. Drivers whose component needs it, like kirkland_rgb, commit
+ * after the writes just as write() does. Offsets must be 4-byte aligned and
+ * inside the component, or the whole batch fails with -EINVAL before any
+ * register is touched.
+ */
+#define KIRKLAND_IOC_REGIO \
+	_IOW(KIRKLAND_REGIO_IOC_MAGIC, 0x40, struct kirkland_regio)
+
+#ifdef __KERNEL__
+#include <linux/device.h>
+#include <linux/idr.h>
+#include <linux/io.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/kernel.h>
+#include <linux/bits.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+#include <linux/compiler.h>
+
+/**
+ * struct kirkland_regs - A driver's register window.
+ * @name: Name for warnings.
+ * @base: The component's ioremapped base address.
+ * @span: Bytes of registers read(), write() and KIRKLAND_IOC_REGIO may reach.
+ * @nr_shadow: Registers @cached and @shadow cover, from offset 0; 0 until
+ *             devm_kirkland_regs_cache() sizes them, which leaves the window
+ *             uncached.
+ * @cached: Bitmap of the registers kept in @shadow; bit n is the register at
+ *          offset 4n.
+ * @shadow: Last value written to each @cached register.
+ *
+ * A @cached register must be plain storage that only the CPU changes, so
+ * what was last written is what the hardware holds. Reads of it are then
+ * served from @shadow without crossing the bridge, and writes of the value
+ * it already holds are skipped. Registers with side effects, like a commit
+ * or FIFO push register, or that the hardware changes, like a status
+ * register, must be left out of @cached.
+ *
+ * The driver's lock protects @shadow, except that kirkland_reg_read() can
+ * also be used without it to get a recent value, e.g. for sysfs.
+ */
+struct kirkland_regs {
+	const char *name;
+	void __iomem *base;
+	u32 span;
+	u32 nr_shadow;
+	unsigned long *cached;
+	u32 *shadow;
+};
+
+/**
+ * struct kirkland_regio_batch - A KIRKLAND_IOC_REGIO call copied in.
+ * @req: The argument.
+ * @writes: Kernel copy of the writes.
+ * @read_offsets: Kernel copy of the read offsets.
+ * @read_values: Values read back, copied out by kirkland_regio_put().
+ */
+struct kirkland_regio_batch {
+	struct kirkland_regio req;
+	struct kirkland_reg_write *writes;
+	u32 *read_offsets;
+	u32 *read_values;
+};
+
+/**
+ * devm_kirkland_regs_cache() - Allocate a window's shadow cache.
+ * @dev: Device the cache belongs to.
+ * @regs: The register window.
+ * @nr: Number of registers to cover, from offset 0.
+ *
+ * The cache starts out empty; kirkland_regs_cache() picks the registers it
+ * holds. Size @nr to the last register that will be cached, so a component
+ * that only fills part of its window, like a pwm bank with few channels,
+ * doesn't pay for the rest.
+ *
+ * Return: 0, or -ENOMEM.
+ */
+static inline int devm_kirkland_regs_cache(struct device *dev,
+	struct kirkland_regs *regs, u32 nr)
+{
+	regs->cached = devm_kcalloc(dev, BITS_TO_LONGS(nr), sizeof(long),
+		GFP_KERNEL);
+	regs->shadow = devm_kcalloc(dev, nr, sizeof(u32), GFP_KERNEL);
+	if (!regs->cached || !regs->shadow) {
+		return -ENOMEM;
+	}
+	regs->nr_shadow = nr;
+
+	return 0;
+}
+
+/**
+ * kirkland_regs_cache() - Keep consecutive registers in the shadow cache.
+ * @regs: The register window, sized by devm_kirkland_regs_cache().
+ * @offset: Byte offset of the first register.
+ * @n: Number of registers; they must all be inside @regs->nr_shadow.
+ */
+static inline void kirkland_regs_cache(struct kirkland_regs *regs,
+	u32 offset, u32 n)
+{
+	bitmap_set(regs->cached, offset / sizeof(u32), n);
+}
+
+/**
+ * kirkland_reg_cached() - Check whether a register is in the shadow cache.
+ * @regs: The register window.
+ * @i: Register number, i.e. byte offset / 4.
+ *
+ * Return: True if reads and writes of the register go through @regs->shadow.
+ */
+static inline bool kirkland_reg_cached(const struct kirkland_regs *regs, u32 i)
+{
+	return i < regs->nr_shadow && test_bit(i, regs->cached);
+}
+
+/**
+ * kirkland_regs_sync() - Load the shadow cache from the hardware.
+ * @regs: The register window, with its cached registers picked.
+ *
+ * Called once at probe, before anything else touches the registers, so the
+ * cache starts out matching what the component came out of reset with.
+ */
+static inline void kirkland_regs_sync(struct kirkland_regs *regs)
+{
+	u32 i;
+
+	for (i = 0; i < regs->nr_shadow; i++) {
+		if (kirkland_reg_cached(regs, i)) {
+			regs->shadow[i] = ioread32(regs->base + i * sizeof(u32));
+		}
+	}
+}
+
+/**
+ * kirkland_reg_read() - Read one register, from the cache if possible.
+ * @regs: The register window.
+ * @offset: Byte offset of the register.
+ *
+ * Return: The register's value.
+ */
+static inline u32 kirkland_reg_read(const struct kirkland_regs *regs,
+	u32 offset)
+{
+	u32 i = offset / sizeof(u32);
+
+	if (kirkland_reg_cached(regs, i)) {
+		return READ_ONCE(regs->shadow[i]);
+	}
+
+	return ioread32(regs->base + offset);
+}
+
+/**
+ * kirkland_reg_write() - Write one register unless it already holds @val.
+ * @regs: The register window.
+ * @offset: Byte offset of the register.
+ * @val: The value.
+ *
+ * The caller holds its driver's lock.
+ *
+ * Return: True if the write reached the hardware, false if it was skipped.
+ */
+static inline bool kirkland_reg_write(struct kirkland_regs *regs, u32 offset,
+	u32 val)
+{
+	u32 i = offset / sizeof(u32);
+
+	if (kirkland_reg_cached(regs, i)) {
+		if (regs->shadow[i] == val) {
+			return false;
+		}
+		WRITE_ONCE(regs->shadow[i], val);
+	}
+	iowrite32(val, regs->base + offset);
+
+	return true;
+}
+
+/**
+ * kirkland_regs_count() - Check a read() or write() against the window.
+ * @regs: The register window.
+ * @offset: File offset of the access.
+ * @count: Bytes asked for.
+ *
+ * Return: The number of whole registers to move, 0 at or past the end of
+ * the window, -EINVAL for a negative offset or less than one register, or
+ * -EFAULT for an unaligned offset.
+ */
+static inline ssize_t kirkland_regs_count(const struct kirkland_regs *regs,
+	loff_t offset, size_t count)
+{
+	size_t n;
+
+	if (offset < 0) {
+		// We can't access a negative file position.
+		return -EINVAL;
+	}
+	if (offset >= regs->span) {
+		// We can't access a position past the end of our device.
+		return 0;
+	}
+	if ((offset % 0x4) != 0) {
+		// Prevent unaligned access.
+		pr_warn("%s: unaligned access\n", regs->name);
+		return -EFAULT;
+	}
+
+	// Number of whole registers requested that fit before the end.
+	n = min_t(size_t, count, regs->span - offset) / sizeof(u32);
+	if (n == 0) {
+		// We only move whole registers.
+		return -EINVAL;
+	}
+
+	return n;
+}
+
+/**
+ * kirkland_regs_read() - Read consecutive registers.
+ * @regs: The register window.
+ * @offset: Byte offset of the first register; checked by the caller.
+ * @vals: Where to put the values.
+ * @n: Number of registers.
+ *
+ * The caller holds its driver's lock.
+ */
+static inline void kirkland_regs_read(const struct kirkland_regs *regs,
+	loff_t offset, u32 *vals, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		vals[i] = kirkland_reg_read(regs, offset + i * sizeof(u32));
+	}
+}
+
+/**
+ * kirkland_regs_write() - Write consecutive registers.
+ * @regs: The register window.
+ * @offset: Byte offset of the first register; checked by the caller.
+ * @vals: The values.
+ * @n: Number of registers.
+ *
+ * The caller holds its driver's lock.
+ *
+ * Return: True if any write reached the hardware.
+ */
+static inline bool kirkland_regs_write(struct kirkland_regs *regs,
+	loff_t offset, const u32 *vals, size_t n)
+{
+	bool changed = false;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		changed |= kirkland_reg_write(regs, offset + i * sizeof(u32), vals[i]);
+	}
+
+	return changed;
+}
+
+/**
+ * kirkland_regs_valid() - Check one KIRKLAND_IOC_REGIO offset.
+ * @regs: The register window.
+ * @offset: Byte offset of the register.
+ *
+ * Return: True if @offset is an aligned register inside the window.
+ */
+static inline bool kirkland_regs_valid(const struct kirkland_regs *regs,
+	u32 offset)
+{
+	return offset % sizeof(u32) == 0 && offset < regs->span;
+}
+
+/**
+ * kirkland_regio_free() - Free a batch's copies.
+ * @batch: The batch.
+ */
+static inline void kirkland_regio_free(struct kirkland_regio_batch *batch)
+{
+	kfree(batch->writes);
+	kfree(batch->read_offsets);
+	kfree(batch->read_values);
+}
+
+/**
+ * kirkland_regio_get() - Copy in and check a KIRKLAND_IOC_REGIO argument.
+ * @regs: The register window.
+ * @batch: Where to put the copy.
+ * @arg: User-space pointer to the struct kirkland_regio.
+ *
+ * Everything that can fault or fail happens here, before the caller takes
+ * its lock.
+ *
+ * Return: 0, -EFAULT, -ENOMEM, or -EINVAL for too many entries or a bad
+ * offset. On failure nothing needs freeing.
+ */
+static inline int kirkland_regio_get(const struct kirkland_regs *regs,
+	struct kirkland_regio_batch *batch, unsigned long arg)
+{
+	struct kirkland_regio *req = &batch->req;
+	u32 i;
+
+	memset(batch, 0, sizeof(*batch));
+	if (copy_from_user(req, (const void __user *)arg, sizeof(*req))) {
+		return -EFAULT;
+	}
+	if (req->nr_writes > KIRKLAND_REGIO_MAX ||
+		req->nr_reads > KIRKLAND_REGIO_MAX) {
+		return -EINVAL;
+	}
+
+	if (req->nr_writes) {
+		batch->writes = memdup_user(u64_to_user_ptr(req->writes),
+			req->nr_writes * sizeof(*batch->writes));
+		if (IS_ERR(batch->writes)) {
+			int ret = PTR_ERR(batch->writes);
+
+			batch->writes = NULL;
+			return ret;
+		}
+	}
+	if (req->nr_reads) {
+		batch->read_offsets = memdup_user(u64_to_user_ptr(req->read_offsets),
+			req->nr_reads * sizeof(u32));
+		if (IS_ERR(batch->read_offsets)) {
+			int ret = PTR_ERR(batch->read_offsets);
+
+			batch->read_offsets = NULL;
+			kirkland_regio_free(batch);
+			return ret;
+		}
+		batch->read_values = kcalloc(req->nr_reads, sizeof(u32), GFP_KERNEL);
+		if (!batch->read_values) {
+			kirkland_regio_free(batch);
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < req->nr_writes; i++) {
+		if (!kirkland_regs_valid(regs, batch->writes[i].offset)) {
+			kirkland_regio_free(batch);
+			return -EINVAL;
+		}
+	}
+	for (i = 0; i < req->nr_reads; i++) {
+		if (!kirkland_regs_valid(regs, batch->read_offsets[i])) {
+			kirkland_regio_free(batch);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * kirkland_regio_apply_writes() - Do a batch's writes.
+ * @regs: The register window.
+ * @batch: The batch from kirkland_regio_get().
+ *
+ * The caller holds its driver's lock, and calls kirkland_regio_apply_reads()
+ * before dropping it, after anything that has to follow the writes.
+ *
+ * Return: True if any write reached the hardware.
+ */
+static inline bool kirkland_regio_apply_writes(struct kirkland_regs *regs,
+	const struct kirkland_regio_batch *batch)
+{
+	bool changed = false;
+	u32 i;
+
+	for (i = 0; i < batch->req.nr_writes; i++) {
+		changed |= kirkland_reg_write(regs, batch->writes[i].offset,
+			batch->writes[i].value);
+	}
+
+	return changed;
+}
+
+/**
+ * kirkland_regio_apply_reads() - Do a batch's reads.
+ * @regs: The register window.
+ * @batch: The batch from kirkland_regio_get().
+ *
+ * The caller holds its driver's lock.
+ */
+static inline void kirkland_regio_apply_reads(const struct kirkland_regs *regs,
+	struct kirkland_regio_batch *batch)
+{
+	u32 i;
+
+	for (i = 0; i < batch->req.nr_reads; i++) {
+		batch->read_values[i] = kirkland_reg_read(regs,
+			batch->read_offsets[i]);
+	}
+}
+
+/**
+ * kirkland_regio_put() - Copy the read-back values out and free the batch.
+ * @batch: The batch.
+ *
+ * Return: 0, or -EFAULT.
+ */
+static inline int kirkland_regio_put(struct kirkland_regio_batch *batch)
+{
+	int ret = 0;
+
+	if (batch->req.nr_reads &&
+		copy_to_user(u64_to_user_ptr(batch->req.read_values),
+			batch->read_values, batch->req.nr_reads * sizeof(u32))) {
+		ret = -EFAULT;
+	}
+	kirkland_regio_free(batch);
+
+	return ret;
+}
+
+/**
+ * struct kirkland_node_id - An instance number taken from a driver's IDA.
+ * @ida: The IDA it came from.
+ * @id: The number.
+ */
+struct kirkland_node_id {
+	struct ida *ida;
+	int id;
+};
+
+/**
+ * kirkland_node_id_free() - Give an instance number back to its IDA.
+ * @data: The struct kirkland_node_id.
+ */
+static inline void kirkland_node_id_free(void *data)
+{
+	struct kirkland_node_id *node = data;
+
+	ida_free(node->ida, node->id);
+}
+
+/**
+ * devm_kirkland_node_name() - Pick an instance number and device node name.
+ * @dev: Device of the instance.
+ * @ida: The driver's instance numbers.
+ * @base: Node name of the first instance.
+ * @id: Where to put the instance number.
+ * @name: Where to put the node name.
+ *
+ * Each instance of a component has its own registers, locks and timers, so
+ * several can be driven in parallel; only their device node names have to
+ * be told apart. The first instance keeps the plain @base name existing
+ * programs open; the others are numbered from 1. The number goes back to
+ * @ida when @dev is unbound.
+ *
+ * Return: 0 on success, or a negative error code.
+ */
+static inline int devm_kirkland_node_name(struct device *dev, struct ida *ida,
+	const char *base, int *id, const char **name)
+{
+	struct kirkland_node_id *node;
+	int ret;
+
+	node = devm_kzalloc(dev, sizeof(*node), GFP_KERNEL);
+	if (!node) {
+		return -ENOMEM;
+	}
+	node->ida = ida;
+	node->id = ida_alloc(ida, GFP_KERNEL);
+	if (node->id < 0) {
+		return node->id;
+	}
+	ret = devm_add_action_or_reset(dev, kirkland_node_id_free, node);
+	if (ret) {
+		return ret;
+	}
+
+	*id = node->id;
+	if (node->id == 0) {
+		*name = base;
+	} else {
+		*name = devm_kasprintf(dev, GFP_KERNEL, "%s%d", base, node->id);
+		if (!*name) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+#endif
+
+#endif /* KIRKLAND_REGIO_H */
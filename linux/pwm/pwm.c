@@ -4,9 +4,12 @@
 #include <linux/io.h>
 #include <linux/mutex.h>
 #include <linux/miscdevice.h>
+#include <linux/idr.h>
 #include <linux/types.h>
 #include <linux/fs.h>
 #include <linux/kstrtox.h>
+
+#include "../include/kirkland_regio.h"
 #define SPAN 16
 
 #define Red_out_OFFSET 0
@@ -19,6 +22,9 @@
     /**
     * struct pwm_dev - Private pwm patterns device struct.
     * @base_addr: Pointer to the component's base address
+    * @regs: Register window for read(), write() and KIRKLAND_IOC_REGIO
+    * @id: Instance number from pwm_ida
+    * @name: Name of the device node; pwm for instance 0 and pwmN for instance N
     * @red_out: Address of the red_out register
     * @green_out: Address of the green_out register
     * @blue_out: Address of the blue_out register
@@ -27,11 +33,14 @@
     */
     struct pwm_dev {
     void __iomem *base_addr;
+    struct kirkland_regs regs;
     void __iomem *red_out;
     void __iomem *green_out;
     void __iomem *blue_out;
     void __iomem *peri;
     struct miscdevice miscdev;
+    int id;
+    const char *name;
     struct mutex lock;
     };
 
@@ -42,44 +51,39 @@
     *@count: the number of bytes being requested
     *@offset: the byte offset in the file being read from
     *
+    *Reads as many whole registers as @count asks for, up to the end of the
+    *device, under a single lock acquisition.
+    *
     *Return: On success, the number of bytes written is returned and the 
     *offset @offset is advanced by this number. On error, a negative error
     *value is returned
     *
     */
     static ssize_t pwm_read(struct file *file, char __user *buf, size_t count, loff_t *offset){
-        size_t ret;
-        u32 val;
+        u32 vals[SPAN / sizeof(u32)];
+        ssize_t n;
 
         struct pwm_dev *priv = container_of(file->private_data, struct pwm_dev, miscdev);
 
-        //Check file offset to make sure we are reading from a valid location.
-        if(*offset <0){
-            //We can't read from a negative position.
-            return -EINVAL;
-        }
-        if(*offset >= SPAN){
-            //We can't read from a position past the end of our device.
-            return 0;
-        }
-        if((*offset % 0x4) != 0){
-            // Prevent unaligned access.
-            pr_warn("pwm_read: unaligned access\n");
-            return -EFAULT;
+        //Check the file offset and work out how many whole registers to read.
+        n = kirkland_regs_count(&priv->regs, *offset, count);
+        if(n <= 0){
+            return n;
         }
 
-        val = ioread32(priv->base_addr + *offset);
+        mutex_lock(&priv->lock);
+        kirkland_regs_read(&priv->regs, *offset, vals, n);
+        mutex_unlock(&priv->lock);
 
-        //Copy the value to userspace
-        ret = copy_to_user(buf, &val, sizeof(val));
-        if(ret == sizeof(val)){
+        //Copy the values to userspace
+        if(copy_to_user(buf, vals, n * sizeof(u32))){
             pr_warn("pwm_read: Nothing copied\n");
             return -EFAULT;
         }
         // Increment the file offset by the number of bytes we read
-        *offset = *offset + sizeof(val);
+        *offset = *offset + n * sizeof(u32);
 
-        return sizeof(val);
+        return n * sizeof(u32);
     }
 
     /**
@@ -89,6 +93,9 @@
     * @count: The number of bytes being written.
     * @offset: The byte offset in the file being written to.
     *
+    * Writes as many whole registers as @count holds, up to the end of the
+    * device, under a single lock acquisition.
+    *
     * Return: On success, the number of bytes written is returned and the
     * offset @offset is advanced by this number. On error, a negative error
     * value is returned.
@@ -96,45 +103,70 @@
     static ssize_t pwm_write(struct file *file, const char __user *buf,
     size_t count, loff_t *offset)
     {
-    size_t ret;
-    u32 val;
+    u32 vals[SPAN / sizeof(u32)];
+    ssize_t n;
 
     struct pwm_dev *priv = container_of(file->private_data,
     struct pwm_dev, miscdev);
 
-    if (*offset < 0) {
-    return -EINVAL;
-    }
-    if (*offset >= SPAN) {
-    return 0;
+    n = kirkland_regs_count(&priv->regs, *offset, count);
+    if (n <= 0) {
+    return n;
     }
-    if ((*offset % 0x4) != 0) {
-    pr_warn("pwm_write: unaligned access\n");
+
+    // Get the values from userspace before taking the lock; this can fault.
+    if (copy_from_user(vals, buf, n * sizeof(u32))) {
+    pr_warn("pwm_write: nothing copied from user space\n");
     return -EFAULT;
     }
 
     mutex_lock(&priv->lock);
-
-    // Get the value from userspace.
-    ret = copy_from_user(&val, buf, sizeof(val));
-    if (ret != sizeof(val)) {
-     iowrite32(val, priv->base_addr + *offset);
+    kirkland_regs_write(&priv->regs, *offset, vals, n);
+    mutex_unlock(&priv->lock);
 
     // Increment the file offset by the number of bytes we wrote.
-    *offset = *offset + sizeof(val);
+    *offset = *offset + n * sizeof(u32);
 
     // Return the number of bytes we wrote.
-    ret = sizeof(val);
+    return n * sizeof(u32);
     }
-    else {
-    pr_warn("pwm_write: nothing copied from user space\n");
-    ret = -EFAULT;
+
+    /**
+    * pwm_ioctl() - ioctl method for the pwm char device
+    * @file: Pointer to the char device file struct.
+    * @cmd: The ioctl command; only KIRKLAND_IOC_REGIO.
+    * @arg: The command's user-space argument.
+    *
+    * Applies a batch of register writes and read-backs under one lock
+    * acquisition; see kirkland_regio.h.
+    *
+    * Return: 0 on success, or a negative error value.
+    */
+    static long pwm_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+    {
+    struct kirkland_regio_batch batch;
+    int ret;
+
+    struct pwm_dev *priv = container_of(file->private_data,
+    struct pwm_dev, miscdev);
+
+    if (cmd != KIRKLAND_IOC_REGIO) {
+    return -ENOTTY;
     }
 
-    mutex_unlock(&priv->lock);
+    ret = kirkland_regio_get(&priv->regs, &batch, arg);
+    if (ret) {
     return ret;
     }
 
+    mutex_lock(&priv->lock);
+    kirkland_regio_apply_writes(&priv->regs, &batch);
+    kirkland_regio_apply_reads(&priv->regs, &batch);
+    mutex_unlock(&priv->lock);
+
+    return kirkland_regio_put(&batch);
+    }
+
     // listings 15 - 19
 
  
@@ -332,6 +364,9 @@
     *   0write: the wrtie function
     *   0llseek: We use the kernel's default_llseek() function; this allows
     *            users to change what position they are writing/reading to/from
+    *   0unlocked_ioctl: Batched register access
+    *   0compat_ioctl: The ioctl argument has the same layout for 32-bit
+    *            callers
     *
     */
     static const struct file_operations pwm_fops = {
@@ -339,8 +374,13 @@
         .read = pwm_read,
         .write = pwm_write,
         .llseek = default_llseek,
+        .unlocked_ioctl = pwm_ioctl,
+        .compat_ioctl = compat_ptr_ioctl,
     };
 
+    // Instance numbers for devm_kirkland_node_name()
+    static DEFINE_IDA(pwm_ida);
+
     /**
     * pwm_probe() - Initialize device when a match is found
     * @pdev: Platform device structure associated with our pwm patterns device;
@@ -354,7 +394,7 @@
     static int pwm_probe(struct platform_device *pdev)
     {
     struct pwm_dev *priv;
-    size_t ret;
+    int ret;
     /*
     * Allocate kernel memory for the pwm patterns device and set it to 0.
     * GFP_KERNEL specifies that we are allocating normal kernel RAM;
@@ -380,6 +420,19 @@
         return PTR_ERR(priv->base_addr);
     }
 
+    mutex_init(&priv->lock);
+
+    ret = devm_kirkland_node_name(&pdev->dev, &pwm_ida, "pwm",
+    &priv->id, &priv->name);
+    if (ret) {
+        pr_err("Failed to allocate an instance number\n");
+        return ret;
+    }
+
+    priv->regs.name = priv->name;
+    priv->regs.base = priv->base_addr;
+    priv->regs.span = SPAN;
+
     // Set the memory addresses for each register.
     priv->red_out = priv->base_addr + Red_out_OFFSET;
     priv->green_out = priv->base_addr + Green_out_OFFSET;
@@ -391,12 +444,13 @@
 
     //Initialize the misc device parameters
     priv->miscdev.minor = MISC_DYNAMIC_MINOR;
-    priv->miscdev.name = "pwm";
+    priv->miscdev.name = priv->name;
     priv->miscdev.fops = &pwm_fops;
     priv->miscdev.parent = &pdev->dev;
 
     iowrite32(1, priv->red_out);
-    //Register the misc device; this creates a char dev at /dev/pwm
+    //Register the misc device; this creates a char dev at /dev/pwm for the
+    //first instance and /dev/pwmN for the others
     ret = misc_register(&priv->miscdev);
     if(ret){
         pr_err("pwm to register misc device");
@@ -420,7 +474,7 @@
     // Disable software-control mode, just for kicks.
     iowrite32(0, priv->red_out);
 
-    //Deregister the misc device and remvoe the /dev/pwm file
+    //Deregister the misc device and remvoe its /dev/pwm* file
     misc_deregister(&priv->miscdev);
 
     pr_info("pwm_remove successful\n");
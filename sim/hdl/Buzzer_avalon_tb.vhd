@@ -0,0 +1,174 @@
+----------------------------------------------------------------------------
+-- Description:  Buzzer_avalon testbench - checks the register file over the
+--               Avalon bus, the tone period set through period_reg, note
+--               FIFO playback timing, overflow, underrun and flush, and
+--               reports the bus cycles each transaction and a note push take
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.tb_pkg.all;
+
+entity Buzzer_avalon_tb is
+end entity Buzzer_avalon_tb;
+
+architecture Buzzer_avalon_tb_arch of Buzzer_avalon_tb is
+	constant CLK_PERIOD : time := 20 ns;
+	constant CLK_FREQ : real := 50.0e6;
+
+	-- Word addresses
+	constant PERIOD_REG : natural := 0;
+	constant DURATION_REG : natural := 1;
+	constant NOTE_PUSH : natural := 2;
+	constant STATUS_REG : natural := 3;
+
+	constant FIFO_DEPTH : natural := 32;
+
+	-- The reset period_reg of 128/4096 s has to run out before a new period
+	-- takes effect
+	constant TIMEOUT : natural := 2000000;
+
+	signal clk : std_logic := '0';
+	signal rst : std_logic := '1';
+	signal avs_read : std_logic := '0';
+	signal avs_write : std_logic := '0';
+	signal avs_address : std_logic_vector(1 downto 0) := (others => '0');
+	signal avs_readdata : std_logic_vector(31 downto 0);
+	signal avs_writedata : std_logic_vector(31 downto 0) := (others => '0');
+	signal GPIO : std_logic;
+
+	component Buzzer_avalon is
+		port (
+			clk				: in	std_ulogic;
+			rst				: in	std_ulogic;
+			avs_read			: in	std_logic;
+			avs_write		: in	std_logic;
+			avs_address		: in	std_logic_vector(1 downto 0);
+			avs_readdata	: out	std_logic_vector(31 downto 0);
+			avs_writedata	: in	std_logic_vector(31 downto 0);
+			GPIO				: out	std_logic
+		);
+	end component Buzzer_avalon;
+
+begin
+
+	dut : Buzzer_avalon
+	port map (
+		clk => clk,
+		rst => rst,
+		avs_read => avs_read,
+		avs_write => avs_write,
+		avs_address => avs_address,
+		avs_readdata => avs_readdata,
+		avs_writedata => avs_writedata,
+		GPIO => GPIO
+	);
+
+	clk <= not clk after CLK_PERIOD / 2;
+
+	stimulus : process
+		variable errors : natural := 0;
+		variable stats : bus_stats := BUS_STATS_INIT;
+		variable push : bus_stats;
+		variable data : std_logic_vector(31 downto 0);
+		variable p, h, n : natural;
+		variable ok : boolean;
+
+		procedure wr (addr : natural; value : std_logic_vector(31 downto 0)) is
+		begin
+			bus_write(clk, avs_write, avs_address, avs_writedata, addr, value, stats);
+		end procedure wr;
+
+		procedure rd (addr : natural; variable value : out std_logic_vector(31 downto 0)) is
+		begin
+			bus_read(clk, avs_read, avs_address, avs_readdata, addr, value, stats);
+		end procedure rd;
+
+		procedure expect (addr : natural; value : std_logic_vector(31 downto 0); what : string) is
+			variable got : std_logic_vector(31 downto 0);
+		begin
+			rd(addr, got);
+			check(got = value, what & ": read 0x" & hex(got) & ", expected 0x" & hex(value), errors);
+		end procedure expect;
+	begin
+		tick(clk, 4);
+		rst <= '0';
+		tick(clk);
+
+		-- Reset values
+		expect(PERIOD_REG, x"00000080", "period_reg after reset");
+		expect(DURATION_REG, x"00000000", "duration_reg after reset");
+		expect(NOTE_PUSH, x"00000000", "note period after reset");
+		expect(STATUS_REG, x"00000000", "status after reset");
+
+		wr(DURATION_REG, x"00012345");
+		expect(DURATION_REG, x"00012345", "duration_reg readback");
+
+		-- A period_reg tone; 5/4096 s is about 819 Hz
+		wr(PERIOD_REG, x"00000005");
+		expect(PERIOD_REG, x"00000005", "period_reg readback");
+		measure_pwm(clk, GPIO, TIMEOUT, p, h, ok);
+		check(ok, "no tone from period_reg", errors);
+		check_clocks("period_reg 5: period", p, CLK_FREQ * 5.0 / 4096.0, 1.0, errors);
+		check_clocks("period_reg 5: high", h, CLK_FREQ * 5.0 / 4096.0 / 2.0, 1.0, errors);
+
+		-- Three 1000-clock notes play back to back, then underrun is set
+		wr(DURATION_REG, std_logic_vector(to_unsigned(1000, 32)));
+		push := BUS_STATS_INIT;
+		bus_write(clk, avs_write, avs_address, avs_writedata, NOTE_PUSH, x"00000002", push);
+		bus_write(clk, avs_write, avs_address, avs_writedata, NOTE_PUSH, x"00000003", push);
+		bus_write(clk, avs_write, avs_address, avs_writedata, NOTE_PUSH, x"00000004", push);
+		report "three note pushes: " & integer'image(push.write_cycles) & " bus cycles";
+		n := 3;
+		rd(STATUS_REG, data);
+		n := n + 1 + AVS_READ_WAIT;
+		check(data(8) = '1', "not playing after three pushes", errors);
+		rd(NOTE_PUSH, data);
+		n := n + 1 + AVS_READ_WAIT;
+		check(unsigned(data) = 2, "first note playing has period 0x" & hex(data), errors);
+		loop
+			rd(STATUS_REG, data);
+			n := n + 1 + AVS_READ_WAIT;
+			exit when data(8) = '0' or n > 10000;
+		end loop;
+		report "three 1000-clock notes played in about " & integer'image(n) & " clocks";
+		-- The poll adds up to two reads on top of the notes themselves
+		check(n >= 3000 and n <= 3000 + 3 * (1 + AVS_READ_WAIT), "notes took "
+			& integer'image(n) & " clocks, expected about 3000", errors);
+		check(data(9) = '1', "underrun not set at the end of the notes", errors);
+		wr(STATUS_REG, x"00000200");
+		rd(STATUS_REG, data);
+		check(data(9) = '0', "underrun not cleared", errors);
+
+		-- The first push starts playing at once, so FIFO_DEPTH + 1 pushes
+		-- fill the FIFO and the next one is dropped
+		wr(DURATION_REG, std_logic_vector(to_unsigned(100000, 32)));
+		for i in 0 to FIFO_DEPTH + 1 loop
+			wr(NOTE_PUSH, std_logic_vector(to_unsigned(i + 1, 32)));
+		end loop;
+		rd(STATUS_REG, data);
+		check(unsigned(data(5 downto 0)) = FIFO_DEPTH, "FIFO level "
+			& integer'image(to_integer(unsigned(data(5 downto 0)))) & " after overfilling", errors);
+		check(data(8) = '1', "not playing with a full FIFO", errors);
+
+		-- Flush drops the queue and stops the note
+		wr(STATUS_REG, x"00000400");
+		rd(STATUS_REG, data);
+		check(unsigned(data(5 downto 0)) = 0, "FIFO not empty after flush", errors);
+		check(data(8) = '0', "still playing after flush", errors);
+
+		report_bus("Buzzer_avalon", stats);
+
+		finish("Buzzer_avalon_tb", errors);
+		wait;
+	end process stimulus;
+
+end architecture Buzzer_avalon_tb_arch;
@@ -0,0 +1,111 @@
+----------------------------------------------------------------------------
+-- Description:  Buzzer testbench - measures the tone period and the 50% duty
+--               cycle over a sweep of period values, and checks that a period
+--               of 0 is silent
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.tb_pkg.all;
+
+entity Buzzer_tb is
+end entity Buzzer_tb;
+
+architecture Buzzer_tb_arch of Buzzer_tb is
+	constant CLK_PERIOD : time := 20 ns;
+	constant CLK_FREQ : real := 50.0e6;
+
+	signal clk : std_logic := '0';
+	signal rst : std_logic := '1';
+	-- 13.12 seconds
+	signal period : unsigned(12 downto 0) := to_unsigned(1, 13);
+	signal output : std_logic;
+
+	-- Period sweep, in 1/4096 s
+	type natural_array is array (natural range <>) of natural;
+	constant PERIODS : natural_array := (1, 2, 3, 5, 8);
+
+	-- Long enough for the longest period in the sweep to finish and two more
+	-- to be measured
+	constant TIMEOUT : natural := 400000;
+
+	component Buzzer is
+		generic (
+			CLK_PERIOD		: time := 20 ns;
+			W_PERIOD			: integer := 13  -- 13.12
+		);
+		port (
+			clk			: in	std_logic;
+			rst			: in	std_logic;
+			period		: in	unsigned(W_PERIOD - 1 downto 0);
+			output		: out	std_logic := '0'
+		);
+	end component Buzzer;
+
+begin
+
+	dut : Buzzer
+	generic map (
+		CLK_PERIOD => CLK_PERIOD
+	)
+	port map (
+		clk => clk,
+		rst => rst,
+		period => period,
+		output => output
+	);
+
+	clk <= not clk after CLK_PERIOD / 2;
+
+	stimulus : process
+		variable errors : natural := 0;
+		variable p, h, n : natural;
+		variable ok : boolean;
+		variable ideal_period : real;
+	begin
+		tick(clk, 4);
+		rst <= '0';
+		tick(clk);
+
+		-- The ideal period is CLK_FREQ * period / 4096 clocks, high for half
+		-- of it; the buzzer truncates both
+		for i in PERIODS'range loop
+			period <= to_unsigned(PERIODS(i), 13);
+			ideal_period := CLK_FREQ * real(PERIODS(i)) / 4096.0;
+			measure_pwm(clk, output, TIMEOUT, p, h, ok);
+			check(ok, "no tone for period " & integer'image(PERIODS(i)), errors);
+			if (ok) then
+				check_clocks("period " & integer'image(PERIODS(i)) & ": period", p, ideal_period, 1.0, errors);
+				check_clocks("period " & integer'image(PERIODS(i)) & ": high", h, ideal_period / 2.0, 1.0, errors);
+				report "period " & integer'image(PERIODS(i)) & ": "
+					& real'image(CLK_FREQ / real(p)) & " Hz";
+			end if;
+		end loop;
+
+		-- Period 0 is silence. It takes effect at the end of the period in
+		-- progress, then the output must stay low.
+		period <= (others => '0');
+		wait until rising_edge(clk) and output = '0';
+		tick(clk, integer(CLK_FREQ * 8.0 / 4096.0));
+		n := 0;
+		for i in 1 to 3 * integer(CLK_FREQ * 8.0 / 4096.0) loop
+			wait until rising_edge(clk);
+			if (output = '1') then
+				n := n + 1;
+			end if;
+		end loop;
+		check(n = 0, "output high for " & integer'image(n) & " clocks with period 0", errors);
+
+		finish("Buzzer_tb", errors);
+		wait;
+	end process stimulus;
+
+end architecture Buzzer_tb_arch;
@@ -0,0 +1,186 @@
+----------------------------------------------------------------------------
+-- Description:  PWM_Bank_avalon testbench - a 4-channel bank in 2 period
+--               groups. Checks the info register and register blocks over the
+--               Avalon bus, that each group runs at its own period after a
+--               commit, and reports the bus cycles of a full bank update
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.tb_pkg.all;
+
+entity PWM_Bank_avalon_tb is
+end entity PWM_Bank_avalon_tb;
+
+architecture PWM_Bank_avalon_tb_arch of PWM_Bank_avalon_tb is
+	-- As in PWM_Controller_tb, a 20 us clock keeps the PWM periods short:
+	-- a period register of 1 is 390 clocks
+	constant CLK_PERIOD : time := 20 us;
+	constant CLK_FREQ : real := 50.0e3;
+	constant N_CHANNELS : integer := 4;
+	constant N_GROUPS : integer := 2;
+
+	-- Word addresses
+	constant INFO_REG : natural := 16#00#;
+	constant COMMIT_REG : natural := 16#01#;
+	constant RAMPING_LO : natural := 16#02#;
+	constant PERIOD_BASE : natural := 16#40#;
+	constant DUTY_BASE : natural := 16#80#;
+	constant STEP_BASE : natural := 16#C0#;
+
+	constant TIMEOUT : natural := 200000;
+
+	signal clk : std_logic := '0';
+	signal rst : std_logic := '1';
+	signal avs_read : std_logic := '0';
+	signal avs_write : std_logic := '0';
+	signal avs_address : std_logic_vector(7 downto 0) := (others => '0');
+	signal avs_readdata : std_logic_vector(31 downto 0);
+	signal avs_writedata : std_logic_vector(31 downto 0) := (others => '0');
+	signal GPIO : std_logic_vector(N_CHANNELS - 1 downto 0);
+
+	component PWM_Bank_avalon is
+		generic (
+			CLK_PERIOD		: time := 20 ns;
+			N_CHANNELS		: integer range 1 to 64 := 16;
+			N_GROUPS			: integer range 1 to 64 := 1
+		);
+		port (
+			clk				: in	std_ulogic;
+			rst				: in	std_ulogic;
+			avs_read			: in	std_logic;
+			avs_write		: in	std_logic;
+			avs_address		: in	std_logic_vector(7 downto 0);
+			avs_readdata	: out	std_logic_vector(31 downto 0);
+			avs_writedata	: in	std_logic_vector(31 downto 0);
+			GPIO				: out	std_logic_vector(N_CHANNELS - 1 downto 0)
+		);
+	end component PWM_Bank_avalon;
+
+begin
+
+	dut : PWM_Bank_avalon
+	generic map (
+		CLK_PERIOD => CLK_PERIOD,
+		N_CHANNELS => N_CHANNELS,
+		N_GROUPS => N_GROUPS
+	)
+	port map (
+		clk => clk,
+		rst => rst,
+		avs_read => avs_read,
+		avs_write => avs_write,
+		avs_address => avs_address,
+		avs_readdata => avs_readdata,
+		avs_writedata => avs_writedata,
+		GPIO => GPIO
+	);
+
+	clk <= not clk after CLK_PERIOD / 2;
+
+	stimulus : process
+		variable errors : natural := 0;
+		variable stats : bus_stats := BUS_STATS_INIT;
+		variable update : bus_stats;
+		variable data : std_logic_vector(31 downto 0);
+		variable p, h, n : natural;
+		variable ok : boolean;
+
+		procedure wr (addr : natural; value : std_logic_vector(31 downto 0)) is
+		begin
+			bus_write(clk, avs_write, avs_address, avs_writedata, addr, value, stats);
+		end procedure wr;
+
+		procedure rd (addr : natural; variable value : out std_logic_vector(31 downto 0)) is
+		begin
+			bus_read(clk, avs_read, avs_address, avs_readdata, addr, value, stats);
+		end procedure rd;
+
+		procedure expect (addr : natural; value : std_logic_vector(31 downto 0); what : string) is
+			variable got : std_logic_vector(31 downto 0);
+		begin
+			rd(addr, got);
+			check(got = value, what & ": read 0x" & hex(got) & ", expected 0x" & hex(value), errors);
+		end procedure expect;
+	begin
+		tick(clk, 4);
+		rst <= '0';
+		tick(clk);
+
+		-- The bank describes itself, and resets to 0% with period 0x80
+		expect(INFO_REG, x"00000204", "info");
+		expect(COMMIT_REG, x"00000000", "commit status after reset");
+		expect(RAMPING_LO, x"00000000", "ramping after reset");
+		expect(PERIOD_BASE + 1, x"00000080", "period 1 after reset");
+		expect(DUTY_BASE + 3, x"00000000", "duty cycle 3 after reset");
+
+		-- Registers keep only the bits the controllers use, and the ones past
+		-- the last channel or group read 0
+		wr(PERIOD_BASE + 1, x"FFFF1234");
+		expect(PERIOD_BASE + 1, x"00001234", "period 1 readback");
+		wr(DUTY_BASE + 3, x"FF123456");
+		expect(DUTY_BASE + 3, x"00123456", "duty cycle 3 readback");
+		wr(STEP_BASE + 2, x"00000100");
+		expect(STEP_BASE + 2, x"00000100", "ramp step 2 readback");
+		wr(DUTY_BASE + N_CHANNELS, x"00100000");
+		expect(DUTY_BASE + N_CHANNELS, x"00000000", "duty cycle past the last channel");
+		wr(PERIOD_BASE + N_GROUPS, x"00000010");
+		expect(PERIOD_BASE + N_GROUPS, x"00000000", "period past the last group");
+		wr(STEP_BASE + 2, x"00000000");
+
+		-- Group 0 (channels 0 and 1) at period 4, group 1 (channels 2 and 3)
+		-- at period 2; all four duty cycles and the commit in one burst
+		update := BUS_STATS_INIT;
+		bus_write(clk, avs_write, avs_address, avs_writedata, PERIOD_BASE + 0, x"00000004", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, PERIOD_BASE + 1, x"00000002", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, DUTY_BASE + 0, x"00100000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, DUTY_BASE + 1, x"00080000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, DUTY_BASE + 2, x"00080000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, DUTY_BASE + 3, x"00180000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, COMMIT_REG, x"00000001", update);
+		report "bank update (2 periods, 4 duty cycles, commit): "
+			& integer'image(update.write_cycles) & " bus cycles";
+
+		-- The commit stays pending until both groups reach a period boundary
+		rd(COMMIT_REG, data);
+		check(data(0) = '1', "commit not pending right after the commit write", errors);
+		n := 0;
+		while data(0) = '1' and n < TIMEOUT loop
+			rd(COMMIT_REG, data);
+			n := n + 1 + AVS_READ_WAIT;
+		end loop;
+		check(data(0) = '0', "commit never applied", errors);
+		report "commit applied to both groups " & integer'image(n) & " clocks after the status poll started";
+
+		measure_pwm(clk, GPIO(0), TIMEOUT, p, h, ok);
+		check(ok, "no output on channel 0", errors);
+		check_clocks("channel 0: period", p, CLK_FREQ / 128.0 * 4.0, 1.0, errors);
+		check_clocks("channel 0: high", h, CLK_FREQ / 128.0 * 4.0 * 0.5, 1.0, errors);
+		measure_pwm(clk, GPIO(1), TIMEOUT, p, h, ok);
+		check(ok, "no output on channel 1", errors);
+		check_clocks("channel 1: period", p, CLK_FREQ / 128.0 * 4.0, 1.0, errors);
+		check_clocks("channel 1: high", h, CLK_FREQ / 128.0 * 4.0 * 0.25, 1.0, errors);
+		measure_pwm(clk, GPIO(2), TIMEOUT, p, h, ok);
+		check(ok, "no output on channel 2", errors);
+		check_clocks("channel 2: period", p, CLK_FREQ / 128.0 * 2.0, 1.0, errors);
+		check_clocks("channel 2: high", h, CLK_FREQ / 128.0 * 2.0 * 0.25, 1.0, errors);
+		measure_pwm(clk, GPIO(3), TIMEOUT, p, h, ok);
+		check(ok, "no output on channel 3", errors);
+		check_clocks("channel 3: period", p, CLK_FREQ / 128.0 * 2.0, 1.0, errors);
+		check_clocks("channel 3: high", h, CLK_FREQ / 128.0 * 2.0 * 0.75, 1.0, errors);
+
+		report_bus("PWM_Bank_avalon", stats);
+
+		finish("PWM_Bank_avalon_tb", errors);
+		wait;
+	end process stimulus;
+
+end architecture PWM_Bank_avalon_tb_arch;
@@ -0,0 +1,251 @@
+----------------------------------------------------------------------------
+-- Description:  PWM_controller_avalon testbench - checks the register file
+--               over the Avalon bus, that writes only reach the outputs on a
+--               commit at a period boundary, the ramp status bits, and
+--               reports the bus cycles each transaction and a colour update
+--               take
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.tb_pkg.all;
+
+entity PWM_Controller_avalon_tb is
+end entity PWM_Controller_avalon_tb;
+
+architecture PWM_Controller_avalon_tb_arch of PWM_Controller_avalon_tb is
+	-- As in PWM_Controller_tb, a 20 us clock keeps the PWM periods short:
+	-- a period register of 1 is 390 clocks
+	constant CLK_PERIOD : time := 20 us;
+	constant CLK_FREQ : real := 50.0e3;
+
+	-- Word addresses
+	constant PERIOD_REG : natural := 0;
+	constant RED_DC_REG : natural := 1;
+	constant GRN_DC_REG : natural := 2;
+	constant BLU_DC_REG : natural := 3;
+	constant COMMIT_REG : natural := 4;
+	constant RED_STEP_REG : natural := 5;
+	constant GRN_STEP_REG : natural := 6;
+	constant BLU_STEP_REG : natural := 7;
+
+	-- Reset values
+	constant PERIOD_DEFAULT : std_logic_vector(31 downto 0) := x"00000080";
+	constant DC_DEFAULT : std_logic_vector(31 downto 0) := x"00100000";
+
+	-- A PWM period is CLK_FREQ * period_reg / 128 clocks. The reset period
+	-- is therefore 50,000 clocks, and the first commit can't apply before it
+	-- ends.
+	constant RESET_PERIOD : natural := 50000;
+	-- The period the test commits, a period_reg of 1
+	constant TEST_PERIOD : natural := 390;
+	constant TIMEOUT : natural := 3 * TEST_PERIOD + 1000;
+
+	signal clk : std_logic := '0';
+	signal rst : std_logic := '1';
+	signal avs_read : std_logic := '0';
+	signal avs_write : std_logic := '0';
+	signal avs_address : std_logic_vector(2 downto 0) := (others => '0');
+	signal avs_readdata : std_logic_vector(31 downto 0);
+	signal avs_writedata : std_logic_vector(31 downto 0) := (others => '0');
+	signal GPIO : std_logic_vector(2 downto 0);
+
+	component PWM_controller_avalon is
+		generic (
+			CLK_PERIOD		: time := 20 ns
+		);
+		port (
+			clk				: in	std_ulogic;
+			rst				: in	std_ulogic;
+			avs_read			: in	std_logic;
+			avs_write		: in	std_logic;
+			avs_address		: in	std_logic_vector(2 downto 0);
+			avs_readdata	: out	std_logic_vector(31 downto 0);
+			avs_writedata	: in	std_logic_vector(31 downto 0);
+			GPIO				: out	std_logic_vector(2 downto 0)
+		);
+	end component PWM_controller_avalon;
+
+begin
+
+	dut : PWM_controller_avalon
+	generic map (
+		CLK_PERIOD => CLK_PERIOD
+	)
+	port map (
+		clk => clk,
+		rst => rst,
+		avs_read => avs_read,
+		avs_write => avs_write,
+		avs_address => avs_address,
+		avs_readdata => avs_readdata,
+		avs_writedata => avs_writedata,
+		GPIO => GPIO
+	);
+
+	clk <= not clk after CLK_PERIOD / 2;
+
+	stimulus : process
+		variable errors : natural := 0;
+		variable stats : bus_stats := BUS_STATS_INIT;
+		variable update : bus_stats;
+		variable data : std_logic_vector(31 downto 0);
+		variable p, h, n : natural;
+		variable ok : boolean;
+
+		procedure wr (addr : natural; value : std_logic_vector(31 downto 0)) is
+		begin
+			bus_write(clk, avs_write, avs_address, avs_writedata, addr, value, stats);
+		end procedure wr;
+
+		procedure rd (addr : natural; variable value : out std_logic_vector(31 downto 0)) is
+		begin
+			bus_read(clk, avs_read, avs_address, avs_readdata, addr, value, stats);
+		end procedure rd;
+
+		procedure expect (addr : natural; value : std_logic_vector(31 downto 0); what : string) is
+			variable got : std_logic_vector(31 downto 0);
+		begin
+			rd(addr, got);
+			check(got = value, what & ": read 0x" & hex(got) & ", expected 0x" & hex(value), errors);
+		end procedure expect;
+	begin
+		tick(clk, 4);
+		rst <= '0';
+		tick(clk);
+
+		-- Reset values
+		expect(PERIOD_REG, PERIOD_DEFAULT, "period_reg after reset");
+		expect(RED_DC_REG, DC_DEFAULT, "red_dc_reg after reset");
+		expect(GRN_DC_REG, DC_DEFAULT, "grn_dc_reg after reset");
+		expect(BLU_DC_REG, DC_DEFAULT, "blu_dc_reg after reset");
+		expect(COMMIT_REG, x"00000000", "status after reset");
+		expect(RED_STEP_REG, x"00000000", "red_step_reg after reset");
+
+		-- Every register reads back what was written to it
+		for addr in 0 to 7 loop
+			if (addr /= COMMIT_REG) then
+				wr(addr, std_logic_vector(to_unsigned(16#1234# * (addr + 1), 32)));
+				expect(addr, std_logic_vector(to_unsigned(16#1234# * (addr + 1), 32)),
+					"register " & integer'image(addr) & " readback");
+			end if;
+		end loop;
+
+		-- A new colour: period_reg 1, red 25%, green 75%, blue 50%. Until
+		-- it's committed, the outputs stay in the first half of the reset
+		-- period, where they're high.
+		wr(PERIOD_REG, x"00000001");
+		wr(RED_DC_REG, x"00080000");
+		wr(GRN_DC_REG, x"00180000");
+		wr(BLU_DC_REG, x"00100000");
+		wr(RED_STEP_REG, x"00000000");
+		wr(GRN_STEP_REG, x"00000000");
+		wr(BLU_STEP_REG, x"00000000");
+		n := 0;
+		for i in 1 to 2 * TEST_PERIOD loop
+			wait until rising_edge(clk);
+			if (GPIO /= "111") then
+				n := n + 1;
+			end if;
+		end loop;
+		check(n = 0, "outputs changed " & integer'image(n) & " clocks before the commit", errors);
+
+		-- Commit, then time how long it takes to be applied
+		wr(COMMIT_REG, x"00000001");
+		rd(COMMIT_REG, data);
+		check(data(0) = '1', "commit not pending right after the commit write", errors);
+		n := 0;
+		while data(0) = '1' and n < RESET_PERIOD + 1000 loop
+			rd(COMMIT_REG, data);
+			n := n + 1 + AVS_READ_WAIT;
+		end loop;
+		check(data(0) = '0', "commit never applied", errors);
+		report "commit applied " & integer'image(n) & " clocks after the status poll started";
+		check(n <= RESET_PERIOD + 2, "commit took longer than one PWM period", errors);
+
+		measure_pwm(clk, GPIO(0), TIMEOUT, p, h, ok);
+		check(ok, "no red output after commit", errors);
+		check_clocks("red after commit: period", p, CLK_FREQ / 128.0, 1.0, errors);
+		check_clocks("red after commit: high", h, CLK_FREQ / 128.0 * 0.25, 1.0, errors);
+		measure_pwm(clk, GPIO(1), TIMEOUT, p, h, ok);
+		check(ok, "no green output after commit", errors);
+		check_clocks("green after commit: high", h, CLK_FREQ / 128.0 * 0.75, 1.0, errors);
+		measure_pwm(clk, GPIO(2), TIMEOUT, p, h, ok);
+		check(ok, "no blue output after commit", errors);
+		check_clocks("blue after commit: high", h, CLK_FREQ / 128.0 * 0.5, 1.0, errors);
+
+		-- Ramp red from 25% to 75% in 12.5% steps; its status bit stays set
+		-- for four periods
+		wr(RED_DC_REG, x"00180000");
+		wr(RED_STEP_REG, x"00040000");
+		wr(COMMIT_REG, x"00000001");
+		n := 0;
+		loop
+			rd(COMMIT_REG, data);
+			exit when data(0) = '0' or n > TIMEOUT;
+			n := n + 1;
+		end loop;
+		rd(COMMIT_REG, data);
+		check(data(1) = '1', "red not ramping after a commit with a ramp step", errors);
+		check(data(3 downto 2) = "00", "green or blue ramping", errors);
+		n := 0;
+		while data(1) = '1' and n < 10 * TEST_PERIOD loop
+			rd(COMMIT_REG, data);
+			n := n + 1 + AVS_READ_WAIT;
+		end loop;
+		check(data(1) = '0', "red never finished ramping", errors);
+		report "ramp finished " & integer'image(n) & " clocks after it started ("
+			& real'image(real(n) / real(TEST_PERIOD)) & " periods)";
+		check(n > 2 * TEST_PERIOD and n <= 4 * TEST_PERIOD + 4, "ramp didn't take 3 to 4 periods", errors);
+
+		-- A shadow write after a commit, but before it applies, stays out
+		-- of it: green keeps 75% until the next commit
+		wr(BLU_DC_REG, x"00080000");
+		wr(COMMIT_REG, x"00000001");
+		wr(GRN_DC_REG, x"00080000");
+		n := 0;
+		loop
+			rd(COMMIT_REG, data);
+			exit when data(0) = '0' or n > TIMEOUT;
+			n := n + 1;
+		end loop;
+		measure_pwm(clk, GPIO(1), TIMEOUT, p, h, ok);
+		check(ok, "no green output after a staged commit", errors);
+		check_clocks("green after a write behind the commit: high", h, CLK_FREQ / 128.0 * 0.75, 1.0, errors);
+		measure_pwm(clk, GPIO(2), TIMEOUT, p, h, ok);
+		check(ok, "no blue output after a staged commit", errors);
+		check_clocks("blue after a staged commit: high", h, CLK_FREQ / 128.0 * 0.25, 1.0, errors);
+		wr(COMMIT_REG, x"00000001");
+		loop
+			rd(COMMIT_REG, data);
+			exit when data(0) = '0' or n > TIMEOUT;
+			n := n + 1;
+		end loop;
+		measure_pwm(clk, GPIO(1), TIMEOUT, p, h, ok);
+		check(ok, "no green output after the second commit", errors);
+		check_clocks("green after the second commit: high", h, CLK_FREQ / 128.0 * 0.25, 1.0, errors);
+
+		-- Bus cost of a full colour update: three duty cycles and a commit
+		update := BUS_STATS_INIT;
+		bus_write(clk, avs_write, avs_address, avs_writedata, RED_DC_REG, x"00020000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, GRN_DC_REG, x"00040000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, BLU_DC_REG, x"00060000", update);
+		bus_write(clk, avs_write, avs_address, avs_writedata, COMMIT_REG, x"00000001", update);
+		report "colour update: " & integer'image(update.write_cycles) & " bus cycles, at most "
+			& integer'image(integer(CLK_FREQ) / update.write_cycles) & " updates/s on the bus";
+
+		report_bus("PWM_controller_avalon", stats);
+
+		finish("PWM_Controller_avalon_tb", errors);
+		wait;
+	end process stimulus;
+
+end architecture PWM_Controller_avalon_tb_arch;
@@ -0,0 +1,154 @@
+----------------------------------------------------------------------------
+-- Description:  PWM_Controller testbench - measures the output period and
+--               high time over a sweep of period and duty cycle values, and
+--               checks the ramp and period_start outputs
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.tb_pkg.all;
+
+entity PWM_Controller_tb is
+end entity PWM_Controller_tb;
+
+architecture PWM_Controller_tb_arch of PWM_Controller_tb is
+	-- The controller counts CLK_FREQ * period / 128 clocks per period. A
+	-- 20 us clock keeps that to hundreds of clocks instead of hundreds of
+	-- thousands, so the sweep simulates quickly.
+	constant CLK_PERIOD : time := 20 us;
+	constant CLK_FREQ : real := 50.0e3;
+
+	signal clk : std_logic := '0';
+	signal rst : std_logic := '1';
+	-- 13.7
+	signal period : unsigned(12 downto 0) := to_unsigned(16#04#, 13);
+	-- 22.21
+	signal duty_cycle : unsigned(21 downto 0) := to_unsigned(16#100000#, 22);
+	signal step : unsigned(21 downto 0) := (others => '0');
+	signal output : std_logic;
+	signal period_start : std_logic;
+	signal ramping : std_logic;
+
+	-- Period sweep, in 13.7, and duty cycle sweep, in 22.21
+	type natural_array is array (natural range <>) of natural;
+	constant PERIODS : natural_array := (1, 3, 16, 128);
+	constant DUTIES : natural_array := (16#008000#, 16#080000#, 16#100000#, 16#1FF000#);
+
+	-- Long enough for the longest period in the sweep to finish and two more
+	-- to be measured
+	constant TIMEOUT : natural := 200000;
+
+	component PWM_Controller is
+		generic (
+			CLK_PERIOD		: time := 20 ns;
+			W_DUTY_CYCLE	: integer := 22; -- 22.21;
+			W_PERIOD			: integer := 13  -- 13.7
+		);
+		port (
+			clk			: in	std_logic;
+			rst			: in	std_logic;
+			period		: in	unsigned(W_PERIOD - 1 downto 0);
+			duty_cycle	: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
+			step			: in	unsigned(W_DUTY_CYCLE - 1 DOWNTO 0);
+			output		: out	std_logic := '0';
+			period_start	: out	std_logic;
+			ramping		: out	std_logic
+		);
+	end component PWM_Controller;
+
+begin
+
+	dut : PWM_Controller
+	generic map (
+		CLK_PERIOD => CLK_PERIOD
+	)
+	port map (
+		clk => clk,
+		rst => rst,
+		period => period,
+		duty_cycle => duty_cycle,
+		step => step,
+		output => output,
+		period_start => period_start,
+		ramping => ramping
+	);
+
+	clk <= not clk after CLK_PERIOD / 2;
+
+	stimulus : process
+		variable errors : natural := 0;
+		variable p, h, n : natural;
+		variable ok : boolean;
+		variable ideal_period : real;
+	begin
+		tick(clk, 4);
+		rst <= '0';
+		tick(clk);
+
+		-- Accuracy sweep. The ideal period is CLK_FREQ * period / 128 clocks
+		-- and the ideal high time is that times duty / 2^21; the controller
+		-- truncates both, so each should be within one clock.
+		for i in PERIODS'range loop
+			for j in DUTIES'range loop
+				period <= to_unsigned(PERIODS(i), 13);
+				duty_cycle <= to_unsigned(DUTIES(j), 22);
+				ideal_period := CLK_FREQ * real(PERIODS(i)) / 128.0;
+				measure_pwm(clk, output, TIMEOUT, p, h, ok);
+				check(ok, "no PWM output for period " & integer'image(PERIODS(i))
+					& ", duty " & integer'image(DUTIES(j)), errors);
+				if (ok) then
+					check_clocks("period " & integer'image(PERIODS(i)) & " duty "
+						& integer'image(DUTIES(j)) & ": period", p, ideal_period, 1.0, errors);
+					check_clocks("period " & integer'image(PERIODS(i)) & " duty "
+						& integer'image(DUTIES(j)) & ": high", h,
+						ideal_period * real(DUTIES(j)) / 2.0**21, 1.0, errors);
+				end if;
+			end loop;
+		end loop;
+
+		-- period_start is high for exactly one clock per period
+		period <= to_unsigned(1, 13);
+		duty_cycle <= to_unsigned(16#100000#, 22);
+		measure_pwm(clk, output, TIMEOUT, p, h, ok);
+		n := 0;
+		for i in 1 to p loop
+			wait until rising_edge(clk);
+			if (period_start = '1') then
+				n := n + 1;
+			end if;
+		end loop;
+		check(n = 1, "period_start was high for " & integer'image(n)
+			& " clocks in one period", errors);
+
+		-- Ramp from 25% to 75% in steps of 12.5%: four periods of ramping
+		step <= (others => '0');
+		duty_cycle <= to_unsigned(16#080000#, 22);
+		measure_pwm(clk, output, TIMEOUT, p, h, ok);
+		check(ramping = '0', "ramping with step 0", errors);
+		step <= to_unsigned(16#040000#, 22);
+		duty_cycle <= to_unsigned(16#180000#, 22);
+		wait until rising_edge(clk) and period_start = '1';
+		wait until rising_edge(clk);
+		n := 0;
+		while ramping = '1' and n < 10 loop
+			wait until rising_edge(clk) and period_start = '1';
+			wait until rising_edge(clk);
+			n := n + 1;
+		end loop;
+		check(n = 3, "ramp took " & integer'image(n + 1) & " periods, expected 4", errors);
+		measure_pwm(clk, output, TIMEOUT, p, h, ok);
+		check_clocks("after ramp: high", h, CLK_FREQ / 128.0 * 0.75, 1.0, errors);
+
+		finish("PWM_Controller_tb", errors);
+		wait;
+	end process stimulus;
+
+end architecture PWM_Controller_tb_arch;
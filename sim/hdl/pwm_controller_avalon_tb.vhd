@@ -0,0 +1,166 @@
+----------------------------------------------------------------------------
+-- Description:  pwm_controller_avalon testbench - checks the register file
+--               over the Avalon bus and measures the period and high time of
+--               the pwm_controller outputs over a sweep of register values
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.tb_pkg.all;
+
+entity pwm_controller_avalon_tb is
+end entity pwm_controller_avalon_tb;
+
+architecture pwm_controller_avalon_tb_arch of pwm_controller_avalon_tb is
+	constant CLK_PERIOD : time := 20 ns;
+	-- pwm_controller counts in kHz
+	constant CLK_FREQ_KHZ : real := 50000.0;
+
+	-- Word addresses
+	constant RED_DUTY_CYCLE : natural := 0;
+	constant GREEN_DUTY_CYCLE : natural := 1;
+	constant BLUE_DUTY_CYCLE : natural := 2;
+	constant PERI : natural := 3;
+
+	-- Period sweep in 26.20 milliseconds, and duty cycles in 15.14
+	type natural_array is array (natural range <>) of natural;
+	constant PERIODS : natural_array := (16#008000#, 16#040000#, 16#100000#);
+	constant DUTIES : natural_array := (16#1000#, 16#2000#, 16#3000#);
+
+	constant TIMEOUT : natural := 400000;
+
+	signal clk : std_logic := '0';
+	-- pwm_controller resets on a low rst
+	signal rst : std_logic := '0';
+	signal avs_read : std_logic := '0';
+	signal avs_write : std_logic := '0';
+	signal avs_address : std_logic_vector(1 downto 0) := (others => '0');
+	signal avs_readdata : std_logic_vector(31 downto 0);
+	signal avs_writedata : std_logic_vector(31 downto 0) := (others => '0');
+	signal red_out : std_logic;
+	signal green_out : std_logic;
+	signal blue_out : std_logic;
+	-- Inputs the component has but doesn't use
+	signal unused_period : unsigned(25 downto 0) := (others => '0');
+	signal unused_duty_cycle : unsigned(14 downto 0) := (others => '0');
+
+	component pwd_controller_avalon is
+		port (
+			clk : in std_ulogic;
+			rst : in std_ulogic;
+			avs_read : in std_logic;
+			avs_write : in std_logic;
+			avs_address : in std_logic_vector(1 downto 0);
+			avs_readdata : out std_logic_vector(31 downto 0);
+			avs_writedata : in std_logic_vector(31 downto 0);
+			period : in unsigned(25 downto 0);
+			duty_cycle : in unsigned( 14 downto 0);
+			red_out : out std_logic;
+			green_out : out std_logic;
+			blue_out : out std_logic
+		);
+	end component pwd_controller_avalon;
+
+begin
+
+	dut : pwd_controller_avalon
+	port map (
+		clk => clk,
+		rst => rst,
+		avs_read => avs_read,
+		avs_write => avs_write,
+		avs_address => avs_address,
+		avs_readdata => avs_readdata,
+		avs_writedata => avs_writedata,
+		period => unused_period,
+		duty_cycle => unused_duty_cycle,
+		red_out => red_out,
+		green_out => green_out,
+		blue_out => blue_out
+	);
+
+	clk <= not clk after CLK_PERIOD / 2;
+
+	stimulus : process
+		variable errors : natural := 0;
+		variable stats : bus_stats := BUS_STATS_INIT;
+		variable p, h : natural;
+		variable ok : boolean;
+		variable ideal_period : real;
+
+		procedure wr (addr : natural; value : std_logic_vector(31 downto 0)) is
+		begin
+			bus_write(clk, avs_write, avs_address, avs_writedata, addr, value, stats);
+		end procedure wr;
+
+		procedure expect (addr : natural; value : std_logic_vector(31 downto 0); what : string) is
+			variable got : std_logic_vector(31 downto 0);
+		begin
+			bus_read(clk, avs_read, avs_address, avs_readdata, addr, got, stats);
+			check(got = value, what & ": read 0x" & hex(got) & ", expected 0x" & hex(value), errors);
+		end procedure expect;
+	begin
+		tick(clk, 4);
+		rst <= '1';
+		tick(clk);
+
+		-- Reset values: 25% duty cycles and a 3 ms period
+		expect(RED_DUTY_CYCLE, x"00001000", "red_duty_cycle after reset");
+		expect(GREEN_DUTY_CYCLE, x"00001000", "green_duty_cycle after reset");
+		expect(BLUE_DUTY_CYCLE, x"00001000", "blue_duty_cycle after reset");
+		expect(PERI, x"00300000", "peri after reset");
+
+		for addr in 0 to 3 loop
+			wr(addr, std_logic_vector(to_unsigned(16#1111# * (addr + 1), 32)));
+			expect(addr, std_logic_vector(to_unsigned(16#1111# * (addr + 1), 32)),
+				"register " & integer'image(addr) & " readback");
+		end loop;
+
+		-- The ideal period is CLK_FREQ_KHZ * peri / 2^20 clocks. The
+		-- controller rounds the period down to an even number of clocks and
+		-- adds one, and rounds the high time down to an even number, so the
+		-- period should be within one clock and the high time within two.
+		for i in PERIODS'range loop
+			wr(PERI, std_logic_vector(to_unsigned(PERIODS(i), 32)));
+			ideal_period := CLK_FREQ_KHZ * real(PERIODS(i)) / 2.0**20;
+			for j in DUTIES'range loop
+				wr(RED_DUTY_CYCLE, std_logic_vector(to_unsigned(DUTIES(j), 32)));
+				measure_pwm(clk, red_out, TIMEOUT, p, h, ok);
+				check(ok, "no red output for peri " & integer'image(PERIODS(i))
+					& ", duty " & integer'image(DUTIES(j)), errors);
+				if (ok) then
+					check_clocks("peri " & integer'image(PERIODS(i)) & " duty "
+						& integer'image(DUTIES(j)) & ": period", p, ideal_period, 1.0, errors);
+					check_clocks("peri " & integer'image(PERIODS(i)) & " duty "
+						& integer'image(DUTIES(j)) & ": high", h,
+						ideal_period * real(DUTIES(j)) / 2.0**14, 2.0, errors);
+				end if;
+			end loop;
+		end loop;
+
+		-- Green and blue follow their own registers
+		wr(GREEN_DUTY_CYCLE, x"00001000");
+		wr(BLUE_DUTY_CYCLE, x"00003000");
+		ideal_period := CLK_FREQ_KHZ * real(PERIODS(PERIODS'high)) / 2.0**20;
+		measure_pwm(clk, green_out, TIMEOUT, p, h, ok);
+		check(ok, "no green output", errors);
+		check_clocks("green 25%: high", h, ideal_period * 0.25, 2.0, errors);
+		measure_pwm(clk, blue_out, TIMEOUT, p, h, ok);
+		check(ok, "no blue output", errors);
+		check_clocks("blue 75%: high", h, ideal_period * 0.75, 2.0, errors);
+
+		report_bus("pwm_controller_avalon", stats);
+
+		finish("pwm_controller_avalon_tb", errors);
+		wait;
+	end process stimulus;
+
+end architecture pwm_controller_avalon_tb_arch;
@@ -0,0 +1,263 @@
+----------------------------------------------------------------------------
+-- Description:  Testbench helpers shared by the simulations in sim/hdl: an
+--               Avalon-MM master that counts the clocks each transaction
+--               takes, a PWM edge timer, and pass/fail bookkeeping
+----------------------------------------------------------------------------
+-- Author:       Grant Kirkland
+-- Company:      Montana State University
+-- Create Date:  December 09, 2024
+-- Revision:     1.0
+----------------------------------------------------------------------------
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+package tb_pkg is
+
+	-- The components tell Platform Designer readLatency 0 and readWaitTime 1,
+	-- so a read holds avs_read for one extra clock and the master samples
+	-- avs_readdata at the end of it. Writes have no wait states.
+	constant AVS_READ_WAIT : natural := 1;
+
+	-- Clocks spent on the bus, for the cycles-per-transaction report
+	type bus_stats is record
+		reads : natural;
+		read_cycles : natural;
+		writes : natural;
+		write_cycles : natural;
+	end record bus_stats;
+
+	constant BUS_STATS_INIT : bus_stats := (0, 0, 0, 0);
+
+	-- One rising edge of clk
+	procedure tick (signal clk : in std_ulogic; n : natural := 1);
+
+	-- Avalon-MM write of data to word address addr. Call it just after a
+	-- rising edge; it returns just after the edge that took the write, so
+	-- back-to-back calls make back-to-back transfers.
+	procedure bus_write (
+		signal clk : in std_ulogic;
+		signal avs_write : out std_logic;
+		signal avs_address : out std_logic_vector;
+		signal avs_writedata : out std_logic_vector;
+		addr : natural;
+		data : std_logic_vector(31 downto 0);
+		variable stats : inout bus_stats
+	);
+
+	-- Avalon-MM read of word address addr, with AVS_READ_WAIT wait states
+	procedure bus_read (
+		signal clk : in std_ulogic;
+		signal avs_read : out std_logic;
+		signal avs_address : out std_logic_vector;
+		signal avs_readdata : in std_logic_vector;
+		addr : natural;
+		variable data : out std_logic_vector(31 downto 0);
+		variable stats : inout bus_stats
+	);
+
+	-- Times one whole period of a PWM output, in clocks, from one rising
+	-- edge to the next. The first rising edge after a low is used, so the
+	-- period in progress when this is called is never measured. ok is false
+	-- if the output didn't complete a period within timeout clocks.
+	procedure measure_pwm (
+		signal clk : in std_ulogic;
+		signal pin : in std_logic;
+		timeout : natural;
+		variable period : out natural;
+		variable high : out natural;
+		variable ok : out boolean
+	);
+
+	-- Counts a failed check and reports it
+	procedure check (
+		cond : boolean;
+		msg : string;
+		variable errors : inout natural
+	);
+
+	-- Checks that a measured count of clocks is within tolerance of the
+	-- ideal value, and reports both
+	procedure check_clocks (
+		name : string;
+		measured : natural;
+		ideal : real;
+		tolerance : real;
+		variable errors : inout natural
+	);
+
+	-- Prints the cycles-per-transaction summary
+	procedure report_bus (name : string; stats : bus_stats);
+
+	-- Ends the simulation; fails it if any check did
+	procedure finish (name : string; errors : natural);
+
+	function hex (v : std_logic_vector) return string;
+
+end package tb_pkg;
+
+package body tb_pkg is
+
+	procedure tick (signal clk : in std_ulogic; n : natural := 1) is
+	begin
+		for i in 1 to n loop
+			wait until rising_edge(clk);
+		end loop;
+	end procedure tick;
+
+	procedure bus_write (
+		signal clk : in std_ulogic;
+		signal avs_write : out std_logic;
+		signal avs_address : out std_logic_vector;
+		signal avs_writedata : out std_logic_vector;
+		addr : natural;
+		data : std_logic_vector(31 downto 0);
+		variable stats : inout bus_stats
+	) is
+	begin
+		avs_address <= std_logic_vector(to_unsigned(addr, avs_address'length));
+		avs_writedata <= data;
+		avs_write <= '1';
+		wait until rising_edge(clk);
+		avs_write <= '0';
+		stats.writes := stats.writes + 1;
+		stats.write_cycles := stats.write_cycles + 1;
+	end procedure bus_write;
+
+	procedure bus_read (
+		signal clk : in std_ulogic;
+		signal avs_read : out std_logic;
+		signal avs_address : out std_logic_vector;
+		signal avs_readdata : in std_logic_vector;
+		addr : natural;
+		variable data : out std_logic_vector(31 downto 0);
+		variable stats : inout bus_stats
+	) is
+	begin
+		avs_address <= std_logic_vector(to_unsigned(addr, avs_address'length));
+		avs_read <= '1';
+		for i in 0 to AVS_READ_WAIT loop
+			wait until rising_edge(clk);
+		end loop;
+		avs_read <= '0';
+		data := avs_readdata;
+		stats.reads := stats.reads + 1;
+		stats.read_cycles := stats.read_cycles + 1 + AVS_READ_WAIT;
+	end procedure bus_read;
+
+	procedure measure_pwm (
+		signal clk : in std_ulogic;
+		signal pin : in std_logic;
+		timeout : natural;
+		variable period : out natural;
+		variable high : out natural;
+		variable ok : out boolean
+	) is
+		variable n : natural := 0;
+		variable t_rise, t_fall : natural;
+	begin
+		period := 0;
+		high := 0;
+		ok := false;
+
+		-- Get out of any high time already in progress
+		while pin /= '0' loop
+			wait until rising_edge(clk);
+			n := n + 1;
+			if (n > timeout) then
+				return;
+			end if;
+		end loop;
+		while pin /= '1' loop
+			wait until rising_edge(clk);
+			n := n + 1;
+			if (n > timeout) then
+				return;
+			end if;
+		end loop;
+		t_rise := n;
+		while pin /= '0' loop
+			wait until rising_edge(clk);
+			n := n + 1;
+			if (n > timeout) then
+				return;
+			end if;
+		end loop;
+		t_fall := n;
+		while pin /= '1' loop
+			wait until rising_edge(clk);
+			n := n + 1;
+			if (n > timeout) then
+				return;
+			end if;
+		end loop;
+
+		period := n - t_rise;
+		high := t_fall - t_rise;
+		ok := true;
+	end procedure measure_pwm;
+
+	procedure check (
+		cond : boolean;
+		msg : string;
+		variable errors : inout natural
+	) is
+	begin
+		if (not cond) then
+			report msg severity error;
+			errors := errors + 1;
+		end if;
+	end procedure check;
+
+	procedure check_clocks (
+		name : string;
+		measured : natural;
+		ideal : real;
+		tolerance : real;
+		variable errors : inout natural
+	) is
+		variable err : real := real(measured) - ideal;
+		variable ppm : real := 0.0;
+	begin
+		if (ideal > 0.0) then
+			ppm := err / ideal * 1.0e6;
+		end if;
+		report name & ": " & integer'image(measured) & " clocks, ideal "
+			& real'image(ideal) & ", error " & real'image(err)
+			& " clocks (" & integer'image(integer(ppm)) & " ppm)";
+		check(abs err <= tolerance,
+			name & ": off by more than " & real'image(tolerance) & " clocks", errors);
+	end procedure check_clocks;
+
+	procedure report_bus (name : string; stats : bus_stats) is
+	begin
+		if (stats.writes > 0) then
+			report name & ": " & integer'image(stats.writes) & " writes, "
+				& real'image(real(stats.write_cycles) / real(stats.writes))
+				& " cycles per write";
+		end if;
+		if (stats.reads > 0) then
+			report name & ": " & integer'image(stats.reads) & " reads, "
+				& real'image(real(stats.read_cycles) / real(stats.reads))
+				& " cycles per read";
+		end if;
+	end procedure report_bus;
+
+	procedure finish (name : string; errors : natural) is
+	begin
+		if (errors = 0) then
+			report name & ": PASS";
+			std.env.finish;
+		else
+			report name & ": FAIL, " & integer'image(errors) & " check(s) failed"
+				severity failure;
+		end if;
+	end procedure finish;
+
+	function hex (v : std_logic_vector) return string is
+	begin
+		return to_hstring(v);
+	end function hex;
+
+end package body tb_pkg;
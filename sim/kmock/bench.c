@@ -0,0 +1,600 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * bench - Drive the real drivers against kmock's fake registers and time
+ * each user-facing path: read(), write(), the ioctls, and sysfs.
+ *
+ * Each case calls the driver's file operation or attribute directly, so
+ * the numbers are the driver's own cost with no syscall entry or VFS in
+ * front of it. The bridge reads and writes per operation don't depend on
+ * the host, so they compare directly with what the board does; -l adds
+ * a busy-wait to every register access to estimate the time on the board.
+ *
+ * Usage: bench [-n iterations] [-l bridge_latency_ns] [-t threads] [-v] [case...]
+ */
+#include <getopt.h>
+#include <unistd.h>
+#include "kmock.h"
+#include "../../linux/include/kirkland_regio.h"
+#include "../../linux/adc/de10nano_adc.h"
+
+extern struct platform_driver *const kmock_rgb_driver;
+extern struct platform_driver *const kmock_buzzer_driver;
+extern struct platform_driver *const kmock_adc_driver;
+extern struct platform_driver *const kmock_pwm_driver;
+extern struct platform_driver *const kmock_pwm_bank_driver;
+
+/**
+ * struct bench_ctx - The device a case runs against.
+ * @kdev: The bound device.
+ * @file: Its device node, opened.
+ * @buf: Scratch buffer for sysfs and read().
+ */
+struct bench_ctx {
+	struct kmock_device *kdev;
+	struct file *file;
+	char buf[PAGE_SIZE];
+};
+
+/**
+ * struct bench_case - One timed operation.
+ * @name: Name to select it by on the command line.
+ * @dev: Which device it runs against; an index into devices[].
+ * @op: The operation; @i is the iteration number. Returns < 0 on error.
+ */
+struct bench_case {
+	const char *name;
+	int dev;
+	long (*op)(struct bench_ctx *ctx, unsigned int i);
+};
+
+/**
+ * struct bench_device - A driver and the component it's probed against.
+ * @drv: The driver.
+ * @compatible: Device tree compatible string.
+ * @node: Name of the first instance's device node.
+ * @span: Register window in bytes.
+ * @info: Value preset in the first register, or 0.
+ */
+struct bench_device {
+	struct platform_driver *const *drv;
+	const char *compatible;
+	const char *node;
+	size_t span;
+	u32 info;
+};
+
+enum {
+	DEV_RGB,
+	DEV_BUZZER,
+	DEV_ADC,
+	DEV_PWM,
+	DEV_PWM_BANK,
+	NR_DEVICES,
+};
+
+static const struct bench_device devices[NR_DEVICES] = {
+	[DEV_RGB] = { &kmock_rgb_driver, "Kirkland,kirkland_rgb", "kirkland_rgb", 32 },
+	[DEV_BUZZER] = { &kmock_buzzer_driver, "Kirkland,kirkland_buzzer", "kirkland_buzzer", 16 },
+	[DEV_ADC] = { &kmock_adc_driver, "adsd,de10nano_adc", "adc", 64 },
+	[DEV_PWM] = { &kmock_pwm_driver, "Vincent,pwm", "pwm", 16 },
+	// 16 channels in one period group, the component's default build
+	[DEV_PWM_BANK] = { &kmock_pwm_bank_driver, "Kirkland,kirkland_pwm_bank", "kirkland_pwm_bank", 0x400, 0x0110 },
+};
+
+static long regio(struct bench_ctx *ctx, const struct kirkland_reg_write *writes, u32 nr_writes,
+	const u32 *read_offsets, u32 nr_reads)
+{
+	u32 values[KIRKLAND_REGIO_MAX];
+	struct kirkland_regio io = {
+		.nr_writes = nr_writes,
+		.nr_reads = nr_reads,
+		.writes = (uintptr_t)writes,
+		.read_offsets = (uintptr_t)read_offsets,
+		.read_values = (uintptr_t)values,
+	};
+
+	return kmock_ioctl(ctx->file, KIRKLAND_IOC_REGIO, &io);
+}
+
+/*
+ * kirkland_rgb
+ */
+static long rgb_read_one(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v;
+
+	return kmock_pread(ctx->file, &v, sizeof(v), 4);
+}
+
+static long rgb_read_all(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v[8];
+
+	return kmock_pread(ctx->file, v, sizeof(v), 0);
+}
+
+// The same value every time, so the shadow cache can skip it
+static long rgb_write_same(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v = 0x100000;
+
+	return kmock_pwrite(ctx->file, &v, sizeof(v), 4);
+}
+
+static long rgb_write_new(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v = i & 0x1fffff;
+
+	return kmock_pwrite(ctx->file, &v, sizeof(v), 4);
+}
+
+// Period and all three duty cycles
+static long rgb_write_16(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v[4] = { 0x80, i & 0x1fffff, (i >> 1) & 0x1fffff, (i >> 2) & 0x1fffff };
+
+	return kmock_pwrite(ctx->file, v, sizeof(v), 0);
+}
+
+static long rgb_regio(struct bench_ctx *ctx, unsigned int i)
+{
+	static const u32 reads[] = { 4, 8, 12 };
+	struct kirkland_reg_write writes[] = {
+		{ 4, i & 0x1fffff },
+		{ 8, (i >> 1) & 0x1fffff },
+		{ 12, (i >> 2) & 0x1fffff },
+	};
+
+	return regio(ctx, writes, ARRAY_SIZE(writes), reads, ARRAY_SIZE(reads));
+}
+
+static long rgb_color_show(struct bench_ctx *ctx, unsigned int i)
+{
+	return kmock_sysfs_read(ctx->kdev, "color", ctx->buf);
+}
+
+static long rgb_color_store(struct bench_ctx *ctx, unsigned int i)
+{
+	char val[48];
+
+	snprintf(val, sizeof(val), "%u %u %u\n", i & 0x1fffff, (i >> 1) & 0x1fffff, (i >> 2) & 0x1fffff);
+	return kmock_sysfs_write(ctx->kdev, "color", val);
+}
+
+/*
+ * kirkland_buzzer
+ */
+static long buzzer_read(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v;
+
+	return kmock_pread(ctx->file, &v, sizeof(v), 0);
+}
+
+static long buzzer_write(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v = i & 0xffff;
+
+	return kmock_pwrite(ctx->file, &v, sizeof(v), 0);
+}
+
+static long buzzer_period_show(struct bench_ctx *ctx, unsigned int i)
+{
+	return kmock_sysfs_read(ctx->kdev, "period_reg", ctx->buf);
+}
+
+static long buzzer_period_store(struct bench_ctx *ctx, unsigned int i)
+{
+	char val[16];
+
+	snprintf(val, sizeof(val), "%u\n", i & 0xffff);
+	return kmock_sysfs_write(ctx->kdev, "period_reg", val);
+}
+
+/*
+ * adc
+ */
+static long adc_read_one(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v;
+
+	return kmock_pread(ctx->file, &v, sizeof(v), 4 * (i % ADC_NUM_CHANNELS));
+}
+
+static long adc_read_all(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v[ADC_NUM_CHANNELS];
+
+	return kmock_pread(ctx->file, v, sizeof(v), 0);
+}
+
+static long adc_snapshot(struct bench_ctx *ctx, unsigned int i)
+{
+	struct adc_scan scan;
+
+	return kmock_ioctl(ctx->file, ADC_IOC_SNAPSHOT, &scan);
+}
+
+static long adc_ch0_show(struct bench_ctx *ctx, unsigned int i)
+{
+	return kmock_sysfs_read(ctx->kdev, "ch0_raw", ctx->buf);
+}
+
+/*
+ * pwm
+ */
+static long pwm_read_all(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v[4];
+
+	return kmock_pread(ctx->file, v, sizeof(v), 0);
+}
+
+static long pwm_write_one(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v = i & 0xfff;
+
+	return kmock_pwrite(ctx->file, &v, sizeof(v), 0);
+}
+
+static long pwm_regio(struct bench_ctx *ctx, unsigned int i)
+{
+	static const u32 reads[] = { 0, 4, 8 };
+	struct kirkland_reg_write writes[] = {
+		{ 0, i & 0xfff },
+		{ 4, (i >> 1) & 0xfff },
+		{ 8, (i >> 2) & 0xfff },
+	};
+
+	return regio(ctx, writes, ARRAY_SIZE(writes), reads, ARRAY_SIZE(reads));
+}
+
+static long pwm_red_store(struct bench_ctx *ctx, unsigned int i)
+{
+	char val[16];
+
+	snprintf(val, sizeof(val), "%u\n", i & 0xfff);
+	return kmock_sysfs_write(ctx->kdev, "red_out", val);
+}
+
+/*
+ * kirkland_pwm_bank
+ */
+static long bank_write_duty(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v[16];
+	unsigned int ch;
+
+	for (ch = 0; ch < ARRAY_SIZE(v); ch++) {
+		v[ch] = (i + ch) & 0x1fffff;
+	}
+	return kmock_pwrite(ctx->file, v, sizeof(v), 0x200);
+}
+
+// Only channel 0 changes, so the other 15 writes are skipped
+static long bank_write_one_new(struct bench_ctx *ctx, unsigned int i)
+{
+	u32 v[16] = { i & 0x1fffff };
+
+	return kmock_pwrite(ctx->file, v, sizeof(v), 0x200);
+}
+
+static long bank_duty_store(struct bench_ctx *ctx, unsigned int i)
+{
+	char val[256];
+	size_t len = 0;
+	unsigned int ch;
+
+	for (ch = 0; ch < 16; ch++) {
+		len += snprintf(val + len, sizeof(val) - len, "%u ", (i + ch) & 0x1fffff);
+	}
+	val[len - 1] = '\n';
+	return kmock_sysfs_write(ctx->kdev, "duty_cycle", val);
+}
+
+static long bank_duty_show(struct bench_ctx *ctx, unsigned int i)
+{
+	return kmock_sysfs_read(ctx->kdev, "duty_cycle", ctx->buf);
+}
+
+static long bank_regio(struct bench_ctx *ctx, unsigned int i)
+{
+	static const u32 reads[] = { 0x008 };
+	struct kirkland_reg_write writes[] = {
+		{ 0x200 + 4 * (i % 16), i & 0x1fffff },
+		{ 0x300 + 4 * (i % 16), 0x1000 },
+	};
+
+	return regio(ctx, writes, ARRAY_SIZE(writes), reads, ARRAY_SIZE(reads));
+}
+
+static const struct bench_case cases[] = {
+	{ "rgb_read_one", DEV_RGB, rgb_read_one },
+	{ "rgb_read_all", DEV_RGB, rgb_read_all },
+	{ "rgb_write_same", DEV_RGB, rgb_write_same },
+	{ "rgb_write_new", DEV_RGB, rgb_write_new },
+	{ "rgb_write_16", DEV_RGB, rgb_write_16 },
+	{ "rgb_regio", DEV_RGB, rgb_regio },
+	{ "rgb_color_show", DEV_RGB, rgb_color_show },
+	{ "rgb_color_store", DEV_RGB, rgb_color_store },
+	{ "buzzer_read", DEV_BUZZER, buzzer_read },
+	{ "buzzer_write", DEV_BUZZER, buzzer_write },
+	{ "buzzer_period_show", DEV_BUZZER, buzzer_period_show },
+	{ "buzzer_period_store", DEV_BUZZER, buzzer_period_store },
+	{ "adc_read_one", DEV_ADC, adc_read_one },
+	{ "adc_read_all", DEV_ADC, adc_read_all },
+	{ "adc_snapshot", DEV_ADC, adc_snapshot },
+	{ "adc_ch0_show", DEV_ADC, adc_ch0_show },
+	{ "pwm_read_all", DEV_PWM, pwm_read_all },
+	{ "pwm_write_one", DEV_PWM, pwm_write_one },
+	{ "pwm_regio", DEV_PWM, pwm_regio },
+	{ "pwm_red_store", DEV_PWM, pwm_red_store },
+	{ "bank_write_duty", DEV_PWM_BANK, bank_write_duty },
+	{ "bank_write_one_new", DEV_PWM_BANK, bank_write_one_new },
+	{ "bank_duty_store", DEV_PWM_BANK, bank_duty_store },
+	{ "bank_duty_show", DEV_PWM_BANK, bank_duty_show },
+	{ "bank_regio", DEV_PWM_BANK, bank_regio },
+};
+
+static unsigned int iterations = 100000;
+
+static int cmp_s64(const void *a, const void *b)
+{
+	s64 x = *(const s64 *)a, y = *(const s64 *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * run_case() - Time one case and print a line of results.
+ * @c: The case.
+ * @ctx: Its device.
+ * @samples: Room for @iterations latencies.
+ *
+ * Return: 0, or the first error the operation returned.
+ */
+static int run_case(const struct bench_case *c, struct bench_ctx *ctx, s64 *samples)
+{
+	struct kmock_bridge_stats before;
+	ktime_t start, t0, t1;
+	unsigned int i;
+	long ret;
+	s64 total;
+
+	// Warm up, and check the path works at all
+	for (i = 0; i < 1000; i++) {
+		ret = c->op(ctx, i);
+		if (ret < 0) {
+			fprintf(stderr, "%s: error %ld\n", c->name, ret);
+			return ret;
+		}
+	}
+
+	before = kmock_bridge;
+	start = ktime_get();
+	for (i = 0; i < iterations; i++) {
+		t0 = ktime_get();
+		c->op(ctx, i);
+		t1 = ktime_get();
+		samples[i] = t1 - t0;
+	}
+	total = ktime_get() - start;
+
+	qsort(samples, iterations, sizeof(*samples), cmp_s64);
+	printf("%-20s %12.0f %9.1f %8lld %8lld %8.2f %8.2f\n", c->name,
+		(double)iterations * NSEC_PER_SEC / total,
+		(double)total / iterations,
+		samples[iterations / 2], samples[iterations * 99 / 100],
+		(double)(kmock_bridge.reads - before.reads) / iterations,
+		(double)(kmock_bridge.writes - before.writes) / iterations);
+	return 0;
+}
+
+/**
+ * struct bench_thread - One thread of the multi-instance run.
+ * @ctx: Its own kirkland_rgb instance.
+ * @ops: Operations it completed.
+ * @thread: The thread.
+ */
+struct bench_thread {
+	struct bench_ctx ctx;
+	unsigned long long ops;
+	pthread_t thread;
+};
+
+static void *bench_thread_fn(void *arg)
+{
+	struct bench_thread *t = arg;
+	unsigned int i;
+
+	for (i = 0; i < iterations; i++) {
+		rgb_write_16(&t->ctx, i);
+	}
+	t->ops = iterations;
+	return NULL;
+}
+
+static int open_instance(int dev, unsigned int instance, struct bench_ctx *ctx)
+{
+	const struct bench_device *d = &devices[dev];
+	char node[64];
+	u32 *regs;
+	int ret;
+
+	regs = calloc(1, d->span);
+	if (!regs) {
+		return -ENOMEM;
+	}
+	regs[0] = d->info;
+	ret = kmock_probe(*d->drv, d->compatible, regs, d->span, &ctx->kdev);
+	free(regs);
+	if (ret) {
+		fprintf(stderr, "%s: probe failed: %d\n", d->compatible, ret);
+		return ret;
+	}
+	if (instance) {
+		snprintf(node, sizeof(node), "%s%u", d->node, instance);
+	} else {
+		snprintf(node, sizeof(node), "%s", d->node);
+	}
+	ctx->file = kmock_open(node);
+	if (!ctx->file) {
+		fprintf(stderr, "%s: no /dev/%s\n", d->compatible, node);
+		kmock_remove(ctx->kdev);
+		return -ENODEV;
+	}
+	return 0;
+}
+
+static void close_instance(struct bench_ctx *ctx)
+{
+	kmock_close(ctx->file);
+	kmock_remove(ctx->kdev);
+}
+
+/**
+ * run_threads() - Write to @nr separate kirkland_rgb instances at once.
+ * @nr: Number of threads, one instance each.
+ *
+ * Each instance has its own lock, so this shows whether anything shared
+ * between instances, like the ID allocation, serializes them.
+ *
+ * Return: 0, or a negative error value.
+ */
+static int run_threads(unsigned int nr)
+{
+	struct bench_thread *threads = calloc(nr, sizeof(*threads));
+	unsigned long long ops = 0;
+	ktime_t start, total;
+	unsigned int i, ready;
+	int ret = 0;
+
+	if (!threads) {
+		return -ENOMEM;
+	}
+	for (ready = 0; ready < nr; ready++) {
+		ret = open_instance(DEV_RGB, ready, &threads[ready].ctx);
+		if (ret) {
+			goto out;
+		}
+	}
+
+	start = ktime_get();
+	for (i = 0; i < nr; i++) {
+		pthread_create(&threads[i].thread, NULL, bench_thread_fn, &threads[i]);
+	}
+	for (i = 0; i < nr; i++) {
+		pthread_join(threads[i].thread, NULL);
+		ops += threads[i].ops;
+	}
+	total = ktime_get() - start;
+
+	printf("\nrgb_write_16 on %u instances in parallel: %.0f ops/s total, %.0f ops/s per thread\n",
+		nr, (double)ops * NSEC_PER_SEC / total, (double)ops * NSEC_PER_SEC / total / nr);
+
+out:
+	while (ready--) {
+		close_instance(&threads[ready].ctx);
+	}
+	free(threads);
+	return ret;
+}
+
+static bool selected(const char *name, int argc, char **argv)
+{
+	int i;
+
+	if (argc == 0) {
+		return true;
+	}
+	for (i = 0; i < argc; i++) {
+		if (strstr(name, argv[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-n iterations] [-l bridge_latency_ns] [-t threads] [-v] [case...]\n", prog);
+	fprintf(stderr, "A case argument selects every case whose name contains it.\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_ctx *ctx[NR_DEVICES] = { NULL };
+	unsigned int threads = 0;
+	const struct bench_case *c;
+	s64 *samples;
+	int opt, dev, ret = 0;
+
+	while ((opt = getopt(argc, argv, "n:l:t:vh")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			kmock_bridge_latency_ns = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			kmock_verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (iterations < 100) {
+		iterations = 100;
+	}
+
+	samples = malloc(iterations * sizeof(*samples));
+	if (!samples) {
+		return 1;
+	}
+
+	printf("%u iterations, %u ns per bridge access\n\n", iterations, kmock_bridge_latency_ns);
+	printf("%-20s %12s %9s %8s %8s %8s %8s\n", "case", "ops/s", "ns/op", "p50 ns", "p99 ns", "rd/op", "wr/op");
+
+	for (c = cases; c < cases + ARRAY_SIZE(cases); c++) {
+		if (!selected(c->name, argc - optind, argv + optind)) {
+			continue;
+		}
+		if (!ctx[c->dev]) {
+			ctx[c->dev] = calloc(1, sizeof(*ctx[c->dev]));
+			if (!ctx[c->dev]) {
+				ret = -ENOMEM;
+				break;
+			}
+			ret = open_instance(c->dev, 0, ctx[c->dev]);
+			if (ret) {
+				free(ctx[c->dev]);
+				ctx[c->dev] = NULL;
+				break;
+			}
+		}
+		ret = run_case(c, ctx[c->dev], samples);
+		if (ret) {
+			break;
+		}
+	}
+
+	for (dev = 0; dev < NR_DEVICES; dev++) {
+		if (ctx[dev]) {
+			close_instance(ctx[dev]);
+			free(ctx[dev]);
+		}
+	}
+
+	if (!ret && threads) {
+		ret = run_threads(threads);
+	}
+
+	kmock_run_deferred();
+	free(samples);
+	return ret ? 1 : 0;
+}
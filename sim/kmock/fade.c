@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * fade - Check that a hardware fade lands on its keyframe's colour by the
+ * end of the keyframe.
+ *
+ * Each case starts a sequence on kirkland_rgb whose first keyframe is a
+ * fade, lets the sequencer write it, and feeds the duty cycles and ramp
+ * steps the driver wrote into the PWM_Controller cycle model from
+ * ../model. The write is taken to land just after a period start, the
+ * worst case for the commit, and the model is clocked until every channel
+ * stops ramping. That has to happen before the keyframe ends, and not so
+ * early that the fade was really a jump.
+ *
+ * Usage: fade
+ */
+#include "kmock.h"
+#include "../model/model.h"
+#include "../../linux/drivers/kirkland-rgb/kirkland-rgb.h"
+
+extern struct platform_driver *const kmock_rgb_driver;
+
+// Register offsets in words
+#define PERIOD_REG 0
+#define RED_DC_REG 1
+#define COMMIT_REG 4
+#define RED_STEP_REG 5
+#define RGB_SPAN 32
+
+// The ramp takes the same time at any clock, so clock the model slowly
+// enough that a multi-second fade is a few million edges
+#define MODEL_CLK_HZ 1000000
+
+/**
+ * struct fade_case - One fade to check.
+ * @name: What it's called in the output.
+ * @period: Period register, in 1/128 s.
+ * @duration_ms: Length of the fade keyframe.
+ * @from: Colour showing before the sequence starts.
+ * @to: The fade keyframe's colour.
+ */
+struct fade_case {
+	const char *name;
+	u32 period;
+	u32 duration_ms;
+	u32 from[3];
+	u32 to[3];
+};
+
+static const struct fade_case cases[] = {
+	{ "period 1, 500 ms", 0x01, 500, { 0x000000, 0x200000, 0x080000 }, { 0x200000, 0x000000, 0x180000 } },
+	{ "period 0x80, 4.5 s", 0x80, 4500, { 0x000000, 0x200000, 0x080000 }, { 0x200000, 0x000000, 0x180000 } },
+};
+
+static const struct pwm_params params = {
+	.clk_hz = MODEL_CLK_HZ,
+	.period_width = 13,
+	.period_frac = 7,
+	.duty_width = 22,
+	.duty_frac = 21,
+};
+
+/**
+ * ramp_ns() - Time from a register write until the ramps finish.
+ * @period: Period register.
+ * @from: Duty cycles committed before the write.
+ * @to: Duty cycles written.
+ * @step: Ramp steps written.
+ * @limit: Give up after this many nanoseconds.
+ *
+ * The controller is already running at @from with no ramp. The write's
+ * commit is set on the edge after a period start, so it waits a whole
+ * period to be latched.
+ *
+ * Return: Nanoseconds until no channel is ramping, or @limit if they're
+ * still ramping then.
+ */
+static s64 ramp_ns(u32 period, const u32 from[3], const u32 to[3], const u32 step[3], s64 limit)
+{
+	struct pwm_model m[3];
+	u32 duty[3], in_step[3] = { 0 };
+	bool latched = false, ramping = true;
+	u64 clocks = 0;
+	u64 max_clocks = limit * MODEL_CLK_HZ / NSEC_PER_SEC;
+	bool latch;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		pwm_model_reset(&m[i], &params, period, from[i], false);
+		duty[i] = from[i];
+	}
+
+	// Line up on a period start, then commit on the edge after it
+	while (!pwm_model_period_start(&m[0])) {
+		for (i = 0; i < 3; i++) {
+			pwm_model_clock(&m[i], period, duty[i], in_step[i], false);
+		}
+	}
+	for (i = 0; i < 3; i++) {
+		pwm_model_clock(&m[i], period, duty[i], in_step[i], false);
+	}
+
+	while ((!latched || ramping) && clocks < max_clocks) {
+		// The wrapper copies the staged set on a period start edge
+		latch = !latched && pwm_model_period_start(&m[0]);
+		ramping = false;
+		for (i = 0; i < 3; i++) {
+			pwm_model_clock(&m[i], period, duty[i], in_step[i], false);
+			ramping |= pwm_model_ramping(&m[i], to[i]);
+		}
+		clocks++;
+		if (latch) {
+			memcpy(duty, to, sizeof(duty));
+			memcpy(in_step, step, sizeof(in_step));
+			latched = true;
+		}
+	}
+
+	return clocks * NSEC_PER_SEC / MODEL_CLK_HZ;
+}
+
+/**
+ * check_fade() - Play one case and check where the ramp lands.
+ * @kdev: The bound rgb controller.
+ * @file: Its device node.
+ * @c: The case.
+ *
+ * Return: 0 if the fade lands in time, 1 if not.
+ */
+static int check_fade(struct kmock_device *kdev, struct file *file, const struct fade_case *c)
+{
+	struct kirkland_rgb_keyframe frames[2] = {
+		{ c->to[0], c->to[1], c->to[2], c->duration_ms, KIRKLAND_RGB_KF_FADE },
+		// Hold the colour afterwards, so the sequence isn't over
+		{ c->to[0], c->to[1], c->to[2], 1000, 0 },
+	};
+	struct kirkland_rgb_sequence seq = {
+		.nr_frames = ARRAY_SIZE(frames),
+		.loop_count = 0,
+		.frames = (uintptr_t)frames,
+	};
+	u32 regs[4] = { c->period, c->from[0], c->from[1], c->from[2] };
+	u32 commit = 1;
+	s64 left, took;
+	ktime_t start;
+	long ret;
+
+	kmock_ioctl(file, KIRKLAND_RGB_IOC_SEQ_STOP, NULL);
+	if (kmock_pwrite(file, regs, sizeof(regs), 0) != sizeof(regs) ||
+	    kmock_pwrite(file, &commit, sizeof(commit), COMMIT_REG * 4) != sizeof(commit)) {
+		printf("%s: FAIL: couldn't set up the start colour\n", c->name);
+		return 1;
+	}
+
+	// The keyframe starts after start, and the driver has written the
+	// ramp before we read the clock again, so at least left is left of it
+	start = ktime_get();
+	ret = kmock_ioctl(file, KIRKLAND_RGB_IOC_SEQ_START, &seq);
+	if (ret) {
+		printf("%s: FAIL: KIRKLAND_RGB_IOC_SEQ_START returned %ld\n", c->name, ret);
+		return 1;
+	}
+	kmock_run_deferred();
+	left = (s64)c->duration_ms * NSEC_PER_MSEC - ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (memcmp(&kdev->regs[RED_DC_REG], c->to, sizeof(c->to))) {
+		printf("%s: FAIL: duty cycles 0x%x 0x%x 0x%x, expected the keyframe's 0x%x 0x%x 0x%x\n",
+		       c->name, kdev->regs[RED_DC_REG], kdev->regs[RED_DC_REG + 1], kdev->regs[RED_DC_REG + 2],
+		       c->to[0], c->to[1], c->to[2]);
+		return 1;
+	}
+
+	took = ramp_ns(c->period, c->from, c->to, &kdev->regs[RED_STEP_REG],
+		       2 * (s64)c->duration_ms * NSEC_PER_MSEC);
+	printf("%s: steps 0x%x 0x%x 0x%x, ramp done after %lld.%03lld ms with %lld.%03lld ms of the keyframe left\n",
+	       c->name, kdev->regs[RED_STEP_REG], kdev->regs[RED_STEP_REG + 1], kdev->regs[RED_STEP_REG + 2],
+	       took / NSEC_PER_MSEC, took % NSEC_PER_MSEC / 1000, left / NSEC_PER_MSEC, left % NSEC_PER_MSEC / 1000);
+
+	if (took > left) {
+		printf("%s: FAIL: the ramp ends after the keyframe\n", c->name);
+		return 1;
+	}
+	if (took < (s64)c->duration_ms * NSEC_PER_MSEC / 2) {
+		printf("%s: FAIL: the ramp is over in less than half the keyframe\n", c->name);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(void)
+{
+	const u32 regs[RGB_SPAN / 4] = { 0 };
+	struct kmock_device *kdev;
+	struct file *file;
+	int errors = 0;
+	size_t i;
+
+	if (kmock_probe(kmock_rgb_driver, "Kirkland,kirkland_rgb", regs, RGB_SPAN, &kdev)) {
+		fprintf(stderr, "kirkland_rgb: probe failed\n");
+		return 1;
+	}
+	file = kmock_open("kirkland_rgb");
+	if (!file) {
+		fprintf(stderr, "kirkland_rgb: no /dev/kirkland_rgb\n");
+		kmock_remove(kdev);
+		return 1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		errors += check_fade(kdev, file, &cases[i]);
+	}
+
+	kmock_ioctl(file, KIRKLAND_RGB_IOC_SEQ_STOP, NULL);
+	kmock_close(file);
+	kmock_remove(kdev);
+
+	printf("%zu fades, %d failed\n", ARRAY_SIZE(cases), errors);
+	return errors != 0;
+}
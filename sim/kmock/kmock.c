@@ -0,0 +1,836 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * kmock - Host implementations of the kernel calls in kmock.h, plus the
+ * harness side: probing a driver against a register buffer, opening its
+ * device node, and reading and writing its sysfs attributes.
+ */
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <ctype.h>
+#include "kmock.h"
+
+int kmock_verbose;
+unsigned int kmock_bridge_latency_ns;
+__thread struct kmock_bridge_stats kmock_bridge;
+
+void kmock_bridge_wait(void)
+{
+	struct timespec ts;
+	long long end;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	end = (long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec + kmock_bridge_latency_ns;
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+	} while ((long long)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec < end);
+}
+
+/*
+ * Strings
+ */
+static int kmock_vscnprintf(char *buf, size_t size, const char *fmt, va_list args)
+{
+	int n;
+
+	if (size == 0) {
+		return 0;
+	}
+	n = vsnprintf(buf, size, fmt, args);
+	if (n < 0) {
+		return 0;
+	}
+	return (size_t)n >= size ? (int)size - 1 : n;
+}
+
+int scnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, fmt);
+	n = kmock_vscnprintf(buf, size, fmt, args);
+	va_end(args);
+	return n;
+}
+
+int sysfs_emit(char *buf, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, fmt);
+	n = kmock_vscnprintf(buf, PAGE_SIZE, fmt, args);
+	va_end(args);
+	return n;
+}
+
+char *skip_spaces(const char *str)
+{
+	while (isspace((unsigned char)*str)) {
+		str++;
+	}
+	return (char *)str;
+}
+
+char *strim(char *s)
+{
+	size_t len = strlen(s);
+
+	while (len && isspace((unsigned char)s[len - 1])) {
+		s[--len] = '\0';
+	}
+	return skip_spaces(s);
+}
+
+bool sysfs_streq(const char *s1, const char *s2)
+{
+	while (*s1 && *s1 == *s2) {
+		s1++;
+		s2++;
+	}
+	if (*s1 == *s2) {
+		return true;
+	}
+	if (!*s1 && *s2 == '\n' && !s2[1]) {
+		return true;
+	}
+	if (*s1 == '\n' && !s1[1] && !*s2) {
+		return true;
+	}
+	return false;
+}
+
+int match_string(const char * const *array, size_t n, const char *string)
+{
+	size_t i;
+
+	for (i = 0; i < n && array[i]; i++) {
+		if (!strcmp(array[i], string)) {
+			return i;
+		}
+	}
+	return -EINVAL;
+}
+
+int __sysfs_match_string(const char * const *array, size_t n, const char *str)
+{
+	size_t i;
+
+	for (i = 0; i < n && array[i]; i++) {
+		if (sysfs_streq(array[i], str)) {
+			return i;
+		}
+	}
+	return -EINVAL;
+}
+
+/*
+ * kstrto*() take an optional trailing newline and nothing else, like the
+ * kernel's.
+ */
+static int kmock_kstrtoull(const char *s, unsigned int base, unsigned long long *res)
+{
+	char *end;
+
+	if (*s == '-' || isspace((unsigned char)*s) || !*s) {
+		return -EINVAL;
+	}
+	if (*s == '+') {
+		s++;
+	}
+	errno = 0;
+	*res = strtoull(s, &end, base);
+	if (errno == ERANGE) {
+		return -ERANGE;
+	}
+	if (end == s) {
+		return -EINVAL;
+	}
+	if (*end == '\n') {
+		end++;
+	}
+	return *end ? -EINVAL : 0;
+}
+
+int kstrtoul(const char *s, unsigned int base, unsigned long *res)
+{
+	unsigned long long v;
+	int ret = kmock_kstrtoull(s, base, &v);
+
+	if (ret) {
+		return ret;
+	}
+	if (v > ULONG_MAX) {
+		return -ERANGE;
+	}
+	*res = v;
+	return 0;
+}
+
+#define KMOCK_KSTRTOU(name, type, limit) \
+int name(const char *s, unsigned int base, type *res) \
+{ \
+	unsigned long long v; \
+	int ret = kmock_kstrtoull(s, base, &v); \
+	if (ret) { \
+		return ret; \
+	} \
+	if (v > (limit)) { \
+		return -ERANGE; \
+	} \
+	*res = v; \
+	return 0; \
+}
+KMOCK_KSTRTOU(kstrtouint, unsigned int, 0xffffffffULL)
+KMOCK_KSTRTOU(kstrtou32, u32, 0xffffffffULL)
+KMOCK_KSTRTOU(kstrtou16, u16, 0xffffULL)
+KMOCK_KSTRTOU(kstrtou8, u8, 0xffULL)
+
+int kstrtoint(const char *s, unsigned int base, int *res)
+{
+	unsigned long long v;
+	bool neg = *s == '-';
+	int ret = kmock_kstrtoull(neg ? s + 1 : s, base, &v);
+
+	if (ret) {
+		return ret;
+	}
+	if (v > (neg ? 0x80000000ULL : 0x7fffffffULL)) {
+		return -ERANGE;
+	}
+	*res = neg ? -(long long)v : (long long)v;
+	return 0;
+}
+
+int kstrtobool(const char *s, bool *res)
+{
+	switch (s[0]) {
+	case 'y': case 'Y': case 't': case 'T': case '1':
+		*res = true;
+		return 0;
+	case 'n': case 'N': case 'f': case 'F': case '0':
+		*res = false;
+		return 0;
+	case 'o': case 'O':
+		if (s[1] == 'n' || s[1] == 'N') {
+			*res = true;
+			return 0;
+		}
+		if (s[1] == 'f' || s[1] == 'F') {
+			*res = false;
+			return 0;
+		}
+		break;
+	}
+	return -EINVAL;
+}
+
+void sort(void *base, size_t num, size_t size,
+	int (*cmp)(const void *, const void *), void (*swap_func)(void *, void *, int))
+{
+	(void)swap_func;
+	qsort(base, num, size, cmp);
+}
+
+/*
+ * Managed resources. Each device keeps a stack of actions that
+ * kmock_remove() (or a failed probe) unwinds, newest first.
+ */
+struct kmock_devres {
+	void (*action)(void *);
+	void *data;
+	struct kmock_devres *next;
+};
+
+static int kmock_devres_add(struct device *dev, void (*action)(void *), void *data)
+{
+	struct kmock_devres *dr = malloc(sizeof(*dr));
+
+	if (!dr) {
+		return -ENOMEM;
+	}
+	dr->action = action;
+	dr->data = data;
+	dr->next = dev->devres;
+	dev->devres = dr;
+	return 0;
+}
+
+static void kmock_devres_release_all(struct device *dev)
+{
+	struct kmock_devres *dr;
+
+	while ((dr = dev->devres)) {
+		dev->devres = dr->next;
+		dr->action(dr->data);
+		free(dr);
+	}
+}
+
+static void *kmock_devm_track(struct device *dev, void *p)
+{
+	if (p && kmock_devres_add(dev, free, p)) {
+		free(p);
+		return NULL;
+	}
+	return p;
+}
+
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp)
+{
+	(void)gfp;
+	return kmock_devm_track(dev, calloc(1, size));
+}
+
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t gfp)
+{
+	(void)gfp;
+	return kmock_devm_track(dev, calloc(n, size));
+}
+
+char *devm_kasprintf(struct device *dev, gfp_t gfp, const char *fmt, ...)
+{
+	va_list args;
+	char *p;
+
+	(void)gfp;
+	va_start(args, fmt);
+	if (vasprintf(&p, fmt, args) < 0) {
+		p = NULL;
+	}
+	va_end(args);
+	return kmock_devm_track(dev, p);
+}
+
+int devm_add_action_or_reset(struct device *dev, void (*action)(void *), void *data)
+{
+	int ret = kmock_devres_add(dev, action, data);
+
+	if (ret) {
+		action(data);
+	}
+	return ret;
+}
+
+struct iio_dev *devm_iio_device_alloc(struct device *dev, int sizeof_priv)
+{
+	struct iio_dev *indio_dev = devm_kzalloc(dev, sizeof(*indio_dev) + sizeof_priv, GFP_KERNEL);
+
+	if (indio_dev) {
+		indio_dev->priv = indio_dev + 1;
+	}
+	return indio_dev;
+}
+
+void *vmalloc_user(unsigned long size)
+{
+	void *p;
+
+	if (posix_memalign(&p, PAGE_SIZE, size)) {
+		return NULL;
+	}
+	memset(p, 0, size);
+	return p;
+}
+
+void vfree(const void *p)
+{
+	free((void *)p);
+}
+
+/*
+ * IDs
+ */
+int ida_alloc(struct ida *ida, gfp_t gfp)
+{
+	int id;
+
+	(void)gfp;
+	pthread_mutex_lock(&ida->lock);
+	for (id = 0; id < 64; id++) {
+		if (!(ida->used & (1ULL << id))) {
+			ida->used |= 1ULL << id;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&ida->lock);
+	return id < 64 ? id : -ENOSPC;
+}
+
+void ida_free(struct ida *ida, unsigned int id)
+{
+	pthread_mutex_lock(&ida->lock);
+	ida->used &= ~(1ULL << id);
+	pthread_mutex_unlock(&ida->lock);
+}
+
+/*
+ * Timers and work. Nothing runs in the background; kmock_run_deferred()
+ * is the only place callbacks fire.
+ */
+static pthread_mutex_t kmock_deferred_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct hrtimer *kmock_timers;
+static struct work_struct *kmock_work;
+
+void hrtimer_init(struct hrtimer *timer, clockid_t clock, enum hrtimer_mode mode)
+{
+	(void)clock;
+	(void)mode;
+	memset(timer, 0, sizeof(*timer));
+}
+
+void hrtimer_start(struct hrtimer *timer, ktime_t t, enum hrtimer_mode mode)
+{
+	timer->expires = mode == HRTIMER_MODE_ABS ? t : ktime_get() + t;
+	pthread_mutex_lock(&kmock_deferred_lock);
+	timer->active = true;
+	if (!timer->listed) {
+		timer->listed = true;
+		timer->next = kmock_timers;
+		kmock_timers = timer;
+	}
+	pthread_mutex_unlock(&kmock_deferred_lock);
+}
+
+int hrtimer_try_to_cancel(struct hrtimer *timer)
+{
+	struct hrtimer **p;
+	bool was_active;
+
+	pthread_mutex_lock(&kmock_deferred_lock);
+	was_active = timer->active;
+	timer->active = false;
+	for (p = &kmock_timers; *p; p = &(*p)->next) {
+		if (*p == timer) {
+			*p = timer->next;
+			break;
+		}
+	}
+	timer->listed = false;
+	pthread_mutex_unlock(&kmock_deferred_lock);
+	return was_active;
+}
+
+int hrtimer_cancel(struct hrtimer *timer)
+{
+	return hrtimer_try_to_cancel(timer);
+}
+
+u64 hrtimer_forward_now(struct hrtimer *timer, ktime_t interval)
+{
+	ktime_t now = ktime_get();
+	u64 overruns = 0;
+
+	if (interval <= 0 || timer->expires > now) {
+		return 0;
+	}
+	overruns = (now - timer->expires) / interval + 1;
+	timer->expires += overruns * interval;
+	return overruns;
+}
+
+bool schedule_work(struct work_struct *work)
+{
+	bool queued = false;
+
+	pthread_mutex_lock(&kmock_deferred_lock);
+	if (!work->pending) {
+		work->pending = true;
+		work->next = kmock_work;
+		kmock_work = work;
+		queued = true;
+	}
+	pthread_mutex_unlock(&kmock_deferred_lock);
+	return queued;
+}
+
+bool cancel_work_sync(struct work_struct *work)
+{
+	struct work_struct **p;
+	bool was_pending;
+
+	pthread_mutex_lock(&kmock_deferred_lock);
+	was_pending = work->pending;
+	for (p = &kmock_work; *p; p = &(*p)->next) {
+		if (*p == work) {
+			*p = work->next;
+			break;
+		}
+	}
+	work->pending = false;
+	pthread_mutex_unlock(&kmock_deferred_lock);
+	return was_pending;
+}
+
+/**
+ * kmock_run_deferred() - Fire every active timer once, then run queued work.
+ *
+ * A timer whose callback returns HRTIMER_RESTART stays active for the next
+ * call. Callbacks run on the caller's thread.
+ */
+void kmock_run_deferred(void)
+{
+	struct hrtimer *timers, *timer, *next;
+	struct work_struct *work;
+
+	pthread_mutex_lock(&kmock_deferred_lock);
+	timers = kmock_timers;
+	kmock_timers = NULL;
+	for (timer = timers; timer; timer = timer->next) {
+		timer->listed = false;
+	}
+	pthread_mutex_unlock(&kmock_deferred_lock);
+
+	for (timer = timers; timer; timer = next) {
+		next = timer->next;
+		if (!timer->active) {
+			continue;
+		}
+		timer->active = false;
+		if (timer->function(timer) == HRTIMER_RESTART) {
+			hrtimer_start(timer, timer->expires, HRTIMER_MODE_ABS);
+		}
+	}
+
+	for (;;) {
+		pthread_mutex_lock(&kmock_deferred_lock);
+		work = kmock_work;
+		if (work) {
+			kmock_work = work->next;
+			work->pending = false;
+		}
+		pthread_mutex_unlock(&kmock_deferred_lock);
+		if (!work) {
+			break;
+		}
+		work->func(work);
+	}
+}
+
+/*
+ * Notifiers
+ */
+int atomic_notifier_chain_register(struct atomic_notifier_head *nh, struct notifier_block *nb)
+{
+	struct notifier_block **p;
+
+	spin_lock(&nh->lock);
+	for (p = &nh->head; *p && (*p)->priority >= nb->priority; p = &(*p)->next) {
+	}
+	nb->next = *p;
+	*p = nb;
+	spin_unlock(&nh->lock);
+	return 0;
+}
+
+int atomic_notifier_chain_unregister(struct atomic_notifier_head *nh, struct notifier_block *nb)
+{
+	struct notifier_block **p;
+	int ret = -ENOENT;
+
+	spin_lock(&nh->lock);
+	for (p = &nh->head; *p; p = &(*p)->next) {
+		if (*p == nb) {
+			*p = nb->next;
+			ret = 0;
+			break;
+		}
+	}
+	spin_unlock(&nh->lock);
+	return ret;
+}
+
+int atomic_notifier_call_chain(struct atomic_notifier_head *nh, unsigned long val, void *v)
+{
+	struct notifier_block *nb;
+	int ret = NOTIFY_DONE;
+
+	for (nb = nh->head; nb; nb = nb->next) {
+		ret = nb->notifier_call(nb, val, v);
+	}
+	return ret;
+}
+
+/*
+ * Character devices. The registry is just a list of miscdevices; opening
+ * one by name does what misc_open() does and points private_data at it.
+ */
+struct kmock_misc {
+	struct miscdevice *misc;
+	struct kmock_misc *next;
+};
+
+static pthread_mutex_t kmock_misc_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct kmock_misc *kmock_miscs;
+
+int misc_register(struct miscdevice *misc)
+{
+	struct kmock_misc *m;
+	int ret = 0;
+
+	pthread_mutex_lock(&kmock_misc_lock);
+	for (m = kmock_miscs; m; m = m->next) {
+		if (!strcmp(m->misc->name, misc->name)) {
+			ret = -EEXIST;
+			goto out;
+		}
+	}
+	m = malloc(sizeof(*m));
+	misc->this_device = calloc(1, sizeof(*misc->this_device));
+	if (!m || !misc->this_device) {
+		free(m);
+		free(misc->this_device);
+		ret = -ENOMEM;
+		goto out;
+	}
+	misc->this_device->name = misc->name;
+	m->misc = misc;
+	m->next = kmock_miscs;
+	kmock_miscs = m;
+out:
+	pthread_mutex_unlock(&kmock_misc_lock);
+	return ret;
+}
+
+void misc_deregister(struct miscdevice *misc)
+{
+	struct kmock_misc **p, *m;
+
+	pthread_mutex_lock(&kmock_misc_lock);
+	for (p = &kmock_miscs; *p; p = &(*p)->next) {
+		if ((*p)->misc == misc) {
+			m = *p;
+			*p = m->next;
+			free(m);
+			break;
+		}
+	}
+	free(misc->this_device);
+	misc->this_device = NULL;
+	pthread_mutex_unlock(&kmock_misc_lock);
+}
+
+loff_t default_llseek(struct file *file, loff_t offset, int whence)
+{
+	switch (whence) {
+	case SEEK_SET:
+		break;
+	case SEEK_CUR:
+		offset += file->f_pos;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (offset < 0) {
+		return -EINVAL;
+	}
+	file->f_pos = offset;
+	return offset;
+}
+
+long compat_ptr_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	if (!file->f_op->unlocked_ioctl) {
+		return -ENOIOCTLCMD;
+	}
+	return file->f_op->unlocked_ioctl(file, cmd, arg);
+}
+
+/**
+ * kmock_open() - Open a registered device node, like open("/dev/<name>").
+ * @name: The miscdevice name.
+ *
+ * Return: The open file, or NULL if no such node exists.
+ */
+struct file *kmock_open(const char *name)
+{
+	struct kmock_misc *m;
+	struct file *file = NULL;
+
+	pthread_mutex_lock(&kmock_misc_lock);
+	for (m = kmock_miscs; m; m = m->next) {
+		if (!strcmp(m->misc->name, name)) {
+			break;
+		}
+	}
+	if (m) {
+		file = calloc(1, sizeof(*file));
+	}
+	if (file) {
+		file->private_data = m->misc;
+		file->f_op = m->misc->fops;
+	}
+	pthread_mutex_unlock(&kmock_misc_lock);
+
+	if (file && file->f_op->open && file->f_op->open(NULL, file)) {
+		free(file);
+		return NULL;
+	}
+	return file;
+}
+
+void kmock_close(struct file *file)
+{
+	if (file->f_op->release) {
+		file->f_op->release(NULL, file);
+	}
+	free(file);
+}
+
+ssize_t kmock_pread(struct file *file, void *buf, size_t count, loff_t offset)
+{
+	return file->f_op->read(file, buf, count, &offset);
+}
+
+ssize_t kmock_pwrite(struct file *file, const void *buf, size_t count, loff_t offset)
+{
+	return file->f_op->write(file, buf, count, &offset);
+}
+
+long kmock_ioctl(struct file *file, unsigned int cmd, void *arg)
+{
+	return file->f_op->unlocked_ioctl(file, cmd, (unsigned long)arg);
+}
+
+/*
+ * sysfs. Attributes are looked up by name in the driver's dev_groups, the
+ * way the driver core would create them on the platform device.
+ */
+ssize_t device_show_ulong(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct dev_ext_attribute *ea = container_of(attr, struct dev_ext_attribute, attr);
+
+	(void)dev;
+	return sysfs_emit(buf, "%lx\n", *(unsigned long *)ea->var);
+}
+
+static struct device_attribute *kmock_find_attr(struct kmock_device *kdev, const char *name)
+{
+	const struct attribute_group **group;
+	struct attribute **attr;
+
+	for (group = kdev->drv->driver.dev_groups; group && *group; group++) {
+		for (attr = (*group)->attrs; *attr; attr++) {
+			if (!strcmp((*attr)->name, name)) {
+				return container_of(*attr, struct device_attribute, attr);
+			}
+		}
+	}
+	return NULL;
+}
+
+/**
+ * kmock_sysfs_read() - Read an attribute, like cat.
+ * @kdev: The device.
+ * @attr: Attribute name.
+ * @buf: PAGE_SIZE buffer for the contents.
+ *
+ * Return: The length of the contents, or a negative error value.
+ */
+ssize_t kmock_sysfs_read(struct kmock_device *kdev, const char *attr, char *buf)
+{
+	struct device_attribute *da = kmock_find_attr(kdev, attr);
+
+	if (!da) {
+		return -ENOENT;
+	}
+	if (!da->show) {
+		return -EACCES;
+	}
+	return da->show(&kdev->pdev.dev, da, buf);
+}
+
+/**
+ * kmock_sysfs_write() - Write an attribute, like echo.
+ * @kdev: The device.
+ * @attr: Attribute name.
+ * @val: The string to write, usually ending in a newline.
+ *
+ * Return: The number of bytes consumed, or a negative error value.
+ */
+ssize_t kmock_sysfs_write(struct kmock_device *kdev, const char *attr, const char *val)
+{
+	struct device_attribute *da = kmock_find_attr(kdev, attr);
+
+	if (!da) {
+		return -ENOENT;
+	}
+	if (!da->store) {
+		return -EACCES;
+	}
+	return da->store(&kdev->pdev.dev, da, val, strlen(val));
+}
+
+/*
+ * Probing
+ */
+
+/**
+ * kmock_probe() - Bind a driver to a fake component.
+ * @drv: The driver, as exported by its module_platform_driver().
+ * @compatible: Compatible string the device tree node would have; it picks
+ *              the of_device_id entry and its match data.
+ * @regs: Initial register contents, or NULL for all zeros.
+ * @span: Size of the register window in bytes.
+ * @out: Returns the bound device.
+ *
+ * Return: 0, or the error the driver's probe() returned.
+ */
+int kmock_probe(struct platform_driver *drv, const char *compatible,
+	const u32 *regs, size_t span, struct kmock_device **out)
+{
+	const struct of_device_id *id;
+	struct kmock_device *kdev;
+	int ret;
+
+	for (id = drv->driver.of_match_table; id->compatible[0]; id++) {
+		if (!strcmp(id->compatible, compatible)) {
+			break;
+		}
+	}
+	if (!id->compatible[0]) {
+		return -ENODEV;
+	}
+
+	kdev = calloc(1, sizeof(*kdev));
+	if (!kdev) {
+		return -ENOMEM;
+	}
+	kdev->regs = calloc(1, span);
+	if (!kdev->regs) {
+		free(kdev);
+		return -ENOMEM;
+	}
+	if (regs) {
+		memcpy(kdev->regs, regs, span);
+	}
+	kdev->span = span;
+	kdev->drv = drv;
+	kdev->pdev.name = drv->driver.name;
+	kdev->pdev.id = -1;
+	kdev->pdev.kmock_regs = kdev->regs;
+	kdev->pdev.dev.name = drv->driver.name;
+	kdev->pdev.dev.driver = &drv->driver;
+	kdev->pdev.dev.match_data = id->data;
+
+	ret = drv->probe(&kdev->pdev);
+	if (ret) {
+		kmock_devres_release_all(&kdev->pdev.dev);
+		free(kdev->regs);
+		free(kdev);
+		return ret;
+	}
+
+	*out = kdev;
+	return 0;
+}
+
+void kmock_remove(struct kmock_device *kdev)
+{
+	if (kdev->drv->remove) {
+		kdev->drv->remove(&kdev->pdev);
+	}
+	kmock_devres_release_all(&kdev->pdev.dev);
+	free(kdev->regs);
+	free(kdev);
+}
@@ -0,0 +1,755 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * kmock - Just enough of the kernel API to build the drivers as ordinary
+ * x86 programs. The include/linux headers all come here. Register access
+ * goes to a plain memory buffer that stands in for the FPGA, user copies
+ * are memcpy()s, and the miscdevice and sysfs plumbing is a small registry
+ * the harness calls into (see the end of this file).
+ *
+ * Everything the drivers use is here, and nothing else. Timers and work
+ * only run when the harness calls kmock_run_deferred().
+ */
+#ifndef KMOCK_H
+#define KMOCK_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+/*
+ * Types and compiler helpers
+ */
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef long long s64;
+typedef uint8_t __u8;
+typedef uint16_t __u16;
+typedef uint32_t __u32;
+typedef unsigned long long __u64;
+typedef int32_t __s32;
+typedef long long __s64;
+typedef u32 __poll_t;
+typedef unsigned int gfp_t;
+typedef s64 ktime_t;
+
+#define __iomem
+#define __user
+#define __init
+#define __exit
+#define __always_unused __attribute__((unused))
+#define __maybe_unused __attribute__((unused))
+#define __packed __attribute__((packed))
+#define __aligned(x) __attribute__((aligned(x)))
+#define ____cacheline_aligned_in_smp
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define BIT(n) (1UL << (n))
+#define GENMASK(h, l) (((~0UL) << (l)) & (~0UL >> (8 * sizeof(long) - 1 - (h))))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min3(a, b, c) min(min(a, b), c)
+#define min_t(t, a, b) ((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b) ((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define clamp(v, lo, hi) min(max(v, lo), hi)
+#define clamp_t(t, v, lo, hi) min_t(t, max_t(t, v, lo), hi)
+#define clamp_val(v, lo, hi) clamp(v, lo, hi)
+#define swap(a, b) do { typeof(a) __t = (a); (a) = (b); (b) = __t; } while (0)
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define DIV_ROUND_CLOSEST(n, d) (((n) + (d) / 2) / (d))
+#define is_power_of_2(n) ((n) != 0 && (((n) & ((n) - 1)) == 0))
+#define hweight32(x) __builtin_popcount(x)
+#define lower_32_bits(x) ((u32)(x))
+#define upper_32_bits(x) ((u32)((u64)(x) >> 32))
+#define BUILD_BUG_ON(x) _Static_assert(!(x), #x)
+#define WARN_ON(x) (!!(x))
+#define WARN_ON_ONCE(x) (!!(x))
+#define IS_ENABLED(x) 0
+
+#define READ_ONCE(x) (*(volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, v) (*(volatile typeof(x) *)&(x) = (v))
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_wmb() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define smp_rmb() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_mb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#define U16_MAX 0xffff
+#define U32_MAX 0xffffffffU
+#ifndef INT_MAX
+#define INT_MAX 0x7fffffff
+#endif
+#ifndef ULONG_MAX
+#define ULONG_MAX (~0UL)
+#endif
+
+#define PAGE_SIZE 4096UL
+#define PAGE_SHIFT 12
+#define PAGE_ALIGN(x) (((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+#define NSEC_PER_SEC 1000000000L
+#define NSEC_PER_MSEC 1000000L
+#define NSEC_PER_USEC 1000L
+#define USEC_PER_SEC 1000000L
+#define MSEC_PER_SEC 1000L
+
+#define ERESTARTSYS 512
+#define EPROBE_DEFER 517
+#define ENOIOCTLCMD 515
+#include <errno.h>
+#include <fcntl.h>
+
+#define IS_ERR_VALUE(x) ((unsigned long)(x) >= (unsigned long)-4095)
+#define IS_ERR(p) IS_ERR_VALUE(p)
+#define IS_ERR_OR_NULL(p) (!(p) || IS_ERR(p))
+#define PTR_ERR(p) ((long)(p))
+#define ERR_PTR(e) ((void *)(long)(e))
+
+/*
+ * Modules and logging. Errors and warnings always print; info and debug
+ * messages only with kmock_verbose set.
+ */
+struct module;
+#define THIS_MODULE ((struct module *)0)
+#define EXPORT_SYMBOL(x)
+#define EXPORT_SYMBOL_GPL(x)
+#define MODULE_LICENSE(x)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_VERSION(x)
+#define MODULE_DEVICE_TABLE(a, b)
+
+extern int kmock_verbose;
+#define pr_err(...) fprintf(stderr, __VA_ARGS__)
+#define pr_warn(...) fprintf(stderr, __VA_ARGS__)
+#define pr_warn_ratelimited(...) fprintf(stderr, __VA_ARGS__)
+#define pr_info(...) do { if (kmock_verbose) printf(__VA_ARGS__); } while (0)
+#define pr_debug(...) do { if (kmock_verbose) printf(__VA_ARGS__); } while (0)
+#define dev_err(d, ...) pr_err(__VA_ARGS__)
+#define dev_warn(d, ...) pr_warn(__VA_ARGS__)
+#define dev_info(d, ...) pr_info(__VA_ARGS__)
+#define dev_dbg(d, ...) pr_debug(__VA_ARGS__)
+
+/*
+ * Strings
+ */
+int scnprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int sysfs_emit(char *buf, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+char *skip_spaces(const char *str);
+char *strim(char *s);
+bool sysfs_streq(const char *s1, const char *s2);
+int match_string(const char * const *array, size_t n, const char *string);
+int __sysfs_match_string(const char * const *array, size_t n, const char *str);
+#define sysfs_match_string(a, s) __sysfs_match_string(a, ARRAY_SIZE(a), s)
+int kstrtobool(const char *s, bool *res);
+int kstrtoul(const char *s, unsigned int base, unsigned long *res);
+int kstrtouint(const char *s, unsigned int base, unsigned int *res);
+int kstrtou32(const char *s, unsigned int base, u32 *res);
+int kstrtou16(const char *s, unsigned int base, u16 *res);
+int kstrtou8(const char *s, unsigned int base, u8 *res);
+int kstrtoint(const char *s, unsigned int base, int *res);
+void sort(void *base, size_t num, size_t size,
+	int (*cmp)(const void *, const void *), void (*swap_func)(void *, void *, int));
+
+/*
+ * Arithmetic
+ */
+static inline u64 div_u64(u64 n, u32 d) { return n / d; }
+static inline u64 div64_u64(u64 n, u64 d) { return n / d; }
+static inline s64 div_s64(s64 n, s32 d) { return n / d; }
+static inline s64 div64_s64(s64 n, s64 d) { return n / d; }
+#define do_div(n, base) ({ u32 __r = (n) % (base); (n) /= (base); __r; })
+
+/*
+ * Memory. devm_ allocations and actions are released when the harness
+ * removes the device, in reverse order, like the driver core does.
+ */
+struct device;
+static inline void *kmalloc(size_t size, gfp_t gfp) { (void)gfp; return malloc(size); }
+static inline void *kzalloc(size_t size, gfp_t gfp) { (void)gfp; return calloc(1, size); }
+static inline void *kcalloc(size_t n, size_t size, gfp_t gfp) { (void)gfp; return calloc(n, size); }
+static inline void *kmalloc_array(size_t n, size_t size, gfp_t gfp) { (void)gfp; return malloc(n * size); }
+static inline void kfree(const void *p) { free((void *)p); }
+#define GFP_KERNEL 0
+#define GFP_ATOMIC 1
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp);
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t gfp);
+char *devm_kasprintf(struct device *dev, gfp_t gfp, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int devm_add_action_or_reset(struct device *dev, void (*action)(void *), void *data);
+
+void *vmalloc_user(unsigned long size);
+void vfree(const void *p);
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_pgoff;
+	unsigned long vm_flags;
+	void *vm_private_data;
+};
+#define VM_WRITE 0x2
+#define VM_MAYWRITE 0x20
+#define VM_DONTDUMP 0x4000000
+#define VM_DONTEXPAND 0x40000
+static inline void vm_flags_set(struct vm_area_struct *vma, unsigned long f) { vma->vm_flags |= f; }
+static inline void vm_flags_clear(struct vm_area_struct *vma, unsigned long f) { vma->vm_flags &= ~f; }
+static inline int remap_vmalloc_range(struct vm_area_struct *vma, void *addr, unsigned long pgoff)
+{
+	(void)vma; (void)addr; (void)pgoff;
+	return 0;
+}
+
+/*
+ * User copies; user pointers are ordinary pointers here
+ */
+static inline unsigned long copy_to_user(void __user *to, const void *from, unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+static inline unsigned long copy_from_user(void *to, const void __user *from, unsigned long n)
+{
+	memcpy(to, from, n);
+	return 0;
+}
+#define get_user(x, p) ((x) = *(p), 0)
+#define put_user(x, p) (*(p) = (x), 0)
+#define u64_to_user_ptr(x) ((void __user *)(uintptr_t)(x))
+static inline void *memdup_user(const void __user *src, size_t len)
+{
+	void *p = malloc(len ? len : 1);
+
+	if (!p) {
+		return ERR_PTR(-ENOMEM);
+	}
+	memcpy(p, src, len);
+	return p;
+}
+
+/*
+ * Register access. Every ioread32()/iowrite32() is counted in the calling
+ * thread's kmock_bridge, and with kmock_bridge_latency_ns set, each one also
+ * busy-waits that long, to stand in for a trip across the HPS-to-FPGA
+ * bridge.
+ */
+struct kmock_bridge_stats {
+	unsigned long long reads;
+	unsigned long long writes;
+};
+extern __thread struct kmock_bridge_stats kmock_bridge;
+extern unsigned int kmock_bridge_latency_ns;
+void kmock_bridge_wait(void);
+
+static inline u32 ioread32(const void __iomem *addr)
+{
+	kmock_bridge.reads++;
+	if (kmock_bridge_latency_ns) {
+		kmock_bridge_wait();
+	}
+	return *(const volatile u32 *)addr;
+}
+
+static inline void iowrite32(u32 val, void __iomem *addr)
+{
+	kmock_bridge.writes++;
+	if (kmock_bridge_latency_ns) {
+		kmock_bridge_wait();
+	}
+	*(volatile u32 *)addr = val;
+}
+
+/*
+ * Locking. Mutexes are pthread mutexes and spinlocks spin, so instances can
+ * be driven from several threads at once.
+ */
+struct mutex {
+	pthread_mutex_t m;
+};
+#define DEFINE_MUTEX(name) struct mutex name = { PTHREAD_MUTEX_INITIALIZER }
+static inline void mutex_init(struct mutex *l) { pthread_mutex_init(&l->m, NULL); }
+static inline void mutex_lock(struct mutex *l) { pthread_mutex_lock(&l->m); }
+static inline int mutex_lock_interruptible(struct mutex *l) { pthread_mutex_lock(&l->m); return 0; }
+static inline void mutex_unlock(struct mutex *l) { pthread_mutex_unlock(&l->m); }
+
+typedef struct {
+	int locked;
+} spinlock_t;
+static inline void spin_lock_init(spinlock_t *l) { l->locked = 0; }
+static inline void spin_lock(spinlock_t *l)
+{
+	while (__atomic_exchange_n(&l->locked, 1, __ATOMIC_ACQUIRE)) {
+		while (__atomic_load_n(&l->locked, __ATOMIC_RELAXED)) {
+		}
+	}
+}
+static inline void spin_unlock(spinlock_t *l) { __atomic_store_n(&l->locked, 0, __ATOMIC_RELEASE); }
+#define spin_lock_irq(l) spin_lock(l)
+#define spin_unlock_irq(l) spin_unlock(l)
+#define spin_lock_irqsave(l, flags) do { (flags) = 0; spin_lock(l); } while (0)
+#define spin_unlock_irqrestore(l, flags) do { (void)(flags); spin_unlock(l); } while (0)
+
+typedef struct {
+	int counter;
+} atomic_t;
+static inline int atomic_read(const atomic_t *v) { return __atomic_load_n(&v->counter, __ATOMIC_RELAXED); }
+static inline void atomic_set(atomic_t *v, int i) { __atomic_store_n(&v->counter, i, __ATOMIC_RELAXED); }
+static inline void atomic_or(int i, atomic_t *v) { __atomic_fetch_or(&v->counter, i, __ATOMIC_SEQ_CST); }
+static inline int atomic_fetch_or(int i, atomic_t *v) { return __atomic_fetch_or(&v->counter, i, __ATOMIC_SEQ_CST); }
+static inline void atomic_andnot(int i, atomic_t *v) { __atomic_fetch_and(&v->counter, ~i, __ATOMIC_SEQ_CST); }
+static inline int atomic_xchg(atomic_t *v, int i) { return __atomic_exchange_n(&v->counter, i, __ATOMIC_SEQ_CST); }
+
+/*
+ * Waiting. Nothing ever sleeps: a wait whose condition is false returns as
+ * if a signal had arrived.
+ */
+struct wait_queue_head {
+	int unused;
+};
+typedef struct wait_queue_head wait_queue_head_t;
+static inline void init_waitqueue_head(wait_queue_head_t *wq) { (void)wq; }
+static inline void wake_up_interruptible(wait_queue_head_t *wq) { (void)wq; }
+static inline void wake_up_interruptible_all(wait_queue_head_t *wq) { (void)wq; }
+static inline void wake_up_interruptible_poll(wait_queue_head_t *wq, __poll_t m) { (void)wq; (void)m; }
+#define wait_event_interruptible(wq, cond) ((cond) ? 0 : -ERESTARTSYS)
+
+struct file;
+struct poll_table_struct {
+	int unused;
+};
+typedef struct poll_table_struct poll_table;
+static inline void poll_wait(struct file *f, wait_queue_head_t *wq, poll_table *p) { (void)f; (void)wq; (void)p; }
+#define EPOLLIN 0x0001
+#define EPOLLPRI 0x0002
+#define EPOLLOUT 0x0004
+#define EPOLLERR 0x0008
+#define EPOLLHUP 0x0010
+#define EPOLLRDNORM 0x0040
+#define EPOLLWRNORM 0x0100
+
+/*
+ * Time
+ */
+static inline ktime_t ktime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (s64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+static inline u64 ktime_get_ns(void) { return ktime_get(); }
+static inline s64 ktime_to_ns(ktime_t t) { return t; }
+static inline s64 ktime_to_us(ktime_t t) { return t / NSEC_PER_USEC; }
+static inline ktime_t ns_to_ktime(u64 ns) { return ns; }
+static inline ktime_t us_to_ktime(u64 us) { return us * NSEC_PER_USEC; }
+static inline ktime_t ms_to_ktime(u64 ms) { return ms * NSEC_PER_MSEC; }
+static inline ktime_t ktime_add_ns(ktime_t t, u64 ns) { return t + ns; }
+static inline ktime_t ktime_add_ms(ktime_t t, u64 ms) { return t + ms * NSEC_PER_MSEC; }
+static inline ktime_t ktime_sub_ms(ktime_t t, u64 ms) { return t - ms * NSEC_PER_MSEC; }
+static inline ktime_t ktime_sub(ktime_t a, ktime_t b) { return a - b; }
+static inline bool ktime_after(ktime_t a, ktime_t b) { return a > b; }
+static inline bool ktime_before(ktime_t a, ktime_t b) { return a < b; }
+
+/*
+ * hrtimers. Started timers are remembered, and kmock_run_deferred() calls
+ * every active one once, whether or not it has expired.
+ */
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+enum hrtimer_mode {
+	HRTIMER_MODE_ABS,
+	HRTIMER_MODE_REL,
+	HRTIMER_MODE_REL_SOFT,
+};
+struct hrtimer {
+	enum hrtimer_restart (*function)(struct hrtimer *timer);
+	ktime_t expires;
+	bool active;
+	bool listed;
+	struct hrtimer *next;
+};
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC 1
+#endif
+void hrtimer_init(struct hrtimer *timer, clockid_t clock, enum hrtimer_mode mode);
+void hrtimer_start(struct hrtimer *timer, ktime_t t, enum hrtimer_mode mode);
+int hrtimer_cancel(struct hrtimer *timer);
+int hrtimer_try_to_cancel(struct hrtimer *timer);
+u64 hrtimer_forward_now(struct hrtimer *timer, ktime_t interval);
+static inline bool hrtimer_active(const struct hrtimer *timer) { return timer->active; }
+static inline void hrtimer_set_expires(struct hrtimer *timer, ktime_t t) { timer->expires = t; }
+static inline ktime_t hrtimer_get_expires(const struct hrtimer *timer) { return timer->expires; }
+
+/*
+ * Work. schedule_work() only queues; kmock_run_deferred() runs the queue.
+ */
+struct work_struct {
+	void (*func)(struct work_struct *work);
+	bool pending;
+	struct work_struct *next;
+};
+#define INIT_WORK(w, f) do { (w)->func = (f); (w)->pending = false; (w)->next = NULL; } while (0)
+bool schedule_work(struct work_struct *work);
+bool cancel_work_sync(struct work_struct *work);
+
+/*
+ * Notifiers
+ */
+struct notifier_block {
+	int (*notifier_call)(struct notifier_block *nb, unsigned long action, void *data);
+	struct notifier_block *next;
+	int priority;
+};
+struct atomic_notifier_head {
+	spinlock_t lock;
+	struct notifier_block *head;
+};
+#define ATOMIC_INIT_NOTIFIER_HEAD(name) do { spin_lock_init(&(name)->lock); (name)->head = NULL; } while (0)
+#define NOTIFY_DONE 0x0000
+#define NOTIFY_OK 0x0001
+int atomic_notifier_chain_register(struct atomic_notifier_head *nh, struct notifier_block *nb);
+int atomic_notifier_chain_unregister(struct atomic_notifier_head *nh, struct notifier_block *nb);
+int atomic_notifier_call_chain(struct atomic_notifier_head *nh, unsigned long val, void *v);
+
+/*
+ * ID allocation
+ */
+struct ida {
+	u64 used;
+	pthread_mutex_t lock;
+};
+#define DEFINE_IDA(name) struct ida name = { 0, PTHREAD_MUTEX_INITIALIZER }
+int ida_alloc(struct ida *ida, gfp_t gfp);
+void ida_free(struct ida *ida, unsigned int id);
+
+/*
+ * Devices, sysfs and the platform bus
+ */
+struct kobject {
+	int unused;
+};
+struct device_node;
+struct attribute {
+	const char *name;
+	unsigned short mode;
+};
+struct attribute_group {
+	const char *name;
+	struct attribute **attrs;
+};
+struct of_device_id {
+	char name[32];
+	char type[32];
+	char compatible[128];
+	const void *data;
+};
+struct device_driver {
+	const char *name;
+	struct module *owner;
+	const struct of_device_id *of_match_table;
+	const struct attribute_group **dev_groups;
+};
+struct kmock_devres;
+struct device {
+	struct kobject kobj;
+	struct device_node *of_node;
+	void *driver_data;
+	struct device_driver *driver;
+	const char *name;
+	const void *match_data;
+	struct kmock_devres *devres;
+};
+struct device_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr, char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr, const char *buf, size_t count);
+};
+struct dev_ext_attribute {
+	struct device_attribute attr;
+	void *var;
+};
+#define __ATTR(_name, _mode, _show, _store) { .attr = { .name = #_name, .mode = _mode }, .show = _show, .store = _store }
+#define __ATTR_RW(_name) __ATTR(_name, 0644, _name##_show, _name##_store)
+#define __ATTR_RO(_name) __ATTR(_name, 0444, _name##_show, NULL)
+#define __ATTR_WO(_name) __ATTR(_name, 0200, NULL, _name##_store)
+#define DEVICE_ATTR(_name, _mode, _show, _store) struct device_attribute dev_attr_##_name = __ATTR(_name, _mode, _show, _store)
+#define DEVICE_ATTR_RW(_name) struct device_attribute dev_attr_##_name = __ATTR_RW(_name)
+#define DEVICE_ATTR_RO(_name) struct device_attribute dev_attr_##_name = __ATTR_RO(_name)
+#define DEVICE_ATTR_WO(_name) struct device_attribute dev_attr_##_name = __ATTR_WO(_name)
+#define ATTRIBUTE_GROUPS(_name) \
+	static const struct attribute_group _name##_group = { .attrs = _name##_attrs }; \
+	static const struct attribute_group *_name##_groups[] = { &_name##_group, NULL }
+ssize_t device_show_ulong(struct device *dev, struct device_attribute *attr, char *buf);
+static inline void sysfs_notify(struct kobject *kobj, const char *dir, const char *attr) { (void)kobj; (void)dir; (void)attr; }
+static inline void *dev_get_drvdata(const struct device *dev) { return dev->driver_data; }
+static inline const char *dev_name(const struct device *dev) { return dev->name; }
+static inline const void *device_get_match_data(const struct device *dev) { return dev->match_data; }
+
+struct platform_device {
+	struct device dev;
+	const char *name;
+	int id;
+	void __iomem *kmock_regs;
+};
+struct platform_driver {
+	int (*probe)(struct platform_device *pdev);
+	int (*remove)(struct platform_device *pdev);
+	struct device_driver driver;
+};
+#define to_platform_device(d) container_of(d, struct platform_device, dev)
+static inline void platform_set_drvdata(struct platform_device *pdev, void *data) { pdev->dev.driver_data = data; }
+static inline void *platform_get_drvdata(const struct platform_device *pdev) { return pdev->dev.driver_data; }
+static inline void __iomem *devm_platform_ioremap_resource(struct platform_device *pdev, unsigned int index)
+{
+	(void)index;
+	return pdev->kmock_regs;
+}
+// The harness never wires up an interrupt, so drivers take their polling path
+static inline int platform_get_irq_optional(struct platform_device *pdev, unsigned int num)
+{
+	(void)pdev; (void)num;
+	return -ENXIO;
+}
+
+/*
+ * Each driver's module_platform_driver() exports its platform_driver under
+ * the name the Makefile passes in KMOCK_DRIVER.
+ */
+#define module_platform_driver(drv) struct platform_driver *const KMOCK_DRIVER = &(drv)
+
+/*
+ * Interrupts
+ */
+typedef int irqreturn_t;
+#define IRQ_NONE 0
+#define IRQ_HANDLED 1
+#define IRQ_WAKE_THREAD 2
+#define IRQF_ONESHOT 0x00002000
+static inline int devm_request_threaded_irq(struct device *dev, unsigned int irq,
+	irqreturn_t (*handler)(int, void *), irqreturn_t (*thread_fn)(int, void *),
+	unsigned long flags, const char *name, void *data)
+{
+	(void)dev; (void)irq; (void)handler; (void)thread_fn; (void)flags; (void)name; (void)data;
+	return -ENXIO;
+}
+static inline void synchronize_irq(unsigned int irq) { (void)irq; }
+
+/*
+ * Character devices
+ */
+struct inode;
+struct file_operations;
+struct file {
+	void *private_data;
+	unsigned int f_flags;
+	loff_t f_pos;
+	const struct file_operations *f_op;
+};
+struct file_operations {
+	struct module *owner;
+	ssize_t (*read)(struct file *file, char __user *buf, size_t count, loff_t *pos);
+	ssize_t (*write)(struct file *file, const char __user *buf, size_t count, loff_t *pos);
+	loff_t (*llseek)(struct file *file, loff_t offset, int whence);
+	__poll_t (*poll)(struct file *file, struct poll_table_struct *wait);
+	long (*unlocked_ioctl)(struct file *file, unsigned int cmd, unsigned long arg);
+	long (*compat_ioctl)(struct file *file, unsigned int cmd, unsigned long arg);
+	int (*mmap)(struct file *file, struct vm_area_struct *vma);
+	int (*open)(struct inode *inode, struct file *file);
+	int (*release)(struct inode *inode, struct file *file);
+};
+loff_t default_llseek(struct file *file, loff_t offset, int whence);
+long compat_ptr_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+
+#define MISC_DYNAMIC_MINOR 255
+struct miscdevice {
+	int minor;
+	const char *name;
+	const struct file_operations *fops;
+	struct device *parent;
+	struct device *this_device;
+};
+int misc_register(struct miscdevice *misc);
+void misc_deregister(struct miscdevice *misc);
+
+/*
+ * ioctl numbers, as asm-generic lays them out
+ */
+#define _IOC_NRSHIFT 0
+#define _IOC_TYPESHIFT 8
+#define _IOC_SIZESHIFT 16
+#define _IOC_DIRSHIFT 30
+#define _IOC_NONE 0U
+#define _IOC_WRITE 1U
+#define _IOC_READ 2U
+#define _IOC(dir, type, nr, size) \
+	(((dir) << _IOC_DIRSHIFT) | ((type) << _IOC_TYPESHIFT) | \
+	 ((nr) << _IOC_NRSHIFT) | ((size) << _IOC_SIZESHIFT))
+#define _IO(type, nr) _IOC(_IOC_NONE, (type), (nr), 0)
+#define _IOR(type, nr, size) _IOC(_IOC_READ, (type), (nr), sizeof(size))
+#define _IOW(type, nr, size) _IOC(_IOC_WRITE, (type), (nr), sizeof(size))
+#define _IOWR(type, nr, size) _IOC(_IOC_READ | _IOC_WRITE, (type), (nr), sizeof(size))
+
+/*
+ * Bit operations
+ */
+#define BITS_PER_LONG (8 * sizeof(long))
+#define BITS_TO_LONGS(n) (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+static inline bool test_bit(unsigned long nr, const unsigned long *addr)
+{
+	return addr[nr / BITS_PER_LONG] & (1UL << (nr % BITS_PER_LONG));
+}
+static inline void bitmap_set(unsigned long *map, unsigned int start, unsigned int n)
+{
+	for (; n; n--, start++) {
+		map[start / BITS_PER_LONG] |= 1UL << (start % BITS_PER_LONG);
+	}
+}
+static inline unsigned long find_next_bit(const unsigned long *addr, unsigned long size, unsigned long offset)
+{
+	for (; offset < size; offset++) {
+		if (addr[offset / (8 * sizeof(long))] & (1UL << (offset % (8 * sizeof(long))))) {
+			break;
+		}
+	}
+	return min(offset, size);
+}
+#define for_each_set_bit(bit, addr, size) \
+	for ((bit) = find_next_bit((addr), (size), 0); (bit) < (size); \
+	     (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+/*
+ * kfifo, for a fixed-size fifo embedded in a struct
+ */
+#define DECLARE_KFIFO(fifo, type, size) struct { type buf[size]; unsigned int in, out; } fifo
+#define INIT_KFIFO(fifo) ((fifo).in = (fifo).out = 0)
+#define kfifo_size(f) (ARRAY_SIZE((f)->buf))
+#define kfifo_len(f) ((f)->in - (f)->out)
+#define kfifo_is_empty(f) ((f)->in == (f)->out)
+#define kfifo_is_full(f) (kfifo_len(f) >= kfifo_size(f))
+#define kfifo_avail(f) (kfifo_size(f) - kfifo_len(f))
+#define kfifo_reset(f) ((f)->in = (f)->out = 0)
+#define kfifo_put(f, v) ({ int __r = !kfifo_is_full(f); if (__r) (f)->buf[(f)->in++ % kfifo_size(f)] = (v); __r; })
+#define kfifo_get(f, p) ({ int __r = !kfifo_is_empty(f); if (__r) *(p) = (f)->buf[(f)->out++ % kfifo_size(f)]; __r; })
+
+/*
+ * IIO. The device registers but never gets a trigger, so the buffer path
+ * isn't exercised.
+ */
+enum iio_chan_type {
+	IIO_VOLTAGE,
+	IIO_TIMESTAMP,
+};
+enum iio_chan_info_enum {
+	IIO_CHAN_INFO_RAW,
+	IIO_CHAN_INFO_SCALE,
+	IIO_CHAN_INFO_SAMP_FREQ,
+};
+enum iio_endian {
+	IIO_CPU,
+	IIO_BE,
+	IIO_LE,
+};
+#define IIO_VAL_INT 1
+#define IIO_VAL_FRACTIONAL_LOG2 11
+#define INDIO_DIRECT_MODE 0x01
+struct iio_scan_type {
+	char sign;
+	u8 realbits;
+	u8 storagebits;
+	u8 shift;
+	enum iio_endian endianness;
+};
+struct iio_chan_spec {
+	enum iio_chan_type type;
+	int channel;
+	unsigned int indexed:1;
+	long info_mask_separate;
+	long info_mask_shared_by_type;
+	int scan_index;
+	struct iio_scan_type scan_type;
+};
+#define IIO_CHAN_SOFT_TIMESTAMP(_si) { \
+	.type = IIO_TIMESTAMP, .channel = -1, .scan_index = _si, \
+	.scan_type = { .sign = 's', .realbits = 64, .storagebits = 64 } }
+struct iio_dev;
+struct iio_trigger;
+struct iio_info {
+	int (*read_raw)(struct iio_dev *indio_dev, struct iio_chan_spec const *chan, int *val, int *val2, long mask);
+};
+struct iio_dev {
+	const char *name;
+	const struct iio_info *info;
+	int modes;
+	const struct iio_chan_spec *channels;
+	int num_channels;
+	unsigned long *active_scan_mask;
+	struct iio_trigger *trig;
+	void *priv;
+};
+struct iio_poll_func {
+	struct iio_dev *indio_dev;
+	s64 timestamp;
+};
+static inline void *iio_priv(const struct iio_dev *indio_dev) { return indio_dev->priv; }
+struct iio_dev *devm_iio_device_alloc(struct device *dev, int sizeof_priv);
+static inline int devm_iio_triggered_buffer_setup(struct device *dev, struct iio_dev *indio_dev,
+	irqreturn_t (*h)(int, void *), irqreturn_t (*thread)(int, void *), const void *ops)
+{
+	(void)dev; (void)indio_dev; (void)h; (void)thread; (void)ops;
+	return 0;
+}
+static inline irqreturn_t iio_pollfunc_store_time(int irq, void *p) { (void)irq; (void)p; return IRQ_WAKE_THREAD; }
+static inline int devm_iio_device_register(struct device *dev, struct iio_dev *indio_dev) { (void)dev; (void)indio_dev; return 0; }
+static inline int iio_push_to_buffers_with_timestamp(struct iio_dev *indio_dev, void *data, s64 ts)
+{
+	(void)indio_dev; (void)data; (void)ts;
+	return 0;
+}
+static inline void iio_trigger_notify_done(struct iio_trigger *trig) { (void)trig; }
+
+/*
+ * Harness interface
+ */
+
+/**
+ * struct kmock_device - A driver bound to a fake component.
+ * @pdev: The platform device handed to the driver's probe().
+ * @drv: The driver.
+ * @regs: The component's registers.
+ * @span: Size of @regs in bytes.
+ */
+struct kmock_device {
+	struct platform_device pdev;
+	struct platform_driver *drv;
+	u32 *regs;
+	size_t span;
+};
+
+int kmock_probe(struct platform_driver *drv, const char *compatible,
+	const u32 *regs, size_t span, struct kmock_device **out);
+void kmock_remove(struct kmock_device *kdev);
+
+struct file *kmock_open(const char *name);
+void kmock_close(struct file *file);
+ssize_t kmock_pread(struct file *file, void *buf, size_t count, loff_t offset);
+ssize_t kmock_pwrite(struct file *file, const void *buf, size_t count, loff_t offset);
+long kmock_ioctl(struct file *file, unsigned int cmd, void *arg);
+
+ssize_t kmock_sysfs_read(struct kmock_device *kdev, const char *attr, char *buf);
+ssize_t kmock_sysfs_write(struct kmock_device *kdev, const char *attr, const char *val);
+
+void kmock_run_deferred(void);
+
+#endif // KMOCK_H
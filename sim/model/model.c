@@ -0,0 +1,423 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * model.c - Cycle models of the PWM and buzzer datapaths.
+ *
+ * The arithmetic is the RTL's, in the same order and at the same widths:
+ * products are formed in full and shifted, then loaded into a counter
+ * as (value - 1), like to_integer(shift_right(...)) - 1.
+ *
+ * Each block multiplies out its terminal counts in a two-stage pipeline
+ * ahead of the counters. The cycle models keep the pipeline registers,
+ * and update them on each edge from their values before it, as the RTL
+ * does.
+ */
+#include "model.h"
+
+// Period register value the buzzer counts while it's silent
+#define BUZZER_SILENT_PERIOD 8
+
+static uint64_t mask(unsigned int width)
+{
+	return width >= 64 ? UINT64_MAX : (UINT64_C(1) << width) - 1;
+}
+
+/*
+ * Converts a count to a VHDL integer, flagging values that to_integer()
+ * couldn't represent.
+ */
+static int64_t to_integer(uint64_t value, bool *overflow)
+{
+	if (value > INT32_MAX)
+		*overflow = true;
+	return (int64_t)value;
+}
+
+/*
+ * Decrements a VHDL integer counter. A counter loaded with -1 counts down
+ * until it leaves the integer range.
+ */
+static int64_t count_down(int64_t counter, bool *overflow)
+{
+	if (counter <= INT32_MIN)
+		*overflow = true;
+	return counter - 1;
+}
+
+/*
+ * Works out the steady state of a modulator that loads a period and a
+ * high time counter together, like PWM_Controller and Buzzer. The reload
+ * clock is always high, so a high time of 0 still gives one high clock,
+ * and a high time of at least the period never goes low.
+ */
+static void counter_timing(uint64_t period_clocks, uint64_t high_clocks, struct timing *t)
+{
+	t->status = TIMING_OK;
+	if (period_clocks == 0)
+		t->status = TIMING_STUCK;
+	else if (period_clocks > INT32_MAX || high_clocks > INT32_MAX)
+		t->status = TIMING_OVERFLOW;
+
+	t->period_clocks = period_clocks;
+	if (high_clocks >= period_clocks)
+		t->high_clocks = period_clocks;
+	else if (high_clocks == 0)
+		t->high_clocks = 1;
+	else
+		t->high_clocks = high_clocks;
+}
+
+// PWM_Controller
+
+// The period in clocks before the shift; period_product in the RTL
+static uint64_t pwm_product(const struct pwm_params *p, uint32_t period)
+{
+	return (uint64_t)p->clk_hz * (period & mask(p->period_width));
+}
+
+static uint64_t pwm_period_clocks(const struct pwm_params *p, uint64_t product)
+{
+	return product >> p->period_frac;
+}
+
+static uint64_t pwm_high_clocks(const struct pwm_params *p, uint64_t product, uint32_t duty)
+{
+	// Duty cycles above 1.0 are hard-limited to the period
+	if (duty > (UINT32_C(1) << p->duty_frac))
+		return pwm_period_clocks(p, product);
+	return (uint64_t)(((unsigned __int128)product * duty) >> (p->period_frac + p->duty_frac));
+}
+
+// The part of the high time pwm_high_clocks() drops; high_fraction in the RTL
+static uint64_t pwm_high_fraction(const struct pwm_params *p, uint64_t product, uint32_t duty,
+				  bool dither)
+{
+	if (!dither || duty > (UINT32_C(1) << p->duty_frac))
+		return 0;
+	return (uint64_t)((unsigned __int128)product * duty) & mask(p->period_frac + p->duty_frac);
+}
+
+// The duty cycle the next period uses: up to @step from @current toward @duty
+static uint32_t pwm_next_duty(uint32_t current, uint32_t duty, uint32_t step)
+{
+	if (step == 0)
+		return duty;
+	if (current < duty)
+		return duty - current > step ? current + step : duty;
+	return current - duty > step ? current - step : duty;
+}
+
+/**
+ * pwm_timing() - Steady-state period of a PWM_Controller.
+ * @p: Its generics.
+ * @period: The period input.
+ * @duty: The duty_cycle input, with a ramp step of 0.
+ * @t: Where to put the result.
+ */
+void pwm_timing(const struct pwm_params *p, uint32_t period, uint32_t duty, struct timing *t)
+{
+	uint64_t product = pwm_product(p, period);
+
+	duty &= mask(p->duty_width);
+	counter_timing(pwm_period_clocks(p, product), pwm_high_clocks(p, product, duty), t);
+}
+
+/**
+ * pwm_model_reset() - Hold a PWM_Controller in reset.
+ * @m: The model.
+ * @p: Its generics.
+ * @period: The period input during reset.
+ * @duty: The duty_cycle input during reset.
+ * @dither: The dither input during reset.
+ *
+ * Reset is taken to last long enough to fill the terminal count pipeline.
+ * It leaves period_counter at 0, so the first clock loads the counters.
+ */
+void pwm_model_reset(struct pwm_model *m, const struct pwm_params *p, uint32_t period, uint32_t duty,
+		     bool dither)
+{
+	m->params = p;
+	m->overflow = false;
+	m->duty_current = duty & mask(p->duty_width);
+	m->pwm_output = true;
+	m->output = false;
+	m->period_counter = 0;
+	m->high_counter = 0;
+	m->residue = 0;
+
+	// Reset holds duty_current at duty_cycle, so the ramp has nowhere to go
+	m->next_duty = m->duty_current;
+	m->period_product = pwm_product(p, period);
+	m->load_duty = m->next_duty;
+	m->period_count = to_integer(pwm_period_clocks(p, m->period_product), &m->overflow);
+	m->high_count = to_integer(pwm_high_clocks(p, m->period_product, m->next_duty), &m->overflow);
+	m->high_fraction = pwm_high_fraction(p, m->period_product, m->next_duty, dither);
+}
+
+/**
+ * pwm_model_clock() - Clock a PWM_Controller once.
+ * @m: The model.
+ * @period: The period input.
+ * @duty: The duty_cycle input.
+ * @step: The step input.
+ * @dither: The dither input.
+ *
+ * Return: The output pin after the edge.
+ */
+bool pwm_model_clock(struct pwm_model *m, uint32_t period, uint32_t duty, uint32_t step, bool dither)
+{
+	const struct pwm_params *p = m->params;
+	bool output = m->pwm_output;
+	uint32_t duty_current = m->duty_current;
+
+	duty &= mask(p->duty_width);
+	step &= mask(p->duty_width);
+
+	// modulator, from the pipeline as it was before this edge
+	if (m->period_counter == 0) {
+		uint64_t sum = m->residue + m->high_fraction;
+		uint64_t carry = sum >> (p->period_frac + p->duty_frac);
+
+		m->residue = sum & mask(p->period_frac + p->duty_frac);
+		m->duty_current = m->load_duty;
+		m->period_counter = m->period_count - 1;
+		m->high_counter = m->high_count - 1 + carry;
+		m->pwm_output = true;
+	} else if (m->high_counter > 0) {
+		m->period_counter = count_down(m->period_counter, &m->overflow);
+		m->high_counter--;
+		m->pwm_output = true;
+	} else {
+		m->period_counter = count_down(m->period_counter, &m->overflow);
+		m->pwm_output = false;
+	}
+
+	// terminal_counts: stage 2 from stage 1, then stage 1 from the inputs
+	m->load_duty = m->next_duty;
+	m->period_count = to_integer(pwm_period_clocks(p, m->period_product), &m->overflow);
+	m->high_count = to_integer(pwm_high_clocks(p, m->period_product, m->next_duty), &m->overflow);
+	m->high_fraction = pwm_high_fraction(p, m->period_product, m->next_duty, dither);
+	m->next_duty = pwm_next_duty(duty_current, duty, step);
+	m->period_product = pwm_product(p, period);
+
+	m->output = output;
+	return m->output;
+}
+
+/**
+ * pwm_model_period_start() - The period_start output.
+ * @m: The model.
+ *
+ * Return: True if the next edge reloads the counters.
+ */
+bool pwm_model_period_start(const struct pwm_model *m)
+{
+	return m->period_counter == 0;
+}
+
+/**
+ * pwm_model_ramping() - The ramping output.
+ * @m: The model.
+ * @duty: The duty_cycle input.
+ *
+ * Return: True while the duty cycle in use hasn't reached @duty.
+ */
+bool pwm_model_ramping(const struct pwm_model *m, uint32_t duty)
+{
+	return m->duty_current != (duty & mask(m->params->duty_width));
+}
+
+// Buzzer
+
+static uint64_t buzzer_product(const struct buzzer_params *p, uint32_t period)
+{
+	return (uint64_t)p->clk_hz * (period & mask(p->period_width));
+}
+
+/**
+ * buzzer_timing() - Steady-state period of a Buzzer.
+ * @p: Its generics.
+ * @period: The period input; 0 is silence.
+ * @t: Where to put the result.
+ */
+void buzzer_timing(const struct buzzer_params *p, uint32_t period, struct timing *t)
+{
+	uint64_t product;
+
+	if ((period & mask(p->period_width)) == 0) {
+		counter_timing(buzzer_product(p, BUZZER_SILENT_PERIOD) >> p->period_frac, 1, t);
+		t->high_clocks = 0;
+		return;
+	}
+	product = buzzer_product(p, period);
+	counter_timing(product >> p->period_frac, product >> (p->period_frac + 1), t);
+}
+
+/**
+ * buzzer_model_reset() - Hold a Buzzer in reset.
+ * @m: The model.
+ * @p: Its generics.
+ * @period: The period input during reset.
+ *
+ * Reset is taken to last long enough to fill the terminal count pipeline.
+ * It leaves period_counter at 0, so the first clock loads the counters.
+ */
+void buzzer_model_reset(struct buzzer_model *m, const struct buzzer_params *p, uint32_t period)
+{
+	m->params = p;
+	m->overflow = false;
+	m->pwm_output = true;
+	m->output = false;
+	m->period_counter = 0;
+	m->high_counter = 0;
+
+	m->period_in = period & mask(p->period_width);
+	m->period_product = buzzer_product(p, m->period_in);
+	m->silent = m->period_in == 0;
+}
+
+/**
+ * buzzer_model_clock() - Clock a Buzzer once.
+ * @m: The model.
+ * @period: The period input.
+ *
+ * Return: The output pin after the edge.
+ */
+bool buzzer_model_clock(struct buzzer_model *m, uint32_t period)
+{
+	const struct buzzer_params *p = m->params;
+	bool output = m->pwm_output;
+
+	// modulator, from the pipeline as it was before this edge
+	if (m->period_counter == 0) {
+		if (!m->silent) {
+			m->period_counter = to_integer(m->period_product >> p->period_frac, &m->overflow) - 1;
+			m->high_counter = to_integer(m->period_product >> (p->period_frac + 1), &m->overflow) - 1;
+			m->pwm_output = true;
+		} else {
+			m->period_counter = to_integer(buzzer_product(p, BUZZER_SILENT_PERIOD) >> p->period_frac,
+						       &m->overflow) - 1;
+			m->high_counter = 0;
+			m->pwm_output = false;
+		}
+	} else if (m->high_counter > 0) {
+		m->period_counter = count_down(m->period_counter, &m->overflow);
+		m->high_counter--;
+		m->pwm_output = true;
+	} else {
+		m->period_counter = count_down(m->period_counter, &m->overflow);
+		m->pwm_output = false;
+	}
+
+	// terminal_counts
+	m->period_product = buzzer_product(p, m->period_in);
+	m->silent = m->period_in == 0;
+	m->period_in = period & mask(p->period_width);
+
+	m->output = output;
+	return m->output;
+}
+
+// pwm_controller
+
+// period_base: clk_freq is a 26-bit signal, so it's 52 bits
+static uint64_t vpwm_period_base(const struct vpwm_params *p, uint32_t period)
+{
+	return (uint64_t)(p->clk_khz & mask(26)) * (period & mask(VPWM_PERIOD_WIDTH));
+}
+
+// trunk2, from the 67-bit high_time: the high time rounded down to even
+static uint64_t vpwm_trunk2(unsigned __int128 high_time)
+{
+	return (uint64_t)(high_time >> 35) << 1;
+}
+
+/**
+ * vpwm_timing() - Steady-state period of a pwm_controller.
+ * @p: Its constants.
+ * @period: The period input, 26.20 milliseconds.
+ * @duty: The duty_cycle input, 15.14.
+ * @t: Where to put the result.
+ *
+ * The counter runs to whichever of the two counts is larger. With a duty
+ * cycle of 1.0 or more the output never goes low and the period
+ * stretches to the high time.
+ */
+void vpwm_timing(const struct vpwm_params *p, uint32_t period, uint32_t duty, struct timing *t)
+{
+	uint64_t period_base = vpwm_period_base(p, period);
+	uint64_t trunk2, trunkp2;
+
+	trunk2 = vpwm_trunk2((unsigned __int128)(duty & mask(VPWM_DUTY_WIDTH)) * period_base);
+	trunkp2 = (period_base >> 21) << 1;
+
+	t->status = TIMING_OK;
+	if (trunk2 >= trunkp2) {
+		t->period_clocks = trunk2 + 1;
+		t->high_clocks = t->period_clocks;
+	} else {
+		t->period_clocks = trunkp2 + 1;
+		t->high_clocks = trunk2;
+	}
+	if (t->period_clocks - 1 > INT32_MAX)
+		t->status = TIMING_OVERFLOW;
+}
+
+/**
+ * vpwm_model_reset() - Hold a pwm_controller in reset.
+ * @m: The model.
+ * @p: Its constants.
+ * @period: The period input during reset.
+ * @duty: The duty_cycle input during reset.
+ *
+ * Reset only clears the count; the output keeps its power-up value of 1.
+ * The terminal count pipeline isn't reset, and is taken to have filled
+ * with the inputs during reset.
+ */
+void vpwm_model_reset(struct vpwm_model *m, const struct vpwm_params *p, uint32_t period,
+		      uint32_t duty)
+{
+	m->params = p;
+	m->overflow = false;
+	m->count = 0;
+	m->output = true;
+
+	m->period_base = vpwm_period_base(p, period);
+	m->duty_reg = duty & mask(VPWM_DUTY_WIDTH);
+	m->high_time = (unsigned __int128)m->duty_reg * m->period_base;
+	m->trunkp = m->period_base >> 21;
+}
+
+/**
+ * vpwm_model_clock() - Clock a pwm_controller once.
+ * @m: The model.
+ * @period: The period input.
+ * @duty: The duty_cycle input.
+ *
+ * Return: The output pin after the edge.
+ */
+bool vpwm_model_clock(struct vpwm_model *m, uint32_t period, uint32_t duty)
+{
+	uint64_t trunk2 = vpwm_trunk2(m->high_time);
+	uint64_t trunkp2 = m->trunkp << 1;
+
+	// clk_counter, from the pipeline as it was before this edge
+	if ((uint64_t)m->count < trunk2) {
+		m->output = true;
+		m->count++;
+	} else if ((uint64_t)m->count < trunkp2) {
+		m->output = false;
+		m->count++;
+	} else {
+		m->count = 0;
+	}
+	if (m->count > INT32_MAX)
+		m->overflow = true;
+
+	// terminal_counts
+	m->high_time = (unsigned __int128)m->duty_reg * m->period_base;
+	m->trunkp = m->period_base >> 21;
+	m->period_base = vpwm_period_base(m->params, period);
+	m->duty_reg = duty & mask(VPWM_DUTY_WIDTH);
+
+	return m->output;
+}
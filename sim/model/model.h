@@ -0,0 +1,194 @@
+/* SPDX-License-Identifier: GPL-2.0 or MIT */
+/*
+ * model.h - Cycle models of the PWM and buzzer datapaths.
+ *
+ * Each block has two models that must agree:
+ *
+ * - A cycle model, one call per rising clock edge, that follows the VHDL
+ *   processes statement by statement, including the terminal count
+ *   pipeline and the output register.
+ * - A timing function that works out one steady-state period of the same
+ *   arithmetic in closed form. Sweeps use it, since some register values
+ *   take billions of clocks per period.
+ *
+ * The models keep the VHDL integer counters in 64 bits and flag any value
+ * that wouldn't fit the 32-bit integer the RTL declares.
+ */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * struct pwm_params - Generics of a Kirkland_PWM/PWM_Controller.
+ * @clk_hz: Clock frequency; 1 sec / CLK_PERIOD in the RTL.
+ * @period_width: Period register width; W_PERIOD.
+ * @period_frac: Fraction bits of the period; the RTL shifts by 7.
+ * @duty_width: Duty cycle register width; W_DUTY_CYCLE.
+ * @duty_frac: Fraction bits of the duty cycle; the RTL has 21.
+ */
+struct pwm_params {
+	uint32_t clk_hz;
+	unsigned int period_width;
+	unsigned int period_frac;
+	unsigned int duty_width;
+	unsigned int duty_frac;
+};
+
+/**
+ * struct buzzer_params - Generics of a Buzzer/Buzzer.
+ * @clk_hz: Clock frequency; 1 sec / CLK_PERIOD in the RTL.
+ * @period_width: Period register width; W_PERIOD.
+ * @period_frac: Fraction bits of the period; the RTL shifts by 12 for the
+ *               period and 13 for the high time.
+ */
+struct buzzer_params {
+	uint32_t clk_hz;
+	unsigned int period_width;
+	unsigned int period_frac;
+};
+
+/**
+ * struct vpwm_params - Constants of pwm/pwm_controller.
+ * @clk_khz: The clk_freq signal; the clock frequency in kHz.
+ *
+ * The period is 26.20 milliseconds and the duty cycle 15.14; neither is a
+ * generic.
+ */
+struct vpwm_params {
+	uint32_t clk_khz;
+};
+
+#define VPWM_PERIOD_WIDTH 26
+#define VPWM_PERIOD_FRAC 20
+#define VPWM_DUTY_WIDTH 15
+#define VPWM_DUTY_FRAC 14
+
+/**
+ * enum timing_status - Whether the counters behave.
+ * @TIMING_OK: The output repeats every @period_clocks.
+ * @TIMING_STUCK: The period works out to 0 clocks; the counter is loaded
+ *                with -1 and never counts back to 0.
+ * @TIMING_OVERFLOW: A count doesn't fit the 32-bit VHDL integer; a
+ *                   simulator stops, and the synthesised counter wraps.
+ */
+enum timing_status {
+	TIMING_OK,
+	TIMING_STUCK,
+	TIMING_OVERFLOW,
+};
+
+/**
+ * struct timing - One steady-state PWM period.
+ * @status: See enum timing_status; the counts are only meaningful when OK.
+ * @period_clocks: Clocks from one rising edge of the output to the next.
+ * @high_clocks: Clocks the output is high in each period. Equal to
+ *               @period_clocks if it never goes low, 0 if it never goes
+ *               high.
+ */
+struct timing {
+	enum timing_status status;
+	int64_t period_clocks;
+	int64_t high_clocks;
+};
+
+/**
+ * struct pwm_model - State of a PWM_Controller.
+ * @params: Its generics.
+ * @period_counter: Clocks left in the period, minus 1.
+ * @high_counter: Clocks left in the high time, minus 1.
+ * @duty_current: Duty cycle in use for the current period.
+ * @pwm_output: The modulator's output.
+ * @output: The registered output pin.
+ * @period_product: Pipeline stage 1: the period in clocks, before the shift.
+ * @next_duty: Pipeline stage 1: the duty cycle the next period uses.
+ * @period_count: Pipeline stage 2: the next period, in clocks.
+ * @high_count: Pipeline stage 2: the next high time, in clocks.
+ * @load_duty: Pipeline stage 2: @next_duty, lined up with the counts.
+ * @high_fraction: Pipeline stage 2: the high time below one clock, in
+ *                 units of 2^-(period_frac + duty_frac) clocks; 0 unless
+ *                 dithering.
+ * @residue: The dither's sigma-delta accumulator, in the same units.
+ * @overflow: A count has left the VHDL integer range.
+ */
+struct pwm_model {
+	const struct pwm_params *params;
+	int64_t period_counter;
+	int64_t high_counter;
+	uint32_t duty_current;
+	bool pwm_output;
+	bool output;
+	uint64_t period_product;
+	uint32_t next_duty;
+	int64_t period_count;
+	int64_t high_count;
+	uint32_t load_duty;
+	uint64_t high_fraction;
+	uint64_t residue;
+	bool overflow;
+};
+
+/**
+ * struct buzzer_model - State of a Buzzer.
+ * @params: Its generics.
+ * @period_counter: Clocks left in the period, minus 1.
+ * @high_counter: Clocks left in the high time, minus 1.
+ * @pwm_output: The modulator's output.
+ * @output: The registered output pin.
+ * @period_in: Pipeline stage 1: the registered period input.
+ * @period_product: Pipeline stage 2: the period in clocks, before the shift.
+ * @silent: Pipeline stage 2: the period is 0.
+ * @overflow: A count has left the VHDL integer range.
+ */
+struct buzzer_model {
+	const struct buzzer_params *params;
+	int64_t period_counter;
+	int64_t high_counter;
+	bool pwm_output;
+	bool output;
+	uint32_t period_in;
+	uint64_t period_product;
+	bool silent;
+	bool overflow;
+};
+
+/**
+ * struct vpwm_model - State of a pwm_controller.
+ * @params: Its constants.
+ * @count: Clocks into the period.
+ * @output: The registered output pin; p_clk_temp.
+ * @period_base: Pipeline stage 1: clk_freq * period.
+ * @duty_reg: Pipeline stage 1: the registered duty cycle.
+ * @high_time: Pipeline stage 2: @duty_reg * @period_base.
+ * @trunkp: Pipeline stage 2: @period_base, shifted.
+ * @overflow: @count has gone past the VHDL integer range.
+ */
+struct vpwm_model {
+	const struct vpwm_params *params;
+	int64_t count;
+	bool output;
+	uint64_t period_base;
+	uint32_t duty_reg;
+	unsigned __int128 high_time;
+	uint64_t trunkp;
+	bool overflow;
+};
+
+void pwm_timing(const struct pwm_params *p, uint32_t period, uint32_t duty, struct timing *t);
+void pwm_model_reset(struct pwm_model *m, const struct pwm_params *p, uint32_t period, uint32_t duty,
+		     bool dither);
+bool pwm_model_clock(struct pwm_model *m, uint32_t period, uint32_t duty, uint32_t step, bool dither);
+bool pwm_model_period_start(const struct pwm_model *m);
+bool pwm_model_ramping(const struct pwm_model *m, uint32_t duty);
+
+void buzzer_timing(const struct buzzer_params *p, uint32_t period, struct timing *t);
+void buzzer_model_reset(struct buzzer_model *m, const struct buzzer_params *p, uint32_t period);
+bool buzzer_model_clock(struct buzzer_model *m, uint32_t period);
+
+void vpwm_timing(const struct vpwm_params *p, uint32_t period, uint32_t duty, struct timing *t);
+void vpwm_model_reset(struct vpwm_model *m, const struct vpwm_params *p, uint32_t period,
+		      uint32_t duty);
+bool vpwm_model_clock(struct vpwm_model *m, uint32_t period, uint32_t duty);
+
+#endif /* MODEL_H */
@@ -0,0 +1,764 @@
+// SPDX-License-Identifier: GPL-2.0 or MIT
+/*
+ * sweep - What-if analysis of the PWM and buzzer register encodings.
+ *
+ * pwm, buzzer and vpwm sweep every period register value (and a grid of
+ * duty cycles) through the closed-form timing of PWM_Controller, Buzzer
+ * and pwm_controller, and report the achieved frequency, the frequency
+ * and duty cycle error against the register's fixed point value, and
+ * which register values overflow the counters. tones looks for the best
+ * buzzer register value for every note of an 88-key piano, for one or a
+ * range of period encodings. verify clocks the cycle models and checks
+ * that they match the closed form.
+ *
+ * Usage: sweep pwm    [-c clk_hz] [-w width] [-f frac] [-s period_step] [-d duty_step] [-o csv]
+ *        sweep buzzer [-c clk_hz] [-w width] [-f frac] [-s period_step] [-o csv]
+ *        sweep vpwm   [-c clk_hz] [-s period_step] [-d duty_step] [-o csv]
+ *        sweep tones  [-c clk_hz] [-w width] [-f frac[:frac]] [-v]
+ *        sweep verify [-c clk_hz]
+ */
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "model.h"
+
+// The generics and constants the components are built with
+#define CLK_HZ 50000000
+#define PWM_PERIOD_WIDTH 13
+#define PWM_PERIOD_FRAC 7
+#define PWM_DUTY_WIDTH 22
+#define PWM_DUTY_FRAC 21
+#define BUZZER_PERIOD_WIDTH 13
+#define BUZZER_PERIOD_FRAC 12
+
+// Piano range, as MIDI note numbers; 69 is A4 at 440 Hz
+#define NOTE_LO 21
+#define NOTE_HI 108
+#define NOTE_A4 69
+// Pitch error a listener won't notice
+#define IN_TUNE_CENTS 5.0
+
+/**
+ * struct options - Command line options.
+ * @clk_hz: Clock frequency.
+ * @width: Period register width, or 0 for the component's.
+ * @frac: Period fraction bits, or -1 for the component's.
+ * @frac_hi: Last fraction bits to try, for tones.
+ * @period_step: Period register step, or 0 for the sweep's default.
+ * @duty_step: Duty cycle register step, or 0 for the sweep's default.
+ * @csv: File to write every point to, or NULL.
+ * @verbose: Print every note, for tones.
+ */
+struct options {
+	uint32_t clk_hz;
+	unsigned int width;
+	int frac;
+	int frac_hi;
+	uint32_t period_step;
+	uint32_t duty_step;
+	const char *csv;
+	bool verbose;
+};
+
+/**
+ * struct sweep_stats - What a sweep found.
+ * @points: Register values swept.
+ * @stuck: Points whose period works out to 0 clocks.
+ * @overflow: Points whose counts don't fit a VHDL integer.
+ * @first_overflow: Lowest period register value that overflows.
+ * @fmin: Lowest frequency reached, in Hz.
+ * @fmax: Highest frequency reached, in Hz.
+ * @worst_ppm: Largest frequency error, in ppm.
+ * @worst_ppm_period: Period register value it's at.
+ * @worst_ppm_duty: Duty cycle register value it's at.
+ * @worst_duty: Largest duty cycle error, as a fraction of the period.
+ * @worst_duty_period: Period register value it's at.
+ * @worst_duty_duty: Duty cycle register value it's at.
+ * @sum_duty: Sum of the absolute duty cycle errors, for the mean.
+ * @glitches: Points that should be 0% but are high for one clock.
+ */
+struct sweep_stats {
+	uint64_t points;
+	uint64_t stuck;
+	uint64_t overflow;
+	uint32_t first_overflow;
+	double fmin;
+	double fmax;
+	double worst_ppm;
+	uint32_t worst_ppm_period;
+	uint32_t worst_ppm_duty;
+	double worst_duty;
+	uint32_t worst_duty_period;
+	uint32_t worst_duty_duty;
+	double sum_duty;
+	uint64_t glitches;
+};
+
+static const char *const status_names[] = {
+	[TIMING_OK] = "ok",
+	[TIMING_STUCK] = "stuck",
+	[TIMING_OVERFLOW] = "overflow",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void stats_init(struct sweep_stats *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->first_overflow = UINT32_MAX;
+	s->fmin = INFINITY;
+}
+
+/*
+ * Adds one point to the sweep: @ideal_clocks is the period the register
+ * value stands for, and @ideal_duty the fraction of it that should be high.
+ */
+static void account(struct sweep_stats *s, FILE *csv, uint32_t clk_hz, uint32_t period,
+		    uint32_t duty, double ideal_clocks, double ideal_duty, const struct timing *t)
+{
+	double freq = 0, ppm = 0, duty_err = 0;
+
+	s->points++;
+	if (t->status == TIMING_STUCK) {
+		s->stuck++;
+	} else if (t->status == TIMING_OVERFLOW) {
+		s->overflow++;
+		if (period < s->first_overflow)
+			s->first_overflow = period;
+	} else {
+		freq = (double)clk_hz / t->period_clocks;
+		if (freq < s->fmin)
+			s->fmin = freq;
+		if (freq > s->fmax)
+			s->fmax = freq;
+
+		if (ideal_clocks > 0) {
+			ppm = (ideal_clocks / t->period_clocks - 1) * 1e6;
+			if (fabs(ppm) > fabs(s->worst_ppm)) {
+				s->worst_ppm = ppm;
+				s->worst_ppm_period = period;
+				s->worst_ppm_duty = duty;
+			}
+		}
+
+		duty_err = (double)t->high_clocks / t->period_clocks - ideal_duty;
+		s->sum_duty += fabs(duty_err);
+		if (fabs(duty_err) > fabs(s->worst_duty)) {
+			s->worst_duty = duty_err;
+			s->worst_duty_period = period;
+			s->worst_duty_duty = duty;
+		}
+		if (ideal_duty == 0 && t->high_clocks > 0)
+			s->glitches++;
+	}
+
+	if (csv)
+		fprintf(csv, "%u,%u,%s,%" PRId64 ",%" PRId64 ",%.6f,%.3f,%.9f,%.9f\n", period, duty,
+			status_names[t->status], t->period_clocks, t->high_clocks, freq, ppm,
+			t->period_clocks ? (double)t->high_clocks / t->period_clocks : 0, duty_err);
+}
+
+static void print_stats(const struct sweep_stats *s, bool has_duty)
+{
+	uint64_t ok = s->points - s->stuck - s->overflow;
+
+	printf("  %" PRIu64 " points\n", s->points);
+	if (ok) {
+		printf("  frequency: %.6g Hz to %.6g Hz\n", s->fmin, s->fmax);
+		if (s->worst_ppm == 0) {
+			printf("  frequency: exact at every point\n");
+		} else {
+			printf("  worst frequency error: %+.1f ppm at period %u", s->worst_ppm,
+			       s->worst_ppm_period);
+			if (has_duty)
+				printf(", duty 0x%x", s->worst_ppm_duty);
+			printf("\n");
+		}
+		if (s->worst_duty == 0) {
+			printf("  duty cycle: exact at every point\n");
+		} else {
+			printf("  worst duty error: %+.6f%% at period %u", s->worst_duty * 100,
+			       s->worst_duty_period);
+			if (has_duty)
+				printf(", duty 0x%x", s->worst_duty_duty);
+			printf("\n");
+		}
+		printf("  mean duty error: %.6f%%\n", s->sum_duty / ok * 100);
+	}
+	if (s->glitches)
+		printf("  %" PRIu64 " points at 0%% duty are high for 1 clock per period\n", s->glitches);
+	if (s->stuck)
+		printf("  %" PRIu64 " points are stuck: the period is 0 clocks and the counter never reloads\n",
+		       s->stuck);
+	if (s->overflow)
+		printf("  %" PRIu64 " points overflow a VHDL integer, from period %u up\n", s->overflow,
+		       s->first_overflow);
+	else
+		printf("  no counter overflow\n");
+}
+
+static FILE *open_csv(const char *path)
+{
+	FILE *csv;
+
+	if (!path)
+		return NULL;
+	csv = fopen(path, "w");
+	if (!csv) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(csv, "period,duty,status,period_clocks,high_clocks,freq_hz,freq_err_ppm,duty,duty_err\n");
+	return csv;
+}
+
+static int sweep_pwm(const struct options *o)
+{
+	struct pwm_params p = {
+		.clk_hz = o->clk_hz,
+		.period_width = o->width ? o->width : PWM_PERIOD_WIDTH,
+		.period_frac = o->frac >= 0 ? o->frac : PWM_PERIOD_FRAC,
+		.duty_width = PWM_DUTY_WIDTH,
+		.duty_frac = PWM_DUTY_FRAC,
+	};
+	uint32_t period_step = o->period_step ? o->period_step : 1;
+	uint32_t duty_step = o->duty_step ? o->duty_step : 1u << (PWM_DUTY_FRAC - 10);
+	uint64_t period_max = (UINT64_C(1) << p.period_width) - 1;
+	uint32_t duty_max = 1u << p.duty_frac;
+	struct sweep_stats s;
+	struct timing t;
+	FILE *csv = open_csv(o->csv);
+	double start = now(), ideal;
+	uint64_t period;
+	uint32_t duty;
+
+	printf("PWM_Controller: %u Hz clock, %u.%u period, %u.%u duty cycle\n", p.clk_hz,
+	       p.period_width, p.period_frac, p.duty_width, p.duty_frac);
+	printf("  one period LSB is %.6g clocks\n", p.clk_hz / ldexp(1, p.period_frac));
+
+	stats_init(&s);
+	for (period = 0; period <= period_max; period += period_step) {
+		ideal = p.clk_hz * ldexp(period, -(int)p.period_frac);
+		for (duty = 0; duty <= duty_max; duty += duty_step) {
+			pwm_timing(&p, period, duty, &t);
+			account(&s, csv, p.clk_hz, period, duty, ideal, (double)duty / duty_max, &t);
+		}
+	}
+	print_stats(&s, true);
+	printf("  swept in %.2f s\n", now() - start);
+
+	if (csv)
+		fclose(csv);
+	return 0;
+}
+
+static int sweep_buzzer(const struct options *o)
+{
+	struct buzzer_params p = {
+		.clk_hz = o->clk_hz,
+		.period_width = o->width ? o->width : BUZZER_PERIOD_WIDTH,
+		.period_frac = o->frac >= 0 ? o->frac : BUZZER_PERIOD_FRAC,
+	};
+	uint32_t period_step = o->period_step ? o->period_step : 1;
+	uint64_t period_max = (UINT64_C(1) << p.period_width) - 1;
+	struct sweep_stats s;
+	struct timing t;
+	FILE *csv = open_csv(o->csv);
+	double start = now();
+	uint64_t period;
+
+	printf("Buzzer: %u Hz clock, %u.%u period\n", p.clk_hz, p.period_width, p.period_frac);
+	printf("  one period LSB is %.6g clocks\n", p.clk_hz / ldexp(1, p.period_frac));
+
+	buzzer_timing(&p, 0, &t);
+	printf("  period 0: %s\n", t.high_clocks ? "not silent" : "silent");
+
+	stats_init(&s);
+	for (period = 1; period <= period_max; period += period_step) {
+		buzzer_timing(&p, period, &t);
+		account(&s, csv, p.clk_hz, period, 0, p.clk_hz * ldexp(period, -(int)p.period_frac), 0.5, &t);
+	}
+	print_stats(&s, false);
+	printf("  swept in %.2f s\n", now() - start);
+
+	if (csv)
+		fclose(csv);
+	return 0;
+}
+
+static int sweep_vpwm(const struct options *o)
+{
+	struct vpwm_params p = {
+		.clk_khz = o->clk_hz / 1000,
+	};
+	uint32_t period_step = o->period_step ? o->period_step : 1u << (VPWM_PERIOD_FRAC - 8);
+	uint32_t duty_step = o->duty_step ? o->duty_step : 1u << (VPWM_DUTY_FRAC - 7);
+	uint64_t period_max = (UINT64_C(1) << VPWM_PERIOD_WIDTH) - 1;
+	uint32_t duty_one = 1u << VPWM_DUTY_FRAC;
+	struct sweep_stats s, over;
+	struct timing t;
+	FILE *csv = open_csv(o->csv);
+	double start = now(), ideal;
+	uint64_t period;
+	uint32_t duty;
+
+	printf("pwm_controller: %u kHz clock, %u.%u period, %u.%u duty cycle\n", p.clk_khz,
+	       VPWM_PERIOD_WIDTH, VPWM_PERIOD_FRAC, VPWM_DUTY_WIDTH, VPWM_DUTY_FRAC);
+
+	/*
+	 * A duty cycle of 1.0 or more stretches the period, so those points
+	 * get their own summary. Period 0 holds the output wherever it was and
+	 * isn't swept.
+	 */
+	stats_init(&s);
+	stats_init(&over);
+	for (period = period_step; period <= period_max; period += period_step) {
+		ideal = p.clk_khz * ldexp(period, -VPWM_PERIOD_FRAC);
+		for (duty = 0; duty < (1u << VPWM_DUTY_WIDTH); duty += duty_step) {
+			vpwm_timing(&p, period, duty, &t);
+			if (duty < duty_one)
+				account(&s, csv, p.clk_khz * 1000, period, duty, ideal,
+					(double)duty / duty_one, &t);
+			else
+				account(&over, csv, p.clk_khz * 1000, period, duty, ideal, 1.0, &t);
+		}
+	}
+	printf("  swept in %.2f s\n", now() - start);
+	printf(" duty cycles below 1.0:\n");
+	print_stats(&s, true);
+	printf(" duty cycles of 1.0 and above:\n");
+	print_stats(&over, true);
+
+	if (csv)
+		fclose(csv);
+	return 0;
+}
+
+// The Buzzer period register value closest in pitch to @freq
+static uint32_t best_register(const struct buzzer_params *p, double freq, double *cents)
+{
+	uint32_t max = (1u << p->period_width) - 1;
+	uint32_t best = 0, candidates[2];
+	double exact = ldexp(1, p->period_frac) / freq, c;
+	struct timing t;
+	int i;
+
+	candidates[0] = exact < 1 ? 1 : exact > max ? max : (uint32_t)exact;
+	candidates[1] = candidates[0] < max ? candidates[0] + 1 : max;
+	*cents = INFINITY;
+	for (i = 0; i < 2; i++) {
+		buzzer_timing(p, candidates[i], &t);
+		if (t.status != TIMING_OK)
+			continue;
+		c = 1200 * log2((double)p->clk_hz / t.period_clocks / freq);
+		if (fabs(c) < fabs(*cents)) {
+			*cents = c;
+			best = candidates[i];
+		}
+	}
+	return best;
+}
+
+static int sweep_tones(const struct options *o)
+{
+	static const char *const names[] = {
+		"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B",
+	};
+	struct buzzer_params p = {
+		.clk_hz = o->clk_hz,
+		.period_width = o->width ? o->width : BUZZER_PERIOD_WIDTH,
+	};
+	int frac_lo = o->frac >= 0 ? o->frac : BUZZER_PERIOD_FRAC;
+	int frac_hi = o->frac_hi >= frac_lo ? o->frac_hi : frac_lo;
+	int frac, note, in_tune_to, out_of_range, shared;
+	bool out_of_tune;
+	uint32_t reg, prev;
+	double freq, cents, worst, worst_a4;
+	struct timing t;
+
+	printf("Buzzer tones: %u Hz clock, %u-bit period, notes %d to %d\n", p.clk_hz,
+	       p.period_width, NOTE_LO, NOTE_HI);
+	if (!o->verbose)
+		printf("%5s %12s %11s %12s %14s %13s %9s\n", "frac", "lowest_hz", "worst_cents",
+		       "worst_A4_up", "in_tune_to", "out_of_range", "shared");
+
+	for (frac = frac_lo; frac <= frac_hi; frac++) {
+		p.period_frac = frac;
+		worst = worst_a4 = 0;
+		in_tune_to = -1;
+		out_of_tune = false;
+		out_of_range = shared = 0;
+		prev = 0;
+
+		buzzer_timing(&p, (1u << p.period_width) - 1, &t);
+		if (o->verbose)
+			printf("%u.%u period; lowest tone %.3f Hz\n%-5s %10s %8s %12s %8s\n",
+			       p.period_width, frac, (double)p.clk_hz / t.period_clocks, "note", "hz",
+			       "register", "achieved_hz", "cents");
+
+		for (note = NOTE_LO; note <= NOTE_HI; note++) {
+			freq = 440.0 * pow(2.0, (note - NOTE_A4) / 12.0);
+			reg = best_register(&p, freq, &cents);
+			// Clamped to the register range, or two notes on one value
+			if (!reg || fabs(cents) > 50)
+				out_of_range++;
+			else if (reg == prev)
+				shared++;
+			prev = reg;
+
+			if (isfinite(cents)) {
+				if (fabs(cents) > fabs(worst))
+					worst = cents;
+				if (note >= NOTE_A4 && fabs(cents) > fabs(worst_a4))
+					worst_a4 = cents;
+				// Every note from the bottom of the range up to here
+				if (fabs(cents) > IN_TUNE_CENTS)
+					out_of_tune = true;
+				else if (!out_of_tune)
+					in_tune_to = note;
+			}
+
+			if (o->verbose) {
+				buzzer_timing(&p, reg, &t);
+				printf("%-2s%-3d %10.3f %8u %12.3f %+8.2f\n", names[note % 12], note / 12 - 1,
+				       freq, reg, (double)p.clk_hz / t.period_clocks, cents);
+			}
+		}
+
+		if (o->verbose) {
+			printf("\n");
+			continue;
+		}
+		printf("%5d %12.3f %+11.2f %+12.2f", frac, (double)p.clk_hz / t.period_clocks,
+		       worst, worst_a4);
+		if (in_tune_to >= 0)
+			printf(" %10s%-4d", names[in_tune_to % 12], in_tune_to / 12 - 1);
+		else
+			printf(" %14s", "none");
+		printf(" %13d %9d\n", out_of_range, shared);
+	}
+	return 0;
+}
+
+/*
+ * Clocks a model until its output has had three rising edges, and
+ * measures the period and high time between the second and third; the
+ * first period after reset is skipped. If the output stops changing,
+ * returns it in @level instead.
+ */
+#define MEASURE(clock_expr, limit, t, level)					\
+	do {									\
+		int64_t n_, rise_[3], fall_ = -1;				\
+		bool prev_ = false, out_;					\
+		int nr_ = 0;							\
+										\
+		for (n_ = 0; n_ < (int64_t)(limit) && nr_ < 3; n_++) {		\
+			out_ = (clock_expr);					\
+			if (out_ && !prev_)					\
+				rise_[nr_++] = n_;				\
+			else if (!out_ && prev_ && nr_ == 2 && fall_ < 0)	\
+				fall_ = n_;					\
+			prev_ = out_;						\
+		}								\
+		(t)->status = TIMING_OK;					\
+		(t)->period_clocks = nr_ == 3 ? rise_[2] - rise_[1] : 0;	\
+		(t)->high_clocks = nr_ == 3 ? fall_ - rise_[1] : 0;		\
+		(level) = prev_;						\
+	} while (0)
+
+/*
+ * Compares a measured period with the closed form; a constant output has
+ * to match a closed form that never goes low, or never goes high.
+ */
+static bool matches(const struct timing *want, const struct timing *got, bool level)
+{
+	if (want->high_clocks == want->period_clocks)
+		return got->period_clocks == 0 && level;
+	if (want->high_clocks == 0)
+		return got->period_clocks == 0 && !level;
+	return got->period_clocks == want->period_clocks && got->high_clocks == want->high_clocks;
+}
+
+static int mismatch(const char *block, uint32_t period, uint32_t duty, const struct timing *want,
+		    const struct timing *got)
+{
+	fprintf(stderr, "%s period 0x%x duty 0x%x: closed form %" PRId64 "/%" PRId64
+		", cycle model %" PRId64 "/%" PRId64 " clocks high/period\n", block, period, duty,
+		want->high_clocks, want->period_clocks, got->high_clocks, got->period_clocks);
+	return 1;
+}
+
+/*
+ * With dither, the high clocks summed over the first n periods have to
+ * stay within one clock below n times the exact high time, for every n;
+ * that's what makes the average duty cycle exact.
+ */
+static int verify_pwm_dither(const struct pwm_params *p)
+{
+	static const uint32_t low_duties[] = { 0x2345, 0x4000, 0x6789, 0xabcd };
+	unsigned int shift = p->period_frac + p->duty_frac;
+	struct pwm_model m;
+	struct timing t;
+	__int128 exact, error;
+	uint64_t high, product;
+	uint32_t period, duty, periods;
+	unsigned int i;
+	int errors = 0;
+
+	for (period = 1; period <= 8; period++) {
+		product = (uint64_t)p->clk_hz * period;
+		for (i = 0; i < 32 + sizeof(low_duties) / sizeof(low_duties[0]); i++) {
+			duty = i < 32 ? (i << (p->duty_frac - 5)) + 0x1234 : low_duties[i - 32];
+			pwm_timing(p, period, duty, &t);
+			exact = (__int128)product * duty;
+			/*
+			 * The reload clock is always high, so a high time under a
+			 * clock still shows as one; and the carry can't lengthen a
+			 * high time that's already the period
+			 */
+			if (t.status != TIMING_OK || (exact >> shift) == 0 ||
+			    t.high_clocks + 1 >= t.period_clocks)
+				continue;
+
+			pwm_model_reset(&m, p, period, duty, true);
+			high = 0;
+			periods = 0;
+			// The first clock after reset starts the first period
+			while (periods <= 256) {
+				if (pwm_model_period_start(&m) && periods++) {
+					error = ((__int128)high << shift) - (periods - 1) * exact;
+					if (error > 0 || error <= -((__int128)1 << shift)) {
+						fprintf(stderr, "PWM_Controller dither period 0x%x duty 0x%x: "
+							"%" PRIu64 " clocks high in %u periods\n",
+							period, duty, high, periods - 1);
+						errors++;
+						break;
+					}
+				}
+				pwm_model_clock(&m, period, duty, 0, true);
+				high += m.pwm_output;
+			}
+		}
+	}
+
+	return errors;
+}
+
+static int verify_pwm(uint32_t clk_hz)
+{
+	static const uint32_t edge_duties[] = { 0, 1, 0x1fffff, 0x200000, 0x200001, 0x3fffff };
+	struct pwm_params p = {
+		.clk_hz = clk_hz,
+		.period_width = PWM_PERIOD_WIDTH,
+		.period_frac = PWM_PERIOD_FRAC,
+		.duty_width = PWM_DUTY_WIDTH,
+		.duty_frac = PWM_DUTY_FRAC,
+	};
+	struct pwm_model m;
+	struct timing want, got;
+	uint32_t period, duty, starts;
+	unsigned int i, points = 0;
+	int errors = 0;
+	bool level, start;
+
+	for (period = 1; period <= 64; period++) {
+		for (i = 0; i < 33 + sizeof(edge_duties) / sizeof(edge_duties[0]); i++) {
+			duty = i < 33 ? i << (PWM_DUTY_FRAC - 5) : edge_duties[i - 33];
+			pwm_timing(&p, period, duty, &want);
+			if (want.status != TIMING_OK)
+				continue;
+			pwm_model_reset(&m, &p, period, duty, false);
+			MEASURE(pwm_model_clock(&m, period, duty, 0, false), 4 * want.period_clocks + 16, &got,
+				level);
+			if (!matches(&want, &got, level))
+				errors += mismatch("PWM_Controller", period, duty, &want, &got);
+			points++;
+		}
+	}
+
+	/*
+	 * A ramp from 25% to 75% in 12.5% steps, started mid-period, reaches
+	 * it at the fourth reload
+	 */
+	pwm_model_reset(&m, &p, 1, 0x080000, false);
+	for (i = 0; i < p.clk_hz >> (PWM_PERIOD_FRAC + 1); i++)
+		pwm_model_clock(&m, 1, 0x080000, 0, false);
+	starts = 0;
+	while (pwm_model_ramping(&m, 0x180000)) {
+		start = pwm_model_period_start(&m);
+		pwm_model_clock(&m, 1, 0x180000, 0x040000, false);
+		starts += start;
+		if (starts > 8)
+			break;
+	}
+	if (starts != 4) {
+		fprintf(stderr, "PWM_Controller ramp: %u reloads, expected 4\n", starts);
+		errors++;
+	}
+
+	errors += verify_pwm_dither(&p);
+
+	printf("PWM_Controller at %u Hz: %u points, %d mismatches\n", clk_hz, points, errors);
+	return errors;
+}
+
+static int verify_buzzer(uint32_t clk_hz)
+{
+	struct buzzer_params p = {
+		.clk_hz = clk_hz,
+		.period_width = BUZZER_PERIOD_WIDTH,
+		.period_frac = BUZZER_PERIOD_FRAC,
+	};
+	struct buzzer_model m;
+	struct timing want, got;
+	unsigned int points = 0;
+	uint32_t period;
+	int errors = 0;
+	bool level;
+
+	for (period = 0; period <= 32; period++) {
+		buzzer_timing(&p, period, &want);
+		if (want.status != TIMING_OK)
+			continue;
+		buzzer_model_reset(&m, &p, period);
+		MEASURE(buzzer_model_clock(&m, period), 4 * want.period_clocks + 16, &got, level);
+		if (!matches(&want, &got, level))
+			errors += mismatch("Buzzer", period, 0, &want, &got);
+		points++;
+	}
+
+	printf("Buzzer at %u Hz: %u points, %d mismatches\n", clk_hz, points, errors);
+	return errors;
+}
+
+static int verify_vpwm(uint32_t clk_hz)
+{
+	struct vpwm_params p = {
+		.clk_khz = clk_hz / 1000,
+	};
+	struct vpwm_model m;
+	struct timing want, got;
+	unsigned int points = 0;
+	uint32_t period, duty;
+	int errors = 0;
+	bool level;
+
+	for (period = 0x8000; period <= 0x100000; period += 0x8000) {
+		for (duty = 0; duty < (1u << VPWM_DUTY_WIDTH); duty += 0x800) {
+			vpwm_timing(&p, period, duty, &want);
+			if (want.status != TIMING_OK)
+				continue;
+			vpwm_model_reset(&m, &p, period, duty);
+			MEASURE(vpwm_model_clock(&m, period, duty), 4 * want.period_clocks + 16, &got, level);
+			if (!matches(&want, &got, level))
+				errors += mismatch("pwm_controller", period, duty, &want, &got);
+			points++;
+		}
+	}
+
+	printf("pwm_controller at %u kHz: %u points, %d mismatches\n", p.clk_khz, points, errors);
+	return errors;
+}
+
+static int verify(const struct options *o)
+{
+	int errors = 0;
+
+	// Like PWM_Controller_tb, run the PWM at a thousandth of the clock, so
+	// a period is hundreds of clocks instead of hundreds of thousands
+	errors += verify_pwm(o->clk_hz / 1000);
+	errors += verify_buzzer(o->clk_hz);
+	errors += verify_vpwm(o->clk_hz);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s pwm    [-c clk_hz] [-w width] [-f frac] [-s period_step] [-d duty_step] [-o csv]\n"
+		"       %s buzzer [-c clk_hz] [-w width] [-f frac] [-s period_step] [-o csv]\n"
+		"       %s vpwm   [-c clk_hz] [-s period_step] [-d duty_step] [-o csv]\n"
+		"       %s tones  [-c clk_hz] [-w width] [-f frac[:frac]] [-v]\n"
+		"       %s verify [-c clk_hz]\n",
+		prog, prog, prog, prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct options o = {
+		.clk_hz = CLK_HZ,
+		.frac = -1,
+		.frac_hi = -1,
+	};
+	const char *cmd;
+	char *end;
+	int opt;
+
+	if (argc < 2) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	cmd = argv[1];
+
+	optind = 2;
+	while ((opt = getopt(argc, argv, "c:w:f:s:d:o:v")) != -1) {
+		switch (opt) {
+		case 'c':
+			o.clk_hz = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			o.width = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			o.frac = strtol(optarg, &end, 0);
+			if (*end == ':')
+				o.frac_hi = strtol(end + 1, NULL, 0);
+			break;
+		case 's':
+			o.period_step = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			o.duty_step = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			o.csv = optarg;
+			break;
+		case 'v':
+			o.verbose = true;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!o.clk_hz || o.width > 31 || o.frac > 31 || o.frac_hi > 31) {
+		fprintf(stderr, "clock must be nonzero, width and frac at most 31\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!strcmp(cmd, "pwm"))
+		return sweep_pwm(&o);
+	if (!strcmp(cmd, "buzzer"))
+		return sweep_buzzer(&o);
+	if (!strcmp(cmd, "vpwm"))
+		return sweep_vpwm(&o);
+	if (!strcmp(cmd, "tones"))
+		return sweep_tones(&o);
+	if (!strcmp(cmd, "verify"))
+		return verify(&o);
+
+	usage(argv[0]);
+	return EXIT_FAILURE;
+}
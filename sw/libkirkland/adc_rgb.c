@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MIT
+/*
+ * adc_rgb - Example for libkirkland. Reads ADC channels 0-2 in a loop and
+ * writes them to the RGB LED's duty cycles, which is what pwm_miscdev_test.c
+ * set out to do.
+ *
+ * usage: adc_rgb [miscdev|uio|devmem] [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "kirkland.h"
+
+// An RGB duty cycle of 1.0 in its 22.21 fixed-point format
+#define RGB_DUTY_ONE (1u << 21)
+
+int main(int argc, char **argv)
+{
+	enum kirkland_backend backend = KIRKLAND_BACKEND_AUTO;
+	struct kirkland_dev *adc;
+	struct kirkland_dev *rgb;
+	uint16_t ch[KIRKLAND_ADC_CHANNELS];
+	struct timespec start, end;
+	long iterations = 100000;
+	long i;
+	double secs;
+	int ret = 0;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "miscdev") == 0) {
+			backend = KIRKLAND_BACKEND_MISCDEV;
+		}
+		else if (strcmp(argv[1], "uio") == 0) {
+			backend = KIRKLAND_BACKEND_UIO;
+		}
+		else if (strcmp(argv[1], "devmem") == 0) {
+			backend = KIRKLAND_BACKEND_DEVMEM;
+		}
+		else {
+			fprintf(stderr, "usage: %s [miscdev|uio|devmem] [iterations]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (argc > 2) {
+		iterations = strtol(argv[2], NULL, 0);
+	}
+
+	adc = kirkland_open(KIRKLAND_ADC, backend);
+	if (adc == NULL) {
+		perror("failed to open the adc");
+		return 1;
+	}
+	rgb = kirkland_open(KIRKLAND_RGB, backend);
+	if (rgb == NULL) {
+		perror("failed to open the rgb controller");
+		kirkland_close(adc);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < iterations && ret == 0; i++) {
+		ret = kirkland_adc_read(adc, ch);
+		if (ret == 0) {
+			// Scale the 12-bit readings to duty cycles of 0 to 1.
+			ret = kirkland_rgb_set(rgb,
+				(uint32_t)ch[0] * (RGB_DUTY_ONE / 4096),
+				(uint32_t)ch[1] * (RGB_DUTY_ONE / 4096),
+				(uint32_t)ch[2] * (RGB_DUTY_ONE / 4096));
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (ret < 0) {
+		fprintf(stderr, "register access failed: %s\n", strerror(-ret));
+	}
+	else {
+		secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+		printf("%ld updates in %.3f s (%.2f us each)\n", i, secs,
+			secs * 1e6 / i);
+	}
+
+	kirkland_close(rgb);
+	kirkland_close(adc);
+
+	return ret < 0;
+}
@@ -0,0 +1,577 @@
+// SPDX-License-Identifier: MIT
+/*
+ * libkirkland - user-space access to the final project's Avalon components.
+ * See kirkland.h for the interface.
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "kirkland.h"
+#include "de10nano_adc.h"
+
+#define UIO_SYSFS "/sys/class/uio"
+
+/**
+ * struct kirkland_block_info - Where a component usually lives.
+ * @miscdev: Path of the driver's device node.
+ * @uio_name: Name of the device tree node, which UIO uses as the device name.
+ * @phys_addr: Base address in socfpga_cyclone5_de10nano_final_project.dts.
+ * @span: Bytes of registers.
+ * @miscdev_span: Bytes of registers the driver's read()/write() cover.
+ */
+struct kirkland_block_info {
+	const char *miscdev;
+	const char *uio_name;
+	unsigned long phys_addr;
+	uint32_t span;
+	uint32_t miscdev_span;
+};
+
+static const struct kirkland_block_info block_info[] = {
+	[KIRKLAND_RGB] = {
+		.miscdev = "/dev/kirkland_rgb",
+		.uio_name = "rgb_controller",
+		.phys_addr = 0xff33E720,
+		.span = 32,
+		.miscdev_span = 32,
+	},
+	[KIRKLAND_BUZZER] = {
+		.miscdev = "/dev/kirkland_buzzer",
+		.uio_name = "buzzer",
+		.phys_addr = 0xff334200,
+		.span = 16,
+		.miscdev_span = 16,
+	},
+	[KIRKLAND_PWM] = {
+		.miscdev = "/dev/pwm",
+		.uio_name = "pwm",
+		.phys_addr = 0xff25E240,
+		.span = 16,
+		.miscdev_span = 16,
+	},
+	[KIRKLAND_ADC] = {
+		.miscdev = "/dev/adc",
+		.uio_name = "adc",
+		.phys_addr = 0xff200000,
+		.span = 128,
+		.miscdev_span = 32,
+	},
+};
+
+/**
+ * struct kirkland_dev - An open component.
+ * @block: Which component.
+ * @backend: How its registers are reached.
+ * @fd: The miscdev, UIO device or /dev/mem.
+ * @map: Start of the mapping, for the UIO and /dev/mem backends.
+ * @map_len: Length of @map.
+ * @regs: The component's first register inside @map.
+ * @span: Bytes of registers that may be accessed.
+ */
+struct kirkland_dev {
+	enum kirkland_block block;
+	enum kirkland_backend backend;
+	int fd;
+	void *map;
+	size_t map_len;
+	volatile uint32_t *regs;
+	uint32_t span;
+};
+
+/**
+ * read_sysfs_ulong() - Read a number from a sysfs file.
+ * @path: The file.
+ * @val: Where to put the number.
+ *
+ * Return: 0, or -1 if the file can't be read or doesn't hold a number.
+ */
+static int read_sysfs_ulong(const char *path, unsigned long *val)
+{
+	FILE *f;
+	int ret;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		return -1;
+	}
+	ret = fscanf(f, "%li", (long *)val) == 1 ? 0 : -1;
+	fclose(f);
+
+	return ret;
+}
+
+/**
+ * find_uio() - Find the UIO device with a given name.
+ * @name: The name, as found in /sys/class/uio/uioN/name.
+ * @index: Where to put N.
+ *
+ * Return: 0, or -1 if there's no such device.
+ */
+static int find_uio(const char *name, int *index)
+{
+	char path[64];
+	char uio_name[64];
+	struct dirent *ent;
+	DIR *dir;
+	FILE *f;
+	int found = -1;
+
+	dir = opendir(UIO_SYSFS);
+	if (dir == NULL) {
+		return -1;
+	}
+
+	while (found < 0 && (ent = readdir(dir)) != NULL) {
+		if (sscanf(ent->d_name, "uio%d", index) != 1) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), UIO_SYSFS "/uio%d/name", *index);
+		f = fopen(path, "r");
+		if (f == NULL) {
+			continue;
+		}
+		if (fgets(uio_name, sizeof(uio_name), f) != NULL) {
+			uio_name[strcspn(uio_name, "\n")] = '\0';
+			if (strcmp(uio_name, name) == 0) {
+				found = 0;
+			}
+		}
+		fclose(f);
+	}
+	closedir(dir);
+
+	return found;
+}
+
+/**
+ * open_uio() - Map a component's registers through UIO.
+ * @dev: The device being opened.
+ * @name: UIO device name.
+ *
+ * uio_pdrv_genirq maps whole pages, so a component that doesn't start on a
+ * page boundary sits maps/map0/offset bytes into the mapping.
+ *
+ * Return: 0, or -1 with errno set.
+ */
+static int open_uio(struct kirkland_dev *dev, const char *name)
+{
+	char path[64];
+	unsigned long size;
+	unsigned long offset = 0;
+	long page = sysconf(_SC_PAGESIZE);
+	int index;
+
+	if (find_uio(name, &index) < 0) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), UIO_SYSFS "/uio%d/maps/map0/size", index);
+	if (read_sysfs_ulong(path, &size) < 0) {
+		errno = ENODEV;
+		return -1;
+	}
+	// Older kernels don't have the offset attribute; assume page alignment.
+	snprintf(path, sizeof(path), UIO_SYSFS "/uio%d/maps/map0/offset", index);
+	read_sysfs_ulong(path, &offset);
+
+	// The device tree node may give a smaller span, like the Terasic ADC's.
+	if (size < dev->span) {
+		dev->span = size;
+	}
+
+	snprintf(path, sizeof(path), "/dev/uio%d", index);
+	dev->fd = open(path, O_RDWR | O_SYNC);
+	if (dev->fd < 0) {
+		return -1;
+	}
+
+	// Map 0 is selected by an mmap() offset of 0.
+	dev->map_len = (offset + dev->span + page - 1) & ~(page - 1);
+	dev->map = mmap(NULL, dev->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		dev->fd, 0);
+	if (dev->map == MAP_FAILED) {
+		dev->map = NULL;
+		return -1;
+	}
+	dev->regs = (volatile uint32_t *)((char *)dev->map + offset);
+
+	return 0;
+}
+
+/**
+ * open_devmem() - Map a component's registers from /dev/mem.
+ * @dev: The device being opened.
+ * @phys_addr: The component's base address.
+ *
+ * Return: 0, or -1 with errno set.
+ */
+static int open_devmem(struct kirkland_dev *dev, unsigned long phys_addr)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	unsigned long offset = phys_addr & (page - 1);
+
+	dev->fd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (dev->fd < 0) {
+		return -1;
+	}
+
+	dev->map_len = (offset + dev->span + page - 1) & ~(page - 1);
+	dev->map = mmap(NULL, dev->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		dev->fd, phys_addr - offset);
+	if (dev->map == MAP_FAILED) {
+		dev->map = NULL;
+		return -1;
+	}
+	dev->regs = (volatile uint32_t *)((char *)dev->map + offset);
+
+	return 0;
+}
+
+struct kirkland_dev *kirkland_open_at(enum kirkland_block block,
+	enum kirkland_backend backend, const char *name, unsigned long phys_addr)
+{
+	const struct kirkland_block_info *info;
+	struct kirkland_dev *dev;
+	int ret;
+
+	if ((unsigned int)block >= sizeof(block_info) / sizeof(block_info[0])) {
+		errno = EINVAL;
+		return NULL;
+	}
+	info = &block_info[block];
+
+	dev = calloc(1, sizeof(*dev));
+	if (dev == NULL) {
+		return NULL;
+	}
+	dev->block = block;
+	dev->backend = backend;
+	dev->fd = -1;
+
+	switch (backend) {
+	case KIRKLAND_BACKEND_MISCDEV:
+		dev->span = info->miscdev_span;
+		dev->fd = open(name ? name : info->miscdev, O_RDWR);
+		ret = dev->fd < 0 ? -1 : 0;
+		break;
+	case KIRKLAND_BACKEND_UIO:
+		dev->span = info->span;
+		ret = open_uio(dev, name ? name : info->uio_name);
+		break;
+	case KIRKLAND_BACKEND_DEVMEM:
+		dev->span = info->span;
+		ret = open_devmem(dev, phys_addr ? phys_addr : info->phys_addr);
+		break;
+	default:
+		errno = EINVAL;
+		ret = -1;
+		break;
+	}
+
+	if (ret < 0) {
+		int err = errno;
+
+		kirkland_close(dev);
+		errno = err;
+		return NULL;
+	}
+
+	return dev;
+}
+
+struct kirkland_dev *kirkland_open(enum kirkland_block block,
+	enum kirkland_backend backend)
+{
+	struct kirkland_dev *dev;
+
+	if (backend != KIRKLAND_BACKEND_AUTO) {
+		return kirkland_open_at(block, backend, NULL, 0);
+	}
+
+	dev = kirkland_open_at(block, KIRKLAND_BACKEND_UIO, NULL, 0);
+	if (dev == NULL) {
+		dev = kirkland_open_at(block, KIRKLAND_BACKEND_MISCDEV, NULL, 0);
+	}
+
+	return dev;
+}
+
+void kirkland_close(struct kirkland_dev *dev)
+{
+	if (dev == NULL) {
+		return;
+	}
+	if (dev->map != NULL) {
+		munmap(dev->map, dev->map_len);
+	}
+	if (dev->fd >= 0) {
+		close(dev->fd);
+	}
+	free(dev);
+}
+
+enum kirkland_backend kirkland_backend(const struct kirkland_dev *dev)
+{
+	return dev->backend;
+}
+
+/**
+ * check_range() - Make sure an access stays inside the component.
+ * @dev: The device.
+ * @offset: Byte offset of the first register.
+ * @n: Number of registers.
+ *
+ * Return: 0, or -EINVAL.
+ */
+static int check_range(const struct kirkland_dev *dev, uint32_t offset,
+	size_t n)
+{
+	if (offset % sizeof(uint32_t) != 0 || offset > dev->span ||
+		n > (dev->span - offset) / sizeof(uint32_t)) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int kirkland_read(struct kirkland_dev *dev, uint32_t offset, uint32_t *vals,
+	size_t n)
+{
+	size_t i;
+	ssize_t ret;
+
+	if (check_range(dev, offset, n) < 0) {
+		return -EINVAL;
+	}
+
+	if (dev->regs != NULL) {
+		for (i = 0; i < n; i++) {
+			vals[i] = dev->regs[offset / sizeof(uint32_t) + i];
+		}
+		return 0;
+	}
+
+	ret = pread(dev->fd, vals, n * sizeof(uint32_t), offset);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return (size_t)ret == n * sizeof(uint32_t) ? 0 : -EIO;
+}
+
+int kirkland_write(struct kirkland_dev *dev, uint32_t offset,
+	const uint32_t *vals, size_t n)
+{
+	size_t i;
+	ssize_t ret;
+
+	if (check_range(dev, offset, n) < 0) {
+		return -EINVAL;
+	}
+
+	if (dev->regs != NULL) {
+		for (i = 0; i < n; i++) {
+			dev->regs[offset / sizeof(uint32_t) + i] = vals[i];
+		}
+		return 0;
+	}
+
+	ret = pwrite(dev->fd, vals, n * sizeof(uint32_t), offset);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return (size_t)ret == n * sizeof(uint32_t) ? 0 : -EIO;
+}
+
+/**
+ * rgb_commit() - Apply the RGB controller's shadow registers.
+ * @dev: The RGB device.
+ *
+ * The driver commits after every write, so only the mapped backends have to.
+ *
+ * Return: 0, or a negative errno.
+ */
+static int rgb_commit(struct kirkland_dev *dev)
+{
+	if (dev->regs == NULL) {
+		return 0;
+	}
+
+	return kirkland_write32(dev, KIRKLAND_RGB_COMMIT, 1);
+}
+
+int kirkland_rgb_set_period(struct kirkland_dev *dev, uint32_t period)
+{
+	int ret;
+
+	if (dev->block != KIRKLAND_RGB) {
+		return -ENODEV;
+	}
+
+	ret = kirkland_write32(dev, KIRKLAND_RGB_PERIOD, period);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return rgb_commit(dev);
+}
+
+int kirkland_rgb_set(struct kirkland_dev *dev, uint32_t red, uint32_t grn,
+	uint32_t blu)
+{
+	uint32_t duty[3] = { red, grn, blu };
+	int ret;
+
+	if (dev->block != KIRKLAND_RGB) {
+		return -ENODEV;
+	}
+
+	ret = kirkland_write(dev, KIRKLAND_RGB_RED_DUTY_CYCLE, duty, 3);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return rgb_commit(dev);
+}
+
+int kirkland_rgb_fade(struct kirkland_dev *dev, const uint32_t duty[3],
+	const uint32_t step[3])
+{
+	int ret;
+
+	if (dev->block != KIRKLAND_RGB) {
+		return -ENODEV;
+	}
+
+	/*
+	 * Steps first: through the driver, that write commits the new steps
+	 * with the old targets, which doesn't move anything, and the duty cycle
+	 * write then starts the fade.
+	 */
+	ret = kirkland_write(dev, KIRKLAND_RGB_RED_RAMP_STEP, step, 3);
+	if (ret < 0) {
+		return ret;
+	}
+	ret = kirkland_write(dev, KIRKLAND_RGB_RED_DUTY_CYCLE, duty, 3);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return rgb_commit(dev);
+}
+
+int kirkland_rgb_status(struct kirkland_dev *dev, uint32_t *status)
+{
+	if (dev->block != KIRKLAND_RGB) {
+		return -ENODEV;
+	}
+
+	return kirkland_read32(dev, KIRKLAND_RGB_COMMIT, status);
+}
+
+int kirkland_buzzer_set_period(struct kirkland_dev *dev, uint32_t period)
+{
+	if (dev->block != KIRKLAND_BUZZER) {
+		return -ENODEV;
+	}
+
+	return kirkland_write32(dev, KIRKLAND_BUZZER_PERIOD, period);
+}
+
+int kirkland_buzzer_push_note(struct kirkland_dev *dev, uint32_t period,
+	uint32_t duration_clocks)
+{
+	// duration_reg and note_push are adjacent, so this is a single write.
+	uint32_t note[2] = { duration_clocks, period };
+
+	if (dev->block != KIRKLAND_BUZZER) {
+		return -ENODEV;
+	}
+
+	return kirkland_write(dev, KIRKLAND_BUZZER_DURATION, note, 2);
+}
+
+int kirkland_buzzer_status(struct kirkland_dev *dev, uint32_t *status)
+{
+	if (dev->block != KIRKLAND_BUZZER) {
+		return -ENODEV;
+	}
+
+	return kirkland_read32(dev, KIRKLAND_BUZZER_STATUS, status);
+}
+
+int kirkland_buzzer_flush(struct kirkland_dev *dev)
+{
+	if (dev->block != KIRKLAND_BUZZER) {
+		return -ENODEV;
+	}
+
+	return kirkland_write32(dev, KIRKLAND_BUZZER_STATUS,
+		KIRKLAND_BUZZER_STATUS_FLUSH);
+}
+
+int kirkland_pwm_set(struct kirkland_dev *dev, uint32_t red, uint32_t grn,
+	uint32_t blu)
+{
+	uint32_t duty[3] = { red, grn, blu };
+
+	if (dev->block != KIRKLAND_PWM) {
+		return -ENODEV;
+	}
+
+	return kirkland_write(dev, KIRKLAND_PWM_RED, duty, 3);
+}
+
+int kirkland_pwm_set_period(struct kirkland_dev *dev, uint32_t period)
+{
+	if (dev->block != KIRKLAND_PWM) {
+		return -ENODEV;
+	}
+
+	return kirkland_write32(dev, KIRKLAND_PWM_PERIOD, period);
+}
+
+int kirkland_adc_read(struct kirkland_dev *dev,
+	uint16_t ch[KIRKLAND_ADC_CHANNELS])
+{
+	uint32_t vals[KIRKLAND_ADC_CHANNELS];
+	struct adc_scan scan;
+	int i;
+	int ret;
+
+	if (dev->block != KIRKLAND_ADC) {
+		return -ENODEV;
+	}
+
+	/*
+	 * read() of /dev/adc returns scans instead of registers while streaming
+	 * is on, so go through the snapshot ioctl, which works either way.
+	 */
+	if (dev->regs == NULL) {
+		if (ioctl(dev->fd, ADC_IOC_SNAPSHOT, &scan) < 0) {
+			return -errno;
+		}
+		memcpy(ch, scan.ch, sizeof(scan.ch));
+		return 0;
+	}
+
+	ret = kirkland_read(dev, 0, vals, KIRKLAND_ADC_CHANNELS);
+	if (ret < 0) {
+		return ret;
+	}
+	for (i = 0; i < KIRKLAND_ADC_CHANNELS; i++) {
+		ch[i] = vals[i] & KIRKLAND_ADC_VALUE_MASK;
+	}
+
+	return 0;
+}
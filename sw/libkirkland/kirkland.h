@@ -0,0 +1,233 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * libkirkland - user-space access to the final project's Avalon components.
+ *
+ * Every component can be reached through one of three backends:
+ *
+ *   KIRKLAND_BACKEND_MISCDEV  The component's kernel driver (/dev/kirkland_rgb,
+ *                             /dev/kirkland_buzzer, /dev/pwm, /dev/adc). Each
+ *                             batch of registers is one pread()/pwrite().
+ *   KIRKLAND_BACKEND_UIO      The component's registers mmap()ed through a UIO
+ *                             device. Register accesses are plain loads and
+ *                             stores with no syscalls.
+ *   KIRKLAND_BACKEND_DEVMEM   The registers mmap()ed from /dev/mem. Needs root,
+ *                             and bypasses the kernel driver's locking if the
+ *                             driver is loaded too.
+ *
+ * The typed calls behave the same on every backend.
+ */
+#ifndef KIRKLAND_H
+#define KIRKLAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The components the library knows about
+enum kirkland_block {
+	KIRKLAND_RGB,
+	KIRKLAND_BUZZER,
+	KIRKLAND_PWM,
+	KIRKLAND_ADC,
+};
+
+// How to reach a component's registers
+enum kirkland_backend {
+	// UIO if the component has a UIO device, otherwise its miscdev
+	KIRKLAND_BACKEND_AUTO,
+	KIRKLAND_BACKEND_MISCDEV,
+	KIRKLAND_BACKEND_UIO,
+	KIRKLAND_BACKEND_DEVMEM,
+};
+
+// RGB controller register offsets
+#define KIRKLAND_RGB_PERIOD 0x00
+#define KIRKLAND_RGB_RED_DUTY_CYCLE 0x04
+#define KIRKLAND_RGB_GRN_DUTY_CYCLE 0x08
+#define KIRKLAND_RGB_BLU_DUTY_CYCLE 0x0C
+#define KIRKLAND_RGB_COMMIT 0x10
+#define KIRKLAND_RGB_RED_RAMP_STEP 0x14
+#define KIRKLAND_RGB_GRN_RAMP_STEP 0x18
+#define KIRKLAND_RGB_BLU_RAMP_STEP 0x1C
+
+// commit_reg bits: a commit is pending, and each channel is still ramping
+#define KIRKLAND_RGB_COMMIT_PENDING 0x1
+#define KIRKLAND_RGB_RAMPING 0xE
+
+// Buzzer register offsets
+#define KIRKLAND_BUZZER_PERIOD 0x00
+#define KIRKLAND_BUZZER_DURATION 0x04
+#define KIRKLAND_BUZZER_NOTE_PUSH 0x08
+#define KIRKLAND_BUZZER_STATUS 0x0C
+
+// Buzzer status_reg fields
+#define KIRKLAND_BUZZER_STATUS_LEVEL 0x3F
+#define KIRKLAND_BUZZER_STATUS_PLAYING 0x100
+#define KIRKLAND_BUZZER_STATUS_UNDERRUN 0x200
+#define KIRKLAND_BUZZER_STATUS_FLUSH 0x400
+
+// Notes the buzzer's sequencer FIFO holds
+#define KIRKLAND_BUZZER_FIFO_DEPTH 32
+
+// Buzzer note durations are in 50 MHz clocks
+#define KIRKLAND_CLOCKS_PER_MS 50000
+
+// PWM register offsets
+#define KIRKLAND_PWM_RED 0x00
+#define KIRKLAND_PWM_GRN 0x04
+#define KIRKLAND_PWM_BLU 0x08
+#define KIRKLAND_PWM_PERIOD 0x0C
+
+// Number of ADC channels, and the mask for a channel register's value
+#define KIRKLAND_ADC_CHANNELS 8
+#define KIRKLAND_ADC_VALUE_MASK 0xFFF
+
+struct kirkland_dev;
+
+/**
+ * kirkland_open() - Open a component at its usual location.
+ * @block: Which component.
+ * @backend: How to reach it.
+ *
+ * The miscdev backend opens the driver's usual /dev node, the UIO backend
+ * looks for a UIO device named after the component's device tree node
+ * ("rgb_controller", "buzzer", "pwm" or "adc"), and the /dev/mem backend maps
+ * the address from socfpga_cyclone5_de10nano_final_project.dts.
+ *
+ * Return: The device, or NULL with errno set.
+ */
+struct kirkland_dev *kirkland_open(enum kirkland_block block,
+	enum kirkland_backend backend);
+
+/**
+ * kirkland_open_at() - Open a component somewhere other than its usual place.
+ * @block: Which component.
+ * @backend: How to reach it; not KIRKLAND_BACKEND_AUTO.
+ * @name: Miscdev path or UIO device name, or NULL for the usual one.
+ * @phys_addr: Base address for the /dev/mem backend, or 0 for the usual one.
+ *
+ * Return: The device, or NULL with errno set.
+ */
+struct kirkland_dev *kirkland_open_at(enum kirkland_block block,
+	enum kirkland_backend backend, const char *name, unsigned long phys_addr);
+
+/**
+ * kirkland_close() - Unmap and close a component.
+ * @dev: The device; NULL is ignored.
+ */
+void kirkland_close(struct kirkland_dev *dev);
+
+/**
+ * kirkland_backend() - Find out which backend a device ended up on.
+ * @dev: The device.
+ *
+ * Return: The backend; never KIRKLAND_BACKEND_AUTO.
+ */
+enum kirkland_backend kirkland_backend(const struct kirkland_dev *dev);
+
+/**
+ * kirkland_read() - Read consecutive registers.
+ * @dev: The device.
+ * @offset: Byte offset of the first register.
+ * @vals: Where to put the values.
+ * @n: Number of registers.
+ *
+ * Return: 0, or a negative errno.
+ */
+int kirkland_read(struct kirkland_dev *dev, uint32_t offset, uint32_t *vals,
+	size_t n);
+
+/**
+ * kirkland_write() - Write consecutive registers in order.
+ * @dev: The device.
+ * @offset: Byte offset of the first register.
+ * @vals: The values.
+ * @n: Number of registers.
+ *
+ * On the miscdev backend the driver's write rules apply; the RGB driver, for
+ * example, commits after every write.
+ *
+ * Return: 0, or a negative errno.
+ */
+int kirkland_write(struct kirkland_dev *dev, uint32_t offset,
+	const uint32_t *vals, size_t n);
+
+/**
+ * kirkland_read32() - Read one register.
+ * @dev: The device.
+ * @offset: Byte offset of the register.
+ * @val: Where to put the value.
+ *
+ * Return: 0, or a negative errno.
+ */
+static inline int kirkland_read32(struct kirkland_dev *dev, uint32_t offset,
+	uint32_t *val)
+{
+	return kirkland_read(dev, offset, val, 1);
+}
+
+/**
+ * kirkland_write32() - Write one register.
+ * @dev: The device.
+ * @offset: Byte offset of the register.
+ * @val: The value.
+ *
+ * Return: 0, or a negative errno.
+ */
+static inline int kirkland_write32(struct kirkland_dev *dev, uint32_t offset,
+	uint32_t val)
+{
+	return kirkland_write(dev, offset, &val, 1);
+}
+
+/*
+ * Typed calls. They all return 0 or a negative errno, and fail with -ENODEV
+ * if @dev is a different kind of component.
+ */
+
+// Set the RGB period and apply it.
+int kirkland_rgb_set_period(struct kirkland_dev *dev, uint32_t period);
+
+// Set all three RGB duty cycles and apply them together.
+int kirkland_rgb_set(struct kirkland_dev *dev, uint32_t red, uint32_t grn,
+	uint32_t blu);
+
+// Fade to new duty cycles, moving each channel by its step every period.
+int kirkland_rgb_fade(struct kirkland_dev *dev, const uint32_t duty[3],
+	const uint32_t step[3]);
+
+// Read commit_reg; see KIRKLAND_RGB_COMMIT_PENDING and KIRKLAND_RGB_RAMPING.
+int kirkland_rgb_status(struct kirkland_dev *dev, uint32_t *status);
+
+// Set the period the buzzer plays while its note FIFO is idle; 0 is silence.
+int kirkland_buzzer_set_period(struct kirkland_dev *dev, uint32_t period);
+
+// Queue a note in the buzzer's FIFO; a full FIFO drops it.
+int kirkland_buzzer_push_note(struct kirkland_dev *dev, uint32_t period,
+	uint32_t duration_clocks);
+
+// Read status_reg; see KIRKLAND_BUZZER_STATUS_*.
+int kirkland_buzzer_status(struct kirkland_dev *dev, uint32_t *status);
+
+// Drop every queued note.
+int kirkland_buzzer_flush(struct kirkland_dev *dev);
+
+// Set all three PWM duty cycles.
+int kirkland_pwm_set(struct kirkland_dev *dev, uint32_t red, uint32_t grn,
+	uint32_t blu);
+
+// Set the PWM period.
+int kirkland_pwm_set_period(struct kirkland_dev *dev, uint32_t period);
+
+// Read the latest value of all eight ADC channels.
+int kirkland_adc_read(struct kirkland_dev *dev,
+	uint16_t ch[KIRKLAND_ADC_CHANNELS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KIRKLAND_H */